@@ -0,0 +1,482 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Throughput of the CPU-side loops in src/nouveau_cpu.h, over a range of
+ * sizes and source alignments.  Prints one CSV line per case:
+ *
+ *   kernel,size,align,bytes,ns,mbps
+ *
+ * size is WxH in pixels (or entries for the bicubic table), align is the
+ * byte offset of the source from a 64 byte boundary, bytes is how much a
+ * single call writes, and ns is the best time per call over all rounds.
+ * Destinations are kept 64 byte aligned, as buffer object maps are.
+ *
+ * The *_refn and *_resident kernels run against test/'s mock libdrm.
+ * Operations reference the buffers they all use, like the front buffer,
+ * again each time in the _refn ones, and have them resident in the
+ * _resident ones, see nouveau_push_refn().  validate is only the pushbuf
+ * validation of an operation, its size is how many buffers every
+ * operation uses by how many operations go in a submission.  The
+ * composites are whole EXA operations, decoded by the mock, with the
+ * destination and NV30's vertex buffer as the resident ones.
+ *
+ * usage: nvbench [-k kernel] [-r rounds] [-t ms]
+ *   -k  only run kernels whose name contains this string
+ *   -r  rounds per case, default 5
+ *   -t  minimum time per round, default 20ms
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nouveau_cpu.h"
+#include "mock.h"
+
+struct bench_case {
+	const char *kernel;
+	int w, h;
+	int align;
+	unsigned char *src, *dst;
+	size_t bytes;
+	void (*run)(struct bench_case *);
+};
+
+static const int bench_align[] = { 0, 1, 4, 16 };
+
+static const struct { int w, h; } bench_video[] = {
+	{ 176, 144 }, { 320, 240 }, { 720, 576 }, { 1920, 1080 },
+};
+
+static const struct { int w, h; } bench_rect[] = {
+	{ 16, 16 }, { 64, 64 }, { 256, 256 }, { 1920, 1080 },
+};
+
+static const char *bench_filter;
+static int bench_rounds = 5;
+static int bench_ms = 20;
+static volatile uint32_t bench_sink;
+
+static uint64_t
+bench_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* YV12 source: w x h luma, then two w/2 x h/2 chroma planes */
+static void
+run_yv12_to_yuy2(struct bench_case *c)
+{
+	int w = c->w, h = c->h;
+	unsigned char *y = c->src, *u = y + w * h, *v = u + (w / 2) * (h / 2);
+
+	NVCopyData420(y, u, v, c->dst, w, w / 2, w * 2, h, w);
+}
+
+static void
+run_yv12_to_nv12(struct bench_case *c)
+{
+	int w = c->w, h = c->h;
+	unsigned char *y = c->src, *u = y + w * h, *v = u + (w / 2) * (h / 2);
+
+	NVCopyPackedLines(c->dst, y, w, w, h, w);
+	NVCopyNV12ColorPlanes(u, v, c->dst + w * h, w, w / 2, h, w);
+}
+
+static void
+run_packed(struct bench_case *c)
+{
+	NVCopyPackedLines(c->dst, c->src, c->w * 2, c->w * 2, c->h, c->w * 2);
+}
+
+static void
+run_shadow(struct bench_case *c)
+{
+	nouveau_cpu_copy_rect(c->dst, 2048 * 4, c->src, c->w * 4,
+			      c->w * 4, c->h);
+}
+
+static void
+run_cursor(struct bench_case *c)
+{
+	nouveau_cpu_convert_cursor((uint32_t *)c->dst,
+				   (const uint32_t *)c->src, 64, c->w);
+}
+
+static void
+run_bicubic(struct bench_case *c)
+{
+	NVXVBicubicTable((int8_t *)c->dst, c->w);
+}
+
+/* Every dword of a w x h 32bpp surface with 16 line tiles, as fb's wfb
+ * accessors would walk it, minus the pixmap lookup.
+ */
+static void
+run_wfb_rd(struct bench_case *c)
+{
+	unsigned pitch = c->w * 4;
+	uint64_t mf = (((1ULL << 36) - 1) / pitch) + 1;
+	unsigned long offset;
+	uint32_t bits, sum = 0;
+
+	for (offset = 0; offset < pitch * c->h; offset += 4) {
+		memcpy(&bits, c->src + nouveau_wfb_tiled_offset(offset, pitch,
+				mf, 4, pitch / 64), 4);
+		sum += bits;
+	}
+
+	bench_sink = sum;
+}
+
+static void
+run_wfb_wr(struct bench_case *c)
+{
+	unsigned pitch = c->w * 4;
+	uint64_t mf = (((1ULL << 36) - 1) / pitch) + 1;
+	unsigned long offset;
+
+	for (offset = 0; offset < pitch * c->h; offset += 4) {
+		memcpy(c->dst + nouveau_wfb_tiled_offset(offset, pitch, mf, 4,
+				pitch / 64), &offset, 4);
+	}
+}
+
+/* Pixmaps for the mock cases.  The first few are used by every
+ * operation, like the front buffer, the rest take turns as the source.
+ */
+#define BENCH_PIXMAPS 16
+
+static struct {
+	ScreenPtr pScreen;
+	NVPtr pNv;
+	PixmapPtr pix[BENCH_PIXMAPS];
+	PicturePtr ppict[BENCH_PIXMAPS];
+	int fixed, next;
+} bench_mock;
+
+static PixmapPtr
+bench_mock_source(int *i)
+{
+	*i = bench_mock.fixed + bench_mock.next++ %
+	     (BENCH_PIXMAPS - bench_mock.fixed);
+	return bench_mock.pix[*i];
+}
+
+/* Only what an operation does to have its buffers validated: w buffers
+ * every operation uses and a source, h operations per submission.
+ */
+static void
+run_validate(struct bench_case *c)
+{
+	NVPtr pNv = bench_mock.pNv;
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	int i;
+
+	PUSH_RESET(push);
+	for (i = 0; i < bench_mock.fixed; i++) {
+		nouveau_push_refn(pNv, nouveau_pixmap_bo(bench_mock.pix[i]),
+				  NOUVEAU_BO_VRAM | NOUVEAU_BO_RDWR);
+	}
+	nouveau_push_refn(pNv, nouveau_pixmap_bo(bench_mock_source(&i)),
+			  NOUVEAU_BO_VRAM | NOUVEAU_BO_RD);
+
+	nouveau_pushbuf_bufctx(push, pNv->bufctx);
+	nouveau_pushbuf_validate(push);
+	nouveau_pushbuf_bufctx(push, NULL);
+
+	if (!(bench_mock.next % c->h))
+		PUSH_KICK(push);
+}
+
+/* run_validate() with the resident bin referenced again after every
+ * kick, as nouveau_push_kick() used to.  With h at 1, there's one
+ * operation per submission, as for a client that flushes after every
+ * request, and this is what that cost each submission.
+ */
+static void
+run_requeue(struct bench_case *c)
+{
+	NVPtr pNv = bench_mock.pNv;
+	int i;
+
+	run_validate(c);
+	if (bench_mock.next % c->h)
+		return;
+
+	nouveau_bufctx_reset(pNv->bufctx, NOUVEAU_BIN_RESIDENT);
+	for (i = 0; i < pNv->resident_nr; i++) {
+		nouveau_bufctx_refn(pNv->bufctx, NOUVEAU_BIN_RESIDENT,
+				    pNv->resident[i], pNv->resident_access[i]);
+	}
+}
+
+/* A w x h composite to the first pixmap */
+static void
+run_composite(struct bench_case *c)
+{
+	PicturePtr pdpict = bench_mock.ppict[0];
+	PixmapPtr pdpix = bench_mock.pix[0], pspix;
+	int i;
+
+	pspix = bench_mock_source(&i);
+	mock_exa->CheckComposite(PictOpOver, bench_mock.ppict[i], NULL,
+				 pdpict);
+	mock_exa->PrepareComposite(PictOpOver, bench_mock.ppict[i], NULL,
+				   pdpict, pspix, NULL, pdpix);
+	mock_exa->Composite(pdpix, 0, 0, 0, 0, 0, 0, c->w, c->h);
+	mock_exa->DoneComposite(pdpix);
+	mock_finish();
+}
+
+static const struct {
+	const char *kernel;
+	uint32_t chipset;
+	int w, h, fixed;
+	void (*run)(struct bench_case *);
+} bench_mock_ops[] = {
+	{ "validate", 0xe4, 1, 64, 1, run_validate },
+	{ "validate", 0xe4, 2, 64, 2, run_validate },
+	{ "validate", 0xe4, 3, 64, 3, run_validate },
+	{ "submit", 0xe4, 1, 1, 1, run_validate },
+	{ "submit", 0xe4, 3, 1, 3, run_validate },
+	{ "submit_requeue", 0xe4, 1, 1, 1, run_requeue },
+	{ "submit_requeue", 0xe4, 3, 1, 3, run_requeue },
+	{ "nv40_composite", 0x46, 16, 16, 1, run_composite },
+	{ "nv50_composite", 0x50, 16, 16, 1, run_composite },
+	{ "nvc0_composite", 0xe4, 16, 16, 1, run_composite },
+};
+
+static void
+bench_mock_init(uint32_t chipset, int fixed, int resident)
+{
+	ScreenPtr pScreen = mock_screen(chipset, NULL);
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	int i;
+
+	bench_mock.pScreen = pScreen;
+	bench_mock.pNv = pNv;
+	bench_mock.fixed = fixed;
+	bench_mock.next = 0;
+	for (i = 0; i < BENCH_PIXMAPS; i++) {
+		bench_mock.pix[i] = mock_pixmap(pScreen, 64, 64, 32);
+		bench_mock.ppict[i] = mock_picture(bench_mock.pix[i],
+						   PICT_a8r8g8b8);
+	}
+
+	for (i = 0; resident && i < fixed; i++) {
+		nouveau_push_resident(pNv, nouveau_pixmap_bo(bench_mock.pix[i]),
+				      NOUVEAU_BO_VRAM | NOUVEAU_BO_RDWR);
+	}
+	if (!resident && pNv->vtxbuf)
+		nouveau_push_evict(pNv, pNv->vtxbuf);
+}
+
+static void
+bench_mock_fini(void)
+{
+	int i;
+
+	PUSH_KICK(bench_mock.pNv->pushbuf);
+	mock_finish();
+
+	for (i = 0; i < BENCH_PIXMAPS; i++) {
+		FreePicture(bench_mock.ppict[i], 0);
+		mock_pixmap_free(bench_mock.pix[i]);
+	}
+	mock_screen_fini(bench_mock.pScreen);
+
+	if (mock_errors) {
+		fprintf(stderr, "mock libdrm: %u errors\n", mock_errors);
+		exit(1);
+	}
+}
+
+static void
+bench_run(struct bench_case *c, size_t src_size, size_t dst_size)
+{
+	unsigned char *src, *dst;
+	uint64_t best = ~0ULL;
+	int round;
+
+	if (bench_filter && !strstr(c->kernel, bench_filter))
+		return;
+
+	if (posix_memalign((void **)&src, 64, src_size + 64) ||
+	    posix_memalign((void **)&dst, 64, dst_size + 64)) {
+		fprintf(stderr, "%s: out of memory\n", c->kernel);
+		exit(1);
+	}
+
+	memset(src, 0x5a, src_size + 64);
+	memset(dst, 0, dst_size + 64);
+	c->src = src + c->align;
+	c->dst = dst;
+
+	/* once to fault everything in */
+	c->run(c);
+
+	for (round = 0; round < bench_rounds; round++) {
+		uint64_t start = bench_ns(), end, calls = 0;
+
+		do {
+			c->run(c);
+			calls++;
+			end = bench_ns();
+		} while (end - start < bench_ms * 1000000ULL);
+
+		if ((end - start) / calls < best)
+			best = (end - start) / calls;
+	}
+
+	if (!best)
+		best = 1;
+
+	printf("%s,%dx%d,%d,%zu,%llu,%.1f\n", c->kernel, c->w, c->h,
+	       c->align, c->bytes, (unsigned long long)best,
+	       c->bytes * 1000.0 / best);
+	fflush(stdout);
+
+	free(src);
+	free(dst);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct bench_case c;
+	int opt, i, j;
+
+	while ((opt = getopt(argc, argv, "k:r:t:")) != -1) {
+		switch (opt) {
+		case 'k': bench_filter = optarg; break;
+		case 'r': bench_rounds = atoi(optarg); break;
+		case 't': bench_ms = atoi(optarg); break;
+		default:
+			goto usage;
+		}
+	}
+
+	if (optind != argc || bench_rounds < 1 || bench_ms < 1)
+		goto usage;
+
+	printf("kernel,size,align,bytes,ns,mbps\n");
+
+	for (i = 0; i < sizeof(bench_video) / sizeof(bench_video[0]); i++) {
+		for (j = 0; j < sizeof(bench_align) / sizeof(bench_align[0]);
+		     j++) {
+			int w = bench_video[i].w, h = bench_video[i].h;
+			size_t yv12 = w * h * 3 / 2, yuy2 = w * h * 2;
+
+			c = (struct bench_case) { "yv12_to_yuy2", w, h,
+				bench_align[j], NULL, NULL, yuy2,
+				run_yv12_to_yuy2 };
+			bench_run(&c, yv12, yuy2);
+
+			c = (struct bench_case) { "yv12_to_nv12", w, h,
+				bench_align[j], NULL, NULL, yv12,
+				run_yv12_to_nv12 };
+			bench_run(&c, yv12, yv12);
+
+			c = (struct bench_case) { "packed_lines", w, h,
+				bench_align[j], NULL, NULL, yuy2,
+				run_packed };
+			bench_run(&c, yuy2, yuy2);
+		}
+	}
+
+	for (i = 0; i < sizeof(bench_rect) / sizeof(bench_rect[0]); i++) {
+		for (j = 0; j < sizeof(bench_align) / sizeof(bench_align[0]);
+		     j++) {
+			int w = bench_rect[i].w, h = bench_rect[i].h;
+
+			c = (struct bench_case) { "shadow_refresh", w, h,
+				bench_align[j], NULL, NULL, w * h * 4,
+				run_shadow };
+			bench_run(&c, w * h * 4, 2048 * 4 * h);
+		}
+	}
+
+	for (i = 0; i < sizeof(bench_rect) / sizeof(bench_rect[0]); i++) {
+		int w = bench_rect[i].w, h = bench_rect[i].h;
+		size_t tiled = w * ((h + 15) & ~15) * 4;
+
+		/* the pitch has to be whole tiles */
+		if (w % 16)
+			continue;
+
+		c = (struct bench_case) { "wfb_rd_tiled", w, h, 0,
+			NULL, NULL, w * h * 4, run_wfb_rd };
+		bench_run(&c, tiled, 0);
+
+		c = (struct bench_case) { "wfb_wr_tiled", w, h, 0,
+			NULL, NULL, w * h * 4, run_wfb_wr };
+		bench_run(&c, 0, tiled);
+	}
+
+	for (i = 32; i <= 64; i *= 2) {
+		c = (struct bench_case) { "convert_cursor", i, i, 0,
+			NULL, NULL, i * i * 4, run_cursor };
+		bench_run(&c, i * i * 4, 64 * 64 * 4);
+	}
+
+	for (i = 64; i <= 512; i *= 2) {
+		c = (struct bench_case) { "bicubic_table", i, 1, 0,
+			NULL, NULL, i * 4, run_bicubic };
+		bench_run(&c, 0, i * 4);
+	}
+
+	for (i = 0; i < sizeof(bench_mock_ops) / sizeof(bench_mock_ops[0]);
+	     i++) {
+		for (j = 0; j < 2; j++) {
+			char kernel[64];
+
+			snprintf(kernel, sizeof(kernel), "%s_%s",
+				 bench_mock_ops[i].kernel,
+				 j ? "resident" : "refn");
+			if (bench_filter && !strstr(kernel, bench_filter))
+				continue;
+
+			bench_mock_init(bench_mock_ops[i].chipset,
+					bench_mock_ops[i].fixed, j);
+			c = (struct bench_case) { kernel,
+				bench_mock_ops[i].w, bench_mock_ops[i].h, 0,
+				NULL, NULL, 0, bench_mock_ops[i].run };
+			if (bench_mock_ops[i].run == run_composite)
+				c.bytes = c.w * c.h * 4;
+			bench_run(&c, 0, 0);
+			bench_mock_fini();
+		}
+	}
+
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-k kernel] [-r rounds] [-t ms]\n",
+		argv[0]);
+	return 1;
+}
@@ -38,6 +38,19 @@
 #define xf86ScrnToScreen(s) screenInfo.screens[(s)->scrnIndex]
 #endif
 
+/* GetTimeInMicros() came with the same server as XF86_SCRN_INTERFACE */
+#ifndef XF86_SCRN_INTERFACE
+#include <sys/time.h>
+static inline CARD64
+GetTimeInMicros(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (CARD64)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+#endif
+
 #ifndef XF86_SCRN_INTERFACE
 
 #define SCRN_ARG_TYPE int
@@ -34,6 +34,7 @@
 #include "xorgVersion.h"
 
 #include "nv_include.h"
+#include "nouveau_cpu.h"
 #include "xf86drmMode.h"
 #include "X11/Xatom.h"
 
@@ -540,18 +541,6 @@ drmmode_set_cursor_position (xf86CrtcPtr crtc, int x, int y)
 	drmModeMoveCursor(drmmode->fd, drmmode_crtc->mode_crtc->crtc_id, x, y);
 }
 
-static void
-convert_cursor(CARD32 *dst, CARD32 *src, int dw, int sw)
-{
-	int i, j;
-
-	for (j = 0;  j < sw; j++) {
-		for (i = 0; i < sw; i++) {
-			dst[j * dw + i] = src[j * sw + i];
-		}
-	}
-}
-
 static void
 drmmode_load_cursor_argb (xf86CrtcPtr crtc, CARD32 *image)
 {
@@ -561,7 +550,8 @@ drmmode_load_cursor_argb (xf86CrtcPtr crtc, CARD32 *image)
 	drmmode_ptr drmmode = drmmode_crtc->drmmode;
 
 	nouveau_bo_map(cursor, NOUVEAU_BO_WR, pNv->client);
-	convert_cursor(cursor->map, image, 64, nv_cursor_width(pNv));
+	nouveau_cpu_convert_cursor(cursor->map, image, 64,
+				   nv_cursor_width(pNv));
 
 	if (drmmode_crtc->cursor_visible) {
 		drmModeSetCursor(drmmode->fd, drmmode_crtc->mode_crtc->crtc_id,
@@ -1523,6 +1513,7 @@ drmmode_xf86crtc_resize(ScrnInfoPtr scrn, int width, int height)
 				       &pitch, &pNv->scanout);
 	if (!ret)
 		goto fail;
+	nouveau_push_replace(pNv, old_bo, pNv->scanout);
 
 	scrn->virtualX = width;
 	scrn->virtualY = height;
@@ -1580,6 +1571,8 @@ drmmode_xf86crtc_resize(ScrnInfoPtr scrn, int width, int height)
 	return TRUE;
 
  fail:
+	if (pNv->scanout)
+		nouveau_push_replace(pNv, pNv->scanout, old_bo);
 	nouveau_bo_ref(old_bo, &pNv->scanout);
 	scrn->virtualX = old_width;
 	scrn->virtualY = old_height;
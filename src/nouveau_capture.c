@@ -0,0 +1,175 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Pushbuf capture.  With Option "PushbufCapture" set to a file name, every
+ * submission on our channels is appended to that file, so the method
+ * streams the acceleration code emits can be looked at and compared
+ * offline, on machines without the GPU they were recorded on.
+ *
+ * nouveau_push.c already knows where each submission starts and ends,
+ * and hands them to us from its kick_notify, see nouveau_push_kick().
+ */
+
+#include <stdio.h>
+
+#include "nouveau_capture.h"
+
+static struct {
+	FILE *file;
+	int users;
+	int channels;
+} capture;
+
+static void
+nouveau_capture_write(uint32_t type, const uint32_t *head, size_t nhead,
+		      const uint32_t *data, size_t ndata)
+{
+	uint32_t rec[2] = { type, nhead + ndata };
+
+	if (fwrite(rec, 4, 2, capture.file) != 2 ||
+	    fwrite(head, 4, nhead, capture.file) != nhead ||
+	    (ndata && fwrite(data, 4, ndata, capture.file) != ndata)) {
+		ErrorF("nouveau: pushbuf capture failed, stopping\n");
+		fclose(capture.file);
+		capture.file = NULL;
+		return;
+	}
+	fflush(capture.file);
+}
+
+/* One submission on channel id, see nouveau_push_kick() */
+void
+nouveau_capture_push(int id, const uint32_t *data, size_t nr)
+{
+	uint32_t chan = id;
+
+	if (capture.file)
+		nouveau_capture_write(NOUVEAU_CAPTURE_PUSH, &chan, 1, data, nr);
+}
+
+static void
+nouveau_capture_object(uint32_t id, struct nouveau_object *obj)
+{
+	uint32_t data[3] = { id, 0, 0 };
+
+	if (!obj || !capture.file)
+		return;
+
+	data[1] = obj->handle;
+	data[2] = obj->oclass;
+	nouveau_capture_write(NOUVEAU_CAPTURE_OBJECT, data, 3, NULL, 0);
+}
+
+static int
+nouveau_capture_chan(NVPtr pNv, int which)
+{
+	struct nouveau_push_track *track = &pNv->push[which];
+
+	if (!track->push)
+		return -1;
+
+	/* start on a submission boundary */
+	PUSH_KICK(track->push);
+	track->capture = capture.channels++;
+	return track->capture;
+}
+
+Bool
+nouveau_capture_init(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	const char *name;
+	int id;
+
+	name = xf86GetOptValString(pNv->Options, OPTION_PUSHBUF_CAPTURE);
+	if (!name || !pNv->pushbuf)
+		return FALSE;
+
+	if (!capture.file) {
+		uint32_t head[3] = { NOUVEAU_CAPTURE_MAGIC,
+				     NOUVEAU_CAPTURE_VERSION,
+				     pNv->dev->chipset };
+
+		capture.file = fopen(name, "wb");
+		if (!capture.file ||
+		    fwrite(head, 4, 3, capture.file) != 3) {
+			xf86DrvMsg(pScrn->scrnIndex, X_ERROR,
+				   "[CAPTURE] couldn't open %s\n", name);
+			if (capture.file)
+				fclose(capture.file);
+			capture.file = NULL;
+			return FALSE;
+		}
+	}
+	capture.users++;
+
+	id = nouveau_capture_chan(pNv, NOUVEAU_PUSH_MAIN);
+	nouveau_capture_object(id, pNv->NvNull);
+	nouveau_capture_object(id, pNv->NvContextSurfaces);
+	nouveau_capture_object(id, pNv->NvContextBeta1);
+	nouveau_capture_object(id, pNv->NvContextBeta4);
+	nouveau_capture_object(id, pNv->NvImagePattern);
+	nouveau_capture_object(id, pNv->NvRop);
+	nouveau_capture_object(id, pNv->NvRectangle);
+	nouveau_capture_object(id, pNv->NvImageBlit);
+	nouveau_capture_object(id, pNv->NvScaledImage);
+	nouveau_capture_object(id, pNv->NvClipRectangle);
+	nouveau_capture_object(id, pNv->NvMemFormat);
+	nouveau_capture_object(id, pNv->NvImageFromCpu);
+	nouveau_capture_object(id, pNv->Nv2D);
+	nouveau_capture_object(id, pNv->Nv3D);
+	nouveau_capture_object(id, pNv->NvSW);
+	nouveau_capture_object(id, pNv->NvCOPY);
+
+	id = nouveau_capture_chan(pNv, NOUVEAU_PUSH_COPY);
+	if (id >= 0)
+		nouveau_capture_object(id, pNv->NvCopy);
+	id = nouveau_capture_chan(pNv, NOUVEAU_PUSH_COPY2);
+	if (id >= 0)
+		nouveau_capture_object(id, pNv->NvCopy2);
+
+	xf86DrvMsg(pScrn->scrnIndex, X_CONFIG,
+		   "[CAPTURE] recording submissions to %s\n", name);
+	return TRUE;
+}
+
+void
+nouveau_capture_fini(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	int i, found = 0;
+
+	for (i = 0; i < NOUVEAU_PUSH_TRACKS; i++) {
+		if (pNv->push[i].capture >= 0) {
+			pNv->push[i].capture = -1;
+			found = 1;
+		}
+	}
+
+	if (found && --capture.users == 0 && capture.file) {
+		fclose(capture.file);
+		capture.file = NULL;
+		capture.channels = 0;
+	}
+}
@@ -0,0 +1,23 @@
+#ifndef __NVDDX_CAPTURE_H__
+#define __NVDDX_CAPTURE_H__
+
+#include "nv_include.h"
+
+/* Capture file layout, everything in host-endian 32-bit words.  The file
+ * starts with a header, followed by records of the form { type, length }
+ * plus length words of payload:
+ *
+ * header: NOUVEAU_CAPTURE_MAGIC, NOUVEAU_CAPTURE_VERSION, chipset
+ * OBJECT: channel, handle, class - one per object bound on a channel
+ * PUSH:   channel, then the method stream of one submission
+ */
+#define NOUVEAU_CAPTURE_MAGIC   0x4e565042 /* "NVPB" */
+#define NOUVEAU_CAPTURE_VERSION 1
+#define NOUVEAU_CAPTURE_OBJECT  1
+#define NOUVEAU_CAPTURE_PUSH    2
+
+Bool nouveau_capture_init(ScreenPtr);
+void nouveau_capture_fini(ScreenPtr);
+void nouveau_capture_push(int, const uint32_t *, size_t);
+
+#endif
@@ -24,16 +24,332 @@
 
 #include "nouveau_copy.h"
 
+#include "hwdefs/nv_object.xml.h"
+#include "nvc0_accel.h"
+
+/* Transfers at least this large are split between both copy engines */
+#define COPY_SPLIT_SIZE (256 * 1024)
+
 void
 nouveau_copy_fini(ScreenPtr pScreen)
 {
 	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
 	NVPtr pNv = NVPTR(pScrn);
+	nouveau_bo_ref(NULL, &pNv->ce_sema);
+	nouveau_object_del(&pNv->NvCopy2);
+	nouveau_push_del(pNv, NOUVEAU_PUSH_COPY2);
+	nouveau_object_del(&pNv->ce_channel2);
 	nouveau_object_del(&pNv->NvCopy);
-	nouveau_pushbuf_del(&pNv->ce_pushbuf);
+	nouveau_push_del(pNv, NOUVEAU_PUSH_COPY);
 	nouveau_object_del(&pNv->ce_channel);
 }
 
+/* Ordering against the main channel.
+ *
+ * Commands sit in a channel's pushbuf until it's kicked, and the kernel
+ * can only order work it has seen.  If the main channel was kicked first,
+ * it could sample a pixmap before the upload to it had been submitted.
+ * Semaphores in a shared buffer order the two explicitly:
+ *
+ * - If the main pushbuf still holds commands for a buffer a transfer
+ *   touches, the main channel releases a new sequence number and is
+ *   kicked.  The copy channel acquires that number before the transfer.
+ * - Each transfer then releases a sequence number on the copy channel,
+ *   and the number is remembered for the buffers it touched.  The main
+ *   channel acquires it before it next uses any of them, see
+ *   nouveau_copy_sync().
+ *
+ * If there's no room for a semaphore method, the two channels are
+ * ordered the slow way instead: by submitting what's queued and waiting
+ * for the buffers on the CPU.
+ *
+ * This needs ACQUIRE_GEQUAL, so it's only done on Fermi and later.
+ */
+#define SEMA_MAIN    0x00
+#define SEMA_CE      0x10
+#define SEMA_CE2     0x20	/* see nouveau_copy_rect() */
+#define SEMA_ACQUIRE NV84_SUBCHAN_SEMAPHORE_TRIGGER_ACQUIRE_GEQUAL
+#define SEMA_RELEASE NV84_SUBCHAN_SEMAPHORE_TRIGGER_WRITE_LONG
+
+static Bool
+nouveau_copy_sema(NVPtr pNv, struct nouveau_pushbuf *push,
+		  unsigned offset, uint32_t seq, uint32_t trigger)
+{
+	struct nouveau_pushbuf_refn ref = {
+		pNv->ce_sema, NOUVEAU_BO_GART | NOUVEAU_BO_RDWR
+	};
+	uint64_t addr = pNv->ce_sema->offset + offset;
+
+	if (nouveau_push_space(push, 8, 0, 0) ||
+	    nouveau_pushbuf_refn (push, &ref, 1))
+		return FALSE;
+
+	/* host methods, the subchannel doesn't matter */
+	BEGIN_NVC0(push, NV84_SUBC(COPY, SEMAPHORE_ADDRESS_HIGH), 4);
+	PUSH_DATA (push, addr >> 32);
+	PUSH_DATA (push, addr);
+	PUSH_DATA (push, seq);
+	PUSH_DATA (push, trigger);
+	return TRUE;
+}
+
+static void
+nouveau_copy_fence(NVPtr pNv, struct nouveau_bo *bo, uint32_t seq)
+{
+	struct nouveau_copy_fence *fence = NULL;
+	int i;
+
+	for (i = 0; i < NOUVEAU_COPY_FENCES; i++) {
+		if (pNv->ce_fence[i].bo == bo) {
+			fence = &pNv->ce_fence[i];
+			break;
+		}
+	}
+
+	/* Forgetting a buffer means waiting for everything it could have
+	 * been waiting for, next time an unknown buffer is used.
+	 */
+	if (!fence) {
+		fence = &pNv->ce_fence[pNv->ce_fence_next++];
+		pNv->ce_fence_next %= NOUVEAU_COPY_FENCES;
+		if (pNv->ce_evicted < fence->seq)
+			pNv->ce_evicted = fence->seq;
+		fence->bo = bo;
+	}
+
+	fence->seq = seq;
+}
+
+/* Make the main channel wait for any transfer that touched the buffer
+ * before it's used there.  Called before the main channel references a
+ * buffer the copy engine could have written to (or still be reading).
+ */
+void
+nouveau_copy_sync(NVPtr pNv, struct nouveau_bo *bo)
+{
+	uint32_t seq = pNv->ce_evicted;
+	int i;
+
+	if (!pNv->ce_sema || !bo)
+		return;
+
+	for (i = 0; i < NOUVEAU_COPY_FENCES; i++) {
+		if (pNv->ce_fence[i].bo == bo) {
+			seq = pNv->ce_fence[i].seq;
+			break;
+		}
+	}
+
+	if (seq <= pNv->ce_acquired)
+		return;
+
+	/* the release has to be submitted before anyone waits on it */
+	PUSH_KICK(pNv->ce_pushbuf);
+	if (!nouveau_copy_sema(pNv, pNv->pushbuf, SEMA_CE, seq, SEMA_ACQUIRE)) {
+		nouveau_bo_wait(bo, NOUVEAU_BO_RDWR, pNv->client);
+		return;
+	}
+	pNv->ce_acquired = seq;
+}
+
+/* Make the copy channel wait for whatever the main pushbuf still has
+ * queued for either buffer.  Called before a transfer between them is
+ * put on the copy channel.
+ */
+void
+nouveau_copy_begin(NVPtr pNv, struct nouveau_bo *src, struct nouveau_bo *dst)
+{
+	uint32_t seq = pNv->ce_main_seq + 1;
+
+	if (!pNv->ce_sema)
+		return;
+
+	if (!nouveau_pushbuf_refd(pNv->pushbuf, src) &&
+	    !nouveau_pushbuf_refd(pNv->pushbuf, dst))
+		return;
+
+	if (nouveau_copy_sema(pNv, pNv->pushbuf, SEMA_MAIN, seq,
+			      SEMA_RELEASE))
+		pNv->ce_main_seq = seq;
+	PUSH_KICK(pNv->pushbuf);
+
+	if (pNv->ce_main_seq != seq ||
+	    !nouveau_copy_sema(pNv, pNv->ce_pushbuf, SEMA_MAIN, seq,
+			       SEMA_ACQUIRE)) {
+		nouveau_bo_wait(src, NOUVEAU_BO_RDWR, pNv->client);
+		nouveau_bo_wait(dst, NOUVEAU_BO_RDWR, pNv->client);
+	}
+}
+
+/* And have the main channel wait for the transfer before it next uses
+ * either buffer, see nouveau_copy_sync().  Called once it's on the copy
+ * channel.
+ */
+void
+nouveau_copy_end(NVPtr pNv, struct nouveau_bo *src, struct nouveau_bo *dst)
+{
+	if (!pNv->ce_sema)
+		return;
+
+	/* the release covers the other engine's half too, if there was one */
+	if (pNv->ce_joined != pNv->ce_seq2 &&
+	    nouveau_copy_sema(pNv, pNv->ce_pushbuf, SEMA_CE2, pNv->ce_seq2,
+			      SEMA_ACQUIRE))
+		pNv->ce_joined = pNv->ce_seq2;
+
+	if (pNv->ce_joined != pNv->ce_seq2 ||
+	    !nouveau_copy_sema(pNv, pNv->ce_pushbuf, SEMA_CE,
+			       pNv->ce_seq + 1, SEMA_RELEASE)) {
+		/* nothing for the main channel to wait on, finish it now */
+		PUSH_KICK(pNv->ce_pushbuf);
+		nouveau_bo_wait(dst, NOUVEAU_BO_RDWR, pNv->client);
+		return;
+	}
+
+	pNv->ce_seq++;
+	nouveau_copy_fence(pNv, src, pNv->ce_seq);
+	nouveau_copy_fence(pNv, dst, pNv->ce_seq);
+}
+
+/* Put the bottom h lines of a transfer on the second copy engine.  It
+ * waits for the main channel as the first one does (whatever the main
+ * channel released last covers this transfer), and releases a sequence
+ * number of its own that the first engine waits for before the transfer's
+ * release, see nouveau_copy_end().  Nothing is submitted here: the first
+ * engine's pushbuf is what gets kicked, and this one goes out with it.
+ */
+static Bool
+nouveau_copy_band(NVPtr pNv, int w, int h, int cpp,
+		  struct nouveau_bo *src, uint32_t src_off, int src_dom,
+		  int src_pitch, int src_h, int src_x, int src_y,
+		  struct nouveau_bo *dst, uint32_t dst_off, int dst_dom,
+		  int dst_pitch, int dst_h, int dst_x, int dst_y)
+{
+	struct nouveau_pushbuf *push = pNv->ce_pushbuf2;
+
+	if (!nouveau_copy_sema(pNv, push, SEMA_MAIN, pNv->ce_main_seq,
+			       SEMA_ACQUIRE) ||
+	    !pNv->ce_rect(push, pNv->NvCopy2, w, h, cpp,
+			  src, src_off, src_dom, src_pitch, src_h,
+			  src_x, src_y,
+			  dst, dst_off, dst_dom, dst_pitch, dst_h,
+			  dst_x, dst_y))
+		return FALSE;
+
+	if (!nouveau_copy_sema(pNv, push, SEMA_CE2, pNv->ce_seq2 + 1,
+			       SEMA_RELEASE)) {
+		/* nothing for the first engine to wait on, finish it now */
+		PUSH_KICK(push);
+		nouveau_bo_wait(dst, NOUVEAU_BO_RDWR, pNv->client);
+		return TRUE;
+	}
+
+	pNv->ce_seq2++;
+	return TRUE;
+}
+
+/* Copy a rect on the copy engine, between nouveau_copy_begin() and
+ * nouveau_copy_end() for the same buffers.
+ *
+ * Where there's a second copy engine, large rects are cut in two bands
+ * of lines, the bottom one queued on the second engine first, then the
+ * top one on the first.  If the bottom band can't be queued, the first
+ * engine does the whole rect.  The first engine's pushbuf is then the
+ * last to reference either buffer, which is what libdrm kicks when
+ * either is waited on.
+ */
+Bool
+nouveau_copy_rect(NVPtr pNv, int w, int h, int cpp,
+		  struct nouveau_bo *src, uint32_t src_off, int src_dom,
+		  int src_pitch, int src_h, int src_x, int src_y,
+		  struct nouveau_bo *dst, uint32_t dst_off, int dst_dom,
+		  int dst_pitch, int dst_h, int dst_x, int dst_y)
+{
+	int band = h / 2;
+
+	if (pNv->ce_pushbuf2 && pNv->ce_sema && band &&
+	    w * cpp * h >= COPY_SPLIT_SIZE &&
+	    nouveau_copy_band(pNv, w, h - band, cpp,
+			      src, src_off, src_dom, src_pitch, src_h,
+			      src_x, src_y + band,
+			      dst, dst_off, dst_dom, dst_pitch, dst_h,
+			      dst_x, dst_y + band))
+		h = band;
+
+	return pNv->ce_rect(pNv->ce_pushbuf, pNv->NvCopy, w, h, cpp,
+			    src, src_off, src_dom, src_pitch, src_h,
+			    src_x, src_y,
+			    dst, dst_off, dst_dom, dst_pitch, dst_h,
+			    dst_x, dst_y);
+}
+
+static void
+nouveau_copy_init_sema(NVPtr pNv)
+{
+	if (nouveau_bo_new(pNv->dev, NOUVEAU_BO_GART | NOUVEAU_BO_MAP, 0,
+			   4096, NULL, &pNv->ce_sema))
+		return;
+
+	if (nouveau_bo_map(pNv->ce_sema, NOUVEAU_BO_WR, pNv->client)) {
+		nouveau_bo_ref(NULL, &pNv->ce_sema);
+		return;
+	}
+
+	memset(pNv->ce_sema->map, 0, 4096);
+	memset(pNv->ce_fence, 0, sizeof(pNv->ce_fence));
+	pNv->ce_seq = 0;
+	pNv->ce_seq2 = 0;
+	pNv->ce_joined = 0;
+	pNv->ce_acquired = 0;
+	pNv->ce_evicted = 0;
+	pNv->ce_fence_next = 0;
+	pNv->ce_main_seq = 0;
+}
+
+/* Kepler and later have (at least) two copy engines, but a channel only
+ * ever runs on one of them.  The primary channel asks for CE0 or CE1 and
+ * gets the first, so a second channel pinned to CE1 gives transfers
+ * somewhere else to go.  Failing to get it isn't an error.
+ */
+static void
+nouveau_copy_init_split(ScrnInfoPtr pScrn)
+{
+	NVPtr pNv = NVPTR(pScrn);
+	struct nouveau_pushbuf *push;
+	int ret;
+
+	ret = nouveau_object_new(&pNv->dev->object, 0,
+				 NOUVEAU_FIFO_CHANNEL_CLASS,
+				 &(struct nve0_fifo) {
+					.engine = NVE0_FIFO_ENGINE_CE1,
+				 }, sizeof(struct nve0_fifo),
+				 &pNv->ce_channel2);
+	if (ret)
+		return;
+
+	ret = nouveau_push_new(pNv, NOUVEAU_PUSH_COPY2, pNv->ce_channel2);
+	if (ret == 0) {
+		ret = nouveau_object_new(pNv->ce_channel2,
+					 pNv->NvCopy->oclass,
+					 pNv->NvCopy->oclass, NULL, 0,
+					 &pNv->NvCopy2);
+	}
+
+	push = pNv->ce_pushbuf2;
+	if (ret || !PUSH_SPACE(push, 8)) {
+		nouveau_object_del(&pNv->NvCopy2);
+		nouveau_push_del(pNv, NOUVEAU_PUSH_COPY2);
+		nouveau_object_del(&pNv->ce_channel2);
+		return;
+	}
+
+	BEGIN_NVC0(push, NV01_SUBC(COPY, OBJECT), 1);
+	PUSH_DATA (push, pNv->NvCopy2->handle);
+
+	xf86DrvMsg(pScrn->scrnIndex, X_INFO,
+		   "[COPY] second copy engine available.\n");
+}
+
 Bool
 nouveau_copy_init(ScreenPtr pScreen)
 {
@@ -104,8 +420,7 @@ nouveau_copy_init(ScreenPtr pScreen)
 		return FALSE;
 	}
 
-	ret = nouveau_pushbuf_new(pNv->client, pNv->ce_channel, 4,
-				  32 * 1024, true, &pNv->ce_pushbuf);
+	ret = nouveau_push_new(pNv, NOUVEAU_PUSH_COPY, pNv->ce_channel);
 	if (ret) {
 		xf86DrvMsg(pScrn->scrnIndex, X_ERROR,
 			   "[COPY] error allocating pushbuf: %d\n", ret);
@@ -137,6 +452,21 @@ nouveau_copy_init(ScreenPtr pScreen)
 		return FALSE;
 	}
 
-	xf86DrvMsg(pScrn->scrnIndex, X_INFO, "[COPY] async initialised.\n");
+	if (pNv->Architecture >= NV_FERMI)
+		nouveau_copy_init_sema(pNv);
+	if (pNv->ce_sema && pNv->Architecture >= NV_KEPLER)
+		nouveau_copy_init_split(pScrn);
+
+	/* Without the semaphores, transfers are only ordered against the
+	 * main channel by the kernel's buffer fences, which don't cover
+	 * commands still sitting in either pushbuf.  Only use it there if
+	 * asked to.
+	 */
+	if (!pNv->ce_sema &&
+	    !xf86IsOptionSet(pNv->Options, OPTION_ASYNC_COPY))
+		pNv->ce_enabled = FALSE;
+
+	xf86DrvMsg(pScrn->scrnIndex, X_INFO, "[COPY] async initialised%s.\n",
+		   pNv->ce_enabled ? "" : ", but not used for transfers");
 	return TRUE;
 }
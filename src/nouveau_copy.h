@@ -6,6 +6,12 @@
 
 Bool nouveau_copy_init(ScreenPtr);
 void nouveau_copy_fini(ScreenPtr);
+void nouveau_copy_sync(NVPtr, struct nouveau_bo *);
+void nouveau_copy_begin(NVPtr, struct nouveau_bo *, struct nouveau_bo *);
+void nouveau_copy_end(NVPtr, struct nouveau_bo *, struct nouveau_bo *);
+Bool nouveau_copy_rect(NVPtr, int, int, int, struct nouveau_bo *, uint32_t,
+		       int, int, int, int, int, struct nouveau_bo *, uint32_t,
+		       int, int, int, int, int);
 
 Bool nouveau_copy85b5_init(NVPtr);
 Bool nouveau_copy90b5_init(NVPtr);
@@ -41,7 +41,7 @@ nouveau_copya0b5_rect(struct nouveau_pushbuf *push, struct nouveau_object *copy,
 	};
 	unsigned exec;
 
-	if (nouveau_pushbuf_space(push, 64, 0, 0) ||
+	if (nouveau_push_space(push, 64, 0, 0) ||
 	    nouveau_pushbuf_refn (push, refs, 2))
 		return FALSE;
 
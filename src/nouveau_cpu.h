@@ -0,0 +1,304 @@
+#ifndef __NVDDX_CPU_H__
+#define __NVDDX_CPU_H__
+
+/* Loops the driver runs on the CPU for every frame, cursor or shadow
+ * update.  Nothing in here may depend on the X server headers, so that
+ * bench/ can build them as they are.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+#ifndef X_BYTE_ORDER
+#define X_BIG_ENDIAN    4321
+#define X_LITTLE_ENDIAN 1234
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define X_BYTE_ORDER X_BIG_ENDIAN
+#else
+#define X_BYTE_ORDER X_LITTLE_ENDIAN
+#endif
+#endif
+
+/**
+ * NVCopyData420
+ * used to convert YV12 to YUY2 for the blitter and NV04 overlay.
+ * The U and V samples generated are linearly interpolated on the vertical
+ * axis for better quality
+ *
+ * @param src1 source buffer of luma
+ * @param src2 source buffer of chroma1
+ * @param src3 source buffer of chroma2
+ * @param dst1 destination buffer
+ * @param srcPitch pitch of src1
+ * @param srcPitch2 pitch of src2, src3
+ * @param dstPitch pitch of dst1
+ * @param h number of lines to copy
+ * @param w length of lines to copy
+ */
+static inline void
+NVCopyData420(unsigned char *src1, unsigned char *src2, unsigned char *src3,
+	      unsigned char *dst1, int srcPitch, int srcPitch2, int dstPitch,
+	      int h, int w)
+{
+	uint32_t *dst;
+	uint8_t *s1, *s2, *s3;
+	int i, j;
+
+#define su(X) (((j & 1) && j < (h-1)) ? ((unsigned)((signed int)s2[X] +        \
+		(signed int)(s2 + srcPitch2)[X]) / 2) : (s2[X]))
+#define sv(X) (((j & 1) && j < (h-1)) ? ((unsigned)((signed int)s3[X] +        \
+		(signed int)(s3 + srcPitch2)[X]) / 2) : (s3[X]))
+
+	w >>= 1;
+
+	for (j = 0; j < h; j++) {
+		dst = (uint32_t*)dst1;
+		s1 = src1;  s2 = src2;  s3 = src3;
+		i = w;
+
+		while (i > 4) {
+#if X_BYTE_ORDER == X_BIG_ENDIAN
+		dst[0] = (s1[0] << 24) | (s1[1] << 8) | (sv(0) << 16) | su(0);
+		dst[1] = (s1[2] << 24) | (s1[3] << 8) | (sv(1) << 16) | su(1);
+		dst[2] = (s1[4] << 24) | (s1[5] << 8) | (sv(2) << 16) | su(2);
+		dst[3] = (s1[6] << 24) | (s1[7] << 8) | (sv(3) << 16) | su(3);
+#else
+		dst[0] = s1[0] | (s1[1] << 16) | (sv(0) << 8) | (su(0) << 24);
+		dst[1] = s1[2] | (s1[3] << 16) | (sv(1) << 8) | (su(1) << 24);
+		dst[2] = s1[4] | (s1[5] << 16) | (sv(2) << 8) | (su(2) << 24);
+		dst[3] = s1[6] | (s1[7] << 16) | (sv(3) << 8) | (su(3) << 24);
+#endif
+		dst += 4; s2 += 4; s3 += 4; s1 += 8;
+		i -= 4;
+		}
+
+		while (i--) {
+#if X_BYTE_ORDER == X_BIG_ENDIAN
+		dst[0] = (s1[0] << 24) | (s1[1] << 8) | (sv(0) << 16) | su(0);
+#else
+		dst[0] = s1[0] | (s1[1] << 16) | (sv(0) << 8) | (su(0) << 24);
+#endif
+		dst++; s2++; s3++;
+		s1 += 2;
+		}
+
+		dst1 += dstPitch;
+		src1 += srcPitch;
+		if (j & 1) {
+			src2 += srcPitch2;
+			src3 += srcPitch2;
+		}
+	}
+
+#undef su
+#undef sv
+}
+
+/**
+ * NVCopyNV12ColorPlanes
+ * Used to convert YV12 color planes to NV12 (interleaved UV) for the overlay
+ *
+ * @param src1 source buffer of chroma1
+ * @param dst1 destination buffer
+ * @param h number of lines to copy
+ * @param w length of lines to copy
+ * @param id source pixel format (YV12 or I420)
+ */
+static inline void
+NVCopyNV12ColorPlanes(unsigned char *src1, unsigned char *src2,
+		      unsigned char *dst, int dstPitch, int srcPitch2,
+		      int h, int w)
+{
+	int i, j, l, e;
+
+	w >>= 1;
+	h >>= 1;
+#ifdef __SSE2__
+	l = w >> 3;
+	e = w & 7;
+#else
+	l = w >> 1;
+	e = w & 1;
+#endif
+
+	for (j = 0; j < h; j++) {
+		unsigned char *us = src1;
+		unsigned char *vs = src2;
+		unsigned int *vuvud = (unsigned int *) dst;
+		unsigned short *vud;
+
+		for (i = 0; i < l; i++) {
+#ifdef __SSE2__
+			_mm_storeu_si128(
+				(void*)vuvud,
+				_mm_unpacklo_epi8(
+					_mm_loadl_epi64((void*)vs),
+					_mm_loadl_epi64((void*)us)));
+			vuvud+=4;
+			us+=8;
+			vs+=8;
+#else /* __SSE2__ */
+#  if X_BYTE_ORDER == X_BIG_ENDIAN
+			*vuvud++ = (vs[0]<<24) | (us[0]<<16) | (vs[1]<<8) | us[1];
+#  else
+			*vuvud++ = vs[0] | (us[0]<<8) | (vs[1]<<16) | (us[1]<<24);
+#  endif
+			us+=2;
+			vs+=2;
+#endif /* __SSE2__ */
+		}
+
+		vud = (unsigned short *)vuvud;
+		for (i = 0; i < e; i++) {
+#if X_BYTE_ORDER == X_BIG_ENDIAN
+			vud[i] = us[i] | (vs[i]<<8);
+#else
+			vud[i] = vs[i] | (us[i]<<8);
+#endif
+		}
+
+		dst += dstPitch;
+		src1 += srcPitch2;
+		src2 += srcPitch2;
+	}
+
+}
+
+/**
+ * NVCopyPackedLines
+ * Copies h lines of a packed image (YUY2, RGB, or the luma plane of YV12)
+ * into the destination, a dword at a time.
+ *
+ * @param dst destination buffer
+ * @param src source buffer
+ * @param dstPitch pitch of dst
+ * @param srcPitch pitch of src
+ * @param h number of lines to copy
+ * @param bytes length of lines to copy
+ */
+static inline void
+NVCopyPackedLines(unsigned char *dst, const unsigned char *src,
+		  int dstPitch, int srcPitch, int h, int bytes)
+{
+	int i;
+
+	for (i = 0; i < h; i++) {
+		int dwords = bytes;
+
+		while (dwords & ~0x03) {
+			*dst = *src;
+			*(dst + 1) = *(src + 1);
+			*(dst + 2) = *(src + 2);
+			*(dst + 3) = *(src + 3);
+			dst += 4;
+			src += 4;
+			dwords -= 4;
+		}
+
+		switch (dwords) {
+		case 3: *(dst + 2) = *(src + 2); /* fall through */
+		case 2: *(dst + 1) = *(src + 1); /* fall through */
+		case 1: *dst = *src;
+		}
+
+		dst += dstPitch - bytes;
+		src += srcPitch - bytes;
+	}
+}
+
+/* The filtering function used for video scaling. We use a cubic filter as
+ * defined in  "Reconstruction Filters in Computer Graphics" Mitchell &
+ * Netravali in SIGGRAPH '88
+ */
+static inline float filter_func(float x)
+{
+	const double B=0.75;
+	const double C=(1.0-B)/2.0;
+	double x1=fabs(x);
+	double x2=fabs(x)*x1;
+	double x3=fabs(x)*x2;
+
+	if (fabs(x)<1.0)
+		return ( (12.0-9.0*B-6.0*C)*x3+(-18.0+12.0*B+6.0*C)*x2+(6.0-2.0*B) )/6.0;
+	else
+		return ( (-B-6.0*C)*x3+(6.0*B+30.0*C)*x2+(-12.0*B-48.0*C)*x1+(8.0*B+24.0*C) )/6.0;
+}
+
+static inline int8_t f32tosb8(float v)
+{
+	return (int8_t)(v*127.0);
+}
+
+/* Fill in size entries of the bicubic lookup texture, four bytes each */
+static inline void
+NVXVBicubicTable(int8_t *t, unsigned size)
+{
+	int i;
+
+	for(i = 0; i < size; i++) {
+		float  x = (i + 0.5) / size;
+		float w0 = filter_func(x+1.0);
+		float w1 = filter_func(x);
+		float w2 = filter_func(x-1.0);
+		float w3 = filter_func(x-2.0);
+
+		t[4*i+2]=f32tosb8(1.0+x-w1/(w0+w1));
+		t[4*i+1]=f32tosb8(1.0-x+w3/(w2+w3));
+		t[4*i+0]=f32tosb8(w0+w1);
+		t[4*i+3]=f32tosb8(0.0);
+	}
+}
+
+/* Where byte offset in a linear view of an NV50-style tiled surface
+ * really lives.  Tiles are 64 bytes wide and 1 << tile_height lines high,
+ * and multiply_factor is 2^36 / pitch, rounded up.
+ */
+static inline unsigned long
+nouveau_wfb_tiled_offset(unsigned long offset, unsigned pitch,
+			 uint64_t multiply_factor, unsigned tile_height,
+			 unsigned horiz_tiles)
+{
+	const unsigned tp = 6, th = tile_height;
+	int x, y;
+
+	y = (offset * multiply_factor) >> 36;
+	x = offset - y * pitch;
+
+	offset  = (x >> tp) + ((y >> th) * horiz_tiles);
+	offset *= (1 << (th + tp));
+	offset += ((y & ((1 << th) - 1)) << tp) + (x & ((1 << tp) - 1));
+	return offset;
+}
+
+/* Copy a width x height byte rectangle between two pitched buffers */
+static inline void
+nouveau_cpu_copy_rect(unsigned char *dst, int dstPitch,
+		      const unsigned char *src, int srcPitch,
+		      int width, int height)
+{
+	while(height--) {
+		memcpy(dst, src, width);
+		dst += dstPitch;
+		src += srcPitch;
+	}
+}
+
+/* Copy an sw x sw ARGB cursor image into a dw wide cursor buffer */
+static inline void
+nouveau_cpu_convert_cursor(uint32_t *dst, const uint32_t *src, int dw, int sw)
+{
+	int i, j;
+
+	for (j = 0;  j < sw; j++) {
+		for (i = 0; i < sw; i++) {
+			dst[j * dw + i] = src[j * sw + i];
+		}
+	}
+}
+
+#endif
@@ -101,6 +101,7 @@ nouveau_dri2_create_buffer2(ScreenPtr pScreen, DrawablePtr pDraw, unsigned int a
 			free(nvbuf);
 			return NULL;
 		}
+		nvpix->exported = TRUE;
 	}
 	return &nvbuf->base;
 }
@@ -262,6 +263,7 @@ update_front(DrawablePtr draw, DRI2BufferPtr front)
 		(*draw->pScreen->DestroyPixmap)(pixmap);
 		return FALSE;
 	}
+	nouveau_pixmap(pixmap)->exported = TRUE;
 
 	if (nvbuf->ppix)
 		(*draw->pScreen->DestroyPixmap)(nvbuf->ppix);
@@ -703,7 +705,7 @@ nouveau_dri2_finish_swap(DrawablePtr draw, unsigned int frame,
 		else
 			NV11SyncToVBlank(dst_pix, REGION_EXTENTS(0, &reg));
 
-		nouveau_pushbuf_kick(push, push->channel);
+		PUSH_KICK(push);
 	}
 
 	if (will_exchange) {
@@ -720,6 +722,8 @@ nouveau_dri2_finish_swap(DrawablePtr draw, unsigned int frame,
 
 		SWAP(s->dst->name, s->src->name);
 		SWAP(nouveau_pixmap(dst_pix)->bo, nouveau_pixmap(src_pix)->bo);
+		nouveau_pixmap_dirty(dst_pix);
+		nouveau_pixmap_dirty(src_pix);
 
 		DamageRegionProcessPending(draw);
 
@@ -1092,6 +1096,7 @@ static PixmapPtr nouveau_dri3_pixmap_from_fd(ScreenPtr screen, int fd, CARD16 wi
 	nouveau_bo_ref(NULL, &nvpix->bo);
 	nvpix->bo = bo;
 	nvpix->shared = (bo->flags & NOUVEAU_BO_APER) == NOUVEAU_BO_GART;
+	nvpix->exported = TRUE;
 	return pixmap;
 
 free_pixmap:
@@ -1106,6 +1111,7 @@ static int nouveau_dri3_fd_from_pixmap(ScreenPtr screen, PixmapPtr pixmap, CARD1
 
 	if (!bo || nouveau_bo_set_prime(bo, &fd) < 0)
 		return -EINVAL;
+	nouveau_pixmap(pixmap)->exported = TRUE;
 
 	*stride = pixmap->devKind;
 	*size = bo->size;
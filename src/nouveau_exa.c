@@ -21,8 +21,12 @@
  */
 
 #include "nv_include.h"
+#include "nouveau_copy.h"
+#include "nouveau_trace.h"
 #include "exa.h"
+#include <float.h>
 
+#include "hwdefs/nv_object.xml.h"
 #include "hwdefs/nv_m2mf.xml.h"
 
 static inline Bool
@@ -42,35 +46,354 @@ NVAccelMemcpyRect(char *dst, const char *src, int height, int dst_pitch,
 	return TRUE;
 }
 
-Bool
-NVAccelM2MF(NVPtr pNv, int w, int h, int cpp, uint32_t srcoff, uint32_t dstoff,
-	    struct nouveau_bo *src, int sd, int sp, int sh, int sx, int sy,
-	    struct nouveau_bo *dst, int dd, int dp, int dh, int dx, int dy)
+/* Transfer planning.  Each engine is modelled as a fixed cost to get a
+ * transfer started plus a throughput, kept separately for linear and
+ * tiled surfaces.  The copy engine runs its channel in order, so anything
+ * still queued on it counts against a new transfer too.
+ *
+ * Throughputs start from a guess and are refined from the GPU's own
+ * timer.  Some transfers are put between two host semaphore releases on
+ * the channel doing them, which write a timestamp once everything before
+ * them on the channel is done (Fermi and later).  So only the transfer is
+ * timed: not the kick, a wait for the other channel or the CPU.  The
+ * timestamps are picked up whenever they've landed, which lets uploads
+ * count as well as downloads.
+ *
+ * Only the engine a transfer went to learns anything from it.  So that
+ * neither model goes stale, an engine that hasn't been timed in a while
+ * gets the next transfer big enough to time, and the planner only
+ * changes its mind about an engine once the other is clearly cheaper.
+ */
+#define XFER_RATE		2048		/* bytes/us, GPU guess */
+#define XFER_CPU_RATE		4096		/* bytes/us, memcpy guess */
+#define XFER_SETUP_MAIN		5		/* us */
+#define XFER_SETUP_CE		40		/* us, own kick and fence */
+#define XFER_CHUNK_MIN		(64 * 1024)	/* bytes */
+#define XFER_CHUNK_MAX		(1024 * 1024)	/* bytes, a scratch buffer */
+#define XFER_SAMPLE_MIN		(64 * 1024)	/* bytes, smallest timed */
+#define XFER_SAMPLE_EVERY	8		/* time one in this many */
+#define XFER_PROBE		64		/* and each engine this often */
+
+/* A semaphore release: sequence, unused, 64-bit GPU timer in ns */
+struct nouveau_xfer_report {
+	uint32_t seq;
+	uint32_t pad;
+	uint64_t time;
+};
+
+static void
+nouveau_exa_xfer_init(NVPtr pNv)
+{
+	int i, j;
+
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < 2; j++) {
+			pNv->xfer_rate[i][j] = XFER_RATE;
+			pNv->xfer_age[i][j] = 0;
+		}
+		pNv->xfer_last[i] = NOUVEAU_XFER_MAIN;
+	}
+	pNv->xfer_cpu_rate = XFER_CPU_RATE;
+	pNv->xfer_queued = 0;
+	pNv->xfer_stamp = GetTimeInMicros();
+	pNv->xfer_count = 0;
+	pNv->xfer_head = 0;
+	pNv->xfer_tail = 0;
+	pNv->xfer_seq = 0;
+
+	/* without timestamps, the guesses stay */
+	if (pNv->Architecture < NV_FERMI)
+		return;
+
+	if (nouveau_bo_new(pNv->dev, NOUVEAU_BO_GART | NOUVEAU_BO_MAP, 0,
+			   NOUVEAU_XFER_SAMPLES * 2 *
+			   sizeof(struct nouveau_xfer_report),
+			   NULL, &pNv->xfer_bo))
+		return;
+
+	if (nouveau_bo_map(pNv->xfer_bo, NOUVEAU_BO_RDWR, pNv->client)) {
+		nouveau_bo_ref(NULL, &pNv->xfer_bo);
+		return;
+	}
+
+	memset(pNv->xfer_bo->map, 0, pNv->xfer_bo->size);
+}
+
+static Bool
+nouveau_exa_xfer_tiled(NVPtr pNv, struct nouveau_bo *bo)
+{
+	if (pNv->Architecture >= NV_FERMI)
+		return bo->config.nvc0.memtype != 0;
+	if (pNv->Architecture >= NV_TESLA)
+		return bo->config.nv50.memtype != 0;
+	return bo->config.nv04.surf_flags != 0;
+}
+
+/* Feed the throughput of every timed transfer that has finished into its
+ * engine's model, oldest first
+ */
+static void
+nouveau_exa_xfer_resolve(NVPtr pNv)
+{
+	struct nouveau_xfer_report *report;
+
+	if (!pNv->xfer_bo)
+		return;
+	report = pNv->xfer_bo->map;
+
+	while (pNv->xfer_tail != pNv->xfer_head) {
+		unsigned i = pNv->xfer_tail % NOUVEAU_XFER_SAMPLES;
+		struct nouveau_xfer_sample *sample = &pNv->xfer_sample[i];
+		int *rate = &pNv->xfer_rate[sample->engine][sample->tiled];
+		uint64_t ns;
+
+		if (report[i * 2 + 0].seq != sample->seq ||
+		    report[i * 2 + 1].seq != sample->seq)
+			break;
+
+		ns = report[i * 2 + 1].time - report[i * 2 + 0].time;
+		if (ns)
+			*rate = (*rate * 7 +
+				 max(sample->bytes * 1000ULL / ns, 1)) / 8;
+		pNv->xfer_tail++;
+	}
+}
+
+/* Write a GPU timestamp into report slot once the channel is idle */
+static Bool
+nouveau_exa_xfer_stamp(NVPtr pNv, struct nouveau_pushbuf *push,
+		       unsigned slot, uint32_t seq)
+{
+	struct nouveau_pushbuf_refn ref = {
+		pNv->xfer_bo, NOUVEAU_BO_GART | NOUVEAU_BO_WR
+	};
+	uint64_t addr = pNv->xfer_bo->offset +
+			slot * sizeof(struct nouveau_xfer_report);
+
+	if (!PUSH_SPACE(push, 8) || nouveau_pushbuf_refn(push, &ref, 1))
+		return FALSE;
+
+	/* host methods, the subchannel doesn't matter */
+	BEGIN_NVC0(push, 0, NV84_SUBCHAN_SEMAPHORE_ADDRESS_HIGH, 4);
+	PUSH_DATA (push, addr >> 32);
+	PUSH_DATA (push, addr);
+	PUSH_DATA (push, seq);
+	PUSH_DATA (push, NV84_SUBCHAN_SEMAPHORE_TRIGGER_WRITE_LONG);
+	return TRUE;
+}
+
+/* Start timing a transfer of this many bytes on push, if it's one of
+ * those to be timed.  Returns its sample, or -1.
+ */
+static int
+nouveau_exa_xfer_begin(NVPtr pNv, struct nouveau_pushbuf *push,
+		       const struct nouveau_xfer_plan *plan, int bytes)
 {
-	if (pNv->ce_rect && pNv->ce_enabled)
-		return pNv->ce_rect(pNv->ce_pushbuf, pNv->NvCopy, w, h, cpp,
-				    src, srcoff, sd, sp, sh, sx, sy,
-				    dst, dstoff, dd, dp, dh, dx, dy);
+	struct nouveau_xfer_sample *sample;
+	unsigned i = pNv->xfer_head % NOUVEAU_XFER_SAMPLES;
+
+	if (!pNv->xfer_bo || bytes < XFER_SAMPLE_MIN ||
+	    pNv->xfer_head - pNv->xfer_tail == NOUVEAU_XFER_SAMPLES)
+		return -1;
+	if (!plan->probe && pNv->xfer_count++ % XFER_SAMPLE_EVERY)
+		return -1;
+
+	if (!nouveau_exa_xfer_stamp(pNv, push, i * 2 + 0, ++pNv->xfer_seq))
+		return -1;
+
+	sample = &pNv->xfer_sample[i];
+	sample->seq = pNv->xfer_seq;
+	sample->engine = plan->engine;
+	sample->tiled = plan->tiled;
+	sample->bytes = bytes;
+	pNv->xfer_age[plan->engine][plan->tiled] = 0;
+	return i;
+}
+
+/* Without room for the second timestamp, the sample is dropped */
+static void
+nouveau_exa_xfer_end(NVPtr pNv, struct nouveau_pushbuf *push, int i)
+{
+	if (i < 0)
+		return;
+
+	if (nouveau_exa_xfer_stamp(pNv, push, i * 2 + 1,
+				   pNv->xfer_sample[i].seq))
+		pNv->xfer_head++;
+}
+
+static int
+nouveau_exa_xfer_engine(NVPtr pNv, struct nouveau_xfer_plan *plan,
+			int bytes)
+{
+	CARD64 now = GetTimeInMicros(), drained;
+	int tiled = plan->tiled, cost_main, cost_ce, i;
+
+	if (!pNv->ce_rect || !pNv->ce_enabled)
+		return NOUVEAU_XFER_MAIN;
+
+	drained = (now - pNv->xfer_stamp) * pNv->xfer_rate[NOUVEAU_XFER_CE][0];
+	if (drained >= pNv->xfer_queued)
+		pNv->xfer_queued = 0;
 	else
+		pNv->xfer_queued -= drained;
+	pNv->xfer_stamp = now;
+
+	if (pNv->xfer_bo && bytes >= XFER_SAMPLE_MIN) {
+		for (i = 0; i < 2; i++)
+			pNv->xfer_age[i][tiled]++;
+		for (i = 0; i < 2; i++) {
+			if (pNv->xfer_age[i][tiled] > XFER_PROBE) {
+				pNv->xfer_age[i][tiled] = 0;
+				plan->probe = TRUE;
+				return i;
+			}
+		}
+	}
+
+	cost_main = bytes / pNv->xfer_rate[NOUVEAU_XFER_MAIN][tiled];
+	cost_main += XFER_SETUP_MAIN;
+	cost_ce = pNv->xfer_queued + bytes;
+	cost_ce /= pNv->xfer_rate[NOUVEAU_XFER_CE][tiled];
+	cost_ce += XFER_SETUP_CE;
+
+	/* a margin against whichever engine wasn't picked last time */
+	if (pNv->xfer_last[tiled] == NOUVEAU_XFER_CE)
+		cost_main += cost_main / 8;
+	else
+		cost_ce += cost_ce / 8;
+
+	pNv->xfer_last[tiled] = cost_ce < cost_main ? NOUVEAU_XFER_CE :
+						     NOUVEAU_XFER_MAIN;
+	return pNv->xfer_last[tiled];
+}
+
+/* Pick the engine for a transfer of h lines of pitch bytes, and how to
+ * cut it into chunks when it goes through the GART scratch buffer.
+ *
+ * With n chunks, the GPU copies one while the CPU fills or reads out
+ * another, so all that doesn't overlap is a chunk's worth of whichever
+ * side is quicker.  But every chunk pays the engine's setup cost again.
+ * The total, max(gpu, cpu) + min(gpu, cpu) / n + n * setup, is lowest
+ * at n = sqrt(min(gpu, cpu) / setup).  Enough chunks are kept in flight
+ * to hide the setup of the next behind the one being copied.
+ */
+static void
+nouveau_exa_xfer_plan(NVPtr pNv, struct nouveau_xfer_plan *plan,
+		      int pitch, int h, Bool tiled)
+{
+	int bytes = pitch * h, gpu, cpu, setup, n;
+
+	nouveau_exa_xfer_resolve(pNv);
+
+	plan->tiled = tiled;
+	plan->probe = FALSE;
+	plan->engine = nouveau_exa_xfer_engine(pNv, plan, bytes);
+
+	setup = plan->engine == NOUVEAU_XFER_CE ? XFER_SETUP_CE :
+						  XFER_SETUP_MAIN;
+	gpu = bytes / pNv->xfer_rate[plan->engine][tiled];
+	cpu = bytes / pNv->xfer_cpu_rate;
+
+	for (n = 1; n * n * setup < min(gpu, cpu); n++)
+		;
+	n = min(n, max(1, bytes / XFER_CHUNK_MIN));
+	n = max(n, (bytes + XFER_CHUNK_MAX - 1) / XFER_CHUNK_MAX);
+
+	plan->lines = (h + n - 1) / n;
+	plan->lines = max(1, min(plan->lines, XFER_CHUNK_MAX / pitch));
+	n = (h + plan->lines - 1) / plan->lines;
+
+	plan->depth = 1 + (setup * n + gpu - 1) / max(gpu, 1);
+	plan->depth = min(max(plan->depth, 2), NOUVEAU_XFER_DEPTH);
+	plan->depth = min(plan->depth, n);
+}
+
+/* Feed back how long the CPU took to copy this many bytes in or out */
+static void
+nouveau_exa_xfer_cpu(NVPtr pNv, int bytes, CARD64 start)
+{
+	int us = GetTimeInMicros() - start;
+
+	if (bytes < XFER_SAMPLE_MIN || us <= 0)
+		return;
+	pNv->xfer_cpu_rate = (pNv->xfer_cpu_rate * 7 +
+			      max(bytes / us, 1)) / 8;
+}
+
+/* Move a rect on the planned engine, timing it if it's one to be timed */
+static Bool
+nouveau_exa_xfer_rect(NVPtr pNv, const struct nouveau_xfer_plan *plan,
+		      int w, int h, int cpp, uint32_t srcoff, uint32_t dstoff,
+		      struct nouveau_bo *src, int sd, int sp, int sh,
+		      int sx, int sy,
+		      struct nouveau_bo *dst, int dd, int dp, int dh,
+		      int dx, int dy)
+{
+	int bytes = w * h * cpp, sample;
+	Bool ret;
+
+	pNv->xfer_engine = plan->engine;
+
+	if (plan->engine == NOUVEAU_XFER_CE) {
+		pNv->xfer_queued += bytes;
+		nouveau_copy_begin(pNv, src, dst);
+		sample = nouveau_exa_xfer_begin(pNv, pNv->ce_pushbuf, plan,
+						bytes);
+		ret = nouveau_copy_rect(pNv, w, h, cpp,
+					src, srcoff, sd, sp, sh, sx, sy,
+					dst, dstoff, dd, dp, dh, dx, dy);
+		if (ret)
+			nouveau_exa_xfer_end(pNv, pNv->ce_pushbuf, sample);
+		nouveau_copy_end(pNv, src, dst);
+		return ret;
+	}
+
+	/* either may still be in use by an earlier copy engine transfer */
+	nouveau_copy_sync(pNv, src);
+	nouveau_copy_sync(pNv, dst);
+
+	sample = nouveau_exa_xfer_begin(pNv, pNv->pushbuf, plan, bytes);
+
+	/* Option "GPUTiming" only covers the main channel */
+	nouveau_timing_begin(pNv, NOUVEAU_TIMING_M2MF);
 	if (pNv->Architecture >= NV_KEPLER)
-		return NVE0EXARectCopy(pNv, w, h, cpp,
-				       src, srcoff, sd, sp, sh, sx, sy,
-				       dst, dstoff, dd, dp, dh, dx, dy);
+		ret = NVE0EXARectCopy(pNv, w, h, cpp,
+				      src, srcoff, sd, sp, sh, sx, sy,
+				      dst, dstoff, dd, dp, dh, dx, dy);
 	else
 	if (pNv->Architecture >= NV_FERMI)
-		return NVC0EXARectM2MF(pNv, w, h, cpp,
-				       src, srcoff, sd, sp, sh, sx, sy,
-				       dst, dstoff, dd, dp, dh, dx, dy);
+		ret = NVC0EXARectM2MF(pNv, w, h, cpp,
+				      src, srcoff, sd, sp, sh, sx, sy,
+				      dst, dstoff, dd, dp, dh, dx, dy);
 	else
 	if (pNv->Architecture >= NV_TESLA)
-		return NV50EXARectM2MF(pNv, w, h, cpp,
-				       src, srcoff, sd, sp, sh, sx, sy,
-				       dst, dstoff, dd, dp, dh, dx, dy);
+		ret = NV50EXARectM2MF(pNv, w, h, cpp,
+				      src, srcoff, sd, sp, sh, sx, sy,
+				      dst, dstoff, dd, dp, dh, dx, dy);
 	else
-		return NV04EXARectM2MF(pNv, w, h, cpp,
-				       src, srcoff, sd, sp, sh, sx, sy,
-				       dst, dstoff, dd, dp, dh, dx, dy);
-	return FALSE;
+		ret = NV04EXARectM2MF(pNv, w, h, cpp,
+				      src, srcoff, sd, sp, sh, sx, sy,
+				      dst, dstoff, dd, dp, dh, dx, dy);
+	nouveau_timing_end(pNv);
+	if (ret)
+		nouveau_exa_xfer_end(pNv, pNv->pushbuf, sample);
+	return ret;
+}
+
+Bool
+NVAccelM2MF(NVPtr pNv, int w, int h, int cpp, uint32_t srcoff, uint32_t dstoff,
+	    struct nouveau_bo *src, int sd, int sp, int sh, int sx, int sy,
+	    struct nouveau_bo *dst, int dd, int dp, int dh, int dx, int dy)
+{
+	struct nouveau_xfer_plan plan;
+
+	nouveau_exa_xfer_plan(pNv, &plan, w * cpp, h,
+			      nouveau_exa_xfer_tiled(pNv, src) ||
+			      nouveau_exa_xfer_tiled(pNv, dst));
+	return nouveau_exa_xfer_rect(pNv, &plan, w, h, cpp, srcoff, dstoff,
+				     src, sd, sp, sh, sx, sy,
+				     dst, dd, dp, dh, dx, dy);
 }
 
 static int
@@ -92,8 +415,11 @@ nouveau_exa_prepare_access(PixmapPtr ppix, int index)
 
 	if (nv50_style_tiled_pixmap(ppix) && !pNv->wfb_enabled)
 		return FALSE;
+	nouveau_copy_sync(pNv, bo);
 	if (nouveau_bo_map(bo, NOUVEAU_BO_RDWR, pNv->client))
 		return FALSE;
+	if (index != EXA_PREPARE_SRC && index != EXA_PREPARE_MASK)
+		nouveau_pixmap_dirty(ppix);
 	ppix->devPrivate.ptr = bo->map;
 	return TRUE;
 }
@@ -206,6 +532,590 @@ nv50_style_tiled_pixmap(PixmapPtr ppix)
 	       nouveau_pixmap_bo(ppix)->config.nv50.memtype;
 }
 
+static Bool
+nouveau_exa_pixel_argb(uint32_t pixel, PictFormatShort format, uint32_t *argb)
+{
+	uint32_t r, g, b;
+
+	switch (format) {
+	case PICT_a8r8g8b8:
+		*argb = pixel;
+		break;
+	case PICT_x8r8g8b8:
+		*argb = pixel | 0xff000000;
+		break;
+	case PICT_a8b8g8r8:
+	case PICT_x8b8g8r8:
+		*argb = (pixel & 0xff00ff00) |
+			((pixel & 0x00ff0000) >> 16) |
+			((pixel & 0x000000ff) << 16);
+		if (format == PICT_x8b8g8r8)
+			*argb |= 0xff000000;
+		break;
+	case PICT_r5g6b5:
+		r = (pixel >> 11) & 0x1f;
+		g = (pixel >>  5) & 0x3f;
+		b = (pixel >>  0) & 0x1f;
+		*argb = 0xff000000 |
+			(((r << 3) | (r >> 2)) << 16) |
+			(((g << 2) | (g >> 4)) <<  8) |
+			(((b << 3) | (b >> 2)) <<  0);
+		break;
+	case PICT_a8:
+		*argb = (pixel & 0xff) << 24;
+		break;
+	default:
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static Bool
+nouveau_exa_argb_pixel(uint32_t argb, PictFormatShort format, uint32_t *pixel)
+{
+	switch (format) {
+	case PICT_a8r8g8b8:
+	case PICT_x8r8g8b8:
+		*pixel = argb;
+		break;
+	case PICT_a8b8g8r8:
+	case PICT_x8b8g8r8:
+		*pixel = (argb & 0xff00ff00) |
+			 ((argb & 0x00ff0000) >> 16) |
+			 ((argb & 0x000000ff) << 16);
+		break;
+	case PICT_r5g6b5:
+		*pixel = ((argb & 0x00f80000) >> 8) |
+			 ((argb & 0x0000fc00) >> 5) |
+			 ((argb & 0x000000f8) >> 3);
+		break;
+	case PICT_a8:
+		*pixel = argb >> 24;
+		break;
+	default:
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* A picture backed by a repeating 1x1 pixmap samples the same colour
+ * everywhere, whatever its transform or filter, so it can be handled like
+ * a SourcePictTypeSolidFill and skip texturing entirely.  Returns TRUE and
+ * the colour as a8r8g8b8 if ppict is solid in either sense.
+ *
+ * The pixel is read back the first time the pixmap is used like this, and
+ * cached until nouveau_pixmap_dirty() is called on it.  Pixmaps that other
+ * clients can write to are never cached.
+ */
+Bool
+nouveau_exa_pict_solid(PixmapPtr ppix, PicturePtr ppict, uint32_t *argb)
+{
+	struct nouveau_pixmap *nvpix;
+	NVPtr pNv;
+	void *map;
+
+	if (!ppict)
+		return FALSE;
+
+	if (!ppict->pDrawable) {
+		if (ppict->pSourcePict->type != SourcePictTypeSolidFill)
+			return FALSE;
+		*argb = ppict->pSourcePict->solidFill.color;
+		return TRUE;
+	}
+
+	if (!ppix || ppict->pDrawable->type != DRAWABLE_PIXMAP ||
+	    ppix->drawable.width != 1 || ppix->drawable.height != 1 ||
+	    !ppict->repeat || ppict->repeatType == RepeatNone ||
+	    ppict->alphaMap)
+		return FALSE;
+
+	nvpix = nouveau_pixmap(ppix);
+	if (!nvpix || !nvpix->bo || nvpix->shared || nvpix->exported)
+		return FALSE;
+
+	if (!nvpix->solid_valid) {
+		pNv = NVPTR(xf86ScreenToScrn(ppix->drawable.pScreen));
+
+		/* This waits for any pending rendering to the pixmap.  The
+		 * first pixel is at offset 0 for every tiling layout.
+		 */
+		if (nouveau_bo_map(nvpix->bo, NOUVEAU_BO_RD, pNv->client))
+			return FALSE;
+		map = nvpix->bo->map;
+
+		switch (ppix->drawable.bitsPerPixel) {
+		case 32: nvpix->solid = *(uint32_t *)map; break;
+		case 16: nvpix->solid = *(uint16_t *)map; break;
+		case  8: nvpix->solid = *(uint8_t  *)map; break;
+		default:
+			return FALSE;
+		}
+		nvpix->solid_valid = TRUE;
+	}
+
+	return nouveau_exa_pixel_argb(nvpix->solid, ppict->format, argb);
+}
+
+/* Whether a picture too large for the 3D engine's textures can still be
+ * composited a window at a time (see nouveau_exa_pict_window()), which
+ * needs every destination pixel to sample from well within 'limit'
+ * texels of the source.
+ */
+Bool
+nouveau_exa_pict_splittable(PicturePtr ppict, int limit)
+{
+	PictTransformPtr t = ppict->transform;
+	float w;
+
+	if (!t)
+		return TRUE;
+
+	if (t->matrix[2][0] || t->matrix[2][1] || t->matrix[2][2] <= 0)
+		return FALSE;
+	w = xFixedToFloat(t->matrix[2][2]);
+
+	return (fabsf(xFixedToFloat(t->matrix[0][0])) +
+		fabsf(xFixedToFloat(t->matrix[0][1]))) / w < limit / 2 &&
+	       (fabsf(xFixedToFloat(t->matrix[1][0])) +
+		fabsf(xFixedToFloat(t->matrix[1][1]))) / w < limit / 2;
+}
+
+/* Find the part of an oversized picture the destination rect x,y,w,h
+ * (in the picture's untransformed space) samples from, rounded out to
+ * the same alignment EXA gives pixmaps so it can be bound as a texture
+ * of its own.  Returns FALSE if that's more than 'limit' texels across.
+ */
+Bool
+nouveau_exa_pict_window(PixmapPtr ppix, PicturePtr ppict, int limit,
+			int x, int y, int w, int h,
+			struct nouveau_exa_window *win)
+{
+	PictTransformPtr t = ppict->transform;
+	int pw = ppict->pDrawable->width;
+	int ph = ppict->pDrawable->height;
+	int cpp = ppix->drawable.bitsPerPixel / 8;
+	float x1 = x, y1 = y, x2 = x + w, y2 = y + h;
+	int ix1, iy1, ix2, iy2, i;
+
+	if (t) {
+		x1 = y1 = FLT_MAX;
+		x2 = y2 = -FLT_MAX;
+
+		for (i = 0; i < 4; i++) {
+			float cx = (i & 1) ? x + w : x;
+			float cy = (i & 2) ? y + h : y;
+			float tx, ty, tw;
+
+			tw = xFixedToFloat(t->matrix[2][0]) * cx +
+			     xFixedToFloat(t->matrix[2][1]) * cy +
+			     xFixedToFloat(t->matrix[2][2]);
+			if (tw <= 0)
+				return FALSE;
+			tx = (xFixedToFloat(t->matrix[0][0]) * cx +
+			      xFixedToFloat(t->matrix[0][1]) * cy +
+			      xFixedToFloat(t->matrix[0][2])) / tw;
+			ty = (xFixedToFloat(t->matrix[1][0]) * cx +
+			      xFixedToFloat(t->matrix[1][1]) * cy +
+			      xFixedToFloat(t->matrix[1][2])) / tw;
+
+			x1 = min(x1, tx);
+			y1 = min(y1, ty);
+			x2 = max(x2, tx);
+			y2 = max(y2, ty);
+		}
+	}
+
+	/* an extra texel either side for bilinear filtering, and anything
+	 * outside the picture is clamped to its edge so needn't be included
+	 */
+	ix1 = max(0, min(pw - 1, (int)floorf(x1) - 1));
+	iy1 = max(0, min(ph - 1, (int)floorf(y1) - 1));
+	ix2 = max(ix1 + 1, min(pw, (int)ceilf(x2) + 1));
+	iy2 = max(iy1 + 1, min(ph, (int)ceilf(y2) + 1));
+
+	/* pitches are 64-byte aligned, so 4 rows keep the offset aligned */
+	ix1 &= ~((256 / cpp) - 1);
+	iy1 &= ~3;
+	if (ix2 - ix1 > limit || iy2 - iy1 > limit)
+		return FALSE;
+
+	win->x = ix1;
+	win->y = iy1;
+	win->w = min(pw - ix1, limit);
+	win->h = min(ph - iy1, limit);
+	win->offset = iy1 * exaGetPixmapPitch(ppix) + ix1 * cpp;
+	return TRUE;
+}
+
+/* The picture's transform as a 4x4 texture matrix for the fixed-function
+ * pipes, rebased onto 'win' if the picture is only bound in part.
+ */
+void
+nouveau_exa_pict_matrix(PicturePtr ppict, const struct nouveau_exa_window *win,
+			float m[16])
+{
+	PictTransformPtr t = ppict->transform;
+	float r[3][3];
+	int i, j;
+
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) {
+			if (t)
+				r[i][j] = xFixedToFloat(t->matrix[i][j]);
+			else
+				r[i][j] = (i == j) ? 1.0 : 0.0;
+		}
+	}
+
+	if (win) {
+		for (j = 0; j < 3; j++) {
+			r[0][j] -= win->x * r[2][j];
+			r[1][j] -= win->y * r[2][j];
+		}
+	}
+
+	memset(m, 0, sizeof(float) * 16);
+	for (i = 0; i < 3; i++) {
+		m[(i == 2 ? 3 : i) * 4 + 0] = r[i][0];
+		m[(i == 2 ? 3 : i) * 4 + 1] = r[i][1];
+		m[(i == 2 ? 3 : i) * 4 + 3] = r[i][2];
+	}
+}
+
+/* What Prepare should set pNv->composite_limit to: 'limit' if either
+ * picture is too large to be bound whole, otherwise 0.
+ */
+int
+nouveau_exa_composite_limit(PicturePtr pspict, PicturePtr pmpict, int limit)
+{
+	PicturePtr ppict[2] = { pspict, pmpict };
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (ppict[i] && ppict[i]->pDrawable &&
+		    (ppict[i]->pDrawable->width > limit ||
+		     ppict[i]->pDrawable->height > limit))
+			return limit;
+	}
+
+	return 0;
+}
+
+static Bool
+nouveau_exa_split_window(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict,
+			 int x, int y, int w, int h,
+			 struct nouveau_exa_window *win,
+			 struct nouveau_exa_window **pwin)
+{
+	*pwin = NULL;
+	if (!ppict || !ppict->pDrawable || !ppix ||
+	    (ppict->pDrawable->width <= pNv->composite_limit &&
+	     ppict->pDrawable->height <= pNv->composite_limit))
+		return TRUE;
+
+	*pwin = win;
+	return nouveau_exa_pict_window(ppix, ppict, pNv->composite_limit,
+				       x, y, w, h, win);
+}
+
+/* Hand 'rect' the composite rect in pieces small enough that every picture
+ * over pNv->composite_limit (set up by Prepare) can be bound as a window.
+ * Pictures that fit get a NULL window and are left bound as they are.
+ */
+void
+nouveau_exa_composite_split(PixmapPtr pdpix, int sx, int sy, int mx, int my,
+			    int dx, int dy, int w, int h,
+			    nouveau_exa_split_rect rect)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pdpix->drawable.pScreen));
+	struct nouveau_exa_window swin, mwin, *ps, *pm;
+	int half;
+
+	if (nouveau_exa_split_window(pNv, pNv->pspix, pNv->pspict,
+				     sx, sy, w, h, &swin, &ps) &&
+	    nouveau_exa_split_window(pNv, pNv->pmpix, pNv->pmpict,
+				     mx, my, w, h, &mwin, &pm)) {
+		rect(pdpix, ps, pm, sx, sy, mx, my, dx, dy, w, h);
+		return;
+	}
+
+	if (w >= h && w > 1) {
+		half = w / 2;
+		nouveau_exa_composite_split(pdpix, sx, sy, mx, my, dx, dy,
+					    half, h, rect);
+		nouveau_exa_composite_split(pdpix, sx + half, sy, mx + half, my,
+					    dx + half, dy, w - half, h, rect);
+	} else
+	if (h > 1) {
+		half = h / 2;
+		nouveau_exa_composite_split(pdpix, sx, sy, mx, my, dx, dy,
+					    w, half, rect);
+		nouveau_exa_composite_split(pdpix, sx, sy + half, mx, my + half,
+					    dx, dy + half, w, h - half, rect);
+	}
+}
+
+/* Composite strength reduction.  A good part of Render traffic is really
+ * a fill or a plain copy, which the 2D engine does without any of the 3D
+ * setup, so requests are rewritten to the cheapest equivalent before the
+ * per-generation hooks (saved in pNv) ever see them:
+ *
+ * - Clear is a fill with zero, mask or not.
+ * - Over from an opaque source is Src, which at least lets the 3D path
+ *   turn blending off.
+ * - Src from a solid source is a fill.
+ * - Src from an untransformed, non-repeating source of the same layout as
+ *   the destination is a copy, EXA having clipped the region to it.
+ *
+ * The 2D Prepare hooks may still refuse, in which case the 3D path gets
+ * the request after all.
+ */
+#define NOUVEAU_EXA_COMPOSITE_3D    0
+#define NOUVEAU_EXA_COMPOSITE_SOLID 1
+#define NOUVEAU_EXA_COMPOSITE_COPY  2
+
+static Bool
+nouveau_exa_pict_opaque(PicturePtr ppict)
+{
+	if (ppict->alphaMap)
+		return FALSE;
+
+	if (!ppict->pDrawable) {
+		return ppict->pSourcePict->type == SourcePictTypeSolidFill &&
+		       (ppict->pSourcePict->solidFill.color >> 24) == 0xff;
+	}
+
+	/* outside a RepeatNone picture is transparent, which only can't be
+	 * sampled if EXA clipped the region to it
+	 */
+	return !PICT_FORMAT_A(ppict->format) &&
+	       (ppict->repeat || !ppict->transform);
+}
+
+static Bool
+nouveau_exa_pict_copyable(PicturePtr pspict, PicturePtr pdpict)
+{
+	PictFormatShort sf = pspict->format, df = pdpict->format;
+
+	if (!pspict->pDrawable || pspict->transform || pspict->repeat ||
+	    pspict->pDrawable->bitsPerPixel != pdpict->pDrawable->bitsPerPixel)
+		return FALSE;
+
+	if (sf == df)
+		return TRUE;
+
+	/* alpha can be dropped, but not made up */
+	return !PICT_FORMAT_A(df) &&
+	       PICT_FORMAT_TYPE(sf) == PICT_FORMAT_TYPE(df) &&
+	       PICT_FORMAT_R(sf) == PICT_FORMAT_R(df) &&
+	       PICT_FORMAT_G(sf) == PICT_FORMAT_G(df) &&
+	       PICT_FORMAT_B(sf) == PICT_FORMAT_B(df);
+}
+
+/* Which NOUVEAU_EXA_COMPOSITE_* a composite can be done with, *op being
+ * rewritten if need be.  The pixmaps are NULL when called from
+ * CheckComposite, which only rules out some of the reductions.
+ */
+static int
+nouveau_exa_composite_reduce(int *op, PicturePtr pspict, PicturePtr pmpict,
+			     PicturePtr pdpict, PixmapPtr pspix,
+			     PixmapPtr pdpix, uint32_t *pixel)
+{
+	uint32_t argb;
+
+	if (pdpict->alphaMap)
+		return NOUVEAU_EXA_COMPOSITE_3D;
+
+	if (*op == PictOpClear) {
+		*pixel = 0;
+		return NOUVEAU_EXA_COMPOSITE_SOLID;
+	}
+
+	/* a convolution isn't the source's colour, even if it's solid */
+	if (pmpict || pspict->alphaMap ||
+	    pspict->filter == PictFilterConvolution)
+		return NOUVEAU_EXA_COMPOSITE_3D;
+
+	if (*op == PictOpOver && nouveau_exa_pict_opaque(pspict))
+		*op = PictOpSrc;
+	if (*op != PictOpSrc)
+		return NOUVEAU_EXA_COMPOSITE_3D;
+
+	if (nouveau_exa_pict_solid(pspix, pspict, &argb)) {
+		if (nouveau_exa_argb_pixel(argb, pdpict->format, pixel))
+			return NOUVEAU_EXA_COMPOSITE_SOLID;
+		return NOUVEAU_EXA_COMPOSITE_3D;
+	}
+
+	if (nouveau_exa_pict_copyable(pspict, pdpict) &&
+	    (!pspix || pspix != pdpix))
+		return NOUVEAU_EXA_COMPOSITE_COPY;
+
+	return NOUVEAU_EXA_COMPOSITE_3D;
+}
+
+/* Solids and copies are wrapped only to have each operation reserved in
+ * one go, see nouveau_push_begin()
+ */
+static Bool
+nouveau_exa_prepare_solid(PixmapPtr ppix, int alu, Pixel planemask, Pixel fg)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(ppix->drawable.pScreen));
+
+	nouveau_push_begin(pNv, NOUVEAU_PUSH_OP_SOLID);
+	if (pNv->PrepareSolid(ppix, alu, planemask, fg))
+		return TRUE;
+
+	nouveau_push_end(pNv);
+	return FALSE;
+}
+
+static void
+nouveau_exa_done_solid(PixmapPtr ppix)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(ppix->drawable.pScreen));
+
+	pNv->DoneSolid(ppix);
+	nouveau_push_end(pNv);
+}
+
+static Bool
+nouveau_exa_prepare_copy(PixmapPtr pspix, PixmapPtr pdpix, int dx, int dy,
+			 int alu, Pixel planemask)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pdpix->drawable.pScreen));
+
+	nouveau_push_begin(pNv, NOUVEAU_PUSH_OP_COPY);
+	if (pNv->PrepareCopy(pspix, pdpix, dx, dy, alu, planemask))
+		return TRUE;
+
+	nouveau_push_end(pNv);
+	return FALSE;
+}
+
+static void
+nouveau_exa_done_copy(PixmapPtr pdpix)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pdpix->drawable.pScreen));
+
+	pNv->DoneCopy(pdpix);
+	nouveau_push_end(pNv);
+}
+
+static Bool
+nouveau_exa_check_composite(int op, PicturePtr pspict, PicturePtr pmpict,
+			    PicturePtr pdpict)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pdpict->pDrawable->pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	uint32_t pixel;
+
+	if (nouveau_exa_composite_reduce(&op, pspict, pmpict, pdpict,
+					 NULL, NULL, &pixel) !=
+	    NOUVEAU_EXA_COMPOSITE_3D)
+		return TRUE;
+
+	return pNv->CheckComposite(op, pspict, pmpict, pdpict);
+}
+
+/* The 3D engine is about to sample from/render to these */
+static void
+nouveau_exa_composite_sync(NVPtr pNv, PixmapPtr pspix, PixmapPtr pmpix,
+			   PixmapPtr pdpix)
+{
+	if (pspix)
+		nouveau_copy_sync(pNv, nouveau_pixmap_bo(pspix));
+	if (pmpix)
+		nouveau_copy_sync(pNv, nouveau_pixmap_bo(pmpix));
+	nouveau_copy_sync(pNv, nouveau_pixmap_bo(pdpix));
+}
+
+static Bool
+nouveau_exa_prepare_composite(int op, PicturePtr pspict, PicturePtr pmpict,
+			      PicturePtr pdpict, PixmapPtr pspix,
+			      PixmapPtr pmpix, PixmapPtr pdpix)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pdpix->drawable.pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	ExaDriverPtr exa = pNv->EXADriverPtr;
+	uint32_t pixel;
+
+	pNv->composite_reduced =
+		nouveau_exa_composite_reduce(&op, pspict, pmpict, pdpict,
+					     pspix, pdpix, &pixel);
+	switch (pNv->composite_reduced) {
+	case NOUVEAU_EXA_COMPOSITE_SOLID:
+		if (exa->PrepareSolid(pdpix, GXcopy, ~0, pixel))
+			return TRUE;
+		break;
+	case NOUVEAU_EXA_COMPOSITE_COPY:
+		if (exa->PrepareCopy(pspix, pdpix, 1, 1, GXcopy, ~0))
+			return TRUE;
+		break;
+	default:
+		break;
+	}
+
+	/* CheckComposite may have passed only because of a reduction that
+	 * it couldn't rule out without the pixmaps, or that failed here
+	 */
+	pNv->composite_reduced = NOUVEAU_EXA_COMPOSITE_3D;
+	if (!pNv->CheckComposite(op, pspict, pmpict, pdpict))
+		return FALSE;
+
+	nouveau_exa_composite_sync(pNv, pspix, pmpix, pdpix);
+	nouveau_push_begin(pNv, NOUVEAU_PUSH_OP_COMPOSITE);
+	if (pNv->PrepareComposite(op, pspict, pmpict, pdpict,
+				  pspix, pmpix, pdpix))
+		return TRUE;
+
+	nouveau_push_end(pNv);
+	return FALSE;
+}
+
+static void
+nouveau_exa_composite(PixmapPtr pdpix, int sx, int sy, int mx, int my,
+		      int dx, int dy, int w, int h)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pdpix->drawable.pScreen));
+	ExaDriverPtr exa = pNv->EXADriverPtr;
+
+	switch (pNv->composite_reduced) {
+	case NOUVEAU_EXA_COMPOSITE_SOLID:
+		exa->Solid(pdpix, dx, dy, dx + w, dy + h);
+		break;
+	case NOUVEAU_EXA_COMPOSITE_COPY:
+		exa->Copy(pdpix, sx, sy, dx, dy, w, h);
+		break;
+	default:
+		pNv->Composite(pdpix, sx, sy, mx, my, dx, dy, w, h);
+		break;
+	}
+}
+
+static void
+nouveau_exa_done_composite(PixmapPtr pdpix)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pdpix->drawable.pScreen));
+	ExaDriverPtr exa = pNv->EXADriverPtr;
+
+	switch (pNv->composite_reduced) {
+	case NOUVEAU_EXA_COMPOSITE_SOLID:
+		exa->DoneSolid(pdpix);
+		break;
+	case NOUVEAU_EXA_COMPOSITE_COPY:
+		exa->DoneCopy(pdpix);
+		break;
+	default:
+		pNv->DoneComposite(pdpix);
+		nouveau_push_end(pNv);
+		break;
+	}
+}
+
 static int
 nouveau_exa_scratch(NVPtr pNv, int size, struct nouveau_bo **pbo, int *off)
 {
@@ -238,62 +1148,115 @@ nouveau_exa_scratch(NVPtr pNv, int size, struct nouveau_bo **pbo, int *off)
 	return 0;
 }
 
+/* The buffer download chunks in flight slot i go through.  Each slot has
+ * its own, so waiting for one chunk doesn't wait for those behind it.
+ */
+static struct nouveau_bo *
+nouveau_exa_xfer_tmp(NVPtr pNv, int i)
+{
+	if (pNv->xfer_tmp[i])
+		return pNv->xfer_tmp[i];
+
+	if (nouveau_bo_new(pNv->dev, NOUVEAU_BO_GART | NOUVEAU_BO_MAP, 0,
+			   XFER_CHUNK_MAX, NULL, &pNv->xfer_tmp[i]))
+		return NULL;
+
+	if (nouveau_bo_map(pNv->xfer_tmp[i], NOUVEAU_BO_RD, pNv->client))
+		nouveau_bo_ref(NULL, &pNv->xfer_tmp[i]);
+	return pNv->xfer_tmp[i];
+}
+
+/* Wait for a chunk of a download to land in GART and copy it out */
+static void
+nouveau_exa_download_chunk(NVPtr pNv, struct nouveau_bo *tmp, int lines,
+			   int tmp_pitch, char **pdst, int dst_pitch)
+{
+	const char *src = tmp->map;
+	char *dst = *pdst;
+	CARD64 start;
+	int i;
+
+	nouveau_bo_wait(tmp, NOUVEAU_BO_RD, pNv->client);
+	start = GetTimeInMicros();
+	if (dst_pitch == tmp_pitch) {
+		memcpy(dst, src, dst_pitch * lines);
+		dst += dst_pitch * lines;
+	} else {
+		for (i = 0; i < lines; i++) {
+			memcpy(dst, src, tmp_pitch);
+			src += tmp_pitch;
+			dst += dst_pitch;
+		}
+	}
+	nouveau_exa_xfer_cpu(pNv, lines * tmp_pitch, start);
+
+	*pdst = dst;
+}
+
 static Bool
 nouveau_exa_download_from_screen(PixmapPtr pspix, int x, int y, int w, int h,
 				 char *dst, int dst_pitch)
 {
 	ScrnInfoPtr pScrn = xf86ScreenToScrn(pspix->drawable.pScreen);
 	NVPtr pNv = NVPTR(pScrn);
-	struct nouveau_bo *bo;
-	int src_pitch, tmp_pitch, cpp, i;
+	struct nouveau_bo *bo = nouveau_pixmap_bo(pspix);
+	struct nouveau_xfer_plan plan;
+	int lines[NOUVEAU_XFER_DEPTH];
+	unsigned head = 0, tail = 0, i;
+	int src_pitch, tmp_pitch, cpp;
 	const char *src;
 	Bool ret;
 
 	cpp = pspix->drawable.bitsPerPixel >> 3;
 	src_pitch  = exaGetPixmapPitch(pspix);
 	tmp_pitch = w * cpp;
+	nouveau_exa_xfer_plan(pNv, &plan, tmp_pitch, h,
+			      nouveau_exa_xfer_tiled(pNv, bo));
 
+	/* Up to plan.depth chunks are submitted before the CPU waits for
+	 * the oldest, so the GPU copies the next ones while it's read out.
+	 */
 	while (h) {
-		const int lines = (h > 2047) ? 2047 : h;
+		const int n = min(h, plan.lines);
 		struct nouveau_bo *tmp;
-		int tmp_offset;
 
-		if (nouveau_exa_scratch(pNv, lines * tmp_pitch,
-					&tmp, &tmp_offset))
-			goto memcpy;
-
-		if (!NVAccelM2MF(pNv, w, lines, cpp, 0, tmp_offset,
-				 nouveau_pixmap_bo(pspix), NOUVEAU_BO_VRAM,
-				 src_pitch, pspix->drawable.height, x, y,
-				 tmp, NOUVEAU_BO_GART, tmp_pitch,
-				 lines, 0, 0))
-			goto memcpy;
-
-		nouveau_bo_wait(tmp, NOUVEAU_BO_RD, pNv->client);
-		if (dst_pitch == tmp_pitch) {
-			memcpy(dst, tmp->map + tmp_offset, dst_pitch * lines);
-			dst += dst_pitch * lines;
-		} else {
-			src = tmp->map + tmp_offset;
-			for (i = 0; i < lines; i++) {
-				memcpy(dst, src, tmp_pitch);
-				src += tmp_pitch;
-				dst += dst_pitch;
-			}
+		if (head - tail == plan.depth) {
+			i = tail++ % plan.depth;
+			nouveau_exa_download_chunk(pNv, pNv->xfer_tmp[i],
+						   lines[i], tmp_pitch,
+						   &dst, dst_pitch);
 		}
 
+		tmp = nouveau_exa_xfer_tmp(pNv, head % plan.depth);
+		if (!tmp ||
+		    !nouveau_exa_xfer_rect(pNv, &plan, w, n, cpp, 0, 0,
+					   bo, NOUVEAU_BO_VRAM, src_pitch,
+					   pspix->drawable.height, x, y,
+					   tmp, NOUVEAU_BO_GART, tmp_pitch,
+					   n, 0, 0))
+			break;
+		lines[head++ % plan.depth] = n;
+
 		/* next! */
-		h -= lines;
-		y += lines;
+		h -= n;
+		y += n;
 	}
-	return TRUE;
 
-memcpy:
-	bo = nouveau_pixmap_bo(pspix);
+	while (tail != head) {
+		i = tail++ % plan.depth;
+		nouveau_exa_download_chunk(pNv, pNv->xfer_tmp[i], lines[i],
+					   tmp_pitch, &dst, dst_pitch);
+	}
+
+	if (!h)
+		return TRUE;
+
 	if (nv50_style_tiled_pixmap(pspix))
 		ErrorF("%s:%d - falling back to memcpy ignores tiling\n",
 		       __func__, __LINE__);
 
+	/* mapping only submits the last pushbuf to have used it */
+	nouveau_copy_sync(pNv, bo);
 	if (nouveau_bo_map(bo, NOUVEAU_BO_RD, pNv->client))
 		return FALSE;
 	src = (char *)bo->map + (y * src_pitch) + (x * cpp);
@@ -307,6 +1270,8 @@ nouveau_exa_upload_to_screen(PixmapPtr pdpix, int x, int y, int w, int h,
 {
 	ScrnInfoPtr pScrn = xf86ScreenToScrn(pdpix->drawable.pScreen);
 	NVPtr pNv = NVPTR(pScrn);
+	struct nouveau_xfer_plan plan;
+	struct nouveau_pushbuf *push;
 	int dst_pitch, tmp_pitch, cpp, i;
 	struct nouveau_bo *bo;
 	char *dst;
@@ -316,6 +1281,8 @@ nouveau_exa_upload_to_screen(PixmapPtr pdpix, int x, int y, int w, int h,
 	dst_pitch  = exaGetPixmapPitch(pdpix);
 	tmp_pitch = w * cpp;
 
+	nouveau_pixmap_dirty(pdpix);
+
 	/* try hostdata transfer */
 	if (w * h * cpp < 16*1024) /* heuristic */
 	{
@@ -338,15 +1305,23 @@ nouveau_exa_upload_to_screen(PixmapPtr pdpix, int x, int y, int w, int h,
 		}
 	}
 
+	bo = nouveau_pixmap_bo(pdpix);
+	nouveau_exa_xfer_plan(pNv, &plan, tmp_pitch, h,
+			      nouveau_exa_xfer_tiled(pNv, bo));
+	push = plan.engine == NOUVEAU_XFER_CE ? pNv->ce_pushbuf :
+						pNv->pushbuf;
+
 	while (h) {
-		const int lines = (h > 2047) ? 2047 : h;
+		const int lines = min(h, plan.lines);
 		struct nouveau_bo *tmp;
 		int tmp_offset;
+		CARD64 start;
 
 		if (nouveau_exa_scratch(pNv, lines * tmp_pitch,
 					&tmp, &tmp_offset))
 			goto memcpy;
 
+		start = GetTimeInMicros();
 		if (src_pitch == tmp_pitch) {
 			memcpy(tmp->map + tmp_offset, src, src_pitch * lines);
 			src += src_pitch * lines;
@@ -358,27 +1333,34 @@ nouveau_exa_upload_to_screen(PixmapPtr pdpix, int x, int y, int w, int h,
 				dst += tmp_pitch;
 			}
 		}
+		nouveau_exa_xfer_cpu(pNv, lines * tmp_pitch, start);
 
-		if (!NVAccelM2MF(pNv, w, lines, cpp, tmp_offset, 0, tmp,
-				 NOUVEAU_BO_GART, tmp_pitch, lines, 0, 0,
-				 nouveau_pixmap_bo(pdpix), NOUVEAU_BO_VRAM,
-				 dst_pitch, pdpix->drawable.height, x, y))
+		if (!nouveau_exa_xfer_rect(pNv, &plan, w, lines, cpp,
+					   tmp_offset, 0, tmp,
+					   NOUVEAU_BO_GART, tmp_pitch, lines,
+					   0, 0, bo, NOUVEAU_BO_VRAM, dst_pitch,
+					   pdpix->drawable.height, x, y))
 			goto memcpy;
 
 		/* next! */
 		h -= lines;
 		y += lines;
+
+		/* get the GPU going on it while the next one is filled */
+		if (h)
+			PUSH_KICK(push);
 	}
 
 	return TRUE;
 
 	/* fallback to memcpy-based transfer */
 memcpy:
-	bo = nouveau_pixmap_bo(pdpix);
 	if (nv50_style_tiled_pixmap(pdpix))
 		ErrorF("%s:%d - falling back to memcpy ignores tiling\n",
 		       __func__, __LINE__);
 
+	/* mapping only submits the last pushbuf to have used it */
+	nouveau_copy_sync(pNv, bo);
 	if (nouveau_bo_map(bo, NOUVEAU_BO_WR, pNv->client))
 		return FALSE;
 	dst = (char *)bo->map + (y * dst_pitch) + (x * cpp);
@@ -401,7 +1383,7 @@ static void
 nouveau_exa_flush(ScrnInfoPtr pScrn)
 {
 	NVPtr pNv = NVPTR(pScrn);
-	nouveau_pushbuf_kick(pNv->pushbuf, pNv->pushbuf->channel);
+	PUSH_KICK(pNv->pushbuf);
 }
 
 Bool
@@ -458,6 +1440,7 @@ nouveau_exa_init(ScreenPtr pScreen)
 
 	exa->DownloadFromScreen = nouveau_exa_download_from_screen;
 	exa->UploadToScreen = nouveau_exa_upload_to_screen;
+	nouveau_exa_xfer_init(pNv);
 
 	if (pNv->Architecture < NV_TESLA) {
 		exa->PrepareCopy = NV04EXAPrepareCopy;
@@ -525,6 +1508,30 @@ nouveau_exa_init(ScreenPtr pScreen)
 		break;
 	}
 
+	pNv->PrepareSolid = exa->PrepareSolid;
+	pNv->DoneSolid    = exa->DoneSolid;
+	pNv->PrepareCopy  = exa->PrepareCopy;
+	pNv->DoneCopy     = exa->DoneCopy;
+
+	exa->PrepareSolid = nouveau_exa_prepare_solid;
+	exa->DoneSolid    = nouveau_exa_done_solid;
+	exa->PrepareCopy  = nouveau_exa_prepare_copy;
+	exa->DoneCopy     = nouveau_exa_done_copy;
+
+	if (exa->CheckComposite) {
+		pNv->CheckComposite   = exa->CheckComposite;
+		pNv->PrepareComposite = exa->PrepareComposite;
+		pNv->Composite        = exa->Composite;
+		pNv->DoneComposite    = exa->DoneComposite;
+
+		exa->CheckComposite   = nouveau_exa_check_composite;
+		exa->PrepareComposite = nouveau_exa_prepare_composite;
+		exa->Composite        = nouveau_exa_composite;
+		exa->DoneComposite    = nouveau_exa_done_composite;
+	}
+
+	nouveau_trace_init(pScreen, exa);
+
 	if (!exaDriverInit(pScreen, exa))
 		return FALSE;
 
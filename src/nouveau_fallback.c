@@ -0,0 +1,223 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Fallback accounting.  Each NOUVEAU_FALLBACK() site has a static
+ * counter, which links itself in here the first time it's taken.  The
+ * counts, busiest first, are kept in the NOUVEAU_FALLBACKS property on
+ * the root window, and written to the log on SIGUSR2 and when the
+ * screen closes.  Option "FallbackDebug" additionally logs each fallback
+ * with its details, at most FALLBACK_LOG_RATE a second.
+ */
+
+#include <signal.h>
+
+#include "nv_include.h"
+
+#include <X11/Xatom.h>
+#include "property.h"
+
+#define FALLBACK_LOG_RATE 10
+#define FALLBACK_PROPERTY "NOUVEAU_FALLBACKS"
+
+Bool nouveau_fallback_verbose;
+
+static struct nouveau_fallback *sites;
+static volatile sig_atomic_t dump_requested;
+static OsSigHandlerPtr dump_handler;
+static int users;
+
+void
+nouveau_fallback(struct nouveau_fallback *site, const char *fmt, ...)
+{
+	static CARD32 stamp;
+	static unsigned logged, dropped;
+	CARD32 now;
+	va_list ap;
+
+	/* not on count == 1, count wraps on a busy enough site */
+	if (!site->linked) {
+		site->next = sites;
+		sites = site;
+		site->linked = TRUE;
+	}
+
+	if (!nouveau_fallback_verbose)
+		return;
+
+	now = GetTimeInMillis();
+	if (now - stamp >= 1000) {
+		if (dropped)
+			ErrorF("nouveau: %u fallbacks not logged\n", dropped);
+		stamp = now;
+		logged = dropped = 0;
+	}
+
+	if (logged++ >= FALLBACK_LOG_RATE) {
+		dropped++;
+		return;
+	}
+
+	ErrorF("nouveau: fallback in %s:%d - ", site->func, site->line);
+	va_start(ap, fmt);
+	VErrorF(fmt, ap);
+	va_end(ap);
+}
+
+/* Put the busiest sites first, it's a short list */
+static void
+nouveau_fallback_sort(void)
+{
+	struct nouveau_fallback *sorted = NULL, *site, **pos;
+
+	while ((site = sites)) {
+		sites = site->next;
+		for (pos = &sorted; *pos; pos = &(*pos)->next) {
+			if ((*pos)->count < site->count)
+				break;
+		}
+		site->next = *pos;
+		*pos = site;
+	}
+
+	sites = sorted;
+}
+
+static unsigned
+nouveau_fallback_total(void)
+{
+	struct nouveau_fallback *site;
+	unsigned total = 0;
+
+	for (site = sites; site; site = site->next)
+		total += site->count;
+	return total;
+}
+
+static int
+nouveau_fallback_print(struct nouveau_fallback *site, char *buf, int size)
+{
+	int len = strlen(site->msg);
+
+	/* the messages are printf formats ending in a newline */
+	if (len && site->msg[len - 1] == '\n')
+		len--;
+
+	return snprintf(buf, size, "%u %s:%d %.*s\n", site->count,
+			site->func, site->line, len, site->msg);
+}
+
+static void
+nouveau_fallback_dump(ScrnInfoPtr pScrn)
+{
+	struct nouveau_fallback *site;
+	char line[256];
+
+	nouveau_fallback_sort();
+	xf86DrvMsg(pScrn->scrnIndex, X_INFO,
+		   "[FALLBACK] %u fallbacks taken\n", nouveau_fallback_total());
+
+	for (site = sites; site; site = site->next) {
+		nouveau_fallback_print(site, line, sizeof(line));
+		xf86DrvMsg(pScrn->scrnIndex, X_INFO, "[FALLBACK] %s", line);
+	}
+}
+
+static void
+nouveau_fallback_signal(int sig)
+{
+	dump_requested = 1;
+}
+
+/* Called from the block handler, refreshes the property once a second */
+void
+nouveau_fallback_update(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	struct nouveau_fallback *site;
+	CARD32 now = GetTimeInMillis();
+	unsigned total;
+	char *data;
+	int size = 0, len = 0;
+
+	if (dump_requested) {
+		dump_requested = 0;
+		nouveau_fallback_dump(pScrn);
+	}
+
+	total = nouveau_fallback_total();
+	if (total == pNv->fallback_published ||
+	    now - pNv->fallback_stamp < 1000 || !pScreen->root)
+		return;
+
+	nouveau_fallback_sort();
+	for (site = sites; site; site = site->next)
+		size += nouveau_fallback_print(site, NULL, 0);
+
+	data = malloc(size + 1);
+	if (!data)
+		return;
+	for (site = sites; site; site = site->next)
+		len += nouveau_fallback_print(site, data + len, size + 1 - len);
+
+	dixChangeWindowProperty(serverClient, pScreen->root,
+				MakeAtom(FALLBACK_PROPERTY,
+					 strlen(FALLBACK_PROPERTY), TRUE),
+				XA_STRING, 8, PropModeReplace, len, data,
+				TRUE);
+	free(data);
+
+	pNv->fallback_published = total;
+	pNv->fallback_stamp = now;
+}
+
+void
+nouveau_fallback_init(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+
+	if (xf86ReturnOptValBool(pNv->Options, OPTION_FALLBACK_DEBUG, FALSE)) {
+		xf86DrvMsg(pScrn->scrnIndex, X_CONFIG,
+			   "[FALLBACK] logging acceleration fallbacks\n");
+		nouveau_fallback_verbose = TRUE;
+	}
+
+	pNv->fallback_published = 0;
+	pNv->fallback_stamp = 0;
+	if (!users++)
+		dump_handler = OsSignal(SIGUSR2, nouveau_fallback_signal);
+}
+
+void
+nouveau_fallback_fini(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+
+	if (nouveau_fallback_total())
+		nouveau_fallback_dump(pScrn);
+
+	if (!--users) {
+		OsSignal(SIGUSR2, dump_handler);
+		nouveau_fallback_verbose = FALSE;
+	}
+}
@@ -32,16 +32,28 @@
 #define NOUVEAU_MSG(fmt,args...) ErrorF(fmt, ##args)
 #define NOUVEAU_ERR(fmt,args...) \
 	ErrorF("%s:%d - "fmt, __func__, __LINE__, ##args)
-#if 0
-#define NOUVEAU_FALLBACK(fmt,args...) do {    \
-	NOUVEAU_ERR("FALLBACK: "fmt, ##args); \
-	return FALSE;                         \
-} while(0)
-#else
-#define NOUVEAU_FALLBACK(fmt,args...) do {    \
-	return FALSE;                         \
+/* Every NOUVEAU_FALLBACK() site counts how often it's been taken, see
+ * nouveau_fallback.c.  Only the first hit, or every one with
+ * Option "FallbackDebug", leaves the fast path.
+ */
+struct nouveau_fallback {
+	const char *func;
+	int line;
+	const char *msg;
+	unsigned count;
+	Bool linked;
+	struct nouveau_fallback *next;
+};
+
+extern Bool nouveau_fallback_verbose;
+void nouveau_fallback(struct nouveau_fallback *, const char *fmt, ...);
+
+#define NOUVEAU_FALLBACK(fmt,args...) do {                                 \
+	static struct nouveau_fallback site = { __func__, __LINE__, fmt }; \
+	if (!site.count++ || nouveau_fallback_verbose)                      \
+		nouveau_fallback(&site, fmt, ##args);                       \
+	return FALSE;                                                      \
 } while(0)
-#endif
 
 #define NOUVEAU_ALIGN(x,bytes) (((x) + ((bytes) - 1)) & ~((bytes) - 1))
 
@@ -95,6 +107,70 @@ static inline int round_up_pow2(int x)
 		(y) = __z;		\
 	} while (0)
 
+/* Why a pushbuf is being submitted, counted in nouveau_push.c.  Anything
+ * not marked otherwise is libdrm submitting by itself, usually to wait on
+ * or map a buffer.
+ */
+enum nouveau_push_why {
+	NOUVEAU_PUSH_IMPLICIT,
+	NOUVEAU_PUSH_EXPLICIT,
+	NOUVEAU_PUSH_FULL,
+};
+
+extern int nouveau_push_why;
+extern uint32_t nouveau_push_want;
+
+/* Operations sized for nouveau_push_begin() */
+enum nouveau_push_op {
+	NOUVEAU_PUSH_OP_SOLID,
+	NOUVEAU_PUSH_OP_COPY,
+	NOUVEAU_PUSH_OP_COMPOSITE,
+	NOUVEAU_PUSH_OP_XV,
+	NOUVEAU_PUSH_OPS
+};
+
+/* A screen's pushbufs, each one's user_priv points at its track */
+#define NOUVEAU_PUSH_MAIN   0
+#define NOUVEAU_PUSH_COPY   1
+#define NOUVEAU_PUSH_COPY2  2
+#define NOUVEAU_PUSH_TRACKS 3
+
+struct nouveau_push_track {
+	struct _NVRec *pNv;
+	struct nouveau_pushbuf *push;
+	struct nouveau_bufctx *bufctx;	/* see BUFCTX() */
+	int capture;			/* channel in the capture file, or -1 */
+	uint32_t *ptr;			/* where the next submission starts */
+	uint32_t *end;
+	int level;
+
+	/* the operation being written, see nouveau_push_begin() */
+	int op;
+	int op_depth;
+	uint64_t op_start;
+	unsigned op_full;
+	uint32_t op_worst[NOUVEAU_PUSH_OPS];	/* last second */
+	uint32_t op_peak[NOUVEAU_PUSH_OPS];	/* this second */
+
+	/* this second */
+	unsigned full;
+	uint32_t peak;
+	CARD32 stamp;
+	int idle;
+
+	/* since the screen was set up */
+	unsigned kicks[3];
+	uint64_t words;
+	uint32_t largest;
+	unsigned grown;
+	unsigned shrunk;
+	unsigned split;
+};
+
+/* use instead of nouveau_pushbuf_space(), see nouveau_push.c */
+int nouveau_push_space(struct nouveau_pushbuf *push, uint32_t dwords,
+		       uint32_t relocs, uint32_t pushes);
+
 static inline uint32_t
 PUSH_AVAIL(struct nouveau_pushbuf *push)
 {
@@ -104,9 +180,16 @@ PUSH_AVAIL(struct nouveau_pushbuf *push)
 static inline Bool
 PUSH_SPACE(struct nouveau_pushbuf *push, uint32_t size)
 {
-	if (PUSH_AVAIL(push) < size)
-		return nouveau_pushbuf_space(push, size, 0, 0) == 0;
-	return TRUE;
+	int ret;
+
+	if (PUSH_AVAIL(push) >= size)
+		return TRUE;
+
+	nouveau_push_why = NOUVEAU_PUSH_FULL;
+	nouveau_push_want = size;
+	ret = nouveau_push_space(push, size, 0, 0);
+	nouveau_push_why = NOUVEAU_PUSH_IMPLICIT;
+	return ret == 0;
 }
 
 static inline void
@@ -132,13 +215,23 @@ PUSH_RELOC(struct nouveau_pushbuf *push, struct nouveau_bo *bo, uint32_t offset,
 static inline void
 PUSH_KICK(struct nouveau_pushbuf *push)
 {
+	nouveau_push_why = NOUVEAU_PUSH_EXPLICIT;
 	nouveau_pushbuf_kick(push, push->channel);
+	nouveau_push_why = NOUVEAU_PUSH_IMPLICIT;
 }
 
+/* Our bufctx has two bins: operations reset and fill bin 0, bin 1 holds
+ * what every submission references, see nouveau_push_resident().
+ */
+#define NOUVEAU_BIN_RESIDENT 1
+#define NOUVEAU_BINS         2
+
 static inline struct nouveau_bufctx *
 BUFCTX(struct nouveau_pushbuf *push)
 {
-	return push->user_priv;
+	struct nouveau_push_track *track = push->user_priv;
+
+	return track->bufctx;
 }
 
 static inline void
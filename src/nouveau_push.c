@@ -0,0 +1,518 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Pushbuf sizing.  libdrm never splits a single PUSH_SPACE() reservation,
+ * but most operations make one per rectangle, glyph or chunk.  So each
+ * operation, from its Prepare hook to its Done hook, is bracketed with
+ * nouveau_push_begin() and nouveau_push_end(), which measure how much it
+ * wrote.  The largest operation of the same kind seen over the last second
+ * or so is then reserved before the next one starts, and it's only split
+ * across submissions if it comes out bigger than that.
+ *
+ * Every submission is classed as explicit (PUSH_KICK), full (a
+ * reservation didn't fit) or implicit (libdrm submitting so it can wait
+ * on or map a buffer), and a pushbuf that keeps filling up, or has
+ * operations that don't fit in it, is replaced by a bigger one.  That's
+ * done from the block handler where no operation is half written, by
+ * creating the pushbuf again with nouveau_push_new().  One that has been
+ * quiet for a while goes back down.
+ *
+ * The screen's pushbufs are tracked in NVRec, and each one's kick_notify
+ * is ours: the state filter and pushbuf capture are told about
+ * submissions from here rather than hooking it themselves.  The counts
+ * are written to the log when the screen closes.
+ *
+ * Buffers nearly every operation uses, like the scratch and front
+ * buffers, are kept in a bufctx bin of their own instead of being
+ * referenced again by each operation, see nouveau_push_refn().
+ * Validation only walks the references added since it last ran, so these
+ * cost something once per submission rather than once per operation.
+ * When libdrm submits, the references of every bufctx validated since
+ * the last submission go back on its pending list, so the first
+ * validation afterwards picks them up again without our help.
+ */
+
+#include "nv_include.h"
+#include "nouveau_capture.h"
+
+/* The sizes a pushbuf can be, the default is what we used to always use */
+static const struct {
+	int nr;
+	int size;
+} nouveau_push_levels[] = {
+	{ 2,  32 * 1024 },
+	{ 4,  32 * 1024 },
+	{ 4,  64 * 1024 },
+	{ 4, 128 * 1024 },
+	{ 8, 128 * 1024 },
+};
+
+#define PUSH_LEVELS \
+	(sizeof(nouveau_push_levels) / sizeof(nouveau_push_levels[0]))
+#define PUSH_LEVEL_DEFAULT 1
+#define PUSH_GROW_RATE     4	/* full submissions a second */
+#define PUSH_SHRINK_IDLE   10	/* seconds without any */
+
+static const char *nouveau_push_names[NOUVEAU_PUSH_TRACKS] = {
+	"main", "copy", "copy2",
+};
+
+int nouveau_push_why;
+uint32_t nouveau_push_want;
+
+static struct nouveau_pushbuf **
+nouveau_push_owner(NVPtr pNv, int which)
+{
+	switch (which) {
+	case NOUVEAU_PUSH_MAIN:
+		return &pNv->pushbuf;
+	case NOUVEAU_PUSH_COPY:
+		return &pNv->ce_pushbuf;
+	default:
+		return &pNv->ce_pushbuf2;
+	}
+}
+
+/* Words written to the pushbuf since it was created, submitted or not */
+static uint64_t
+nouveau_push_written(struct nouveau_push_track *track)
+{
+	struct nouveau_pushbuf *push = track->push;
+
+	if (push->end != track->end)
+		return track->words;
+	return track->words + (push->cur - track->ptr);
+}
+
+/* How many words have been written to the main and copy engine pushbufs,
+ * submitted or not, and how many submissions there have been, since they
+ * were first created.
+ */
+void
+nouveau_push_count(NVPtr pNv, uint64_t *words, unsigned *kicks)
+{
+	int i;
+
+	*words = 0;
+	*kicks = 0;
+
+	for (i = 0; i < NOUVEAU_PUSH_TRACKS; i++) {
+		struct nouveau_push_track *track = &pNv->push[i];
+
+		if (!track->push)
+			continue;
+
+		*words += nouveau_push_written(track);
+		*kicks += track->kicks[NOUVEAU_PUSH_IMPLICIT] +
+			  track->kicks[NOUVEAU_PUSH_EXPLICIT] +
+			  track->kicks[NOUVEAU_PUSH_FULL];
+	}
+}
+
+static void
+nouveau_push_resident_refn(NVPtr pNv)
+{
+	int i;
+
+	nouveau_bufctx_reset(pNv->bufctx, NOUVEAU_BIN_RESIDENT);
+	for (i = 0; i < pNv->resident_nr; i++) {
+		nouveau_bufctx_refn(pNv->bufctx, NOUVEAU_BIN_RESIDENT,
+				    pNv->resident[i], pNv->resident_access[i]);
+	}
+}
+
+/* Have bo referenced by every submission on the main pushbuf from now on,
+ * until nouveau_push_evict().  Operations using it needn't PUSH_REFN() it.
+ */
+Bool
+nouveau_push_resident(NVPtr pNv, struct nouveau_bo *bo, uint32_t access)
+{
+	int i = pNv->resident_nr;
+
+	if (!pNv->bufctx || i == NOUVEAU_PUSH_RESIDENT)
+		return FALSE;
+
+	pNv->resident[i] = NULL;
+	nouveau_bo_ref(bo, &pNv->resident[i]);
+	pNv->resident_access[i] = access;
+	pNv->resident_nr++;
+
+	nouveau_bufctx_refn(pNv->bufctx, NOUVEAU_BIN_RESIDENT, bo, access);
+	return TRUE;
+}
+
+void
+nouveau_push_evict(NVPtr pNv, struct nouveau_bo *bo)
+{
+	int i;
+
+	for (i = 0; i < pNv->resident_nr; i++) {
+		if (pNv->resident[i] != bo)
+			continue;
+
+		nouveau_bo_ref(NULL, &pNv->resident[i]);
+		pNv->resident_nr--;
+		pNv->resident[i] = pNv->resident[pNv->resident_nr];
+		pNv->resident_access[i] =
+			pNv->resident_access[pNv->resident_nr];
+		pNv->resident[pNv->resident_nr] = NULL;
+
+		nouveau_push_resident_refn(pNv);
+		return;
+	}
+}
+
+/* Put bo where old was, if old is resident, as when the front buffer is
+ * reallocated.
+ */
+void
+nouveau_push_replace(NVPtr pNv, struct nouveau_bo *old, struct nouveau_bo *bo)
+{
+	int i;
+
+	for (i = 0; i < pNv->resident_nr; i++) {
+		if (pNv->resident[i] != old)
+			continue;
+
+		nouveau_bo_ref(bo, &pNv->resident[i]);
+		nouveau_push_resident_refn(pNv);
+		return;
+	}
+}
+
+/* PUSH_REFN() on the main pushbuf, unless bo is resident for access
+ * already.  Validation then only has the operation's other buffers to
+ * look up.
+ */
+void
+nouveau_push_refn(NVPtr pNv, struct nouveau_bo *bo, uint32_t access)
+{
+	int i;
+
+	for (i = 0; i < pNv->resident_nr; i++) {
+		if (pNv->resident[i] == bo &&
+		    !(access & ~pNv->resident_access[i]))
+			return;
+	}
+
+	PUSH_REFN(pNv->pushbuf, bo, access);
+}
+
+static void
+nouveau_push_kick(struct nouveau_pushbuf *push)
+{
+	struct nouveau_push_track *track = push->user_priv;
+	NVPtr pNv = track->pNv;
+	uint32_t words;
+
+	/* nothing the state filter remembers can be relied on any more */
+	if (push == pNv->pushbuf)
+		nouveau_state_reset(pNv);
+
+	/* The copy channel may wait on the second copy engine's half of a
+	 * transfer, and waiting on a buffer only kicks the copy channel, so
+	 * that half goes out first, see nouveau_copy_rect()
+	 */
+	if (push == pNv->ce_pushbuf && pNv->ce_pushbuf2) {
+		int why = nouveau_push_why;
+
+		PUSH_KICK(pNv->ce_pushbuf2);
+		nouveau_push_why = why;
+	}
+
+	/* a buffer switch nobody told us about, see nouveau_push_space() */
+	if (push->end != track->end) {
+		if (track->capture >= 0)
+			ErrorF("nouveau: pushbuf capture lost a submission\n");
+		track->end = push->end;
+		track->ptr = push->cur;
+	}
+
+	words = push->cur - track->ptr;
+
+	/* libdrm only submits if there's something to */
+	if (!words)
+		return;
+
+	if (track->capture >= 0)
+		nouveau_capture_push(track->capture, track->ptr, words);
+	track->ptr = push->cur;
+
+	track->words += words;
+	if (track->peak < words)
+		track->peak = words;
+
+	track->kicks[nouveau_push_why]++;
+	if (nouveau_push_why == NOUVEAU_PUSH_FULL) {
+		track->full++;
+		if (track->largest < nouveau_push_want)
+			track->largest = nouveau_push_want;
+	}
+}
+
+/* nouveau_pushbuf_space(), for all of the driver.
+ *
+ * When there isn't room for dwords more, libdrm submits what's queued and
+ * moves on to the next buffer in its ring, which is filled from the top.
+ * That's the only time push->cur moves other than by us writing to it,
+ * and where the next submission starts is needed to count or capture it.
+ * Before returning, libdrm re-emits the methods in the bound bufctx into
+ * the new buffer.  So it's unbound while libdrm switches, which leaves
+ * push->cur at the top, and validated again afterwards.
+ */
+int
+nouveau_push_space(struct nouveau_pushbuf *push, uint32_t dwords,
+		   uint32_t relocs, uint32_t pushes)
+{
+	struct nouveau_push_track *track = push->user_priv;
+	struct nouveau_bufctx *bctx;
+	uint32_t *cur = push->cur;
+	int ret;
+
+	if (push->cur + dwords < push->end)
+		return nouveau_pushbuf_space(push, dwords, relocs, pushes);
+
+	bctx = nouveau_pushbuf_bufctx(push, NULL);
+	ret = nouveau_pushbuf_space(push, dwords, relocs, pushes);
+	if (push->cur != cur) {
+		track->ptr = push->cur;
+		track->end = push->end;
+	}
+	nouveau_pushbuf_bufctx(push, bctx);
+
+	if (ret == 0 && bctx)
+		ret = nouveau_pushbuf_validate(push);
+	return ret;
+}
+
+/* Reserve room for the largest operation of its kind lately, so it goes
+ * out in one submission.  One that wouldn't leave room for much else in
+ * a buffer has the buffer grown instead, see nouveau_push_adapt().
+ * Operations may nest (a composite reduced to a solid fill), only the
+ * outermost one counts.
+ */
+void
+nouveau_push_begin(NVPtr pNv, int op)
+{
+	struct nouveau_push_track *track = &pNv->push[NOUVEAU_PUSH_MAIN];
+	uint32_t worst;
+
+	if (!track->push || track->op_depth++)
+		return;
+
+	worst = track->op_worst[op];
+	if (worst < track->op_peak[op])
+		worst = track->op_peak[op];
+	if (worst * 2 <= nouveau_push_levels[track->level].size / 4)
+		PUSH_SPACE(track->push, worst);
+	else
+	if (track->largest < worst)
+		track->largest = worst;
+
+	track->op = op;
+	track->op_start = nouveau_push_written(track);
+	track->op_full = track->kicks[NOUVEAU_PUSH_FULL];
+}
+
+void
+nouveau_push_end(NVPtr pNv)
+{
+	struct nouveau_push_track *track = &pNv->push[NOUVEAU_PUSH_MAIN];
+	uint32_t words;
+
+	if (!track->push || !track->op_depth || --track->op_depth)
+		return;
+
+	words = nouveau_push_written(track) - track->op_start;
+	if (track->op_peak[track->op] < words)
+		track->op_peak[track->op] = words;
+	if (track->kicks[NOUVEAU_PUSH_FULL] != track->op_full)
+		track->split++;
+}
+
+static int
+nouveau_push_create(NVPtr pNv, int which, struct nouveau_object *channel,
+		    int level)
+{
+	struct nouveau_push_track *track = &pNv->push[which];
+	struct nouveau_pushbuf **owner = nouveau_push_owner(pNv, which);
+	struct nouveau_pushbuf *push;
+	int ret;
+
+	ret = nouveau_pushbuf_new(pNv->client, channel,
+				  nouveau_push_levels[level].nr,
+				  nouveau_push_levels[level].size, true,
+				  &push);
+	if (ret)
+		return ret;
+
+	if (*owner) {
+		PUSH_KICK(*owner);
+		nouveau_pushbuf_del(owner);
+	} else {
+		memset(track, 0, sizeof(*track));
+		track->pNv = pNv;
+		track->capture = -1;
+		track->stamp = GetTimeInMillis();
+	}
+
+	if (which == NOUVEAU_PUSH_MAIN)
+		track->bufctx = pNv->bufctx;
+	track->push = push;
+	track->ptr = push->cur;
+	track->end = push->end;
+	track->level = level;
+
+	push->user_priv = track;
+	push->kick_notify = nouveau_push_kick;
+	*owner = push;
+	return 0;
+}
+
+/* Create one of the screen's pushbufs, on channel.  The main one's bufctx
+ * has to exist already.
+ */
+int
+nouveau_push_new(NVPtr pNv, int which, struct nouveau_object *channel)
+{
+	return nouveau_push_create(pNv, which, channel, PUSH_LEVEL_DEFAULT);
+}
+
+void
+nouveau_push_del(NVPtr pNv, int which)
+{
+	nouveau_pushbuf_del(nouveau_push_owner(pNv, which));
+	pNv->push[which].push = NULL;
+}
+
+/* Swap the pushbuf for one of a different size, on the same channel.
+ * Whatever is queued on the old one is submitted first.
+ */
+static Bool
+nouveau_push_resize(struct nouveau_push_track *track, int level)
+{
+	NVPtr pNv = track->pNv;
+
+	return nouveau_push_create(pNv, track - pNv->push,
+				   track->push->channel, level) == 0;
+}
+
+static void
+nouveau_push_adapt(struct nouveau_push_track *track)
+{
+	int level = track->level;
+	int words = nouveau_push_levels[level].size / 4;
+
+	/* grow when it keeps filling up, or one reservation takes a good
+	 * part of a buffer by itself
+	 */
+	if (track->full > PUSH_GROW_RATE || track->largest * 4 > words) {
+		track->idle = 0;
+		if (level + 1 < PUSH_LEVELS &&
+		    nouveau_push_resize(track, level + 1))
+			track->grown++;
+		return;
+	}
+
+	if (track->full || track->peak * 4 > words) {
+		track->idle = 0;
+		return;
+	}
+
+	if (++track->idle >= PUSH_SHRINK_IDLE && level > 0 &&
+	    nouveau_push_levels[level - 1].size / 4 > track->largest * 4) {
+		track->idle = 0;
+		if (nouveau_push_resize(track, level - 1))
+			track->shrunk++;
+	}
+}
+
+/* Called from the block handler, resizes at most once a second */
+void
+nouveau_push_update(ScreenPtr pScreen)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	CARD32 now = GetTimeInMillis();
+	int i;
+
+	for (i = 0; i < NOUVEAU_PUSH_TRACKS; i++) {
+		struct nouveau_push_track *track = &pNv->push[i];
+
+		if (!track->push || now - track->stamp < 1000)
+			continue;
+
+		if (!track->op_depth &&
+		    xf86ReturnOptValBool(pNv->Options, OPTION_PUSHBUF_ADAPTIVE,
+					 TRUE))
+			nouveau_push_adapt(track);
+
+		memcpy(track->op_worst, track->op_peak,
+		       sizeof(track->op_worst));
+		memset(track->op_peak, 0, sizeof(track->op_peak));
+		track->full = 0;
+		track->peak = 0;
+		track->stamp = now;
+	}
+}
+
+void
+nouveau_push_init(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+
+	if (!xf86ReturnOptValBool(pNv->Options, OPTION_PUSHBUF_ADAPTIVE, TRUE))
+		xf86DrvMsg(pScrn->scrnIndex, X_CONFIG,
+			   "[PUSH] adaptive pushbuf sizing disabled\n");
+}
+
+void
+nouveau_push_fini(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	int i;
+
+	for (i = 0; i < NOUVEAU_PUSH_TRACKS; i++) {
+		struct nouveau_push_track *track = &pNv->push[i];
+
+		if (!track->push)
+			continue;
+
+		xf86DrvMsg(pScrn->scrnIndex, X_INFO,
+			   "[PUSH] %s: %u explicit, %u full, %u implicit "
+			   "submissions, %llu words\n",
+			   nouveau_push_names[i],
+			   track->kicks[NOUVEAU_PUSH_EXPLICIT],
+			   track->kicks[NOUVEAU_PUSH_FULL],
+			   track->kicks[NOUVEAU_PUSH_IMPLICIT],
+			   (unsigned long long)track->words);
+		xf86DrvMsg(pScrn->scrnIndex, X_INFO,
+			   "[PUSH] %s: grown %u, shrunk %u times, "
+			   "%d x %dKiB at exit, %u operations split\n",
+			   nouveau_push_names[i],
+			   track->grown, track->shrunk,
+			   nouveau_push_levels[track->level].nr,
+			   nouveau_push_levels[track->level].size / 1024,
+			   track->split);
+	}
+}
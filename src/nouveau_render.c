@@ -0,0 +1,309 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Render operations the EXA core won't hand to the driver.
+ *
+ * Convolution filters: kernels small enough for the driver's fragment
+ * programs (see nv50_fp.c) go to it like any other composite.  Larger ones
+ * that are the outer product of a row and a column are done here in two
+ * such composites, the row over the source into an ARGB intermediate, then
+ * the column over that to the destination with the original operator and
+ * mask.  That needs the source transform to be a plain scale, and as the
+ * intermediate has 8 bits a channel the row must keep to one sign.  It's
+ * normalised to add up to one so the intermediate can't clamp, leaving
+ * the column with whatever scale the kernel had.  Anything else goes to
+ * pixman.
+ */
+
+#include "nv_include.h"
+#include "exa.h"
+#include "mipict.h"
+
+/* Largest side of a kernel done in two passes */
+#define CONV_MAX_SIDE 32
+
+struct nouveau_render {
+	CompositeProcPtr Composite;
+};
+
+#define nouveau_render_priv(pScreen)                                           \
+	((struct nouveau_render *)NVPTR(xf86ScreenToScrn(pScreen))->render)
+
+/* Split the convolution kernel of 'ppict' into a row and a column whose
+ * outer product it is, as the filter parameters of a kw x 1 and a 1 x kh
+ * kernel, if it can be done in two passes.
+ */
+static Bool
+nouveau_conv_split(PicturePtr ppict, xFixed *row, xFixed *col)
+{
+	xFixed *params = ppict->filter_params;
+	double kp, s;
+	int kw, kh, i, j, pi = 0, pj = 0;
+
+#define K(i, j) xFixedToDouble(params[2 + (j) * kw + (i)])
+	if (ppict->filter_nparams < 2)
+		return FALSE;
+
+	kw = xFixedToInt(params[0]);
+	kh = xFixedToInt(params[1]);
+	if (kw < 1 || kw > CONV_MAX_SIDE || kh < 1 || kh > CONV_MAX_SIDE ||
+	    ppict->filter_nparams < 2 + kw * kh)
+		return FALSE;
+
+	for (j = 0; j < kh; j++) {
+		for (i = 0; i < kw; i++) {
+			if (fabs(K(i, j)) > fabs(K(pi, pj))) {
+				pi = i;
+				pj = j;
+			}
+		}
+	}
+
+	kp = K(pi, pj);
+	if (kp == 0.0)
+		return FALSE;
+
+	/* the kernel has to be the outer product of its pivot's row and
+	 * column
+	 */
+	for (j = 0; j < kh; j++) {
+		for (i = 0; i < kw; i++) {
+			double d = K(i, j) - K(pi, j) * K(i, pj) / kp;
+
+			if (fabs(d) > 1.0 / 4096)
+				return FALSE;
+		}
+	}
+
+	for (i = 0, s = 0.0; i < kw; i++)
+		s += K(i, pj);
+	for (i = 0; i < kw; i++) {
+		if (K(i, pj) * s < 0.0)
+			return FALSE;
+	}
+
+	row[0] = IntToxFixed(kw);
+	row[1] = xFixed1;
+	for (i = 0; i < kw; i++)
+		row[2 + i] = xDoubleToFixed(K(i, pj) / s);
+
+	col[0] = xFixed1;
+	col[1] = IntToxFixed(kh);
+	for (j = 0; j < kh; j++)
+		col[2 + j] = xDoubleToFixed(K(pi, j) / kp * s);
+#undef K
+
+	return TRUE;
+}
+
+static PixmapPtr
+nouveau_conv_scratch(ScreenPtr pScreen, PictFormatPtr pFormat,
+		     int width, int height, PicturePtr *ppict)
+{
+	PixmapPtr ppix;
+	int error;
+
+	ppix = pScreen->CreatePixmap(pScreen, width, height, 32,
+				     CREATE_PIXMAP_USAGE_SCRATCH);
+	if (!ppix)
+		return NULL;
+
+	exaMoveInPixmap(ppix);
+	if (!nouveau_pixmap_bo(ppix)) {
+		pScreen->DestroyPixmap(ppix);
+		return NULL;
+	}
+
+	*ppict = CreatePicture(0, &ppix->drawable, pFormat, 0, NULL,
+			       serverClient, &error);
+	if (!*ppict) {
+		pScreen->DestroyPixmap(ppix);
+		return NULL;
+	}
+
+	ValidatePicture(*ppict);
+	return ppix;
+}
+
+static Bool
+nouveau_conv_composite(ScreenPtr pScreen, CARD8 op, PicturePtr pSrc,
+		       PicturePtr pMask, PicturePtr pDst,
+		       INT16 xSrc, INT16 ySrc, INT16 xMask, INT16 yMask,
+		       INT16 xDst, INT16 yDst, CARD16 width, CARD16 height)
+{
+	ExaDriverPtr exa = NVPTR(xf86ScreenToScrn(pScreen))->EXADriverPtr;
+	PictTransform t = {{{ xFixed1, 0, 0 }, { 0, xFixed1, 0 },
+			    { 0, 0, xFixed1 }}};
+	xFixed row[2 + CONV_MAX_SIDE], col[2 + CONV_MAX_SIDE];
+	PicturePtr pRowSrc = NULL, pRow = NULL;
+	PixmapPtr prpix = NULL;
+	PictFormatPtr pFormat;
+	double sy, oy, y0, y1, yoff;
+	int ry0, ry1, error;
+	Bool ret = FALSE;
+	XID attr[2];
+
+	if (!pSrc->pDrawable || pSrc->alphaMap || pSrc->clientClip ||
+	    (pMask && pMask->alphaMap) || pDst->alphaMap)
+		return FALSE;
+
+	if (!width || !height || width > exa->maxX)
+		return FALSE;
+
+	/* a kernel the driver can do in one pass is left to it */
+	if (exa->CheckComposite(op, pSrc, pMask, pDst) ||
+	    !nouveau_conv_split(pSrc, row, col))
+		return FALSE;
+
+	if (pSrc->transform)
+		t = *pSrc->transform;
+	if (t.matrix[0][1] || t.matrix[1][0] || t.matrix[2][0] ||
+	    t.matrix[2][1] || t.matrix[2][2] != xFixed1)
+		return FALSE;
+
+	/* Rows of the source the column will cover, with a row of slack
+	 * either side for rounding.
+	 */
+	sy = xFixedToDouble(t.matrix[1][1]);
+	oy = xFixedToDouble(t.matrix[1][2]);
+	y0 = sy * (ySrc + 0.5) + oy;
+	y1 = sy * (ySrc + height - 0.5) + oy;
+	yoff = (xFixedToInt(col[1]) - 1) / 2.0;
+	ry0 = floor(min(y0, y1) - yoff) - 1;
+	ry1 = floor(max(y0, y1) - yoff) + xFixedToInt(col[1]) + 1;
+	if (ry1 - ry0 > exa->maxY)
+		return FALSE;
+
+	pFormat = PictureMatchFormat(pScreen, 32, PICT_a8r8g8b8);
+	if (!pFormat)
+		return FALSE;
+
+	/* row r of the intermediate is source row ry0 + r, filtered and
+	 * scaled in x only
+	 */
+	attr[0] = pSrc->repeatType;
+	attr[1] = pSrc->subWindowMode;
+	pRowSrc = CreatePicture(0, pSrc->pDrawable, pSrc->pFormat,
+				CPRepeat | CPSubwindowMode, attr, serverClient,
+				&error);
+	if (!pRowSrc)
+		return FALSE;
+
+	t.matrix[1][1] = xFixed1;
+	t.matrix[1][2] = ry0 * xFixed1;
+	SetPictureTransform(pRowSrc, &t);
+	SetPictureFilter(pRowSrc, FilterConvolution, strlen(FilterConvolution),
+			 row, 2 + xFixedToInt(row[0]));
+
+	prpix = nouveau_conv_scratch(pScreen, pFormat, width, ry1 - ry0, &pRow);
+	if (!prpix)
+		goto out;
+
+	/* then the intermediate is filtered and scaled in y */
+	t.matrix[0][0] = xFixed1;
+	t.matrix[0][2] = 0;
+	t.matrix[1][1] = xDoubleToFixed(sy);
+	t.matrix[1][2] = xDoubleToFixed(oy) - ry0 * xFixed1;
+	SetPictureTransform(pRow, &t);
+	SetPictureFilter(pRow, FilterConvolution, strlen(FilterConvolution),
+			 col, 2 + xFixedToInt(col[1]));
+
+	if (!exa->CheckComposite(PictOpSrc, pRowSrc, NULL, pRow) ||
+	    !exa->CheckComposite(op, pRow, pMask, pDst))
+		goto out;
+
+	ValidatePicture(pRowSrc);
+	ValidatePicture(pRow);
+	CompositePicture(PictOpSrc, pRowSrc, NULL, pRow, xSrc, 0, 0, 0, 0, 0,
+			 width, ry1 - ry0);
+	CompositePicture(op, pRow, pMask, pDst, 0, ySrc, xMask, yMask,
+			 xDst, yDst, width, height);
+	ret = TRUE;
+out:
+	if (pRow)
+		FreePicture(pRow, 0);
+	if (prpix)
+		pScreen->DestroyPixmap(prpix);
+	FreePicture(pRowSrc, 0);
+	return ret;
+}
+
+static void
+nouveau_render_composite(CARD8 op, PicturePtr pSrc, PicturePtr pMask,
+			 PicturePtr pDst, INT16 xSrc, INT16 ySrc,
+			 INT16 xMask, INT16 yMask, INT16 xDst, INT16 yDst,
+			 CARD16 width, CARD16 height)
+{
+	ScreenPtr pScreen = pDst->pDrawable->pScreen;
+	PictureScreenPtr ps = GetPictureScreen(pScreen);
+	struct nouveau_render *priv = nouveau_render_priv(pScreen);
+
+	if (pSrc->filter == PictFilterConvolution &&
+	    nouveau_conv_composite(pScreen, op, pSrc, pMask, pDst,
+				   xSrc, ySrc, xMask, yMask, xDst, yDst,
+				   width, height))
+		return;
+
+	ps->Composite = priv->Composite;
+	ps->Composite(op, pSrc, pMask, pDst, xSrc, ySrc, xMask, yMask,
+		      xDst, yDst, width, height);
+	ps->Composite = nouveau_render_composite;
+}
+
+void
+nouveau_render_fini(ScreenPtr pScreen)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	PictureScreenPtr ps = GetPictureScreen(pScreen);
+	struct nouveau_render *priv = pNv->render;
+
+	if (!priv)
+		return;
+
+	ps->Composite = priv->Composite;
+	pNv->render = NULL;
+	free(priv);
+}
+
+Bool
+nouveau_render_init(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	PictureScreenPtr ps = GetPictureScreen(pScreen);
+	struct nouveau_render *priv;
+
+	/* Both passes are convolution composites, which only NV50 has a
+	 * fragment program for, see nv50_fp.c.
+	 */
+	if (!ps || pNv->Architecture != NV_TESLA)
+		return FALSE;
+
+	priv = pNv->render = calloc(1, sizeof(*priv));
+	if (!priv)
+		return FALSE;
+
+	priv->Composite = ps->Composite;
+	ps->Composite = nouveau_render_composite;
+	return TRUE;
+}
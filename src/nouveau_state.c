@@ -0,0 +1,215 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Redundant state filter.  Every composite and Xv frame re-sends its
+ * render target, blend and shader selection, which is almost always what
+ * the 3D engine already has.  State methods written with
+ * nouveau_state_data() are remembered per subchannel, and only the words
+ * that actually changed go out.
+ *
+ * Methods that do something when written (as opposed to just latching a
+ * value) are never filtered, see the tables below.  What we
+ * remember is forgotten whenever the pushbuf is submitted, so nothing
+ * relies on the GPU still having a value from an earlier submission.
+ */
+
+#include "nv_include.h"
+
+struct nouveau_state_range {
+	int start;
+	int end;
+};
+
+/* Method ranges (inclusive, in bytes) that trigger work or stream data */
+static const struct nouveau_state_range
+nouveau_state_nv50[] = {
+	{ 0x0000, 0x01fc },	/* object binding, NOP, notify, semaphores */
+	{ 0x0300, 0x08fc },	/* VTX_ATTR_*F immediate vertex data */
+	{ 0x0f00, 0x0f40 },	/* CB_ADDR, CB_DATA */
+	{ 0x1330, 0x1338 },	/* TSC_FLUSH, TIC_FLUSH, TEX_CACHE_CTL */
+	{ 0x1440, 0x1440 },	/* CODE_CB_FLUSH */
+	{ 0x15dc, 0x15e0 },	/* VERTEX_END_GL, VERTEX_BEGIN_GL */
+	{ 0x1640, 0x1640 },	/* VERTEX_DATA */
+	{ 0x19d0, 0x19d0 },	/* CLEAR_BUFFERS */
+	{ 0x1b0c, 0x1b0c },	/* QUERY_GET */
+	{ -1 }
+};
+
+static const struct nouveau_state_range
+nouveau_state_nvc0[] = {
+	{ 0x0000, 0x01fc },	/* object binding, NOP, notify, semaphores */
+	{ 0x114c, 0x116c },	/* VTX_ATTR_DEFINE, VTX_ATTR_DATA */
+	{ 0x1330, 0x1338 },	/* TSC_FLUSH, TIC_FLUSH, TEX_CACHE_CTL */
+	{ 0x1614, 0x1618 },	/* VERTEX_END_GL, VERTEX_BEGIN_GL */
+	{ 0x1640, 0x1640 },	/* VERTEX_DATA */
+	{ 0x19d0, 0x19d0 },	/* CLEAR_BUFFERS */
+	{ 0x1b0c, 0x1b0c },	/* QUERY_GET */
+	{ 0x238c, 0x23cc },	/* CB_POS, CB_DATA */
+	{ 0x3800, 0x3ffc },	/* MACRO */
+	{ -1 }
+};
+
+static inline int
+nouveau_state_test(const uint32_t *map, int i)
+{
+	return map[i / 32] & (1u << (i % 32));
+}
+
+/* The pushbuf has been submitted, see nouveau_push_kick() */
+void
+nouveau_state_reset(NVPtr pNv)
+{
+	int subc;
+
+	for (subc = 0; subc < 8; subc++) {
+		if (pNv->state[subc]) {
+			memset(pNv->state[subc]->valid, 0,
+			       sizeof(pNv->state[subc]->valid));
+		}
+	}
+}
+
+/* Write size words of state at mthd on subc, skipping everything before
+ * the first and after the last word that differs from what was written
+ * there last.  The caller has already made room for size + 1 words.
+ */
+void
+nouveau_state_data(NVPtr pNv, int subc, int mthd, int size,
+		   const uint32_t *data)
+{
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	struct nouveau_state *state = pNv->state[subc];
+	int base = mthd / 4, first, last, i;
+
+	if (!state || base + size > NOUVEAU_STATE_SLOTS) {
+		first = 0;
+		last = size - 1;
+	} else {
+		first = size;
+		last = -1;
+		for (i = 0; i < size; i++) {
+			int s = base + i;
+
+			if (nouveau_state_test(state->valid, s) &&
+			    state->value[s] == data[i])
+				continue;
+
+			if (!nouveau_state_test(state->fixed, s)) {
+				state->valid[s / 32] |= 1u << (s % 32);
+				state->value[s] = data[i];
+			}
+
+			if (first > i)
+				first = i;
+			last = i;
+		}
+
+		pNv->state_dropped += size - (last - first + 1);
+		if (last < first)
+			return;
+	}
+
+	pNv->state_emitted += last - first + 1;
+	if (pNv->Architecture >= NV_FERMI)
+		BEGIN_NVC0(push, subc, mthd + first * 4, last - first + 1);
+	else
+		BEGIN_NV04(push, subc, mthd + first * 4, last - first + 1);
+	PUSH_DATAp(push, &data[first], last - first + 1);
+}
+
+void
+nouveau_state_mthd(NVPtr pNv, int subc, int mthd, uint32_t data)
+{
+	nouveau_state_data(pNv, subc, mthd, 1, &data);
+}
+
+static struct nouveau_state *
+nouveau_state_new(const struct nouveau_state_range *fixed)
+{
+	struct nouveau_state *state;
+	int i;
+
+	state = calloc(1, sizeof(*state));
+	if (!state)
+		return NULL;
+
+	for (; fixed->start >= 0; fixed++) {
+		for (i = fixed->start / 4; i <= fixed->end / 4; i++)
+			state->fixed[i / 32] |= 1u << (i % 32);
+	}
+
+	return state;
+}
+
+Bool
+nouveau_state_init(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	const struct nouveau_state_range *fixed;
+	int subc;
+
+	if (!pNv->pushbuf || !pNv->Nv3D ||
+	    !xf86ReturnOptValBool(pNv->Options, OPTION_STATE_FILTER, TRUE))
+		return FALSE;
+
+	/* The composite and Xv paths are the only users, on the 3D class */
+	if (pNv->Architecture < NV_TESLA)
+		return FALSE;
+
+	if (pNv->Architecture < NV_FERMI) {
+		fixed = nouveau_state_nv50;
+		subc = 7;
+	} else {
+		fixed = nouveau_state_nvc0;
+		subc = 0;
+	}
+
+	pNv->state[subc] = nouveau_state_new(fixed);
+	if (!pNv->state[subc])
+		return FALSE;
+
+	xf86DrvMsg(pScrn->scrnIndex, X_INFO,
+		   "[STATE] Redundant state filtering enabled\n");
+	return TRUE;
+}
+
+void
+nouveau_state_fini(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		if (pNv->state[i]) {
+			free(pNv->state[i]);
+			pNv->state[i] = NULL;
+		}
+	}
+
+	if (pNv->state_emitted || pNv->state_dropped) {
+		xf86DrvMsg(pScrn->scrnIndex, X_INFO,
+			   "[STATE] %u state words sent, %u dropped\n",
+			   pNv->state_emitted, pNv->state_dropped);
+	}
+}
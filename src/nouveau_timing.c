@@ -0,0 +1,374 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* GPU timing of acceleration operations (Option "GPUTiming", NV50+).
+ *
+ * Each operation, from its Prepare hook to its Done hook, is bracketed by
+ * a pair of 3D engine QUERY_GETs that write the GPU timer into a small
+ * GART buffer.  Nothing waits for them: the oldest outstanding pairs are
+ * picked up whenever the GPU has got around to writing them, and added
+ * to a per-operation histogram of GPU time, next to one of the CPU time
+ * spent building the commands.  Long GPU times point at the hardware,
+ * long CPU times at command building, and both short while things are
+ * still slow at submission or synchronisation.
+ *
+ * The histograms are logged when the screen closes, and kept up to date
+ * in the NOUVEAU_GPU_TIMING property on the root window.  That's an
+ * array of 32-bit integers: a version (1), the number of operations and
+ * of buckets, then per operation its count, total GPU and CPU time in
+ * microseconds, and the GPU and CPU histograms.  Bucket 0 counts times
+ * below 1us, bucket n those from 2^(n-1)us up to 2^n us, and the last one
+ * everything longer.
+ */
+
+#include "nv_include.h"
+
+#include <X11/Xatom.h>
+#include "property.h"
+
+#include "hwdefs/nv_object.xml.h"
+#include "hwdefs/nv50_3d.xml.h"
+
+#define TIMING_PENDING	256		/* operations in flight */
+#define TIMING_BUCKETS	20
+#define TIMING_VERSION	1
+#define TIMING_PROPERTY	"NOUVEAU_GPU_TIMING"
+
+/* A QUERY_GET report: sequence, unused, 64-bit GPU timer in ns */
+struct nouveau_timing_report {
+	uint32_t sequence;
+	uint32_t pad;
+	uint64_t time;
+};
+
+struct nouveau_timing_hist {
+	uint32_t count;
+	uint64_t gpu_ns;
+	uint64_t cpu_us;
+	uint32_t gpu[TIMING_BUCKETS];
+	uint32_t cpu[TIMING_BUCKETS];
+};
+
+struct nouveau_timing {
+	struct nouveau_bo *bo;
+	uint32_t sequence;
+
+	struct {
+		uint32_t sequence;
+		int op;
+		CARD64 cpu;
+	} pending[TIMING_PENDING];
+	unsigned head;			/* next to be started */
+	unsigned tail;			/* oldest not yet resolved */
+	int active;			/* nesting depth, only the outer one counts */
+	Bool timed;			/* ... and has its entry at head - 1 */
+	unsigned lost;
+
+	struct nouveau_timing_hist hist[NOUVEAU_TIMING_OPS];
+	Bool changed;
+	CARD32 published;
+	Atom atom;
+};
+
+static const char *
+nouveau_timing_name[NOUVEAU_TIMING_OPS] = {
+	"Solid", "Copy", "Composite", "M2MF", "Xv"
+};
+
+static int
+nouveau_timing_bucket(uint64_t us)
+{
+	int bucket = 0;
+
+	while (us && bucket < TIMING_BUCKETS - 1) {
+		us >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+/* Write the GPU timer and sequence into report slot */
+static Bool
+nouveau_timing_query(NVPtr pNv, unsigned slot, uint32_t sequence)
+{
+	struct nouveau_timing *timing = pNv->timing;
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	struct nouveau_pushbuf_refn ref = {
+		timing->bo, NOUVEAU_BO_GART | NOUVEAU_BO_WR
+	};
+	uint64_t addr = timing->bo->offset +
+			slot * sizeof(struct nouveau_timing_report);
+
+	/* the operation's buffers have already been validated by now, so
+	 * this one goes straight onto the submission
+	 */
+	if (!PUSH_SPACE(push, 8) || nouveau_pushbuf_refn(push, &ref, 1))
+		return FALSE;
+
+	/* The query methods are at the same place on NVC0, see also
+	 * SUBC_3D() in nv50_accel.h and nvc0_accel.h.
+	 */
+	if (pNv->Architecture >= NV_FERMI) {
+		BEGIN_NVC0(push, 0, NV50_GRAPH_SERIALIZE, 1);
+		PUSH_DATA (push, 0);
+		BEGIN_NVC0(push, 0, NV50_3D_QUERY_ADDRESS_HIGH, 4);
+	} else {
+		BEGIN_NV04(push, 7, NV50_GRAPH_SERIALIZE, 1);
+		PUSH_DATA (push, 0);
+		BEGIN_NV04(push, 7, NV50_3D_QUERY_ADDRESS_HIGH, 4);
+	}
+	PUSH_DATA (push, addr >> 32);
+	PUSH_DATA (push, addr);
+	PUSH_DATA (push, sequence);
+	PUSH_DATA (push, NV50_3D_QUERY_GET_MODE_WRITE_UNK2 |
+			 NV50_3D_QUERY_GET_UNIT_STRMOUT);
+	return TRUE;
+}
+
+/* Account for every finished operation, oldest first */
+static void
+nouveau_timing_resolve(NVPtr pNv)
+{
+	struct nouveau_timing *timing = pNv->timing;
+	struct nouveau_timing_report *report = timing->bo->map;
+
+	while (timing->tail != timing->head) {
+		unsigned i = timing->tail % TIMING_PENDING;
+		uint32_t sequence = timing->pending[i].sequence;
+		struct nouveau_timing_hist *hist;
+		uint64_t ns;
+
+		if (timing->timed && timing->tail + 1 == timing->head)
+			break;
+		if (report[i * 2 + 0].sequence != sequence ||
+		    report[i * 2 + 1].sequence != sequence)
+			break;
+
+		ns = report[i * 2 + 1].time - report[i * 2 + 0].time;
+		hist = &timing->hist[timing->pending[i].op];
+		hist->count++;
+		hist->gpu_ns += ns;
+		hist->cpu_us += timing->pending[i].cpu;
+		hist->gpu[nouveau_timing_bucket(ns / 1000)]++;
+		hist->cpu[nouveau_timing_bucket(timing->pending[i].cpu)]++;
+		timing->changed = TRUE;
+		timing->tail++;
+	}
+}
+
+void
+nouveau_timing_begin(NVPtr pNv, int op)
+{
+	struct nouveau_timing *timing = pNv->timing;
+	unsigned i;
+
+	if (!timing || timing->active++)
+		return;
+
+	nouveau_timing_resolve(pNv);
+	if (timing->head - timing->tail == TIMING_PENDING) {
+		timing->tail++;
+		timing->lost++;
+	}
+
+	i = timing->head++ % TIMING_PENDING;
+	timing->pending[i].sequence = ++timing->sequence;
+	timing->pending[i].op = op;
+	timing->pending[i].cpu = GetTimeInMicros();
+
+	/* Without room for the query the operation just isn't timed */
+	timing->timed = nouveau_timing_query(pNv, i * 2 + 0, timing->sequence);
+	if (!timing->timed)
+		timing->head--;
+}
+
+void
+nouveau_timing_end(NVPtr pNv)
+{
+	struct nouveau_timing *timing = pNv->timing;
+	unsigned i;
+
+	if (!timing || !timing->active || --timing->active || !timing->timed)
+		return;
+
+	i = (timing->head - 1) % TIMING_PENDING;
+	timing->pending[i].cpu = GetTimeInMicros() - timing->pending[i].cpu;
+	timing->timed = FALSE;
+
+	if (!nouveau_timing_query(pNv, i * 2 + 1, timing->pending[i].sequence))
+		timing->head--;
+}
+
+/* Called from the block handler, refreshes the property once a second */
+void
+nouveau_timing_update(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	struct nouveau_timing *timing = pNv->timing;
+	uint32_t data[3 + NOUVEAU_TIMING_OPS * (3 + 2 * TIMING_BUCKETS)];
+	CARD32 now = GetTimeInMillis();
+	int op, b, n = 0;
+
+	if (!timing)
+		return;
+
+	nouveau_timing_resolve(pNv);
+	if (!timing->changed || now - timing->published < 1000 ||
+	    !pScreen->root)
+		return;
+
+	data[n++] = TIMING_VERSION;
+	data[n++] = NOUVEAU_TIMING_OPS;
+	data[n++] = TIMING_BUCKETS;
+	for (op = 0; op < NOUVEAU_TIMING_OPS; op++) {
+		struct nouveau_timing_hist *hist = &timing->hist[op];
+
+		data[n++] = hist->count;
+		data[n++] = hist->gpu_ns / 1000;
+		data[n++] = hist->cpu_us;
+		for (b = 0; b < TIMING_BUCKETS; b++)
+			data[n++] = hist->gpu[b];
+		for (b = 0; b < TIMING_BUCKETS; b++)
+			data[n++] = hist->cpu[b];
+	}
+
+	dixChangeWindowProperty(serverClient, pScreen->root, timing->atom,
+				XA_INTEGER, 32, PropModeReplace, n, data,
+				TRUE);
+	timing->changed = FALSE;
+	timing->published = now;
+}
+
+static void
+nouveau_timing_dump(ScrnInfoPtr pScrn)
+{
+	NVPtr pNv = NVPTR(pScrn);
+	struct nouveau_timing *timing = pNv->timing;
+	char line[TIMING_BUCKETS * 8];
+	int op, b, len;
+
+	xf86DrvMsg(pScrn->scrnIndex, X_INFO,
+		   "[TIMING] %u operations not resolved in time\n",
+		   timing->lost);
+
+	for (op = 0; op < NOUVEAU_TIMING_OPS; op++) {
+		struct nouveau_timing_hist *hist = &timing->hist[op];
+
+		if (!hist->count)
+			continue;
+
+		xf86DrvMsg(pScrn->scrnIndex, X_INFO,
+			   "[TIMING] %s: %u, GPU %llu us, CPU %llu us\n",
+			   nouveau_timing_name[op], hist->count,
+			   (unsigned long long)hist->gpu_ns / 1000,
+			   (unsigned long long)hist->cpu_us);
+
+		for (b = 0, len = 0; b < TIMING_BUCKETS; b++) {
+			len += snprintf(line + len, sizeof(line) - len,
+					" %u", hist->gpu[b]);
+		}
+		xf86DrvMsg(pScrn->scrnIndex, X_INFO,
+			   "[TIMING]   GPU log2(us):%s\n", line);
+
+		for (b = 0, len = 0; b < TIMING_BUCKETS; b++) {
+			len += snprintf(line + len, sizeof(line) - len,
+					" %u", hist->cpu[b]);
+		}
+		xf86DrvMsg(pScrn->scrnIndex, X_INFO,
+			   "[TIMING]   CPU log2(us):%s\n", line);
+	}
+}
+
+Bool
+nouveau_timing_init(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	struct nouveau_timing *timing;
+	int ret;
+
+	if (!xf86ReturnOptValBool(pNv->Options, OPTION_GPU_TIMING, FALSE))
+		return FALSE;
+
+	if (pNv->Architecture < NV_TESLA || !pNv->Nv3D) {
+		xf86DrvMsg(pScrn->scrnIndex, X_WARNING,
+			   "[TIMING] needs NV50 or newer acceleration\n");
+		return FALSE;
+	}
+
+	timing = calloc(1, sizeof(*timing));
+	if (!timing)
+		return FALSE;
+
+	ret = nouveau_bo_new(pNv->dev, NOUVEAU_BO_GART | NOUVEAU_BO_MAP, 0,
+			     TIMING_PENDING * 2 *
+			     sizeof(struct nouveau_timing_report),
+			     NULL, &timing->bo);
+	if (ret == 0)
+		ret = nouveau_bo_map(timing->bo, NOUVEAU_BO_RD, pNv->client);
+	if (ret) {
+		xf86DrvMsg(pScrn->scrnIndex, X_ERROR,
+			   "[TIMING] couldn't allocate query buffer: %d\n",
+			   ret);
+		nouveau_bo_ref(NULL, &timing->bo);
+		free(timing);
+		return FALSE;
+	}
+
+	memset(timing->bo->map, 0, timing->bo->size);
+	timing->atom = MakeAtom(TIMING_PROPERTY, strlen(TIMING_PROPERTY),
+				TRUE);
+	pNv->timing = timing;
+
+	xf86DrvMsg(pScrn->scrnIndex, X_CONFIG,
+		   "[TIMING] GPU timing of acceleration enabled\n");
+	return TRUE;
+}
+
+void
+nouveau_timing_fini(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	struct nouveau_timing *timing = pNv->timing;
+
+	if (!timing)
+		return;
+
+	/* Whatever is still outstanding gets a chance to land */
+	if (timing->head != timing->tail) {
+		PUSH_KICK(pNv->pushbuf);
+		nouveau_bo_wait(timing->bo, NOUVEAU_BO_RD, pNv->client);
+	}
+	if (timing->timed) {
+		timing->head--;
+		timing->timed = FALSE;
+	}
+	nouveau_timing_resolve(pNv);
+	nouveau_timing_dump(pScrn);
+
+	nouveau_bo_ref(NULL, &timing->bo);
+	free(timing);
+	pNv->timing = NULL;
+}
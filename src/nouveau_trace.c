@@ -0,0 +1,507 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Acceleration trace.  With Option "AccelTrace" set to a file name, every
+ * call EXA makes into the driver's solid, copy, composite, upload and
+ * download hooks is appended to that file, along with the pixmaps they
+ * were made on and what each call cost: the command words it wrote, the
+ * submissions it made on any channel and the CPU time the X server
+ * thread spent in it.  tools/nvtrace-replay
+ * summarises a trace, or replays it through a running X server so the
+ * same desktop workload can be timed again after a change.
+ *
+ * We wrap the hooks in the ExaDriverRec after nouveau_exa_init() has
+ * filled it in.  Calls the hooks make to each other, such as a composite
+ * reduced to a solid fill, are part of the outer call and not recorded.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "nouveau_trace.h"
+
+static struct {
+	FILE *file;
+	int users;
+	int busy;
+	uint32_t pixmaps;
+
+	/* when the call being recorded started */
+	uint64_t words;
+	unsigned kicks;
+	uint64_t ns;
+
+	Bool (*PrepareSolid)(PixmapPtr, int, Pixel, Pixel);
+	void (*Solid)(PixmapPtr, int, int, int, int);
+	void (*DoneSolid)(PixmapPtr);
+	Bool (*PrepareCopy)(PixmapPtr, PixmapPtr, int, int, int, Pixel);
+	void (*Copy)(PixmapPtr, int, int, int, int, int, int);
+	void (*DoneCopy)(PixmapPtr);
+	Bool (*PrepareComposite)(int, PicturePtr, PicturePtr, PicturePtr,
+				 PixmapPtr, PixmapPtr, PixmapPtr);
+	void (*Composite)(PixmapPtr, int, int, int, int, int, int, int, int);
+	void (*DoneComposite)(PixmapPtr);
+	Bool (*UploadToScreen)(PixmapPtr, int, int, int, int, char *, int);
+	Bool (*DownloadFromScreen)(PixmapPtr, int, int, int, int, char *, int);
+	void (*DestroyPixmap)(ScreenPtr, void *);
+} trace;
+
+static uint64_t
+nouveau_trace_ns(void)
+{
+	struct timespec ts;
+
+	/* not waiting on the GPU or for another process to be scheduled */
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+nouveau_trace_write(uint32_t type, const uint32_t *data, size_t ndata)
+{
+	uint32_t rec[2] = { type, ndata };
+
+	if (!trace.file)
+		return;
+
+	if (fwrite(rec, 4, 2, trace.file) != 2 ||
+	    fwrite(data, 4, ndata, trace.file) != ndata) {
+		ErrorF("nouveau: acceleration trace failed, stopping\n");
+		fclose(trace.file);
+		trace.file = NULL;
+	}
+}
+
+/* Whether this call is to be recorded, and if so, start costing it */
+static Bool
+nouveau_trace_begin(NVPtr pNv)
+{
+	if (trace.busy || !trace.file)
+		return FALSE;
+
+	trace.busy = 1;
+	nouveau_push_count(pNv, &trace.words, &trace.kicks);
+	trace.ns = nouveau_trace_ns();
+	return TRUE;
+}
+
+/* data has room for the three words of cost after the first n */
+static void
+nouveau_trace_end(NVPtr pNv, uint32_t type, uint32_t *data, int n)
+{
+	uint64_t ns = nouveau_trace_ns(), words;
+	unsigned kicks;
+
+	nouveau_push_count(pNv, &words, &kicks);
+	data[n++] = words - trace.words;
+	data[n++] = kicks - trace.kicks;
+	data[n++] = ns - trace.ns;
+	trace.busy = 0;
+
+	nouveau_trace_write(type, data, n);
+}
+
+static uint32_t
+nouveau_trace_pixmap(PixmapPtr ppix)
+{
+	struct nouveau_pixmap *nvpix = ppix ? nouveau_pixmap(ppix) : NULL;
+	ScreenPtr pScreen;
+	uint32_t data[7];
+
+	if (!nvpix)
+		return 0;
+	if (nvpix->trace_id)
+		return nvpix->trace_id;
+
+	pScreen = ppix->drawable.pScreen;
+	nvpix->trace_id = ++trace.pixmaps;
+
+	data[0] = nvpix->trace_id;
+	data[1] = ppix->drawable.width;
+	data[2] = ppix->drawable.height;
+	data[3] = ppix->drawable.depth;
+	data[4] = ppix->drawable.bitsPerPixel;
+	data[5] = ppix->devKind;
+	data[6] = 0;
+	if (ppix == pScreen->GetScreenPixmap(pScreen))
+		data[6] |= NOUVEAU_TRACE_PIXMAP_SCREEN;
+	if (nvpix->bo && nv50_style_tiled_pixmap(ppix))
+		data[6] |= NOUVEAU_TRACE_PIXMAP_TILED;
+
+	nouveau_trace_write(NOUVEAU_TRACE_PIXMAP, data, 7);
+	return nvpix->trace_id;
+}
+
+static int
+nouveau_trace_picture(uint32_t *data, PicturePtr ppict, PixmapPtr ppix)
+{
+	int n = 0, i;
+
+	data[n++] = nouveau_trace_pixmap(ppix);
+	data[n++] = ppict ? ppict->format : 0;
+	data[n++] = 0;
+	if (!ppict)
+		return n;
+
+	if (ppict->repeat)
+		data[2] |= ppict->repeatType + 1;
+	data[2] |= (ppict->filter & 0xf) << 4;
+	if (ppict->componentAlpha)
+		data[2] |= NOUVEAU_TRACE_PICT_CA;
+
+	if (ppict->transform) {
+		data[2] |= NOUVEAU_TRACE_PICT_TRANSFORM;
+		for (i = 0; i < 9; i++)
+			data[n++] = ppict->transform->matrix[i / 3][i % 3];
+	}
+
+	return n;
+}
+
+static Bool
+nouveau_trace_prepare_solid(PixmapPtr ppix, int alu, Pixel planemask,
+			    Pixel fg)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(ppix->drawable.pScreen));
+	uint32_t data[8];
+	Bool ret;
+
+	if (trace.busy || !trace.file)
+		return trace.PrepareSolid(ppix, alu, planemask, fg);
+
+	data[0] = nouveau_trace_pixmap(ppix);
+	data[1] = alu;
+	data[2] = planemask;
+	data[3] = fg;
+
+	nouveau_trace_begin(pNv);
+	ret = trace.PrepareSolid(ppix, alu, planemask, fg);
+	data[4] = ret;
+	nouveau_trace_end(pNv, NOUVEAU_TRACE_PREPARE_SOLID, data, 5);
+	return ret;
+}
+
+static void
+nouveau_trace_solid(PixmapPtr ppix, int x1, int y1, int x2, int y2)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(ppix->drawable.pScreen));
+	uint32_t data[7] = { x1, y1, x2, y2 };
+
+	if (!nouveau_trace_begin(pNv)) {
+		trace.Solid(ppix, x1, y1, x2, y2);
+		return;
+	}
+
+	trace.Solid(ppix, x1, y1, x2, y2);
+	nouveau_trace_end(pNv, NOUVEAU_TRACE_SOLID, data, 4);
+}
+
+static void
+nouveau_trace_done_solid(PixmapPtr ppix)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(ppix->drawable.pScreen));
+	uint32_t data[3];
+
+	if (!nouveau_trace_begin(pNv)) {
+		trace.DoneSolid(ppix);
+		return;
+	}
+
+	trace.DoneSolid(ppix);
+	nouveau_trace_end(pNv, NOUVEAU_TRACE_DONE_SOLID, data, 0);
+}
+
+static Bool
+nouveau_trace_prepare_copy(PixmapPtr pspix, PixmapPtr pdpix, int xdir,
+			   int ydir, int alu, Pixel planemask)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pdpix->drawable.pScreen));
+	uint32_t data[10];
+	Bool ret;
+
+	if (trace.busy || !trace.file) {
+		return trace.PrepareCopy(pspix, pdpix, xdir, ydir,
+					 alu, planemask);
+	}
+
+	data[0] = nouveau_trace_pixmap(pspix);
+	data[1] = nouveau_trace_pixmap(pdpix);
+	data[2] = xdir;
+	data[3] = ydir;
+	data[4] = alu;
+	data[5] = planemask;
+
+	nouveau_trace_begin(pNv);
+	ret = trace.PrepareCopy(pspix, pdpix, xdir, ydir, alu, planemask);
+	data[6] = ret;
+	nouveau_trace_end(pNv, NOUVEAU_TRACE_PREPARE_COPY, data, 7);
+	return ret;
+}
+
+static void
+nouveau_trace_copy(PixmapPtr pdpix, int sx, int sy, int dx, int dy,
+		   int w, int h)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pdpix->drawable.pScreen));
+	uint32_t data[9] = { sx, sy, dx, dy, w, h };
+
+	if (!nouveau_trace_begin(pNv)) {
+		trace.Copy(pdpix, sx, sy, dx, dy, w, h);
+		return;
+	}
+
+	trace.Copy(pdpix, sx, sy, dx, dy, w, h);
+	nouveau_trace_end(pNv, NOUVEAU_TRACE_COPY, data, 6);
+}
+
+static void
+nouveau_trace_done_copy(PixmapPtr ppix)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(ppix->drawable.pScreen));
+	uint32_t data[3];
+
+	if (!nouveau_trace_begin(pNv)) {
+		trace.DoneCopy(ppix);
+		return;
+	}
+
+	trace.DoneCopy(ppix);
+	nouveau_trace_end(pNv, NOUVEAU_TRACE_DONE_COPY, data, 0);
+}
+
+static Bool
+nouveau_trace_prepare_composite(int op, PicturePtr pspict,
+				PicturePtr pmpict, PicturePtr pdpict,
+				PixmapPtr pspix, PixmapPtr pmpix,
+				PixmapPtr pdpix)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pdpix->drawable.pScreen));
+	uint32_t data[1 + 3 * 12 + 1 + 3];
+	Bool ret;
+	int n = 0;
+
+	if (trace.busy || !trace.file) {
+		return trace.PrepareComposite(op, pspict, pmpict, pdpict,
+					      pspix, pmpix, pdpix);
+	}
+
+	data[n++] = op;
+	n += nouveau_trace_picture(&data[n], pspict, pspix);
+	n += nouveau_trace_picture(&data[n], pmpict, pmpix);
+	n += nouveau_trace_picture(&data[n], pdpict, pdpix);
+
+	nouveau_trace_begin(pNv);
+	ret = trace.PrepareComposite(op, pspict, pmpict, pdpict,
+				     pspix, pmpix, pdpix);
+	data[n++] = ret;
+	nouveau_trace_end(pNv, NOUVEAU_TRACE_PREPARE_COMPOSITE, data, n);
+	return ret;
+}
+
+static void
+nouveau_trace_composite(PixmapPtr pdpix, int sx, int sy, int mx, int my,
+			int dx, int dy, int w, int h)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pdpix->drawable.pScreen));
+	uint32_t data[11] = { sx, sy, mx, my, dx, dy, w, h };
+
+	if (!nouveau_trace_begin(pNv)) {
+		trace.Composite(pdpix, sx, sy, mx, my, dx, dy, w, h);
+		return;
+	}
+
+	trace.Composite(pdpix, sx, sy, mx, my, dx, dy, w, h);
+	nouveau_trace_end(pNv, NOUVEAU_TRACE_COMPOSITE, data, 8);
+}
+
+static void
+nouveau_trace_done_composite(PixmapPtr ppix)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(ppix->drawable.pScreen));
+	uint32_t data[3];
+
+	if (!nouveau_trace_begin(pNv)) {
+		trace.DoneComposite(ppix);
+		return;
+	}
+
+	trace.DoneComposite(ppix);
+	nouveau_trace_end(pNv, NOUVEAU_TRACE_DONE_COMPOSITE, data, 0);
+}
+
+static Bool
+nouveau_trace_upload(PixmapPtr pdpix, int x, int y, int w, int h,
+		     char *src, int src_pitch)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pdpix->drawable.pScreen));
+	uint32_t data[10];
+	Bool ret;
+
+	if (trace.busy || !trace.file)
+		return trace.UploadToScreen(pdpix, x, y, w, h, src, src_pitch);
+
+	data[0] = nouveau_trace_pixmap(pdpix);
+	data[1] = x;
+	data[2] = y;
+	data[3] = w;
+	data[4] = h;
+	data[5] = src_pitch;
+
+	nouveau_trace_begin(pNv);
+	ret = trace.UploadToScreen(pdpix, x, y, w, h, src, src_pitch);
+	data[6] = ret;
+	nouveau_trace_end(pNv, NOUVEAU_TRACE_UPLOAD, data, 7);
+	return ret;
+}
+
+static Bool
+nouveau_trace_download(PixmapPtr pspix, int x, int y, int w, int h,
+		       char *dst, int dst_pitch)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pspix->drawable.pScreen));
+	uint32_t data[10];
+	Bool ret;
+
+	if (trace.busy || !trace.file) {
+		return trace.DownloadFromScreen(pspix, x, y, w, h,
+						dst, dst_pitch);
+	}
+
+	data[0] = nouveau_trace_pixmap(pspix);
+	data[1] = x;
+	data[2] = y;
+	data[3] = w;
+	data[4] = h;
+	data[5] = dst_pitch;
+
+	nouveau_trace_begin(pNv);
+	ret = trace.DownloadFromScreen(pspix, x, y, w, h, dst, dst_pitch);
+	data[6] = ret;
+	nouveau_trace_end(pNv, NOUVEAU_TRACE_DOWNLOAD, data, 7);
+	return ret;
+}
+
+static void
+nouveau_trace_destroy_pixmap(ScreenPtr pScreen, void *priv)
+{
+	struct nouveau_pixmap *nvpix = priv;
+
+	if (nvpix && nvpix->trace_id)
+		nouveau_trace_write(NOUVEAU_TRACE_FREE, &nvpix->trace_id, 1);
+
+	trace.DestroyPixmap(pScreen, priv);
+}
+
+/* Called by nouveau_exa_init() once it has filled in exa */
+Bool
+nouveau_trace_init(ScreenPtr pScreen, ExaDriverPtr exa)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	const char *name;
+
+	name = xf86GetOptValString(pNv->Options, OPTION_ACCEL_TRACE);
+	if (!name)
+		return FALSE;
+
+	if (!trace.file) {
+		uint32_t head[3] = { NOUVEAU_TRACE_MAGIC,
+				     NOUVEAU_TRACE_VERSION,
+				     pNv->dev->chipset };
+
+		trace.file = fopen(name, "wb");
+		if (!trace.file || fwrite(head, 4, 3, trace.file) != 3) {
+			xf86DrvMsg(pScrn->scrnIndex, X_ERROR,
+				   "[TRACE] couldn't open %s\n", name);
+			if (trace.file)
+				fclose(trace.file);
+			trace.file = NULL;
+			return FALSE;
+		}
+	}
+	trace.users++;
+
+	/* every screen is using the same functions */
+	trace.PrepareSolid = exa->PrepareSolid;
+	trace.Solid = exa->Solid;
+	trace.DoneSolid = exa->DoneSolid;
+	exa->PrepareSolid = nouveau_trace_prepare_solid;
+	exa->Solid = nouveau_trace_solid;
+	exa->DoneSolid = nouveau_trace_done_solid;
+
+	trace.PrepareCopy = exa->PrepareCopy;
+	trace.Copy = exa->Copy;
+	trace.DoneCopy = exa->DoneCopy;
+	exa->PrepareCopy = nouveau_trace_prepare_copy;
+	exa->Copy = nouveau_trace_copy;
+	exa->DoneCopy = nouveau_trace_done_copy;
+
+	if (exa->PrepareComposite) {
+		trace.PrepareComposite = exa->PrepareComposite;
+		trace.Composite = exa->Composite;
+		trace.DoneComposite = exa->DoneComposite;
+		exa->PrepareComposite = nouveau_trace_prepare_composite;
+		exa->Composite = nouveau_trace_composite;
+		exa->DoneComposite = nouveau_trace_done_composite;
+	}
+
+	trace.UploadToScreen = exa->UploadToScreen;
+	trace.DownloadFromScreen = exa->DownloadFromScreen;
+	trace.DestroyPixmap = exa->DestroyPixmap;
+	exa->UploadToScreen = nouveau_trace_upload;
+	exa->DownloadFromScreen = nouveau_trace_download;
+	exa->DestroyPixmap = nouveau_trace_destroy_pixmap;
+
+	xf86DrvMsg(pScrn->scrnIndex, X_CONFIG,
+		   "[TRACE] recording acceleration calls to %s\n", name);
+	return TRUE;
+}
+
+/* Called from the block handler, so that the file is whole up to the
+ * last request the server finished without a write for every operation.
+ */
+void
+nouveau_trace_update(ScreenPtr pScreen)
+{
+	if (trace.file && fflush(trace.file)) {
+		ErrorF("nouveau: acceleration trace failed, stopping\n");
+		fclose(trace.file);
+		trace.file = NULL;
+	}
+}
+
+/* The hooks stay wrapped until EXA goes away, they just stop recording */
+void
+nouveau_trace_fini(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+
+	if (!pNv->EXADriverPtr ||
+	    pNv->EXADriverPtr->PrepareSolid != nouveau_trace_prepare_solid)
+		return;
+
+	if (--trace.users == 0 && trace.file) {
+		fclose(trace.file);
+		trace.file = NULL;
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef __NVDDX_TRACE_H__
+#define __NVDDX_TRACE_H__
+
+#include "nv_include.h"
+
+/* Trace file layout, host-endian 32-bit words like the pushbuf capture:
+ * a header, followed by records of the form { type, length } plus length
+ * words of payload:
+ *
+ * header:            NOUVEAU_TRACE_MAGIC, NOUVEAU_TRACE_VERSION, chipset
+ * PIXMAP:            pixmap, width, height, depth, bpp, pitch, flags
+ * FREE:              pixmap
+ * PREPARE_SOLID:     pixmap, alu, planemask, fg, result, cost
+ * SOLID:             x1, y1, x2, y2, cost
+ * DONE_SOLID:        cost
+ * PREPARE_COPY:      src, dst, xdir, ydir, alu, planemask, result, cost
+ * COPY:              sx, sy, dx, dy, w, h, cost
+ * DONE_COPY:         cost
+ * PREPARE_COMPOSITE: op, picture for each of src, mask, dst, result, cost
+ * COMPOSITE:         sx, sy, mx, my, dx, dy, w, h, cost
+ * DONE_COMPOSITE:    cost
+ * UPLOAD:            pixmap, x, y, w, h, pitch, result, cost
+ * DOWNLOAD:          pixmap, x, y, w, h, pitch, result, cost
+ *
+ * Pixmaps are numbered from 1 in the order they're first used, and get a
+ * PIXMAP record then; 0 means none.  A picture is its pixmap, format and
+ * NOUVEAU_TRACE_PICT_* flags, then the 3x3 transform if it has one.  The
+ * cost of a call is the command words it wrote and the submissions it made,
+ * counting the copy engine channels, and the CPU time the server's thread
+ * spent in it in ns.
+ */
+#define NOUVEAU_TRACE_MAGIC   0x4e565452 /* "NVTR" */
+#define NOUVEAU_TRACE_VERSION 2
+
+#define NOUVEAU_TRACE_PIXMAP            1
+#define NOUVEAU_TRACE_FREE              2
+#define NOUVEAU_TRACE_PREPARE_SOLID     3
+#define NOUVEAU_TRACE_SOLID             4
+#define NOUVEAU_TRACE_DONE_SOLID        5
+#define NOUVEAU_TRACE_PREPARE_COPY      6
+#define NOUVEAU_TRACE_COPY              7
+#define NOUVEAU_TRACE_DONE_COPY         8
+#define NOUVEAU_TRACE_PREPARE_COMPOSITE 9
+#define NOUVEAU_TRACE_COMPOSITE         10
+#define NOUVEAU_TRACE_DONE_COMPOSITE    11
+#define NOUVEAU_TRACE_UPLOAD            12
+#define NOUVEAU_TRACE_DOWNLOAD          13
+
+#define NOUVEAU_TRACE_PIXMAP_SCREEN     0x00000001
+#define NOUVEAU_TRACE_PIXMAP_TILED      0x00000002
+
+#define NOUVEAU_TRACE_PICT_REPEAT(f)    ((f) & 0xf) /* repeatType + 1 */
+#define NOUVEAU_TRACE_PICT_FILTER(f)    (((f) >> 4) & 0xf)
+#define NOUVEAU_TRACE_PICT_TRANSFORM    0x00000100
+#define NOUVEAU_TRACE_PICT_CA           0x00000200
+
+Bool nouveau_trace_init(ScreenPtr, ExaDriverPtr);
+void nouveau_trace_fini(ScreenPtr);
+void nouveau_trace_update(ScreenPtr);
+
+#endif
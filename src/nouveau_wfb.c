@@ -26,6 +26,7 @@
  */
 
 #include "nv_include.h"
+#include "nouveau_cpu.h"
 
 struct wfb_pixmap {
 	PixmapPtr ppix;
@@ -54,17 +55,12 @@ nouveau_wfb_wr_linear(void *dst, FbBits value, int size)
 	memcpy(dst, &value, size);
 }
 
-#define TP 6
-#define TH wfb->tile_height
-#define TPM ((1 << TP) - 1)
-#define THM ((1 << TH) - 1)
-
 static FbBits
 nouveau_wfb_rd_tiled(const void *ptr, int size) {
 	unsigned long offset = (unsigned long)ptr;
 	struct wfb_pixmap *wfb = NULL;
 	FbBits bits = 0;
-	int x, y, i;
+	int i;
 
 	for (i = 0; i < 6; i++) {
 		if (offset >= wfb_pixmap[i].base &&
@@ -77,14 +73,9 @@ nouveau_wfb_rd_tiled(const void *ptr, int size) {
 	if (!wfb || !wfb->pitch)
 		return nouveau_wfb_rd_linear(ptr, size);
 
-	offset -= wfb->base;
-
-	y = (offset * wfb->multiply_factor) >> 36;
-	x = offset - y * wfb->pitch;
-
-	offset  = (x >> TP) + ((y >> TH) * wfb->horiz_tiles);
-	offset *= (1 << (TH + TP));
-	offset += ((y & THM) * (1 << TP)) + (x & TPM);
+	offset = nouveau_wfb_tiled_offset(offset - wfb->base, wfb->pitch,
+					  wfb->multiply_factor,
+					  wfb->tile_height, wfb->horiz_tiles);
 
 	memcpy(&bits, (void *)wfb->base + offset, size);
 	return bits;
@@ -94,7 +85,7 @@ static void
 nouveau_wfb_wr_tiled(void *ptr, FbBits value, int size) {
 	unsigned long offset = (unsigned long)ptr;
 	struct wfb_pixmap *wfb = NULL;
-	int x, y, i;
+	int i;
 
 	for (i = 0; i < 6; i++) {
 		if (offset >= wfb_pixmap[i].base &&
@@ -109,14 +100,9 @@ nouveau_wfb_wr_tiled(void *ptr, FbBits value, int size) {
 		return;
 	}
 
-	offset -= wfb->base;
-
-	y = (offset * wfb->multiply_factor) >> 36;
-	x = offset - y * wfb->pitch;
-
-	offset  = (x >> TP) + ((y >> TH) * wfb->horiz_tiles);
-	offset *= (1 << (TH + TP));
-	offset += ((y & THM) * (1 << TP)) + (x & TPM);
+	offset = nouveau_wfb_tiled_offset(offset - wfb->base, wfb->pitch,
+					  wfb->multiply_factor,
+					  wfb->tile_height, wfb->horiz_tiles);
 
 	memcpy((void *)wfb->base + offset, &value, size);
 }
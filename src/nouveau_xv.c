@@ -25,10 +25,6 @@
 #include "config.h"
 #endif
 
-#ifdef __SSE2__
-#include <immintrin.h>
-#endif
-
 #include "xf86xv.h"
 #include <X11/extensions/Xv.h>
 #include "exa.h"
@@ -38,6 +34,7 @@
 
 #include "nv_include.h"
 #include "nv_dma.h"
+#include "nouveau_cpu.h"
 
 #include "vl_hwmc.h"
 
@@ -545,149 +542,6 @@ NVQueryBestSize(ScrnInfoPtr pScrn, Bool motion,
 	*p_h = drw_h;
 }
 
-/**
- * NVCopyData420
- * used to convert YV12 to YUY2 for the blitter and NV04 overlay.
- * The U and V samples generated are linearly interpolated on the vertical
- * axis for better quality
- *
- * @param src1 source buffer of luma
- * @param src2 source buffer of chroma1
- * @param src3 source buffer of chroma2
- * @param dst1 destination buffer
- * @param srcPitch pitch of src1
- * @param srcPitch2 pitch of src2, src3
- * @param dstPitch pitch of dst1
- * @param h number of lines to copy
- * @param w length of lines to copy
- */
-static inline void
-NVCopyData420(unsigned char *src1, unsigned char *src2, unsigned char *src3,
-	      unsigned char *dst1, int srcPitch, int srcPitch2, int dstPitch,
-	      int h, int w)
-{
-	CARD32 *dst;
-	CARD8 *s1, *s2, *s3;
-	int i, j;
-
-#define su(X) (((j & 1) && j < (h-1)) ? ((unsigned)((signed int)s2[X] +        \
-		(signed int)(s2 + srcPitch2)[X]) / 2) : (s2[X]))
-#define sv(X) (((j & 1) && j < (h-1)) ? ((unsigned)((signed int)s3[X] +        \
-		(signed int)(s3 + srcPitch2)[X]) / 2) : (s3[X]))
-
-	w >>= 1;
-
-	for (j = 0; j < h; j++) {
-		dst = (CARD32*)dst1;
-		s1 = src1;  s2 = src2;  s3 = src3;
-		i = w;
-
-		while (i > 4) {
-#if X_BYTE_ORDER == X_BIG_ENDIAN
-		dst[0] = (s1[0] << 24) | (s1[1] << 8) | (sv(0) << 16) | su(0);
-		dst[1] = (s1[2] << 24) | (s1[3] << 8) | (sv(1) << 16) | su(1);
-		dst[2] = (s1[4] << 24) | (s1[5] << 8) | (sv(2) << 16) | su(2);
-		dst[3] = (s1[6] << 24) | (s1[7] << 8) | (sv(3) << 16) | su(3);
-#else
-		dst[0] = s1[0] | (s1[1] << 16) | (sv(0) << 8) | (su(0) << 24);
-		dst[1] = s1[2] | (s1[3] << 16) | (sv(1) << 8) | (su(1) << 24);
-		dst[2] = s1[4] | (s1[5] << 16) | (sv(2) << 8) | (su(2) << 24);
-		dst[3] = s1[6] | (s1[7] << 16) | (sv(3) << 8) | (su(3) << 24);
-#endif
-		dst += 4; s2 += 4; s3 += 4; s1 += 8;
-		i -= 4;
-		}
-
-		while (i--) {
-#if X_BYTE_ORDER == X_BIG_ENDIAN
-		dst[0] = (s1[0] << 24) | (s1[1] << 8) | (sv(0) << 16) | su(0);
-#else
-		dst[0] = s1[0] | (s1[1] << 16) | (sv(0) << 8) | (su(0) << 24);
-#endif
-		dst++; s2++; s3++;
-		s1 += 2;
-		}
-
-		dst1 += dstPitch;
-		src1 += srcPitch;
-		if (j & 1) {
-			src2 += srcPitch2;
-			src3 += srcPitch2;
-		}
-	}
-}
-
-/**
- * NVCopyNV12ColorPlanes
- * Used to convert YV12 color planes to NV12 (interleaved UV) for the overlay
- *
- * @param src1 source buffer of chroma1
- * @param dst1 destination buffer
- * @param h number of lines to copy
- * @param w length of lines to copy
- * @param id source pixel format (YV12 or I420)
- */
-static inline void
-NVCopyNV12ColorPlanes(unsigned char *src1, unsigned char *src2,
-		      unsigned char *dst, int dstPitch, int srcPitch2,
-		      int h, int w)
-{
-	int i, j, l, e;
-
-	w >>= 1;
-	h >>= 1;
-#ifdef __SSE2__
-	l = w >> 3;
-	e = w & 7;
-#else
-	l = w >> 1;
-	e = w & 1;
-#endif
-
-	for (j = 0; j < h; j++) {
-		unsigned char *us = src1;
-		unsigned char *vs = src2;
-		unsigned int *vuvud = (unsigned int *) dst;
-		unsigned short *vud;
-
-		for (i = 0; i < l; i++) {
-#ifdef __SSE2__
-			_mm_storeu_si128(
-				(void*)vuvud,
-				_mm_unpacklo_epi8(
-					_mm_loadl_epi64((void*)vs),
-					_mm_loadl_epi64((void*)us)));
-			vuvud+=4;
-			us+=8;
-			vs+=8;
-#else /* __SSE2__ */
-#  if X_BYTE_ORDER == X_BIG_ENDIAN
-			*vuvud++ = (vs[0]<<24) | (us[0]<<16) | (vs[1]<<8) | us[1];
-#  else
-			*vuvud++ = vs[0] | (us[0]<<8) | (vs[1]<<16) | (us[1]<<24);
-#  endif
-			us+=2;
-			vs+=2;
-#endif /* __SSE2__ */
-		}
-
-		vud = (unsigned short *)vuvud;
-		for (i = 0; i < e; i++) {
-#if X_BYTE_ORDER == X_BIG_ENDIAN
-			vud[i] = us[i] | (vs[i]<<8);
-#else
-			vud[i] = vs[i] | (us[i]<<8);
-#endif
-		}
-
-		dst += dstPitch;
-		src1 += srcPitch2;
-		src2 += srcPitch2;
-	}
-
-}
-
-
 static int
 NV_set_dimensions(ScrnInfoPtr pScrn, int action_flags, INT32 *xa, INT32 *xb,
 		  INT32 *ya, INT32 *yb, short *src_x, short *src_y,
@@ -1257,31 +1111,11 @@ CPU_copy:
 					      map, srcPitch, srcPitch2,
 					      dstPitch, nlines, npixels);
 			} else {
-				unsigned char *tbuf =
-					buf + left + top * srcPitch;
-
-				for (i = 0; i < nlines; i++) {
-					int dwords = npixels << 1;
-
-					while (dwords & ~0x03) {
-						*map = *tbuf;
-						*(map + 1) = *(tbuf + 1);
-						*(map + 2) = *(tbuf + 2);
-						*(map + 3) = *(tbuf + 3);
-						map += 4;
-						tbuf += 4;
-						dwords -= 4;
-					}
-
-					switch (dwords) {
-					case 3: *(map + 2) = *(tbuf + 2);
-					case 2: *(map + 1) = *(tbuf + 1);
-					case 1: *map = *tbuf;
-					}
-
-					map += dstPitch - (npixels << 1);
-					tbuf += srcPitch - (npixels << 1);
-				}
+				NVCopyPackedLines(map,
+						  buf + left + top * srcPitch,
+						  dstPitch, srcPitch, nlines,
+						  npixels << 1);
+				map += nlines * dstPitch;
 
 				NVCopyNV12ColorPlanes(buf + s2offset,
 						      buf + s3offset,
@@ -1290,28 +1124,8 @@ CPU_copy:
 			}
 		} else {
 			/* YUY2 and RGB */
-			for (i = 0; i < nlines; i++) {
-				int dwords = npixels << 1;
-
-				while (dwords & ~0x03) {
-					*map = *buf;
-					*(map + 1) = *(buf + 1);
-					*(map + 2) = *(buf + 2);
-					*(map + 3) = *(buf + 3);
-					map += 4;
-					buf += 4;
-					dwords -= 4;
-				}
-
-				switch (dwords) {
-				case 3: *(map + 2) = *(buf + 2);
-				case 2: *(map + 1) = *(buf + 1);
-				case 1: *map = *buf;
-				}
-
-				map += dstPitch - (npixels << 1);
-				buf += srcPitch - (npixels << 1);
-			}
+			NVCopyPackedLines(map, buf, dstPitch, srcPitch, nlines,
+					  npixels << 1);
 		}
 	}
 
@@ -1334,6 +1148,7 @@ CPU_copy:
 
 		if (!exaGetPixmapDriverPrivate(ppix))
 			return BadAlloc;
+		nouveau_pixmap_dirty(ppix);
 
 #ifdef COMPOSITE
 		/* Convert screen coords to pixmap coords */
@@ -1368,6 +1183,8 @@ CPU_copy:
 	if (action_flags & USE_TEXTURE) {
 		ret = BadImplementation;
 
+		nouveau_push_begin(pNv, NOUVEAU_PUSH_OP_XV);
+
 		if (pNv->Architecture == NV_ARCH_30) {
 			ret = NV30PutTextureImage(pScrn, pPriv->video_mem,
 						  offset, uv_offset,
@@ -1399,14 +1216,17 @@ CPU_copy:
 						src_w, src_h, drw_w, drw_h,
 						clipBoxes, ppix, pPriv);
 		}
+		nouveau_push_end(pNv);
 
 		if (ret != Success)
 			return ret;
 	} else {
+		nouveau_push_begin(pNv, NOUVEAU_PUSH_OP_XV);
 		ret = NVPutBlitImage(pScrn, pPriv->video_mem, offset, id,
 				     dstPitch, &dstBox, 0, 0, xb, yb, npixels,
 				     nlines, src_w, src_h, drw_w, drw_h,
 				     clipBoxes, ppix);
+		nouveau_push_end(pNv);
 		if (ret != Success)
 			return ret;
 	}
@@ -2272,45 +2092,8 @@ NVTakedownVideo(ScrnInfoPtr pScrn)
 	}
 }
 
-/* The filtering function used for video scaling. We use a cubic filter as
- * defined in  "Reconstruction Filters in Computer Graphics" Mitchell &
- * Netravali in SIGGRAPH '88
- */
-static float filter_func(float x)
-{
-	const double B=0.75;
-	const double C=(1.0-B)/2.0;
-	double x1=fabs(x);
-	double x2=fabs(x)*x1;
-	double x3=fabs(x)*x2;
-
-	if (fabs(x)<1.0)
-		return ( (12.0-9.0*B-6.0*C)*x3+(-18.0+12.0*B+6.0*C)*x2+(6.0-2.0*B) )/6.0; 
-	else
-		return ( (-B-6.0*C)*x3+(6.0*B+30.0*C)*x2+(-12.0*B-48.0*C)*x1+(8.0*B+24.0*C) )/6.0;
-}
-
-static int8_t f32tosb8(float v)
-{
-	return (int8_t)(v*127.0);
-}
-
 void
 NVXVComputeBicubicFilter(struct nouveau_bo *bo, unsigned offset, unsigned size)
 {
-	int8_t *t = (int8_t *)(bo->map + offset);
-	int i;
-
-	for(i = 0; i < size; i++) {
-		float  x = (i + 0.5) / size;
-		float w0 = filter_func(x+1.0);
-		float w1 = filter_func(x);
-		float w2 = filter_func(x-1.0);
-		float w3 = filter_func(x-2.0);
-
-		t[4*i+2]=f32tosb8(1.0+x-w1/(w0+w1));
-		t[4*i+1]=f32tosb8(1.0-x+w3/(w2+w3));
-		t[4*i+0]=f32tosb8(w0+w1);
-		t[4*i+3]=f32tosb8(0.0);
-	}
+	NVXVBicubicTable((int8_t *)(bo->map + offset), size);
 }
@@ -18,6 +18,8 @@
 #define PFP_NV12_BICUBIC  0x00000800
 #define XV_TABLE          0x00001000
 #define SOLID(i)         (0x00002000 + (i) * 0x100)
+#define GRADIENT(i)      (0x00003000 + (i) * 0x400)
+#define PFP_GEN(i)       (0x00004000 + (i) * 0x800) /* see nv30_fp.c */
 
 /* subchannel assignments */
 #define SUBC_M2MF(mthd)  0, (mthd)
@@ -49,7 +51,7 @@
 #define NV30_3D(mthd)    SUBC_3D(NV30_3D_##mthd)
 #define NV40_3D(mthd)    SUBC_3D(NV40_3D_##mthd)
 
-static __inline__ void
+static __inline__ Bool
 PUSH_DATAu(struct nouveau_pushbuf *push, struct nouveau_bo *bo,
 	   unsigned delta, unsigned dwords)
 {
@@ -57,9 +59,9 @@ PUSH_DATAu(struct nouveau_pushbuf *push, struct nouveau_bo *bo,
 	struct nouveau_pushbuf_refn refs[] = { { bo, domain } };
 	unsigned pitch = ((dwords * 4) + 63) & ~63;
 
-	if (nouveau_pushbuf_space(push, 32 + dwords, 2, 0) ||
+	if (nouveau_push_space(push, 32 + dwords, 2, 0) ||
 	    nouveau_pushbuf_refn (push, refs, 1))
-		return;
+		return FALSE;
 
 	BEGIN_NV04(push, NV01_SUBC(MISC, OBJECT), 1);
 	PUSH_DATA (push, NvClipRectangle);
@@ -78,8 +80,59 @@ PUSH_DATAu(struct nouveau_pushbuf *push, struct nouveau_bo *bo,
 	PUSH_DATA (push, (1 << 16) | dwords);
 	PUSH_DATA (push, (1 << 16) | dwords);
 	BEGIN_NV04(push, NV01_IFC(COLOR(0)), dwords);
+	return TRUE;
 }
 
+/* NV30/NV40 fragment program being generated, see nv30_fp.c.  Programs
+ * are built with NV30EXAFragProgInsn() and friends, using these.
+ */
+struct nv30_fp {
+	uint32_t insn[512];
+	int size;
+	int last;
+	Bool nv40;
+};
+
+#define FP_NOP           0x00
+#define FP_MOV           0x01
+#define FP_MUL           0x02
+#define FP_ADD           0x03
+#define FP_MAD           0x04
+#define FP_MIN           0x08
+#define FP_MAX           0x09
+#define FP_FRC           0x10
+#define FP_TEX           0x17
+#define FP_TXP           0x18
+#define FP_RCP           0x1a
+#define FP_EX2           0x1c
+#define FP_LG2           0x1d
+
+/* destination: rN or hN, write mask, a[texN] read by the sources, t[N] */
+#define FP_X             1
+#define FP_Y             2
+#define FP_Z             4
+#define FP_W             8
+#define FP_R(r, mask)    ((r) << 1 | (mask) << 9)
+#define FP_H(r, mask)    (FP_R((r), (mask)) | 0x00000080)
+#define FP_IN(n)         ((4 + (n)) << 13)
+#define FP_UNIT(n)       ((n) << 17)
+#define FP_FP16          0x00400000
+
+/* sources: temporary, the input picked by FP_IN(), or the immediate
+ * following the instruction, with a swizzle
+ */
+#define FP_SWZ(x, y, z, w) (((x) | (y) << 2 | (z) << 4 | (w) << 6) << 9)
+#define FP_XYZW          FP_SWZ(0, 1, 2, 3)
+#define FP_XXXX          FP_SWZ(0, 0, 0, 0)
+#define FP_YYYY          FP_SWZ(1, 1, 1, 1)
+#define FP_ZZZZ          FP_SWZ(2, 2, 2, 2)
+#define FP_WWWW          FP_SWZ(3, 3, 3, 3)
+#define FP_TEMP(r, swz)  ((r) << 2 | (swz))
+#define FP_INPUT(swz)    (1 | (swz))
+#define FP_IMM(swz)      (2 | (swz))
+#define FP_NEG           0x00020000
+#define FP_NONE          FP_TEMP(0, FP_XYZW)
+
 /* For NV40 FP upload, deal with the weird-arse big-endian swap */
 static __inline__ void
 PUSH_DATAs(struct nouveau_pushbuf *push, unsigned data)
@@ -94,12 +94,14 @@ NV04EXAPrepareSolid(PixmapPtr ppix, int alu, Pixel planemask, Pixel fg)
 	unsigned pitch = exaGetPixmapPitch(ppix);
 	unsigned surf_fmt, rect_fmt;
 
+	nouveau_pixmap_dirty(ppix);
+
 	/* When SURFACE_FORMAT_A8R8G8B8 is used with GDI_RECTANGLE_TEXT, the 
 	 * alpha channel gets forced to 0xFF for some reason.  We're using 
 	 * SURFACE_FORMAT_Y32 as a workaround
 	 */
 	if (!NVAccelGetCtxSurf2DFormatFromPixmap(ppix, (int*)&surf_fmt))
-		return FALSE;
+		NOUVEAU_FALLBACK("rect format\n");
 	if (surf_fmt == NV04_SURFACE_2D_FORMAT_A8R8G8B8)
 		surf_fmt = NV04_SURFACE_2D_FORMAT_Y32;
 
@@ -112,11 +114,12 @@ NV04EXAPrepareSolid(PixmapPtr ppix, int alu, Pixel planemask, Pixel fg)
 	}
 
 	if (!PUSH_SPACE(push, 64))
-		return FALSE;
+		NOUVEAU_FALLBACK("space\n");
 	PUSH_RESET(push);
 
 	if (!NV04EXASetROP(ppix, NV04_RECT(OPERATION), alu, planemask))
-		return FALSE;
+		NOUVEAU_FALLBACK("rop 0x%x, planemask 0x%lx\n", alu,
+				 (unsigned long)planemask);
 
 	BEGIN_NV04(push, NV04_SF2D(FORMAT), 4);
 	PUSH_DATA (push, surf_fmt);
@@ -131,7 +134,7 @@ NV04EXAPrepareSolid(PixmapPtr ppix, int alu, Pixel planemask, Pixel fg)
 	nouveau_pushbuf_bufctx(push, pNv->bufctx);
 	if (nouveau_pushbuf_validate(push)) {
 		nouveau_pushbuf_bufctx(push, NULL);
-		return FALSE;
+		NOUVEAU_FALLBACK("validate\n");
 	}
 
 	pNv->fg_colour = fg;
@@ -177,18 +180,23 @@ NV04EXAPrepareCopy(PixmapPtr pspix, PixmapPtr pdpix, int dx, int dy,
 	struct nouveau_bo *dst_bo = nouveau_pixmap_bo(pdpix);
 	int surf_fmt;
 
+	nouveau_pixmap_dirty(pdpix);
+
 	if (pspix->drawable.bitsPerPixel != pdpix->drawable.bitsPerPixel)
-		return FALSE;
+		NOUVEAU_FALLBACK("bpp mismatch, %d vs %d\n",
+				 pspix->drawable.bitsPerPixel,
+				 pdpix->drawable.bitsPerPixel);
 
 	if (!NVAccelGetCtxSurf2DFormatFromPixmap(pdpix, &surf_fmt))
-		return FALSE;
+		NOUVEAU_FALLBACK("dst format\n");
 
 	if (!PUSH_SPACE(push, 64))
-		return FALSE;
+		NOUVEAU_FALLBACK("space\n");
 	PUSH_RESET(push);
 
 	if (!NV04EXASetROP(pdpix, NV01_BLIT(OPERATION), alu, planemask))
-		return FALSE;
+		NOUVEAU_FALLBACK("rop 0x%x, planemask 0x%lx\n", alu,
+				 (unsigned long)planemask);
 
 	BEGIN_NV04(push, NV04_SF2D(FORMAT), 4);
 	PUSH_DATA (push, surf_fmt);
@@ -202,7 +210,7 @@ NV04EXAPrepareCopy(PixmapPtr pspix, PixmapPtr pdpix, int dx, int dy,
 	nouveau_pushbuf_bufctx(push, pNv->bufctx);
 	if (nouveau_pushbuf_validate(push)) {
 		nouveau_pushbuf_bufctx(push, NULL);
-		return FALSE;
+		NOUVEAU_FALLBACK("validate\n");
 	}
 
 	pNv->pspix = pspix;
@@ -221,7 +229,7 @@ NV04EXACopy(PixmapPtr pdpix, int srcX, int srcY, int dstX, int dstY,
 	int split_dstY = NOUVEAU_ALIGN(dstY + 1, 64);
 	int split_height = split_dstY - dstY;
 
-	if (nouveau_pushbuf_space(push, 16, 2, 0))
+	if (nouveau_push_space(push, 16, 2, 0))
 		return;
 
 	if ((width * height) >= 200000 && pNv->pspix != pNv->pdpix &&
@@ -405,7 +413,7 @@ NV04EXARectM2MF(NVPtr pNv, int w, int h, int cpp,
 			line_count = 2047;
 		h -= line_count;
 
-		if (nouveau_pushbuf_space(push, 16, 4, 0) ||
+		if (nouveau_push_space(push, 16, 4, 0) ||
 		    nouveau_pushbuf_refn (push, refs, 2))
 			return FALSE;
 
@@ -154,22 +154,24 @@ check_texture(NVPtr pNv, PicturePtr pict)
 			NOUVEAU_FALLBACK("gradient pictures unsupported\n");
 	}
 
-	if (w > 2046 || h > 2046)
+	/* bigger pictures are bound a window at a time, see NV10EXAComposite */
+	if ((w > 2046 || h > 2046) && !nouveau_exa_pict_splittable(pict, 2046))
 		NOUVEAU_FALLBACK("picture too large, %dx%d\n", w, h);
 
 	if (!get_tex_format(pNv, pict))
-		return FALSE;
+		NOUVEAU_FALLBACK("picture format 0x%08x\n", pict->format);
 
 	if (pict->filter != PictFilterNearest &&
 	    pict->filter != PictFilterBilinear)
-		return FALSE;
+		NOUVEAU_FALLBACK("picture filter %d\n", pict->filter);
 
 	/* We cannot repeat on NV10 because NPOT textures do not
 	 * support this. unfortunately. */
 	if (pict->repeat != RepeatNone)
 		/* we can repeat 1x1 textures */
 		if (!(w == 1 && h == 1))
-			return FALSE;
+			NOUVEAU_FALLBACK("repeat %d, %dx%d\n",
+					 pict->repeat, w, h);
 
 	return TRUE;
 }
@@ -181,10 +183,11 @@ check_render_target(PicturePtr pict)
 	int h = pict->pDrawable->height;
 
 	if (w > 4096 || h > 4096)
-		return FALSE;
+		NOUVEAU_FALLBACK("render target too large, %dx%d\n", w, h);
 
 	if (!get_rt_format(pict))
-		return FALSE;
+		NOUVEAU_FALLBACK("render target format 0x%08x\n",
+				 pict->format);
 
 	return TRUE;
 }
@@ -342,7 +345,7 @@ NV10EXACheckComposite(int op, PicturePtr src, PicturePtr mask, PicturePtr dst)
 
 	if (!check_pict_op(op)) {
 		print_fallback_info("pictop", op, src, mask, dst);
-		return FALSE;
+		NOUVEAU_FALLBACK("unsupported blend op %d\n", op);
 	}
 
 	if (!check_render_target(dst)) {
@@ -366,7 +369,7 @@ NV10EXACheckComposite(int op, PicturePtr src, PicturePtr mask, PicturePtr dst)
 		    needs_src(op) && needs_src_alpha(op)) {
 			print_fallback_info("ca-mask", op, src,
 					    mask, dst);
-			return FALSE;
+			NOUVEAU_FALLBACK("mask CA + SA, op %d\n", op);
 		}
 	}
 
@@ -375,13 +378,14 @@ NV10EXACheckComposite(int op, PicturePtr src, PicturePtr mask, PicturePtr dst)
 }
 
 static Bool
-setup_texture(NVPtr pNv, int unit, PicturePtr pict, PixmapPtr pixmap)
+setup_texture(NVPtr pNv, int unit, PicturePtr pict, PixmapPtr pixmap,
+	      const struct nouveau_exa_window *win)
 {
 	struct nouveau_pushbuf *push = pNv->pushbuf;
 	struct nouveau_bo *bo = nouveau_pixmap_bo(pixmap);
 	unsigned reloc = NOUVEAU_BO_VRAM | NOUVEAU_BO_GART | NOUVEAU_BO_RD;
-	unsigned h = pict->pDrawable->height;
-	unsigned w = pict->pDrawable->width;
+	unsigned h = win ? win->h : pict->pDrawable->height;
+	unsigned w = win ? win->w : pict->pDrawable->width;
 	unsigned format;
 
 	format = NV10_3D_TEX_FORMAT_WRAP_T_CLAMP_TO_EDGE |
@@ -399,7 +403,8 @@ setup_texture(NVPtr pNv, int unit, PicturePtr pict, PixmapPtr pixmap)
 	w = (w + 1) & ~1;
 
 	BEGIN_NV04(push, NV10_3D(TEX_OFFSET(unit)), 1);
-	PUSH_MTHDl(push, NV10_3D(TEX_OFFSET(unit)), bo, 0, reloc);
+	PUSH_MTHDl(push, NV10_3D(TEX_OFFSET(unit)), bo,
+			 win ? win->offset : 0, reloc);
 	BEGIN_NV04(push, NV10_3D(TEX_FORMAT(unit)), 1);
 	PUSH_MTHDs(push, NV10_3D(TEX_FORMAT(unit)), bo, format, reloc,
 			 NV10_3D_TEX_FORMAT_DMA0,
@@ -417,26 +422,16 @@ setup_texture(NVPtr pNv, int unit, PicturePtr pict, PixmapPtr pixmap)
 	else
 		PUSH_DATA(push, NV10_3D_TEX_FILTER_MAGNIFY_LINEAR |
 				NV10_3D_TEX_FILTER_MINIFY_LINEAR);
-	if (pict->transform) {
+	if (pict->transform || win) {
+		float m[16];
+		int i;
+
+		nouveau_exa_pict_matrix(pict, win, m);
 		BEGIN_NV04(push, NV10_3D(TEX_MATRIX_ENABLE(unit)), 1);
 		PUSH_DATA (push, 1);
 		BEGIN_NV04(push, NV10_3D(TEX_MATRIX(unit, 0)), 16);
-		PUSH_DATAf(push, xFixedToFloat(pict->transform->matrix[0][0]));
-		PUSH_DATAf(push, xFixedToFloat(pict->transform->matrix[0][1]));
-		PUSH_DATAf(push, 0.f);
-		PUSH_DATAf(push, xFixedToFloat(pict->transform->matrix[0][2]));
-		PUSH_DATAf(push, xFixedToFloat(pict->transform->matrix[1][0]));
-		PUSH_DATAf(push, xFixedToFloat(pict->transform->matrix[1][1]));
-		PUSH_DATAf(push, 0.f);
-		PUSH_DATAf(push, xFixedToFloat(pict->transform->matrix[1][2]));
-		PUSH_DATAf(push, 0.0f);
-		PUSH_DATAf(push, 0.0f);
-		PUSH_DATAf(push, 0.0f);
-		PUSH_DATAf(push, 0.0f);
-		PUSH_DATAf(push, xFixedToFloat(pict->transform->matrix[2][0]));
-		PUSH_DATAf(push, xFixedToFloat(pict->transform->matrix[2][1]));
-		PUSH_DATAf(push, 0.0f);
-		PUSH_DATAf(push, xFixedToFloat(pict->transform->matrix[2][2]));
+		for (i = 0; i < 16; i++)
+			PUSH_DATAf(push, m[i]);
 	} else {
 		BEGIN_NV04(push, NV10_3D(TEX_MATRIX_ENABLE(unit)), 1);
 		PUSH_DATA (push, 0);
@@ -507,7 +502,7 @@ setup_picture(NVPtr pNv, PicturePtr pict, PixmapPtr pixmap, int unit,
 	uint32_t shift, source;
 
 	if (pict && pict->pDrawable) {
-		if (!setup_texture(pNv, unit, pict, pixmap))
+		if (!setup_texture(pNv, unit, pict, pixmap, NULL))
 			return FALSE;
 		source = RCSRC_TEX(unit);
 	} else
@@ -550,20 +545,22 @@ NV10EXAPrepareComposite(int op,
 	struct nouveau_pushbuf *push = pNv->pushbuf;
 	uint32_t sc, sa, mc, ma;
 
+	nouveau_pixmap_dirty(dst);
+
 	if (!PUSH_SPACE(push, 128))
-		return FALSE;
+		NOUVEAU_FALLBACK("space\n");
 	PUSH_RESET(push);
 
 	/* setup render target and blending */
 	if (!setup_render_target(pNv, pict_dst, dst))
-		return FALSE;
+		NOUVEAU_FALLBACK("render target invalid\n");
 	setup_blend_function(pNv, pict_dst, pict_mask, op);
 
 	/* select picture sources */
 	if (!setup_picture(pNv, pict_src, src, 0, &sc, &sa))
-		return FALSE;
+		NOUVEAU_FALLBACK("src picture invalid\n");
 	if (!setup_picture(pNv, pict_mask, mask, 1, &mc, &ma))
-		return FALSE;
+		NOUVEAU_FALLBACK("mask picture invalid\n");
 
 	/* configure register combiners */
 	BEGIN_NV04(push, NV10_3D(RC_IN_ALPHA(0)), 1);
@@ -581,11 +578,15 @@ NV10EXAPrepareComposite(int op,
 	nouveau_pushbuf_bufctx(push, pNv->bufctx);
 	if (nouveau_pushbuf_validate(push)) {
 		nouveau_pushbuf_bufctx(push, NULL);
-		return FALSE;
+		NOUVEAU_FALLBACK("validate\n");
 	}
 
+	pNv->pspix = src;
+	pNv->pmpix = mask;
 	pNv->pspict = pict_src;
 	pNv->pmpict = pict_mask;
+	pNv->composite_limit = nouveau_exa_composite_limit(pict_src, pict_mask,
+							   2046);
 	return TRUE;
 }
 
@@ -603,17 +604,24 @@ PUSH_VTX2s(struct nouveau_pushbuf *push,
 	PUSH_DATAf(push, 0.0);
 }
 
-void
-NV10EXAComposite(PixmapPtr pix_dst,
-		 int sx, int sy, int mx, int my, int dx, int dy, int w, int h)
+static void
+NV10EXACompositeRect(PixmapPtr pix_dst,
+		     const struct nouveau_exa_window *swin,
+		     const struct nouveau_exa_window *mwin,
+		     int sx, int sy, int mx, int my, int dx, int dy, int w, int h)
 {
 	ScrnInfoPtr pScrn = xf86ScreenToScrn(pix_dst->drawable.pScreen);
 	NVPtr pNv = NVPTR(pScrn);
 	struct nouveau_pushbuf *push = pNv->pushbuf;
 
-	if (!PUSH_SPACE(push, 64))
+	if (!PUSH_SPACE(push, 128))
 		return;
 
+	if (swin)
+		setup_texture(pNv, 0, pNv->pspict, pNv->pspix, swin);
+	if (mwin)
+		setup_texture(pNv, 1, pNv->pmpict, pNv->pmpix, mwin);
+
 	BEGIN_NV04(push, NV10_3D(VERTEX_BEGIN_END), 1);
 	PUSH_DATA (push, NV10_3D_VERTEX_BEGIN_END_QUADS);
 	PUSH_VTX2s(push, sx, sy, mx, my, dx, dy);
@@ -624,6 +632,23 @@ NV10EXAComposite(PixmapPtr pix_dst,
 	PUSH_DATA (push, NV10_3D_VERTEX_BEGIN_END_STOP);
 }
 
+void
+NV10EXAComposite(PixmapPtr pix_dst,
+		 int sx, int sy, int mx, int my, int dx, int dy, int w, int h)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pix_dst->drawable.pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+
+	/* Sources too large for a texture get split into windows */
+	if (pNv->composite_limit) {
+		nouveau_exa_composite_split(pix_dst, sx, sy, mx, my, dx, dy,
+					    w, h, NV10EXACompositeRect);
+		return;
+	}
+
+	NV10EXACompositeRect(pix_dst, NULL, NULL, sx, sy, mx, my, dx, dy, w, h);
+}
+
 void
 NV10EXADoneComposite(PixmapPtr dst)
 {
@@ -246,8 +246,29 @@ NV30_SetupBlend(ScrnInfoPtr pScrn, nv_pict_op_t *blend,
 	}
 }
 
+static void
+NV30EXATexMatrix(struct nouveau_pushbuf *push, PicturePtr pPict,
+		 const struct nouveau_exa_window *win, int unit)
+{
+	if (pPict->transform || win) {
+		float m[16];
+		int i;
+
+		nouveau_exa_pict_matrix(pPict, win, m);
+		BEGIN_NV04(push, NV30_3D(TEX_MATRIX_ENABLE(unit)), 1);
+		PUSH_DATA (push, 1);
+		BEGIN_NV04(push, NV30_3D(TEX_MATRIX(unit, 0)), 16);
+		for (i = 0; i < 16; i++)
+			PUSH_DATAf(push, m[i]);
+	} else {
+		BEGIN_NV04(push, NV30_3D(TEX_MATRIX_ENABLE(unit)), 1);
+		PUSH_DATA (push, 0);
+	}
+}
+
 static Bool
-NV30EXATexture(ScrnInfoPtr pScrn, PixmapPtr pPix, PicturePtr pPict, int unit)
+NV30EXATexture(ScrnInfoPtr pScrn, PixmapPtr pPix, PicturePtr pPict, int unit,
+	       const struct nouveau_exa_window *win)
 {
 	NVPtr pNv = NVPTR(pScrn);
 	struct nouveau_pushbuf *push = pNv->pushbuf;
@@ -255,8 +276,10 @@ NV30EXATexture(ScrnInfoPtr pScrn, PixmapPtr pPix, PicturePtr pPict, int unit)
 	nv_pict_texture_format_t *fmt;
 	unsigned reloc = NOUVEAU_BO_VRAM | NOUVEAU_BO_GART | NOUVEAU_BO_RD;
 	uint32_t pitch = exaGetPixmapPitch(pPix);
-	uint32_t log2h = log2i(pPix->drawable.height);
-	uint32_t log2w = log2i(pPix->drawable.width);
+	uint32_t w = win ? win->w : pPix->drawable.width;
+	uint32_t h = win ? win->h : pPix->drawable.height;
+	uint32_t log2h = log2i(h);
+	uint32_t log2w = log2i(w);
 	uint32_t card_filter, card_repeat;
 
 	fmt = NV30_GetPictTextureFormat(pPict->format);
@@ -271,7 +294,8 @@ NV30EXATexture(ScrnInfoPtr pScrn, PixmapPtr pPix, PicturePtr pPict, int unit)
 		card_filter = 1;
 
 	BEGIN_NV04(push, NV30_3D(TEX_OFFSET(unit)), 8);
-	PUSH_MTHDl(push, NV30_3D(TEX_OFFSET(unit)), bo, 0, reloc);
+	PUSH_MTHDl(push, NV30_3D(TEX_OFFSET(unit)), bo,
+			 win ? win->offset : 0, reloc);
 	PUSH_MTHDs(push, NV30_3D(TEX_FORMAT(unit)), bo, (1 << 16) | 8 |
 			 NV30_3D_TEX_FORMAT_DIMS_2D |
 			 (fmt->card_fmt << NV30_3D_TEX_FORMAT_FORMAT__SHIFT) |
@@ -288,35 +312,46 @@ NV30EXATexture(ScrnInfoPtr pScrn, PixmapPtr pPix, PicturePtr pPict, int unit)
 	PUSH_DATA (push, (card_filter << NV30_3D_TEX_FILTER_MIN__SHIFT) |
 			 (card_filter << NV30_3D_TEX_FILTER_MAG__SHIFT) |
 			 0x2000 /* engine lock */);
-	PUSH_DATA (push, (pPix->drawable.width <<
-			  NV30_3D_TEX_NPOT_SIZE_W__SHIFT) |
-			 pPix->drawable.height);
+	PUSH_DATA (push, (w << NV30_3D_TEX_NPOT_SIZE_W__SHIFT) | h);
 	PUSH_DATA (push, 0x00000000); /* border ARGB */
-	if (pPict->transform) {
-		BEGIN_NV04(push, NV30_3D(TEX_MATRIX_ENABLE(unit)), 1);
-		PUSH_DATA (push, 1);
-		BEGIN_NV04(push, NV30_3D(TEX_MATRIX(unit, 0)), 16);
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[0][0]));
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[0][1]));
-		PUSH_DATAf(push, 0.f);
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[0][2]));
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[1][0]));
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[1][1]));
-		PUSH_DATAf(push, 0.f);
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[1][2]));
-		PUSH_DATAf(push, 0.0f);
-		PUSH_DATAf(push, 0.0f);
-		PUSH_DATAf(push, 0.0f);
-		PUSH_DATAf(push, 0.0f);
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[2][0]));
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[2][1]));
-		PUSH_DATAf(push, 0.0f);
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[2][2]));
-	} else {
-		BEGIN_NV04(push, NV30_3D(TEX_MATRIX_ENABLE(unit)), 1);
-		PUSH_DATA (push, 0);
-	}
+	NV30EXATexMatrix(push, pPict, win, unit);
+	return TRUE;
+}
+
+/* Bind the colour ramp of gradient picture 'pPict', see nv30_fp.c */
+static Bool
+NV30EXAGradientTexture(ScrnInfoPtr pScrn, PicturePtr pPict, int unit)
+{
+	NVPtr pNv = NVPTR(pScrn);
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	nv_pict_texture_format_t *fmt;
+	unsigned reloc = NOUVEAU_BO_VRAM | NOUVEAU_BO_RD;
 
+	fmt = NV30_GetPictTextureFormat(PICT_a8r8g8b8);
+	if (!NV30EXAGradientRamp(pNv, pPict, unit))
+		return FALSE;
+
+	BEGIN_NV04(push, NV30_3D(TEX_OFFSET(unit)), 8);
+	PUSH_MTHDl(push, NV30_3D(TEX_OFFSET(unit)), pNv->scratch,
+			 GRADIENT(unit), reloc);
+	PUSH_MTHDs(push, NV30_3D(TEX_FORMAT(unit)), pNv->scratch,
+			 (1 << 16) | 8 | NV30_3D_TEX_FORMAT_DIMS_2D |
+			 (fmt->card_fmt << NV30_3D_TEX_FORMAT_FORMAT__SHIFT) |
+			 (8 << NV30_3D_TEX_FORMAT_BASE_SIZE_U__SHIFT),
+			 reloc, NV30_3D_TEX_FORMAT_DMA0,
+			 NV30_3D_TEX_FORMAT_DMA1);
+	PUSH_DATA (push, (3 << NV30_3D_TEX_WRAP_S__SHIFT) |
+			 (3 << NV30_3D_TEX_WRAP_T__SHIFT) |
+			 (3 << NV30_3D_TEX_WRAP_R__SHIFT));
+	PUSH_DATA (push, NV30_3D_TEX_ENABLE_ENABLE);
+	PUSH_DATA (push, (1024 << NV30_3D_TEX_SWIZZLE_RECT_PITCH__SHIFT) |
+			 fmt->card_swz);
+	PUSH_DATA (push, (2 << NV30_3D_TEX_FILTER_MIN__SHIFT) |
+			 (2 << NV30_3D_TEX_FILTER_MAG__SHIFT) |
+			 0x2000 /* engine lock */);
+	PUSH_DATA (push, (256 << NV30_3D_TEX_NPOT_SIZE_W__SHIFT) | 1);
+	PUSH_DATA (push, 0x00000000); /* border ARGB */
+	NV30EXATexMatrix(push, pPict, NULL, unit);
 	return TRUE;
 }
 
@@ -329,21 +364,29 @@ NV30EXATexture(ScrnInfoPtr pScrn, PixmapPtr pPix, PicturePtr pPict, int unit)
 #define RCINP_A__SHIFT 24
 #define RCINP_B__SHIFT 16
 
+/* *solid is already the picture's colour if is_solid is set, see
+ * nouveau_exa_pict_solid().
+ */
 static Bool
 NV30EXAPicture(ScrnInfoPtr pScrn, PixmapPtr pPix, PicturePtr pPict, int unit,
-	       uint32_t *color, uint32_t *alpha, uint32_t *solid)
+	       Bool is_solid, uint32_t *color, uint32_t *alpha, uint32_t *solid)
 {
 	uint32_t shift, source;
 
+	if (is_solid) {
+		source = RCSRC_COL(unit);
+	} else
 	if (pPict && pPict->pDrawable) {
-		if (!NV30EXATexture(pScrn, pPix, pPict, unit))
+		if (!NV30EXATexture(pScrn, pPix, pPict, unit, NULL))
 			return FALSE;
 		*solid = 0x00000000;
 		source = RCSRC_TEX(unit);
 	} else
-	if (pPict) {
-		*solid = pPict->pSourcePict->solidFill.color;
-		source = RCSRC_COL(unit);
+	if (NV30EXAIsGradient(pPict)) {
+		if (!NV30EXAGradientTexture(pScrn, pPict, unit))
+			return FALSE;
+		*solid = 0x00000000;
+		source = RCSRC_TEX(unit);
 	}
 
 	if (pPict && PICT_FORMAT_RGB(pPict->format))
@@ -365,6 +408,124 @@ NV30EXAPicture(ScrnInfoPtr pScrn, PixmapPtr pPix, PicturePtr pPict, int unit,
 	return TRUE;
 }
 
+/* Rect textures can only clamp, so RepeatPad comes for free and the
+ * other repeat modes are done by wrapping the coordinates in the fragment
+ * program before the fetch.
+ */
+static int
+NV30EXARepeatMode(PicturePtr pPict, Bool is_solid)
+{
+	if (!pPict || !pPict->pDrawable || is_solid || !pPict->repeat)
+		return RepeatNone;
+
+	if (pPict->pDrawable->width == 1 && pPict->pDrawable->height == 1)
+		return RepeatNone;
+
+	switch (pPict->repeatType) {
+	case RepeatNormal:
+	case RepeatReflect:
+		return pPict->repeatType;
+	default:
+		return RepeatNone;
+	}
+}
+
+/* Fetch texture unit 'unit' into the register the combiners read it from,
+ * the same as PFP_PASS does, with the coordinates wrapped first if the
+ * picture repeats.
+ */
+static void
+NV30EXAFragProgUnit(struct nv30_fp *fp, int unit, int mode, int w, int h)
+{
+	if (mode == RepeatNone) {
+		/* txph hN, a[texN], t[N] */
+		NV30EXAFragProgInsn(fp, FP_TXP, FP_H(unit, 0xf) | FP_IN(unit) |
+				    FP_UNIT(unit), FP_INPUT(FP_XYZW),
+				    FP_NONE, FP_NONE);
+		return;
+	}
+
+	/* reflection is a repeat over twice the size, folded back */
+	if (mode == RepeatReflect) {
+		w *= 2;
+		h *= 2;
+	}
+
+	/* rcp r2.w, a[texN].w
+	 * mul r2.xy, a[texN], r2.w
+	 * mul r2.xy, r2, imm
+	 * frc r2.xy, r2
+	 * mul r2.xy, r2, imm
+	 */
+	NV30EXAFragProgInsn(fp, FP_RCP, FP_R(2, FP_W) | FP_IN(unit),
+			    FP_INPUT(FP_WWWW), FP_NONE, FP_NONE);
+	NV30EXAFragProgInsn(fp, FP_MUL, FP_R(2, FP_X | FP_Y) | FP_IN(unit),
+			    FP_INPUT(FP_XYZW), FP_TEMP(2, FP_WWWW), FP_NONE);
+	NV30EXAFragProgInsn(fp, FP_MUL, FP_R(2, FP_X | FP_Y),
+			    FP_TEMP(2, FP_XYZW), FP_IMM(FP_XYZW), FP_NONE);
+	NV30EXAFragProgImm(fp, 1.0 / w, 1.0 / h, 0.0, 0.0);
+	NV30EXAFragProgInsn(fp, FP_FRC, FP_R(2, FP_X | FP_Y),
+			    FP_TEMP(2, FP_XYZW), FP_NONE, FP_NONE);
+	NV30EXAFragProgInsn(fp, FP_MUL, FP_R(2, FP_X | FP_Y),
+			    FP_TEMP(2, FP_XYZW), FP_IMM(FP_XYZW), FP_NONE);
+	NV30EXAFragProgImm(fp, w, h, 0.0, 0.0);
+
+	if (mode == RepeatReflect) {
+		/* mad r2.zw, r2.xxxy, imm.x, imm
+		 * min r2.xy, r2, r2.zwzw
+		 */
+		NV30EXAFragProgInsn(fp, FP_MAD, FP_R(2, FP_Z | FP_W),
+				    FP_TEMP(2, FP_SWZ(0, 0, 0, 1)),
+				    FP_IMM(FP_XXXX), FP_IMM(FP_XYZW));
+		NV30EXAFragProgImm(fp, -1.0, 0.0, w, h);
+		NV30EXAFragProgInsn(fp, FP_MIN, FP_R(2, FP_X | FP_Y),
+				    FP_TEMP(2, FP_XYZW),
+				    FP_TEMP(2, FP_SWZ(2, 3, 2, 3)), FP_NONE);
+	}
+
+	/* texh hN, r2, t[N] */
+	NV30EXAFragProgInsn(fp, FP_TEX, FP_H(unit, 0xf) | FP_UNIT(unit),
+			    FP_TEMP(2, FP_XYZW), FP_NONE, FP_NONE);
+}
+
+/* Pick the fragment program for a composite: PFP_PASS unless one of the
+ * pictures repeats or is a gradient, in which case one is generated.
+ */
+static Bool
+NV30EXAFragProg(NVPtr pNv, PicturePtr psPict, Bool ssolid,
+		PicturePtr pmPict, Bool msolid, uint32_t *offset)
+{
+	PicturePtr pPict[2] = { psPict, pmPict };
+	Bool solid[2] = { ssolid, msolid };
+	struct nv30_fp fp = { .nv40 = FALSE };
+	int mode[2], unit;
+
+	for (unit = 0; unit < 2; unit++)
+		mode[unit] = NV30EXARepeatMode(pPict[unit], solid[unit]);
+
+	if (mode[0] == RepeatNone && mode[1] == RepeatNone &&
+	    !NV30EXAIsGradient(psPict) && !NV30EXAIsGradient(pmPict)) {
+		*offset = PFP_PASS;
+		return TRUE;
+	}
+
+	for (unit = 0; unit < 2; unit++) {
+		if (!solid[unit] && NV30EXAIsGradient(pPict[unit])) {
+			NV30EXAGradient(&fp, pPict[unit], unit,
+					FP_H(unit, 0xf), FALSE);
+		} else
+		if (mode[unit] != RepeatNone) {
+			NV30EXAFragProgUnit(&fp, unit, mode[unit],
+					    pPict[unit]->pDrawable->width,
+					    pPict[unit]->pDrawable->height);
+		} else {
+			NV30EXAFragProgUnit(&fp, unit, RepeatNone, 1, 1);
+		}
+	}
+
+	return NV30EXAFragProgUpload(pNv, &fp, offset);
+}
+
 static Bool
 NV30_SetupSurface(ScrnInfoPtr pScrn, PixmapPtr pPix, PicturePtr pPict)
 {
@@ -397,12 +558,18 @@ NV30EXACheckCompositeTexture(PicturePtr pPict, PicturePtr pdPict, int op)
 	if (pPict->pDrawable) {
 		w = pPict->pDrawable->width;
 		h = pPict->pDrawable->height;
-	} else {
-		if (pPict->pSourcePict->type != SourcePictTypeSolidFill)
-			NOUVEAU_FALLBACK("gradient pictures unsupported\n");
+	} else
+	if (NV30EXAIsGradient(pPict)) {
+		/* the colour ramp is bound in place of the picture */
+		return NV30EXACheckGradient(pPict);
 	}
 
-	if ((w > 4096) || (h > 4096))
+	/* Bigger pictures are bound a window at a time, which the repeat
+	 * fragment programs can't wrap around.
+	 */
+	if (((w > 4096) || (h > 4096)) &&
+	    (!nouveau_exa_pict_splittable(pPict, 4096) ||
+	     NV30EXARepeatMode(pPict, FALSE) != RepeatNone))
 		NOUVEAU_FALLBACK("picture too large, %dx%d\n", w, h);
 
 	fmt = NV30_GetPictTextureFormat(pPict->format);
@@ -414,7 +581,10 @@ NV30EXACheckCompositeTexture(PicturePtr pPict, PicturePtr pdPict, int op)
 			pPict->filter != PictFilterBilinear)
 		NOUVEAU_FALLBACK("filter 0x%x not supported\n", pPict->filter);
 
-	if (!(w==1 && h==1) && pPict->repeat && pPict->repeatType != RepeatNone)
+	/* RepeatNormal/Reflect are done in the fragment program, and rect
+	 * textures clamp to edge anyway which is RepeatPad.
+	 */
+	if (pPict->repeat && pPict->repeatType > RepeatReflect)
 		NOUVEAU_FALLBACK("repeat 0x%x not supported (surface %dx%d)\n",
 				 pPict->repeatType,w,h);
 
@@ -474,24 +644,39 @@ NV30EXAPrepareComposite(int op, PicturePtr psPict,
 	NVPtr pNv = NVPTR(pScrn);
 	nv_pict_op_t *blend = NV30_GetPictOpRec(op);
 	struct nouveau_pushbuf *push = pNv->pushbuf;
-	uint32_t sc, sa, mc, ma, solid[2];
+	uint32_t sc, sa, mc, ma, solid[2], fp;
+	Bool ssolid, msolid;
 
-	if (!PUSH_SPACE(push, 128))
-		return FALSE;
+	nouveau_pixmap_dirty(pdPix);
+
+	/* Before touching the pushbuf, reading back a 1x1 pixmap may kick it */
+	ssolid = nouveau_exa_pict_solid(psPix, psPict, &solid[0]);
+	msolid = nouveau_exa_pict_solid(pmPix, pmPict, &solid[1]);
+
+	/* Uploading a generated program may need its own pushbuf space too */
+	if (!NV30EXAFragProg(pNv, psPict, ssolid, pmPict, msolid, &fp))
+		NOUVEAU_FALLBACK("fragment program upload failed\n");
+
+	/* ...as do gradient ramps, which come with the textures */
+	if (!PUSH_SPACE(push, 160 + 2 * (32 + 256)))
+		NOUVEAU_FALLBACK("space\n");
 	PUSH_RESET(push);
+	NV30EXAVtxBufPrepare(pNv);
 
 	/* setup render target and blending */
 	if (!NV30_SetupSurface(pScrn, pdPix, pdPict))
-		return FALSE;
+		NOUVEAU_FALLBACK("render target invalid\n");
 	NV30_SetupBlend(pScrn, blend, pdPict->format,
 			(pmPict && pmPict->componentAlpha &&
 			 PICT_FORMAT_RGB(pmPict->format)));
 
 	/* select picture sources */
-	if (!NV30EXAPicture(pScrn, psPix, psPict, 0, &sc, &sa, &solid[0]))
-		return FALSE;
-	if (!NV30EXAPicture(pScrn, pmPix, pmPict, 1, &mc, &ma, &solid[1]))
-		return FALSE;
+	if (!NV30EXAPicture(pScrn, psPix, psPict, 0, ssolid,
+			    &sc, &sa, &solid[0]))
+		NOUVEAU_FALLBACK("src picture invalid\n");
+	if (!NV30EXAPicture(pScrn, pmPix, pmPict, 1, msolid,
+			    &mc, &ma, &solid[1]))
+		NOUVEAU_FALLBACK("mask picture invalid\n");
 
 	/* configure register combiners */
 	BEGIN_NV04(push, NV30_3D(RC_IN_ALPHA(0)), 6);
@@ -517,9 +702,11 @@ NV30EXAPrepareComposite(int op, PicturePtr psPict,
 	PUSH_DATA (push, 0x00001c00);
 	PUSH_DATA (push, 0x01000101);
 
-	/* select fragprog which just sources textures for combiners */
+	/* select fragprog which just sources textures for combiners, the
+	 * generated ones need temp registers too
+	 */
 	BEGIN_NV04(push, NV30_3D(FP_ACTIVE_PROGRAM), 1);
-	PUSH_MTHD (push, NV30_3D(FP_ACTIVE_PROGRAM), pNv->scratch, PFP_PASS,
+	PUSH_MTHD (push, NV30_3D(FP_ACTIVE_PROGRAM), pNv->scratch, fp,
 			 NOUVEAU_BO_VRAM | NOUVEAU_BO_RD | NOUVEAU_BO_LOW |
 			 NOUVEAU_BO_OR,
 			 NV30_3D_FP_ACTIVE_PROGRAM_DMA0,
@@ -527,28 +714,47 @@ NV30EXAPrepareComposite(int op, PicturePtr psPict,
 	BEGIN_NV04(push, NV30_3D(FP_REG_CONTROL), 1);
 	PUSH_DATA (push, 0x0001000f);
 	BEGIN_NV04(push, NV30_3D(FP_CONTROL), 1);
-	PUSH_DATA (push, 0x00000000);
+	PUSH_DATA (push, fp != PFP_PASS ? 0x00000001 : 0x00000000);
 	BEGIN_NV04(push, NV30_3D(TEX_UNITS_ENABLE), 1);
 	PUSH_DATA (push, 3);
 
 	nouveau_pushbuf_bufctx(push, pNv->bufctx);
 	if (nouveau_pushbuf_validate(push)) {
 		nouveau_pushbuf_bufctx(push, NULL);
-		return FALSE;
+		NOUVEAU_FALLBACK("validate\n");
 	}
 
+	pNv->pspix = psPix;
+	pNv->pmpix = pmPix;
+	pNv->pspict = psPict;
+	pNv->pmpict = pmPict;
+	pNv->composite_limit = nouveau_exa_composite_limit(psPict, pmPict,
+							   4096);
 	return TRUE;
 }
 
-static __inline__ void
-PUSH_VTX2s(struct nouveau_pushbuf *push,
-	   int x1, int y1, int x2, int y2, int dx, int dy)
+static void
+NV30EXACompositeRect(PixmapPtr pdPix,
+		     const struct nouveau_exa_window *swin,
+		     const struct nouveau_exa_window *mwin,
+		     int sx, int sy, int mx, int my, int dx, int dy, int w, int h)
 {
-	BEGIN_NV04(push, NV30_3D(VTX_ATTR_2I(8)), 2);
-	PUSH_DATA (push, ((y1 & 0xffff) << 16) | (x1 & 0xffff));
-	PUSH_DATA (push, ((y2 & 0xffff) << 16) | (x2 & 0xffff));
-	BEGIN_NV04(push, NV30_3D(VTX_ATTR_2I(0)), 1);
-	PUSH_DATA (push, ((dy & 0xffff) << 16) | (dx & 0xffff));
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pdPix->drawable.pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+
+	/* rebinding a window has to wait for the quads using the last one */
+	if (swin || mwin) {
+		if (!NV30EXAVtxBufFlush(pNv) || !PUSH_SPACE(push, 128))
+			return;
+
+		if (swin)
+			NV30EXATexture(pScrn, pNv->pspix, pNv->pspict, 0, swin);
+		if (mwin)
+			NV30EXATexture(pScrn, pNv->pmpix, pNv->pmpict, 1, mwin);
+	}
+
+	NV30EXAVtxBufQuad(pNv, sx, sy, mx, my, dx, dy, w, h);
 }
 
 void
@@ -557,33 +763,25 @@ NV30EXAComposite(PixmapPtr pdPix,
 {
 	ScrnInfoPtr pScrn = xf86ScreenToScrn(pdPix->drawable.pScreen);
 	NVPtr pNv = NVPTR(pScrn);
-	struct nouveau_pushbuf *push = pNv->pushbuf;
 
-	if (!PUSH_SPACE(push, 64))
+	/* Sources too large for a texture get split into windows */
+	if (pNv->composite_limit) {
+		nouveau_exa_composite_split(pdPix, sx, sy, mx, my, dx, dy,
+					    w, h, NV30EXACompositeRect);
 		return;
+	}
 
-	/* We're drawing a triangle, we need to scissor it to a quad. */
-	/* The scissors are here for a good reason, we don't get the full
-	 * image, but just a part.
-	 */
-	/* Handling the cliprects is done for us already. */
-	BEGIN_NV04(push, NV30_3D(SCISSOR_HORIZ), 2);
-	PUSH_DATA (push, (w << 16) | dx);
-	PUSH_DATA (push, (h << 16) | dy);
-	BEGIN_NV04(push, NV30_3D(VERTEX_BEGIN_END), 1);
-	PUSH_DATA (push, NV30_3D_VERTEX_BEGIN_END_TRIANGLES);
-	PUSH_VTX2s(push, sx, sy + (h * 2), mx, my + (h * 2), dx, dy + (h * 2));
-	PUSH_VTX2s(push, sx, sy, mx, my, dx, dy);
-	PUSH_VTX2s(push, sx + (w * 2), sy, mx + (w * 2), my, dx + (w * 2), dy);
-	BEGIN_NV04(push, NV30_3D(VERTEX_BEGIN_END), 1);
-	PUSH_DATA (push, NV30_3D_VERTEX_BEGIN_END_STOP);
+	NV30EXACompositeRect(pdPix, NULL, NULL, sx, sy, mx, my, dx, dy, w, h);
 }
 
 void
 NV30EXADoneComposite(PixmapPtr pdPix)
 {
 	ScrnInfoPtr pScrn = xf86ScreenToScrn(pdPix->drawable.pScreen);
-	nouveau_pushbuf_bufctx(NVPTR(pScrn)->pushbuf, NULL);
+	NVPtr pNv = NVPTR(pScrn);
+
+	NV30EXAVtxBufDone(pNv);
+	nouveau_pushbuf_bufctx(pNv->pushbuf, NULL);
 }
 
 Bool
@@ -621,6 +819,9 @@ NVAccelInitNV30TCL(ScrnInfoPtr pScrn)
 	if (nouveau_object_new(pNv->channel, Nv3D, class, NULL, 0, &pNv->Nv3D))
 		return FALSE;
 
+	if (!NV30EXAVtxBufInit(pNv))
+		return FALSE;
+
 	if (!PUSH_SPACE(push, 256))
 		return FALSE;
 
@@ -637,6 +838,9 @@ NVAccelInitNV30TCL(ScrnInfoPtr pScrn)
 	PUSH_DATA (push, fifo->vram);
 	BEGIN_NV04(push, NV30_3D(DMA_UNK1B0), 1);
 	PUSH_DATA (push, fifo->vram);
+	BEGIN_NV04(push, NV30_3D(DMA_VTXBUF0), 2);
+	PUSH_DATA (push, fifo->vram);
+	PUSH_DATA (push, fifo->gart);
 
 	for (i=1; i<8; i++) {
 		BEGIN_NV04(push, NV30_3D(VIEWPORT_CLIP_HORIZ(i)), 2);
@@ -819,6 +1023,8 @@ NVAccelInitNV30TCL(ScrnInfoPtr pScrn)
 	PUSH_DATA (push, 4096<<16);
 	PUSH_DATA (push, 4096<<16);
 
+	NV30EXAFragProgReset(pNv);
+
 	PUSH_DATAu(push, pNv->scratch, PFP_PASS, 2 * 4);
 	PUSH_DATAs(push, 0x18009e80); /* txph r0, a[tex0], t[0] */
 	PUSH_DATAs(push, 0x1c9dc801);
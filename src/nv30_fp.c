@@ -0,0 +1,493 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Fragment programs generated at composite time on NV30 and NV40, for
+ * the things the fixed programs in the scratch buffer can't do: pictures
+ * that need their coordinates wrapped, and gradients.
+ *
+ * Gradients are done by working out the gradient parameter t for each
+ * fragment, then looking the colour up in a ramp of GRADIENT_TEXELS
+ * premultiplied texels built from the stops on the CPU.  The ramp has an
+ * extra texel either end, transparent for RepeatNone and the end colour
+ * otherwise, so that clamping the lookup handles t outside [0, 1].
+ *
+ * What was last uploaded to the PFP_GEN() and GRADIENT() slots in the
+ * scratch buffer is remembered, so repeated composites with the same
+ * program or gradient don't upload it again.  That's only allocated once
+ * a program or ramp is first needed.
+ */
+
+#include "nv_include.h"
+
+#include "hwdefs/nv_object.xml.h"
+#include "hwdefs/nv30-40_3d.xml.h"
+#include "nv04_accel.h"
+
+#define GRADIENT_TEXELS 256
+
+struct nv30_fp_cache {
+	/* the program in each PFP_GEN() slot */
+	uint32_t gen[2][512];
+	int gen_size[2];
+	int gen_last;
+
+	/* the gradient whose ramp is in each GRADIENT() slot, with a copy
+	 * of its stops as the picture may have been freed and another
+	 * allocated in its place
+	 */
+	struct {
+		SourcePictPtr src;
+		Bool pad;
+		int nstops;
+		PictGradientStop *stops;
+	} ramp[2];
+};
+
+static struct nv30_fp_cache *
+NV30EXAFragProgCache(NVPtr pNv)
+{
+	if (!pNv->fp_cache)
+		pNv->fp_cache = calloc(1, sizeof(*pNv->fp_cache));
+	return pNv->fp_cache;
+}
+
+/* Forget what the scratch buffer holds, when it's (re)initialised or
+ * going away.
+ */
+void
+NV30EXAFragProgReset(NVPtr pNv)
+{
+	struct nv30_fp_cache *cache = pNv->fp_cache;
+	int i;
+
+	if (!cache)
+		return;
+
+	for (i = 0; i < 2; i++)
+		free(cache->ramp[i].stops);
+	free(cache);
+	pNv->fp_cache = NULL;
+}
+
+/* Operands are in the encoding used by the hand-assembled programs in
+ * nv30_exa.c/nv40_exa.c.  Sources reading an input need some extra bits
+ * in the last word, on NV30 only texture fetches appear to care.
+ */
+void
+NV30EXAFragProgInsn(struct nv30_fp *fp, int op, uint32_t dst,
+		    uint32_t src0, uint32_t src1, uint32_t src2)
+{
+	uint32_t *insn = &fp->insn[fp->size];
+
+	insn[0] = (op << 24) | dst;
+	insn[1] = 0x1c9c0000 | src0;
+	insn[2] = src1;
+	insn[3] = src2;
+
+	if (((src0 & 3) == 1 || (src1 & 3) == 1 || (src2 & 3) == 1) &&
+	    (fp->nv40 || op == FP_TEX || op == FP_TXP))
+		insn[3] |= 0x3fe00000;
+
+	fp->last = fp->size;
+	fp->size += 4;
+}
+
+/* The immediate read by FP_IMM() sources of the previous instruction */
+void
+NV30EXAFragProgImm(struct nv30_fp *fp, float x, float y, float z, float w)
+{
+	union { float f; uint32_t i; } imm[4] = { {x}, {y}, {z}, {w} };
+	int i;
+
+	for (i = 0; i < 4; i++)
+		fp->insn[fp->size++] = imm[i].i;
+}
+
+/* Put a generated program in one of the two PFP_GEN() slots, and return
+ * its offset in *offset.  Slots are only rewritten when neither already
+ * holds the program, and never the one the previous composite used as the
+ * hardware won't notice a program changing under an unchanged
+ * FP_ACTIVE_PROGRAM.
+ */
+Bool
+NV30EXAFragProgUpload(NVPtr pNv, struct nv30_fp *fp, uint32_t *offset)
+{
+	struct nv30_fp_cache *cache = NV30EXAFragProgCache(pNv);
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	int i, j;
+
+	fp->insn[fp->last] |= 0x00000001; /* end */
+
+	if (!cache)
+		return FALSE;
+
+	for (i = 0; i < 2; i++) {
+		if (cache->gen_size[i] == fp->size &&
+		    !memcmp(cache->gen[i], fp->insn, fp->size * 4))
+			goto done;
+	}
+
+	/* the slot only holds the program once the upload is queued */
+	i = cache->gen_last ^ 1;
+	if (!PUSH_DATAu(push, pNv->scratch, PFP_GEN(i), fp->size))
+		return FALSE;
+	for (j = 0; j < fp->size; j++)
+		PUSH_DATAs(push, fp->insn[j]);
+
+	memcpy(cache->gen[i], fp->insn, fp->size * 4);
+	cache->gen_size[i] = fp->size;
+done:
+	cache->gen_last = i;
+	*offset = PFP_GEN(i);
+	return TRUE;
+}
+
+Bool
+NV30EXAIsGradient(PicturePtr pPict)
+{
+	return pPict && !pPict->pDrawable &&
+	       pPict->pSourcePict->type != SourcePictTypeSolidFill;
+}
+
+/* For radial gradients t is the larger root of a.t^2 - 2b.t + c = 0, where
+ * a depends only on the circles.  Only a < 0, with one circle inside the
+ * other, is handled as otherwise there may be no root at all.
+ */
+static double
+NV30EXARadialA(PictRadialGradient *r)
+{
+	double cdx = xFixedToDouble(r->c2.x) - xFixedToDouble(r->c1.x);
+	double cdy = xFixedToDouble(r->c2.y) - xFixedToDouble(r->c1.y);
+	double dr = xFixedToDouble(r->c2.radius) -
+		    xFixedToDouble(r->c1.radius);
+
+	return cdx * cdx + cdy * cdy - dr * dr;
+}
+
+Bool
+NV30EXACheckGradient(PicturePtr pPict)
+{
+	SourcePictPtr src = pPict->pSourcePict;
+	PictLinearGradient *l = &src->linear;
+
+	if (src->gradient.nstops < 1)
+		NOUVEAU_FALLBACK("gradient without stops\n");
+
+	switch (src->type) {
+	case SourcePictTypeLinear:
+		if (l->p1.x == l->p2.x && l->p1.y == l->p2.y)
+			NOUVEAU_FALLBACK("degenerate linear gradient\n");
+		break;
+	case SourcePictTypeRadial:
+		if (NV30EXARadialA(&src->radial) >= 0)
+			NOUVEAU_FALLBACK("radial gradient circles not nested\n");
+		break;
+	default:
+		NOUVEAU_FALLBACK("gradient type 0x%x\n", src->type);
+	}
+
+	return TRUE;
+}
+
+static uint32_t
+NV30EXAGradientColour(PictGradient *g, double t)
+{
+	PictGradientStopPtr s = g->stops;
+	double a, r, gr, b, f;
+	int i;
+
+	for (i = 0; i < g->nstops; i++) {
+		if (xFixedToDouble(s[i].x) > t)
+			break;
+	}
+
+	if (i == 0 || i == g->nstops) {
+		i = i ? i - 1 : 0;
+		a = s[i].color.alpha;
+		r = s[i].color.red;
+		gr = s[i].color.green;
+		b = s[i].color.blue;
+	} else {
+		f = (t - xFixedToDouble(s[i - 1].x)) /
+		    (xFixedToDouble(s[i].x) - xFixedToDouble(s[i - 1].x));
+		a = s[i - 1].color.alpha +
+		    f * (s[i].color.alpha - s[i - 1].color.alpha);
+		r = s[i - 1].color.red +
+		    f * (s[i].color.red - s[i - 1].color.red);
+		gr = s[i - 1].color.green +
+		     f * (s[i].color.green - s[i - 1].color.green);
+		b = s[i - 1].color.blue +
+		    f * (s[i].color.blue - s[i - 1].color.blue);
+	}
+
+	/* stops aren't premultiplied, the ramp is */
+	a /= 65535.0;
+	return ((uint32_t)(a * 255.0 + 0.5) << 24) |
+	       ((uint32_t)(r * a / 257.0 + 0.5) << 16) |
+	       ((uint32_t)(gr * a / 257.0 + 0.5) << 8) |
+	       ((uint32_t)(b * a / 257.0 + 0.5));
+}
+
+/* Whether GRADIENT(unit) already holds the ramp for this gradient */
+static Bool
+NV30EXAGradientCached(struct nv30_fp_cache *cache, SourcePictPtr src,
+		      Bool pad, int unit)
+{
+	PictGradient *g = &src->gradient;
+
+	return cache->ramp[unit].src == src && cache->ramp[unit].pad == pad &&
+	       cache->ramp[unit].nstops == g->nstops &&
+	       !memcmp(cache->ramp[unit].stops, g->stops,
+		       g->nstops * sizeof(*g->stops));
+}
+
+/* Upload the colour ramp for a gradient picture to GRADIENT(unit), a
+ * GRADIENT_TEXELS x 1 A8R8G8B8 image with a pitch of GRADIENT_TEXELS * 4,
+ * unless it's there already.
+ */
+Bool
+NV30EXAGradientRamp(NVPtr pNv, PicturePtr pPict, int unit)
+{
+	struct nv30_fp_cache *cache = NV30EXAFragProgCache(pNv);
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	SourcePictPtr src = pPict->pSourcePict;
+	PictGradient *g = &src->gradient;
+	Bool pad = pPict->repeat && pPict->repeatType != RepeatNone;
+	uint32_t ramp[GRADIENT_TEXELS];
+	PictGradientStop *stops;
+	int i;
+
+	if (!cache)
+		return FALSE;
+	if (NV30EXAGradientCached(cache, src, pad, unit))
+		return TRUE;
+
+	for (i = 1; i < GRADIENT_TEXELS - 1; i++)
+		ramp[i] = NV30EXAGradientColour(g, (double)(i - 1) /
+						   (GRADIENT_TEXELS - 3));
+
+	if (pad) {
+		ramp[0] = ramp[1];
+		ramp[GRADIENT_TEXELS - 1] = ramp[GRADIENT_TEXELS - 2];
+	} else {
+		ramp[0] = 0x00000000;
+		ramp[GRADIENT_TEXELS - 1] = 0x00000000;
+	}
+
+	if (!PUSH_DATAu(push, pNv->scratch, GRADIENT(unit), GRADIENT_TEXELS))
+		return FALSE;
+	for (i = 0; i < GRADIENT_TEXELS; i++)
+		PUSH_DATA (push, ramp[i]);
+
+	/* without a copy of the stops it'll just be uploaded again */
+	cache->ramp[unit].src = NULL;
+	stops = realloc(cache->ramp[unit].stops,
+			(g->nstops + 1) * sizeof(*g->stops));
+	if (!stops)
+		return TRUE;
+
+	memcpy(stops, g->stops, g->nstops * sizeof(*g->stops));
+	cache->ramp[unit].src = src;
+	cache->ramp[unit].pad = pad;
+	cache->ramp[unit].nstops = g->nstops;
+	cache->ramp[unit].stops = stops;
+	return TRUE;
+}
+
+/* Colour of the gradient in picture 'pPict' at the (projective) position
+ * in a[texN] into 'dst', a texture fetch destination, using r2/r3 for
+ * temporaries.  The ramp is expected bound on t[N], with normalised
+ * coordinates if 'normalized' is set and as a rect texture otherwise.
+ */
+void
+NV30EXAGradient(struct nv30_fp *fp, PicturePtr pPict, int unit, uint32_t dst,
+		Bool normalized)
+{
+	SourcePictPtr src = pPict->pSourcePict;
+	float scale = GRADIENT_TEXELS - 3, offset = 1.5;
+	int repeat = pPict->repeat ? pPict->repeatType : RepeatNone;
+
+	if (normalized) {
+		scale /= GRADIENT_TEXELS;
+		offset /= GRADIENT_TEXELS;
+	}
+
+	/* rcp r2.w, a[texN].w; mul r2.xy, a[texN], r2.w */
+	NV30EXAFragProgInsn(fp, FP_RCP, FP_R(2, FP_W) | FP_IN(unit),
+			    FP_INPUT(FP_WWWW), FP_NONE, FP_NONE);
+	NV30EXAFragProgInsn(fp, FP_MUL, FP_R(2, FP_X | FP_Y) | FP_IN(unit),
+			    FP_INPUT(FP_XYZW), FP_TEMP(2, FP_WWWW), FP_NONE);
+
+	if (src->type == SourcePictTypeLinear) {
+		PictLinearGradient *l = &src->linear;
+		double x1 = xFixedToDouble(l->p1.x);
+		double y1 = xFixedToDouble(l->p1.y);
+		double dx = xFixedToDouble(l->p2.x) - x1;
+		double dy = xFixedToDouble(l->p2.y) - y1;
+		double ll = dx * dx + dy * dy;
+
+		/* t = (p - p1).(p2 - p1) / |p2 - p1|^2
+		 *
+		 * mad r2.x, r2.x, imm.x, imm.z
+		 * mad r2.x, r2.y, imm.y, r2.x
+		 */
+		NV30EXAFragProgInsn(fp, FP_MAD, FP_R(2, FP_X),
+				    FP_TEMP(2, FP_XXXX), FP_IMM(FP_XXXX),
+				    FP_IMM(FP_ZZZZ));
+		NV30EXAFragProgImm(fp, dx / ll, dy / ll,
+				   -(x1 * dx + y1 * dy) / ll, 0.0);
+		NV30EXAFragProgInsn(fp, FP_MAD, FP_R(2, FP_X),
+				    FP_TEMP(2, FP_YYYY), FP_IMM(FP_YYYY),
+				    FP_TEMP(2, FP_XXXX));
+		NV30EXAFragProgImm(fp, dx / ll, dy / ll, 0.0, 0.0);
+	} else {
+		PictRadialGradient *r = &src->radial;
+		double x1 = xFixedToDouble(r->c1.x);
+		double y1 = xFixedToDouble(r->c1.y);
+		double r1 = xFixedToDouble(r->c1.radius);
+		double cdx = xFixedToDouble(r->c2.x) - x1;
+		double cdy = xFixedToDouble(r->c2.y) - y1;
+		double dr = xFixedToDouble(r->c2.radius) - r1;
+		double a = NV30EXARadialA(r);
+
+		/* pd = p - c1: add r2.xy, r2, imm */
+		NV30EXAFragProgInsn(fp, FP_ADD, FP_R(2, FP_X | FP_Y),
+				    FP_TEMP(2, FP_XYZW), FP_IMM(FP_XYZW),
+				    FP_NONE);
+		NV30EXAFragProgImm(fp, -x1, -y1, 0.0, 0.0);
+
+		/* b = pd.cd + r1.dr, c = pd.pd - r1^2, into r3.xy:
+		 *
+		 * mul r3.xy, r2, imm
+		 * add r3.x, r3.x, r3.y
+		 * mul r2.xy, r2, r2
+		 * add r3.y, r2.x, r2.y
+		 * add r3.xy, r3, imm
+		 */
+		NV30EXAFragProgInsn(fp, FP_MUL, FP_R(3, FP_X | FP_Y),
+				    FP_TEMP(2, FP_XYZW), FP_IMM(FP_XYZW),
+				    FP_NONE);
+		NV30EXAFragProgImm(fp, cdx, cdy, 0.0, 0.0);
+		NV30EXAFragProgInsn(fp, FP_ADD, FP_R(3, FP_X),
+				    FP_TEMP(3, FP_XXXX), FP_TEMP(3, FP_YYYY),
+				    FP_NONE);
+		NV30EXAFragProgInsn(fp, FP_MUL, FP_R(2, FP_X | FP_Y),
+				    FP_TEMP(2, FP_XYZW), FP_TEMP(2, FP_XYZW),
+				    FP_NONE);
+		NV30EXAFragProgInsn(fp, FP_ADD, FP_R(3, FP_Y),
+				    FP_TEMP(2, FP_XXXX), FP_TEMP(2, FP_YYYY),
+				    FP_NONE);
+		NV30EXAFragProgInsn(fp, FP_ADD, FP_R(3, FP_X | FP_Y),
+				    FP_TEMP(3, FP_XYZW), FP_IMM(FP_XYZW),
+				    FP_NONE);
+		NV30EXAFragProgImm(fp, r1 * dr, -r1 * r1, 0.0, 0.0);
+
+		/* sqrt(b^2 - a.c) into r3.y, as ex2(lg2(x) / 2):
+		 *
+		 * mul r3.y, r3.y, imm.x
+		 * mad r3.y, r3.x, r3.x, r3.y
+		 * max r3.y, r3.y, imm.x
+		 * lg2 r3.y, r3.y
+		 * mul r3.y, r3.y, imm.x
+		 * ex2 r3.y, r3.y
+		 */
+		NV30EXAFragProgInsn(fp, FP_MUL, FP_R(3, FP_Y),
+				    FP_TEMP(3, FP_YYYY), FP_IMM(FP_XXXX),
+				    FP_NONE);
+		NV30EXAFragProgImm(fp, -a, 0.0, 0.0, 0.0);
+		NV30EXAFragProgInsn(fp, FP_MAD, FP_R(3, FP_Y),
+				    FP_TEMP(3, FP_XXXX), FP_TEMP(3, FP_XXXX),
+				    FP_TEMP(3, FP_YYYY));
+		NV30EXAFragProgInsn(fp, FP_MAX, FP_R(3, FP_Y),
+				    FP_TEMP(3, FP_YYYY), FP_IMM(FP_XXXX),
+				    FP_NONE);
+		NV30EXAFragProgImm(fp, 0.0, 0.0, 0.0, 0.0);
+		NV30EXAFragProgInsn(fp, FP_LG2, FP_R(3, FP_Y),
+				    FP_TEMP(3, FP_YYYY), FP_NONE, FP_NONE);
+		NV30EXAFragProgInsn(fp, FP_MUL, FP_R(3, FP_Y),
+				    FP_TEMP(3, FP_YYYY), FP_IMM(FP_XXXX),
+				    FP_NONE);
+		NV30EXAFragProgImm(fp, 0.5, 0.0, 0.0, 0.0);
+		NV30EXAFragProgInsn(fp, FP_EX2, FP_R(3, FP_Y),
+				    FP_TEMP(3, FP_YYYY), FP_NONE, FP_NONE);
+
+		/* With nested circles only one root has a positive radius,
+		 * the larger if the circles grow, the smaller if they shrink.
+		 *
+		 * add r2.x, r3.x, (-)r3.y
+		 * mul r2.x, r2.x, imm.x
+		 */
+		NV30EXAFragProgInsn(fp, FP_ADD, FP_R(2, FP_X),
+				    FP_TEMP(3, FP_XXXX),
+				    FP_TEMP(3, FP_YYYY) | (dr > 0 ? FP_NEG : 0),
+				    FP_NONE);
+		NV30EXAFragProgInsn(fp, FP_MUL, FP_R(2, FP_X),
+				    FP_TEMP(2, FP_XXXX), FP_IMM(FP_XXXX),
+				    FP_NONE);
+		NV30EXAFragProgImm(fp, 1.0 / a, 0.0, 0.0, 0.0);
+	}
+
+	switch (repeat) {
+	case RepeatNormal:
+		/* frc r2.x, r2.x */
+		NV30EXAFragProgInsn(fp, FP_FRC, FP_R(2, FP_X),
+				    FP_TEMP(2, FP_XXXX), FP_NONE, FP_NONE);
+		break;
+	case RepeatReflect:
+		/* t = min(f, 2 - f), f = 2 * frc(t / 2):
+		 *
+		 * mul r2.x, r2.x, imm.x
+		 * frc r2.x, r2.x
+		 * add r2.x, r2.x, r2.x
+		 * add r2.y, -r2.x, imm.x
+		 * min r2.x, r2.x, r2.y
+		 */
+		NV30EXAFragProgInsn(fp, FP_MUL, FP_R(2, FP_X),
+				    FP_TEMP(2, FP_XXXX), FP_IMM(FP_XXXX),
+				    FP_NONE);
+		NV30EXAFragProgImm(fp, 0.5, 0.0, 0.0, 0.0);
+		NV30EXAFragProgInsn(fp, FP_FRC, FP_R(2, FP_X),
+				    FP_TEMP(2, FP_XXXX), FP_NONE, FP_NONE);
+		NV30EXAFragProgInsn(fp, FP_ADD, FP_R(2, FP_X),
+				    FP_TEMP(2, FP_XXXX), FP_TEMP(2, FP_XXXX),
+				    FP_NONE);
+		NV30EXAFragProgInsn(fp, FP_ADD, FP_R(2, FP_Y),
+				    FP_TEMP(2, FP_XXXX) | FP_NEG,
+				    FP_IMM(FP_XXXX), FP_NONE);
+		NV30EXAFragProgImm(fp, 2.0, 0.0, 0.0, 0.0);
+		NV30EXAFragProgInsn(fp, FP_MIN, FP_R(2, FP_X),
+				    FP_TEMP(2, FP_XXXX), FP_TEMP(2, FP_YYYY),
+				    FP_NONE);
+		break;
+	default:
+		/* RepeatNone/Pad are down to the ramp's end texels */
+		break;
+	}
+
+	/* mad r2.xy, r2.x, imm, imm.zwzw; tex dst, r2, t[N] */
+	NV30EXAFragProgInsn(fp, FP_MAD, FP_R(2, FP_X | FP_Y),
+			    FP_TEMP(2, FP_XXXX), FP_IMM(FP_XYZW),
+			    FP_IMM(FP_SWZ(2, 3, 2, 3)));
+	NV30EXAFragProgImm(fp, scale, 0.0, offset, 0.5);
+	NV30EXAFragProgInsn(fp, FP_TEX, dst | FP_UNIT(unit),
+			    FP_TEMP(2, FP_XYZW), FP_NONE, FP_NONE);
+}
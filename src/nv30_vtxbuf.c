@@ -0,0 +1,192 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Vertex buffer for NV30/NV40 composite.  Rects are written to a GART
+ * buffer as quads, three 16-bit pairs per vertex (position, then the
+ * source and mask coordinates), and drawn in one go whenever state has
+ * to change or the composite is done.  Drawing each rect in immediate
+ * mode instead costs a scissor update and a dozen methods per rect, which
+ * is what limits glyph and small composite throughput.
+ *
+ * The buffer is only ever appended to.  When it fills up, whatever is
+ * pending is submitted and waited on before starting again from the top.
+ */
+
+#include "nv_include.h"
+
+#include "hwdefs/nv_object.xml.h"
+#include "hwdefs/nv30-40_3d.xml.h"
+#include "nv04_accel.h"
+
+#define VTXBUF_SIZE	(1024 * 1024)
+#define VTX_SIZE	12
+#define QUAD_SIZE	(4 * VTX_SIZE)
+#define VTX_FORMAT	(NV30_3D_VTXFMT_TYPE_V16_SSCALED |		\
+			 (2 << NV30_3D_VTXFMT_SIZE__SHIFT) |		\
+			 (VTX_SIZE << NV30_3D_VTXFMT_STRIDE__SHIFT))
+
+Bool
+NV30EXAVtxBufInit(NVPtr pNv)
+{
+	if (!pNv->vtxbuf) {
+		if (nouveau_bo_new(pNv->dev, NOUVEAU_BO_GART | NOUVEAU_BO_MAP,
+				   0, VTXBUF_SIZE, NULL, &pNv->vtxbuf))
+			return FALSE;
+
+		if (nouveau_bo_map(pNv->vtxbuf, NOUVEAU_BO_WR, pNv->client)) {
+			nouveau_bo_ref(NULL, &pNv->vtxbuf);
+			return FALSE;
+		}
+
+		nouveau_push_resident(pNv, pNv->vtxbuf,
+				      NOUVEAU_BO_GART | NOUVEAU_BO_RD);
+	}
+
+	pNv->vtxbuf_offset = 0;
+	pNv->vtxbuf_start = 0;
+	return TRUE;
+}
+
+/* Called from PrepareComposite, between PUSH_RESET() and validation */
+void
+NV30EXAVtxBufPrepare(NVPtr pNv)
+{
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	int i;
+
+	nouveau_push_refn(pNv, pNv->vtxbuf, NOUVEAU_BO_GART | NOUVEAU_BO_RD);
+	pNv->vtxbuf_start = pNv->vtxbuf_offset;
+
+	BEGIN_NV04(push, NV30_3D(VTXFMT(0)), 16);
+	for (i = 0; i < 16; i++) {
+		if (i == 0 || i == 8 || i == 9)
+			PUSH_DATA (push, VTX_FORMAT);
+		else
+			PUSH_DATA (push, NV30_3D_VTXFMT_TYPE_V32_FLOAT);
+	}
+
+	/* quads cover exactly the rect, no need to scissor them */
+	BEGIN_NV04(push, NV30_3D(SCISSOR_HORIZ), 2);
+	PUSH_DATA (push, 4096 << 16);
+	PUSH_DATA (push, 4096 << 16);
+}
+
+/* Draw the quads written since the last flush.  They stay pending if
+ * there's no room for the draw.
+ */
+Bool
+NV30EXAVtxBufFlush(NVPtr pNv)
+{
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	unsigned reloc = NOUVEAU_BO_GART | NOUVEAU_BO_RD | NOUVEAU_BO_LOW |
+			 NOUVEAU_BO_OR;
+	int start = pNv->vtxbuf_start;
+	int count = (pNv->vtxbuf_offset - start) / VTX_SIZE;
+	int batches = (count + 255) / 256, i, n;
+
+	if (!count)
+		return TRUE;
+
+	if (!PUSH_SPACE(push, 16 + batches))
+		return FALSE;
+
+	BEGIN_NV04(push, NV30_3D(VTXBUF(0)), 1);
+	PUSH_MTHD (push, NV30_3D(VTXBUF(0)), pNv->vtxbuf, start + 0, reloc,
+			 0, NV30_3D_VTXBUF_DMA1);
+	BEGIN_NV04(push, NV30_3D(VTXBUF(8)), 2);
+	PUSH_MTHD (push, NV30_3D(VTXBUF(8)), pNv->vtxbuf, start + 4, reloc,
+			 0, NV30_3D_VTXBUF_DMA1);
+	PUSH_MTHD (push, NV30_3D(VTXBUF(9)), pNv->vtxbuf, start + 8, reloc,
+			 0, NV30_3D_VTXBUF_DMA1);
+	if (pNv->Architecture == NV_ARCH_40) {
+		BEGIN_NV04(push, NV40_3D(VTX_CACHE_INVALIDATE), 1);
+		PUSH_DATA (push, 0);
+	}
+
+	BEGIN_NV04(push, NV30_3D(VERTEX_BEGIN_END), 1);
+	PUSH_DATA (push, NV30_3D_VERTEX_BEGIN_END_QUADS);
+	BEGIN_NI04(push, NV30_3D(VB_VERTEX_BATCH), batches);
+	for (i = 0; i < count; i += n) {
+		n = count - i < 256 ? count - i : 256;
+		PUSH_DATA (push, ((n - 1) << 24) | i); /* count - 1, first */
+	}
+	BEGIN_NV04(push, NV30_3D(VERTEX_BEGIN_END), 1);
+	PUSH_DATA (push, NV30_3D_VERTEX_BEGIN_END_STOP);
+
+	pNv->vtxbuf_start = pNv->vtxbuf_offset;
+	return TRUE;
+}
+
+static __inline__ void
+VTX(uint32_t *v, int sx, int sy, int mx, int my, int dx, int dy)
+{
+	v[0] = ((dy & 0xffff) << 16) | (dx & 0xffff);
+	v[1] = ((sy & 0xffff) << 16) | (sx & 0xffff);
+	v[2] = ((my & 0xffff) << 16) | (mx & 0xffff);
+}
+
+void
+NV30EXAVtxBufQuad(NVPtr pNv, int sx, int sy, int mx, int my,
+		  int dx, int dy, int w, int h)
+{
+	uint32_t *v;
+
+	if (pNv->vtxbuf_offset + QUAD_SIZE > VTXBUF_SIZE) {
+		if (!NV30EXAVtxBufFlush(pNv))
+			return;
+
+		/* kicks the pushbuf, bufctx state is re-emitted after */
+		if (nouveau_bo_wait(pNv->vtxbuf, NOUVEAU_BO_WR, pNv->client))
+			return;
+		pNv->vtxbuf_offset = pNv->vtxbuf_start = 0;
+	}
+
+	v = (uint32_t *)((char *)pNv->vtxbuf->map + pNv->vtxbuf_offset);
+	VTX(v + 0, sx    , sy    , mx    , my    , dx    , dy    );
+	VTX(v + 3, sx + w, sy    , mx + w, my    , dx + w, dy    );
+	VTX(v + 6, sx + w, sy + h, mx + w, my + h, dx + w, dy + h);
+	VTX(v + 9, sx    , sy + h, mx    , my + h, dx    , dy + h);
+	pNv->vtxbuf_offset += QUAD_SIZE;
+}
+
+/* Called from DoneComposite, leaves vertex arrays disabled again for the
+ * immediate mode users of the 3D engine.
+ */
+void
+NV30EXAVtxBufDone(NVPtr pNv)
+{
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	int i;
+
+	if (!NV30EXAVtxBufFlush(pNv)) {
+		/* those quads are lost, don't draw them with the next state */
+		pNv->vtxbuf_start = pNv->vtxbuf_offset;
+		return;
+	}
+
+	if (!PUSH_SPACE(push, 17))
+		return;
+
+	BEGIN_NV04(push, NV30_3D(VTXFMT(0)), 16);
+	for (i = 0; i < 16; i++)
+		PUSH_DATA (push, NV30_3D_VTXFMT_TYPE_V32_FLOAT);
+}
@@ -181,12 +181,12 @@ NV40_SetupBlend(ScrnInfoPtr pScrn, nv_pict_op_t *blend,
 }
 
 static Bool
-NV40EXAPictSolid(NVPtr pNv, PicturePtr pPict, int unit)
+NV40EXAPictSolid(NVPtr pNv, uint32_t color, int unit)
 {
 	struct nouveau_pushbuf *push = pNv->pushbuf;
 
 	PUSH_DATAu(push, pNv->scratch, SOLID(unit), 2);
-	PUSH_DATA (push, pPict->pSourcePict->solidFill.color);
+	PUSH_DATA (push, color);
 	PUSH_DATA (push, 0);
 	BEGIN_NV04(push, NV30_3D(TEX_OFFSET(unit)), 8);
 	PUSH_MTHDl(push, NV30_3D(TEX_OFFSET(unit)), pNv->scratch, SOLID(unit),
@@ -230,10 +230,82 @@ NV40EXAPictSolid(NVPtr pNv, PicturePtr pPict, int unit)
 	return TRUE;
 }
 
+/* Upload the picture transform for texture unit 'unit' to the vertex
+ * program, with the scale applied to the result after it.
+ */
+static void
+NV40EXATexMatrix(struct nouveau_pushbuf *push, PicturePtr pPict, int unit,
+		 float sx, float sy)
+{
+	BEGIN_NV04(push, NV30_3D(VP_UPLOAD_CONST_ID), 17);
+	PUSH_DATA (push, unit * 4);
+	if (pPict->transform) {
+		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[0][0]));
+		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[0][1]));
+		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[0][2]));
+		PUSH_DATAf(push, 0);
+		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[1][0]));
+		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[1][1]));
+		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[1][2]));
+		PUSH_DATAf(push, 0);
+		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[2][0]));
+		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[2][1]));
+		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[2][2]));
+		PUSH_DATAf(push, 0);
+	} else {
+		PUSH_DATAf(push, 1.0);
+		PUSH_DATAf(push, 0.0);
+		PUSH_DATAf(push, 0.0);
+		PUSH_DATAf(push, 0.0);
+		PUSH_DATAf(push, 0.0);
+		PUSH_DATAf(push, 1.0);
+		PUSH_DATAf(push, 0.0);
+		PUSH_DATAf(push, 0.0);
+		PUSH_DATAf(push, 0.0);
+		PUSH_DATAf(push, 0.0);
+		PUSH_DATAf(push, 1.0);
+		PUSH_DATAf(push, 0.0);
+	}
+	PUSH_DATAf(push, sx);
+	PUSH_DATAf(push, sy);
+	PUSH_DATAf(push, 0.0);
+	PUSH_DATAf(push, 1.0);
+}
+
+/* Bind the colour ramp of gradient picture 'pPict', see nv30_fp.c.  The
+ * fragment program wants the coordinates in picture space, unscaled.
+ */
 static Bool
 NV40EXAPictGradient(NVPtr pNv, PicturePtr pPict, int unit)
 {
-	return FALSE;
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+
+	if (!NV30EXAGradientRamp(pNv, pPict, unit))
+		return FALSE;
+
+	BEGIN_NV04(push, NV30_3D(TEX_OFFSET(unit)), 8);
+	PUSH_MTHDl(push, NV30_3D(TEX_OFFSET(unit)), pNv->scratch,
+			 GRADIENT(unit), NOUVEAU_BO_VRAM | NOUVEAU_BO_RD);
+	PUSH_DATA (push, NV40_3D_TEX_FORMAT_FORMAT_A8R8G8B8 | 0x8000 |
+			 NV40_3D_TEX_FORMAT_LINEAR |
+			 NV30_3D_TEX_FORMAT_DIMS_2D |
+			 NV30_3D_TEX_FORMAT_NO_BORDER |
+			 (1 << NV40_3D_TEX_FORMAT_MIPMAP_COUNT__SHIFT) |
+			 NV30_3D_TEX_FORMAT_DMA0);
+	PUSH_DATA (push, NV30_3D_TEX_WRAP_S_CLAMP_TO_EDGE |
+			 NV30_3D_TEX_WRAP_T_CLAMP_TO_EDGE |
+			 NV30_3D_TEX_WRAP_R_CLAMP_TO_EDGE);
+	PUSH_DATA (push, NV40_3D_TEX_ENABLE_ENABLE);
+	PUSH_DATA (push, 0x0000aae4);
+	PUSH_DATA (push, NV30_3D_TEX_FILTER_MIN_LINEAR |
+			 NV30_3D_TEX_FILTER_MAG_LINEAR | 0x3fd6);
+	PUSH_DATA (push, (256 << 16) | 1);
+	PUSH_DATA (push, 0x00000000);
+	BEGIN_NV04(push, NV40_3D(TEX_SIZE1(unit)), 1);
+	PUSH_DATA (push, (1 << NV40_3D_TEX_SIZE1_DEPTH__SHIFT) | 1024);
+
+	NV40EXATexMatrix(push, pPict, unit, 1.0, 1.0);
+	return TRUE;
 }
 
 static Bool
@@ -296,53 +368,24 @@ NV40EXAPictTexture(NVPtr pNv, PixmapPtr pPix, PicturePtr pPict, int unit)
 	PUSH_DATA (push, (1 << NV40_3D_TEX_SIZE1_DEPTH__SHIFT) |
 			 (uint32_t)exaGetPixmapPitch(pPix));
 
-	BEGIN_NV04(push, NV30_3D(VP_UPLOAD_CONST_ID), 17);
-	PUSH_DATA (push, unit * 4);
-	if (pPict->transform) {
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[0][0]));
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[0][1]));
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[0][2]));
-		PUSH_DATAf(push, 0);
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[1][0]));
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[1][1]));
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[1][2]));
-		PUSH_DATAf(push, 0);
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[2][0]));
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[2][1]));
-		PUSH_DATAf(push, xFixedToFloat(pPict->transform->matrix[2][2]));
-		PUSH_DATAf(push, 0);
-	} else {
-		PUSH_DATAf(push, 1.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 1.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 1.0);
-		PUSH_DATAf(push, 0.0);
-	}
-	PUSH_DATAf(push, 1.0 / pPix->drawable.width);
-	PUSH_DATAf(push, 1.0 / pPix->drawable.height);
-	PUSH_DATAf(push, 0.0);
-	PUSH_DATAf(push, 1.0);
-
+	NV40EXATexMatrix(push, pPict, unit, 1.0 / pPix->drawable.width,
+			 1.0 / pPix->drawable.height);
 	return TRUE;
 }
 
 static Bool
-NV40EXAPicture(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, int unit)
+NV40EXAPicture(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, int unit,
+	       const uint32_t *solid)
 {
+	if (solid)
+		return NV40EXAPictSolid(pNv, *solid, unit);
+
 	if (ppict->pDrawable)
 		return NV40EXAPictTexture(pNv, ppix, ppict, unit);
 
 	switch (ppict->pSourcePict->type) {
-	case SourcePictTypeSolidFill:
-		return NV40EXAPictSolid(pNv, ppict, unit);
 	case SourcePictTypeLinear:
+	case SourcePictTypeRadial:
 		return NV40EXAPictGradient(pNv, ppict, unit);
 	default:
 		break;
@@ -388,7 +431,8 @@ NV40EXACheckCompositeTexture(PicturePtr pPict, PicturePtr pdPict, int op)
 		case SourcePictTypeSolidFill:
 			break;
 		default:
-			NOUVEAU_FALLBACK("gradient\n");
+			/* the colour ramp is bound in place of the picture */
+			return NV30EXACheckGradient(pPict);
 		}
 	}
 
@@ -448,6 +492,69 @@ NV40EXACheckComposite(int op, PicturePtr psPict,
 	return TRUE;
 }
 
+/* The fixed programs fetch both pictures as textures, gradients need a
+ * program generated to compute them first.  The program is otherwise the
+ * same as the fixed one '*fragprog', minus the condition code tricks,
+ * and replaces it.
+ */
+static Bool
+NV40EXAFragProg(NVPtr pNv, PicturePtr psPict, PicturePtr pmPict,
+		uint32_t *fragprog)
+{
+	PicturePtr pPict[2] = { psPict, pmPict };
+	struct nv30_fp fp = { .nv40 = TRUE };
+	uint32_t out = FP_H(0, 0xf) | FP_FP16;
+	int unit;
+
+	for (unit = 0; unit < 2 && pPict[unit]; unit++) {
+		if (NV30EXAIsGradient(pPict[unit])) {
+			NV30EXAGradient(&fp, pPict[unit], unit,
+					FP_R(unit, 0xf), TRUE);
+		} else {
+			/* txp rN, a[texN], t[N] */
+			NV30EXAFragProgInsn(&fp, FP_TXP, FP_R(unit, 0xf) |
+					    FP_IN(unit) | FP_UNIT(unit),
+					    FP_INPUT(FP_XYZW), FP_NONE,
+					    FP_NONE);
+		}
+	}
+
+	switch (*fragprog) {
+	case PFP_S:
+		/* mov h0, r0 */
+		NV30EXAFragProgInsn(&fp, FP_MOV, out, FP_TEMP(0, FP_XYZW),
+				    FP_NONE, FP_NONE);
+		break;
+	case PFP_S_A8:
+		/* mov h0, r0.w */
+		NV30EXAFragProgInsn(&fp, FP_MOV, out, FP_TEMP(0, FP_WWWW),
+				    FP_NONE, FP_NONE);
+		break;
+	case PFP_C:
+		/* mul h0, r0, r1.w */
+		NV30EXAFragProgInsn(&fp, FP_MUL, out, FP_TEMP(0, FP_XYZW),
+				    FP_TEMP(1, FP_WWWW), FP_NONE);
+		break;
+	case PFP_C_A8:
+		/* mul h0, r0.w, r1.w */
+		NV30EXAFragProgInsn(&fp, FP_MUL, out, FP_TEMP(0, FP_WWWW),
+				    FP_TEMP(1, FP_WWWW), FP_NONE);
+		break;
+	case PFP_CCA:
+		/* mul h0, r0, r1 */
+		NV30EXAFragProgInsn(&fp, FP_MUL, out, FP_TEMP(0, FP_XYZW),
+				    FP_TEMP(1, FP_XYZW), FP_NONE);
+		break;
+	case PFP_CCASA:
+		/* mul h0, r0.w, r1 */
+		NV30EXAFragProgInsn(&fp, FP_MUL, out, FP_TEMP(0, FP_WWWW),
+				    FP_TEMP(1, FP_XYZW), FP_NONE);
+		break;
+	}
+
+	return NV30EXAFragProgUpload(pNv, &fp, fragprog);
+}
+
 Bool
 NV40EXAPrepareComposite(int op, PicturePtr psPict,
 				PicturePtr pmPict,
@@ -460,24 +567,16 @@ NV40EXAPrepareComposite(int op, PicturePtr psPict,
 	NVPtr pNv = NVPTR(pScrn);
 	nv_pict_op_t *blend = NV40_GetPictOpRec(op);
 	struct nouveau_pushbuf *push = pNv->pushbuf;
-	uint32_t fragprog;
-
-	if (!PUSH_SPACE(push, 128))
-		NOUVEAU_FALLBACK("space\n");
-	PUSH_RESET(push);
+	uint32_t fragprog, solid[2];
+	Bool ssolid, msolid, gradient;
 
-	NV40_SetupBlend(pScrn, blend, pdPict->format,
-			(pmPict && pmPict->componentAlpha &&
-			 PICT_FORMAT_RGB(pmPict->format)));
+	nouveau_pixmap_dirty(pdPix);
 
-	if (!NV40_SetupSurface(pScrn, pdPix, pdPict->format) ||
-	    !NV40EXAPicture(pNv, psPix, psPict, 0))
-		return FALSE;
+	/* Before touching the pushbuf, reading back a 1x1 pixmap may kick it */
+	ssolid = nouveau_exa_pict_solid(psPix, psPict, &solid[0]);
+	msolid = nouveau_exa_pict_solid(pmPix, pmPict, &solid[1]);
 
 	if (pmPict) {
-		if (!NV40EXAPicture(pNv, pmPix, pmPict, 1))
-			return FALSE;
-
 		if (pdPict->format == PICT_a8) {
 			fragprog = PFP_C_A8;
 		} else
@@ -496,6 +595,31 @@ NV40EXAPrepareComposite(int op, PicturePtr psPict,
 			fragprog = PFP_S;
 	}
 
+	/* Uploading a generated program needs its own pushbuf space, and
+	 * gradient ramps some more with the textures.
+	 */
+	gradient = NV30EXAIsGradient(psPict) || NV30EXAIsGradient(pmPict);
+	if (gradient && !NV40EXAFragProg(pNv, psPict, pmPict, &fragprog))
+		NOUVEAU_FALLBACK("fragment program upload failed\n");
+
+	if (!PUSH_SPACE(push, 160 + 2 * (32 + 256)))
+		NOUVEAU_FALLBACK("space\n");
+	PUSH_RESET(push);
+	NV30EXAVtxBufPrepare(pNv);
+
+	NV40_SetupBlend(pScrn, blend, pdPict->format,
+			(pmPict && pmPict->componentAlpha &&
+			 PICT_FORMAT_RGB(pmPict->format)));
+
+	if (!NV40_SetupSurface(pScrn, pdPix, pdPict->format))
+		NOUVEAU_FALLBACK("render target invalid\n");
+	if (!NV40EXAPicture(pNv, psPix, psPict, 0, ssolid ? &solid[0] : NULL))
+		NOUVEAU_FALLBACK("src picture invalid\n");
+
+	if (pmPict && !NV40EXAPicture(pNv, pmPix, pmPict, 1,
+				      msolid ? &solid[1] : NULL))
+		NOUVEAU_FALLBACK("mask picture invalid\n");
+
 	BEGIN_NV04(push, NV30_3D(FP_ACTIVE_PROGRAM), 1);
 	PUSH_MTHD (push, NV30_3D(FP_ACTIVE_PROGRAM), pNv->scratch, fragprog,
 			 NOUVEAU_BO_VRAM | NOUVEAU_BO_RD | NOUVEAU_BO_LOW |
@@ -503,7 +627,7 @@ NV40EXAPrepareComposite(int op, PicturePtr psPict,
 			 NV30_3D_FP_ACTIVE_PROGRAM_DMA0,
 			 NV30_3D_FP_ACTIVE_PROGRAM_DMA1);
 	BEGIN_NV04(push, NV30_3D(FP_CONTROL), 1);
-	PUSH_DATA (push, 0x02000000);
+	PUSH_DATA (push, gradient ? 0x04000000 : 0x02000000);
 
 	/* Appears to be some kind of cache flush, needed here at least
 	 * sometimes.. funky text rendering otherwise :)
@@ -516,56 +640,29 @@ NV40EXAPrepareComposite(int op, PicturePtr psPict,
 	nouveau_pushbuf_bufctx(push, pNv->bufctx);
 	if (nouveau_pushbuf_validate(push)) {
 		nouveau_pushbuf_bufctx(push, NULL);
-		return FALSE;
+		NOUVEAU_FALLBACK("validate\n");
 	}
 
 	return TRUE;
 }
 
-static __inline__ void
-PUSH_VTX2s(struct nouveau_pushbuf *push,
-	   int x1, int y1, int x2, int y2, int dx, int dy)
-{
-	BEGIN_NV04(push, NV30_3D(VTX_ATTR_2I(8)), 2);
-	PUSH_DATA (push, ((y1 & 0xffff) << 16) | (x1 & 0xffff));
-	PUSH_DATA (push, ((y2 & 0xffff) << 16) | (x2 & 0xffff));
-	BEGIN_NV04(push, NV30_3D(VTX_ATTR_2I(0)), 1);
-	PUSH_DATA (push, ((dy & 0xffff) << 16) | (dx & 0xffff));
-}
-
 void
 NV40EXAComposite(PixmapPtr pdPix,
 		 int sx, int sy, int mx, int my, int dx, int dy, int w, int h)
 {
 	ScrnInfoPtr pScrn = xf86ScreenToScrn(pdPix->drawable.pScreen);
-	NVPtr pNv = NVPTR(pScrn);
-	struct nouveau_pushbuf *push = pNv->pushbuf;
 
-	if (!PUSH_SPACE(push, 64))
-		return;
-
-	/* We're drawing a triangle, we need to scissor it to a quad. */
-	/* The scissors are here for a good reason, we don't get the full
-	 * image, but just a part.
-	 */
-	/* Handling the cliprects is done for us already. */
-	BEGIN_NV04(push, NV30_3D(SCISSOR_HORIZ), 2);
-	PUSH_DATA (push, (w << 16) | dx);
-	PUSH_DATA (push, (h << 16) | dy);
-	BEGIN_NV04(push, NV30_3D(VERTEX_BEGIN_END), 1);
-	PUSH_DATA (push, NV30_3D_VERTEX_BEGIN_END_TRIANGLES);
-	PUSH_VTX2s(push, sx, sy + (h * 2), mx, my + (h * 2), dx, dy + (h * 2));
-	PUSH_VTX2s(push, sx, sy, mx, my, dx, dy);
-	PUSH_VTX2s(push, sx + (w * 2), sy, mx + (w * 2), my, dx + (w * 2), dy);
-	BEGIN_NV04(push, NV30_3D(VERTEX_BEGIN_END), 1);
-	PUSH_DATA (push, NV30_3D_VERTEX_BEGIN_END_STOP);
+	NV30EXAVtxBufQuad(NVPTR(pScrn), sx, sy, mx, my, dx, dy, w, h);
 }
 
 void
 NV40EXADoneComposite(PixmapPtr pdPix)
 {
 	ScrnInfoPtr pScrn = xf86ScreenToScrn(pdPix->drawable.pScreen);
-	nouveau_pushbuf_bufctx(NVPTR(pScrn)->pushbuf, NULL);
+	NVPtr pNv = NVPTR(pScrn);
+
+	NV30EXAVtxBufDone(pNv);
+	nouveau_pushbuf_bufctx(pNv->pushbuf, NULL);
 }
 
 #define NV30_3D_CHIPSET_4X_MASK 0x00000baf
@@ -601,6 +698,9 @@ NVAccelInitNV40TCL(ScrnInfoPtr pScrn)
 	if (nouveau_object_new(pNv->channel, Nv3D, class, NULL, 0, &pNv->Nv3D))
 		return FALSE;
 
+	if (!NV30EXAVtxBufInit(pNv))
+		return FALSE;
+
 	if (!PUSH_SPACE(push, 256))
 		return FALSE;
 
@@ -614,6 +714,9 @@ NVAccelInitNV40TCL(ScrnInfoPtr pScrn)
 	BEGIN_NV04(push, NV30_3D(DMA_COLOR0), 2);
 	PUSH_DATA (push, fifo->vram);
 	PUSH_DATA (push, fifo->vram);
+	BEGIN_NV04(push, NV30_3D(DMA_VTXBUF0), 2);
+	PUSH_DATA (push, fifo->vram);
+	PUSH_DATA (push, fifo->gart);
 
 	/* voodoo */
 	BEGIN_NV04(push, SUBC_3D(0x1ea4), 3);
@@ -777,6 +880,8 @@ NVAccelInitNV40TCL(ScrnInfoPtr pScrn)
 	PUSH_DATA (push, 0x00000309);
 	PUSH_DATA (push, 0x0000c001);
 
+	NV30EXAFragProgReset(pNv);
+
 	PUSH_DATAu(push, pNv->scratch, PFP_PASS, 1 * 4);
 	PUSH_DATAs(push, 0x01403e81); /* mov r0, a[col0] */
 	PUSH_DATAs(push, 0x1c9dc801);
@@ -175,7 +175,7 @@ NVAccelInitNV50TCL(ScrnInfoPtr pScrn)
 		return FALSE;
 	}
 
-	if (nouveau_pushbuf_space(push, 512, 0, 0) ||
+	if (nouveau_push_space(push, 512, 0, 0) ||
 	    nouveau_pushbuf_refn (push, &(struct nouveau_pushbuf_refn) {
 					pNv->scratch, NOUVEAU_BO_VRAM |
 					NOUVEAU_BO_WR }, 1))
@@ -223,7 +223,7 @@ NVAccelInitNV50TCL(ScrnInfoPtr pScrn)
 	BEGIN_NV04(push, NV50_3D(TEX_LIMITS(2)), 1);
 	PUSH_DATA (push, 0x54);
 
-	PUSH_DATAu(push, pNv->scratch, PVP_OFFSET, 30 * 2);
+	PUSH_DATAu(push, pNv->scratch, PVP_OFFSET + PVP_XFRM, 30 * 2);
 	PUSH_DATA (push, 0x10000001);
 	PUSH_DATA (push, 0x0423c788); /* mov b32 o[0x0] a[0x0] */
 	PUSH_DATA (push, 0x10000205);
@@ -284,6 +284,19 @@ NVAccelInitNV50TCL(ScrnInfoPtr pScrn)
 	PUSH_DATA (push, 0x00000788); /* mul rn f32 o[0x10] $r0 c0[0x50] */
 	PUSH_DATA (push, 0xc0950215);
 	PUSH_DATA (push, 0x00000789); /* exit mul rn f32 o[0x14] $r1 c0[0x54] */
+	PUSH_DATAu(push, pNv->scratch, PVP_OFFSET + PVP_IDENT, 6 * 2);
+	PUSH_DATA (push, 0x10000001);
+	PUSH_DATA (push, 0x0423c788); /* mov b32 o[0x0] a[0x0] */
+	PUSH_DATA (push, 0x10000205);
+	PUSH_DATA (push, 0x0423c788); /* mov b32 o[0x4] a[0x4] */
+	PUSH_DATA (push, 0xc0890409);
+	PUSH_DATA (push, 0x00200788); /* mul rn f32 o[0x8] a[0x8] c0[0x24] */
+	PUSH_DATA (push, 0xc08a060d);
+	PUSH_DATA (push, 0x00200788); /* mul rn f32 o[0xc] a[0xc] c0[0x28] */
+	PUSH_DATA (push, 0xc0940811);
+	PUSH_DATA (push, 0x00200788); /* mul rn f32 o[0x10] a[0x10] c0[0x50] */
+	PUSH_DATA (push, 0xc0950a15);
+	PUSH_DATA (push, 0x00200789); /* exit mul rn f32 o[0x14] a[0x14] c0[0x54] */
 
 	/* fetch only VTX_ATTR[0,8,9].xy */
 	BEGIN_NV04(push, NV50_3D(VP_ATTR_EN(0)), 2);
@@ -304,7 +317,7 @@ NVAccelInitNV50TCL(ScrnInfoPtr pScrn)
 	BEGIN_NV04(push, NV50_3D(SET_PROGRAM_CB), 1);
 	PUSH_DATA (push, 0x00000001 | (CB_PVP << 12));
 	BEGIN_NV04(push, NV50_3D(VP_START_ID), 1);
-	PUSH_DATA (push, 0);
+	PUSH_DATA (push, PVP_XFRM);
 
 	PUSH_DATAu(push, pNv->scratch, PFP_OFFSET + PFP_S, 6);
 	PUSH_DATA (push, 0x80000000); /* interp $r0 v[0x0] */
@@ -417,6 +430,19 @@ NVAccelInitNV50TCL(ScrnInfoPtr pScrn)
 	PUSH_DATA (push, 0x00014780); /* add f32 $r2 (mul $r1 c0[0x24]) $r5 */
 	PUSH_DATA (push, 0xe0880205);
 	PUSH_DATA (push, 0x00010781); /* exit add f32 $r1 (mul $r1 c0[0x20]) $r4 */
+	PUSH_DATAu(push, pNv->scratch, PFP_OFFSET + PFP_SC_A8, 12);
+	PUSH_DATA (push, 0x80000000); /* interp $r0 v[0x0] */
+	PUSH_DATA (push, 0x90000004); /* rcp f32 $r1 $r0 */
+	PUSH_DATA (push, 0x82030200); /* interp $r0 v[0xc] $r1 */
+	PUSH_DATA (push, 0x82040204); /* interp $r1 v[0x10] $r1 */
+	PUSH_DATA (push, 0xf0400201);
+	PUSH_DATA (push, 0x00008784); /* texauto live #:#:#:$r0 $t1 $s0 $r0:$r1 0x0 0x0 0x0 */
+	PUSH_DATA (push, 0xc0810004); /* mul f32 $r1 $r0 c0[0x4] */
+	PUSH_DATA (push, 0xc0820008); /* mul f32 $r2 $r0 c0[0x8] */
+	PUSH_DATA (push, 0xc083000c); /* mul f32 $r3 $r0 c0[0xc] */
+	PUSH_DATA (push, 0xc0800010); /* mul f32 $r4 $r0 c0[0x0] */
+	PUSH_DATA (push, 0x10000801);
+	PUSH_DATA (push, 0x0403c781); /* exit mov b32 $r0 $r4 */
 
 	/* HPOS.xy = ($o0, $o1), HPOS.zw = (0.0, 1.0), then map $o2 - $o5 */
 	BEGIN_NV04(push, NV50_3D(VP_RESULT_MAP(0)), 2);
@@ -454,5 +480,7 @@ NVAccelInitNV50TCL(ScrnInfoPtr pScrn)
 	PUSH_DATA (push, 8192 << NV50_3D_SCREEN_SCISSOR_HORIZ_W__SHIFT);
 	PUSH_DATA (push, 8192 << NV50_3D_SCREEN_SCISSOR_VERT_H__SHIFT);
 
+	nouveau_tex_cache_invalidate(pNv);
+	NV50EXAFragProgReset(pNv);
 	return TRUE;
 }
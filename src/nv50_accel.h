@@ -32,6 +32,11 @@
 #define PVP_DATA    0x00004000 /* VP constbuf */
 #define PFP_DATA    0x00004100 /* FP constbuf */
 #define SOLID(i)   (0x00006000 + (i) * 0x100)
+#define PFP_GEN(i) (0x00008000 + (i) * 0x800) /* see nv50_fp.c */
+
+/* Vertex programs */
+#define PVP_XFRM  0x0000 /* projective transform */
+#define PVP_IDENT 0x0100 /* identity transform, normalise only */
 
 /* Fragment programs */
 #define PFP_S     0x0000 /* (src) */
@@ -41,6 +46,10 @@
 #define PFP_S_A8  0x0400 /* (src) a8 rt */
 #define PFP_C_A8  0x0500 /* (src IN mask) a8 rt - same for CA and CA_SA */
 #define PFP_NV12  0x0600 /* NV12 YUV->RGB */
+#define PFP_SC_A8 0x0700 /* (solid IN mask) a8 mask, colour in c0[] */
+
+/* Pushbuf space NV50EXAConv() may need, for a program and its constants */
+#define NV50_CONV_SPACE 640
 
 /* Constant buffer assignments */
 #define CB_PSH 0
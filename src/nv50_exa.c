@@ -25,6 +25,7 @@
 #include "nv_rop.h"
 
 #include "nv50_accel.h"
+#include "nouveau_copy.h"
 
 #define NV50EXA_LOCALS(p)                                                      \
 	ScrnInfoPtr pScrn = xf86ScreenToScrn((p)->drawable.pScreen);         \
@@ -125,7 +126,7 @@ NV50EXAAcquireSurface2D(PixmapPtr ppix, int is_src, uint32_t fmt)
 	if (is_src == 0)
 		NV50EXASetClip(ppix, 0, 0, ppix->drawable.width, ppix->drawable.height);
 
-	PUSH_REFN (push, bo, bo_flags);
+	nouveau_push_refn(pNv, bo, bo_flags);
 }
 
 static void
@@ -146,7 +147,7 @@ NV50EXASetROP(PixmapPtr pdpix, int alu, Pixel planemask)
 	NV50EXA_LOCALS(pdpix);
 	int rop;
 
-	if (planemask != ~0)
+	if (!EXA_PM_IS_SOLID(&pdpix->drawable, planemask))
 		rop = NVROP[alu].copy_planemask;
 	else
 		rop = NVROP[alu].copy;
@@ -198,6 +199,9 @@ NV50EXAPrepareSolid(PixmapPtr pdpix, int alu, Pixel planemask, Pixel fg)
 	NV50EXA_LOCALS(pdpix);
 	uint32_t fmt;
 
+	nouveau_pixmap_dirty(pdpix);
+	nouveau_copy_sync(pNv, nouveau_pixmap_bo(pdpix));
+
 	if (!NV50EXA2DSurfaceFormat(pdpix, &fmt))
 		NOUVEAU_FALLBACK("rect format\n");
 
@@ -219,6 +223,7 @@ NV50EXAPrepareSolid(PixmapPtr pdpix, int alu, Pixel planemask, Pixel fg)
 		NOUVEAU_FALLBACK("validate\n");
 	}
 
+	nouveau_timing_begin(pNv, NOUVEAU_TIMING_SOLID);
 	return TRUE;
 }
 
@@ -244,6 +249,7 @@ void
 NV50EXADoneSolid(PixmapPtr pdpix)
 {
 	NV50EXA_LOCALS(pdpix);
+	nouveau_timing_end(pNv);
 	nouveau_pushbuf_bufctx(push, NULL);
 }
 
@@ -254,6 +260,10 @@ NV50EXAPrepareCopy(PixmapPtr pspix, PixmapPtr pdpix, int dx, int dy,
 	NV50EXA_LOCALS(pdpix);
 	uint32_t src, dst;
 
+	nouveau_pixmap_dirty(pdpix);
+	nouveau_copy_sync(pNv, nouveau_pixmap_bo(pspix));
+	nouveau_copy_sync(pNv, nouveau_pixmap_bo(pdpix));
+
 	if (!NV50EXA2DSurfaceFormat(pspix, &src))
 		NOUVEAU_FALLBACK("src format\n");
 	if (!NV50EXA2DSurfaceFormat(pdpix, &dst))
@@ -273,6 +283,7 @@ NV50EXAPrepareCopy(PixmapPtr pspix, PixmapPtr pdpix, int dx, int dy,
 		NOUVEAU_FALLBACK("validate\n");
 	}
 
+	nouveau_timing_begin(pNv, NOUVEAU_TIMING_COPY);
 	return TRUE;
 }
 
@@ -312,6 +323,7 @@ void
 NV50EXADoneCopy(PixmapPtr pdpix)
 {
 	NV50EXA_LOCALS(pdpix);
+	nouveau_timing_end(pNv);
 	nouveau_pushbuf_bufctx(push, NULL);
 }
 
@@ -417,6 +429,7 @@ NV50EXARenderTarget(PixmapPtr ppix, PicturePtr ppict)
 {
 	NV50EXA_LOCALS(ppix);
 	struct nouveau_bo *bo = nouveau_pixmap_bo(ppix);
+	uint32_t rt[5];
 	unsigned format;
 
 	/*XXX: Scanout buffer not tiled, someone needs to figure it out */
@@ -445,22 +458,36 @@ NV50EXARenderTarget(PixmapPtr ppix, PicturePtr ppict)
 		NOUVEAU_FALLBACK("invalid picture format\n");
 	}
 
-	PUSH_REFN (push, bo, NOUVEAU_BO_VRAM | NOUVEAU_BO_WR);
-	BEGIN_NV04(push, NV50_3D(RT_ADDRESS_HIGH(0)), 5);
-	PUSH_DATA (push, bo->offset >> 32);
-	PUSH_DATA (push, bo->offset);
-	PUSH_DATA (push, format);
-	PUSH_DATA (push, bo->config.nv50.tile_mode);
-	PUSH_DATA (push, 0x00000000);
-	BEGIN_NV04(push, NV50_3D(RT_HORIZ(0)), 2);
-	PUSH_DATA (push, ppix->drawable.width);
-	PUSH_DATA (push, ppix->drawable.height);
-	BEGIN_NV04(push, NV50_3D(RT_ARRAY_MODE), 1);
-	PUSH_DATA (push, 0x00000001);
+	nouveau_push_refn(pNv, bo, NOUVEAU_BO_VRAM | NOUVEAU_BO_WR);
+	rt[0] = bo->offset >> 32;
+	rt[1] = bo->offset;
+	rt[2] = format;
+	rt[3] = bo->config.nv50.tile_mode;
+	rt[4] = 0x00000000;
+	nouveau_state_data(pNv, NV50_3D(RT_ADDRESS_HIGH(0)), 5, rt);
+	rt[0] = ppix->drawable.width;
+	rt[1] = ppix->drawable.height;
+	nouveau_state_data(pNv, NV50_3D(RT_HORIZ(0)), 2, rt);
+	nouveau_state_mthd(pNv, NV50_3D(RT_ARRAY_MODE), 0x00000001);
 
 	return TRUE;
 }
 
+/* OpenGL and Render disagree on what should be sampled outside an XRGB
+ * texture (with no repeating). OpenGL has a hardcoded alpha value of
+ * 1.0, while render expects 0.0. We assume that clipping is done for
+ * untransformed sources, anything else needs the bounds test done by
+ * NV50EXAPictBounds().
+ */
+static Bool
+NV50EXANeedsBounds(PicturePtr ppict, PicturePtr pdpict, int op)
+{
+	return NV50EXABlendOp[op].src_alpha && ppict->pDrawable &&
+	       !ppict->repeat && ppict->transform &&
+	       PICT_FORMAT_A(ppict->format) == 0 &&
+	       PICT_FORMAT_A(pdpict->format) != 0;
+}
+
 static Bool
 NV50EXACheckTexture(PicturePtr ppict, PicturePtr pdpict, int op)
 {
@@ -509,20 +536,14 @@ NV50EXACheckTexture(PicturePtr ppict, PicturePtr pdpict, int op)
 	case PictFilterNearest:
 	case PictFilterBilinear:
 		break;
+	case PictFilterConvolution:
+		if (!NV50EXACheckConv(ppict))
+			return FALSE;
+		break;
 	default:
 		NOUVEAU_FALLBACK("picture filter %d\n", ppict->filter);
 	}
 
-	/* Opengl and Render disagree on what should be sampled outside an XRGB 
-	 * texture (with no repeating). Opengl has a hardcoded alpha value of 
-	 * 1.0, while render expects 0.0. We assume that clipping is done for 
-	 * untranformed sources.
-	 */
-	if (NV50EXABlendOp[op].src_alpha && !ppict->repeat &&
-		ppict->transform && (PICT_FORMAT_A(ppict->format) == 0)
-		&& (PICT_FORMAT_A(pdpict->format) != 0))
-		NOUVEAU_FALLBACK("REPEAT_NONE unsupported for XRGB source\n");
-
 	return TRUE;
 }
 
@@ -531,35 +552,46 @@ NV50EXACheckTexture(PicturePtr ppict, PicturePtr pdpict, int op)
 			    NV50TIC_0_0_FMT_##FMT)
 
 static Bool
-NV50EXAPictSolid(NVPtr pNv, PicturePtr ppict, unsigned unit)
+NV50EXAPictSolid(NVPtr pNv, uint32_t color, unsigned unit, Bool border)
 {
 	uint64_t offset = pNv->scratch->offset + SOLID(unit);
 	struct nouveau_pushbuf *push = pNv->pushbuf;
+	uint32_t tic[8] = {
+		_(B_C0, G_C1, R_C2, A_C3, 8_8_8_8),
+		offset,
+		(offset >> 32) | 0xd005d000,
+		0x00300000,
+		0x00000001,
+		0x00010001,
+		0x03000000,
+		0x00000000,
+	}, tsc[8] = {
+		NV50TSC_1_0_WRAPS_REPEAT |
+		NV50TSC_1_0_WRAPT_REPEAT |
+		NV50TSC_1_0_WRAPR_REPEAT | 0x00024000,
+		NV50TSC_1_1_MAGF_NEAREST |
+		NV50TSC_1_1_MINF_NEAREST |
+		NV50TSC_1_1_MIPF_NONE,
+	};
+
+	if (border) {
+		tsc[0] = NV50TSC_1_0_WRAPS_CLAMP_TO_BORDER |
+			 NV50TSC_1_0_WRAPT_CLAMP_TO_BORDER |
+			 NV50TSC_1_0_WRAPR_CLAMP_TO_BORDER | 0x00024000;
+	}
 
 	PUSH_DATAu(push, pNv->scratch, SOLID(unit), 1);
-	PUSH_DATA (push, ppict->pSourcePict->solidFill.color);
-	PUSH_DATAu(push, pNv->scratch, TIC_OFFSET + (unit * 32), 8);
-	PUSH_DATA (push, _(B_C0, G_C1, R_C2, A_C3, 8_8_8_8));
-	PUSH_DATA (push,  offset);
-	PUSH_DATA (push, (offset >> 32) | 0xd005d000);
-	PUSH_DATA (push, 0x00300000);
-	PUSH_DATA (push, 0x00000001);
-	PUSH_DATA (push, 0x00010001);
-	PUSH_DATA (push, 0x03000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATAu(push, pNv->scratch, TSC_OFFSET + (unit * 32), 8);
-	PUSH_DATA (push, NV50TSC_1_0_WRAPS_REPEAT |
-			 NV50TSC_1_0_WRAPT_REPEAT |
-			 NV50TSC_1_0_WRAPR_REPEAT | 0x00024000);
-	PUSH_DATA (push, NV50TSC_1_1_MAGF_NEAREST |
-			 NV50TSC_1_1_MINF_NEAREST |
-			 NV50TSC_1_1_MIPF_NONE);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
+	PUSH_DATA (push, color);
+
+	if (!nouveau_tex_cache_tic(pNv, unit, tic)) {
+		PUSH_DATAu(push, pNv->scratch, TIC_OFFSET + (unit * 32), 8);
+		PUSH_DATAp(push, tic, 8);
+	}
+
+	if (!nouveau_tex_cache_tsc(pNv, unit, tsc)) {
+		PUSH_DATAu(push, pNv->scratch, TSC_OFFSET + (unit * 32), 8);
+		PUSH_DATAp(push, tsc, 8);
+	}
 
 	return TRUE;
 }
@@ -570,12 +602,39 @@ NV50EXAPictGradient(NVPtr pNv, PicturePtr ppict, unsigned unit)
 	return FALSE;
 }
 
+static Bool
+NV50EXAPictTransform(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, unsigned unit)
+{
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	float xfrm[11] = {
+		1.0, 0.0, 0.0,
+		0.0, 1.0, 0.0,
+		0.0, 0.0, 1.0,
+		1.0 / ppix->drawable.width,
+		1.0 / ppix->drawable.height,
+	};
+	PictTransformPtr t = ppict->transform;
+	int i;
+
+	if (t) {
+		for (i = 0; i < 9; i++)
+			xfrm[i] = xFixedToFloat(t->matrix[i / 3][i % 3]);
+	}
+
+	if (!nouveau_tex_cache_xfrm(pNv, unit, xfrm)) {
+		PUSH_DATAu(push, pNv->scratch, PVP_DATA + (unit * 11 * 4), 11);
+		PUSH_DATAp(push, xfrm, 11);
+	}
+
+	return TRUE;
+}
+
 static Bool
 NV50EXAPictTexture(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, unsigned unit)
 {
 	struct nouveau_bo *bo = nouveau_pixmap_bo(ppix);
 	struct nouveau_pushbuf *push = pNv->pushbuf;
-	uint32_t format;
+	uint32_t format, tic[8], tsc[8] = {};
 
 	/*XXX: Scanout buffer not tiled, someone needs to figure it out */
 	if (!nv50_style_tiled_pixmap(ppix))
@@ -650,96 +709,103 @@ NV50EXAPictTexture(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, unsigned unit)
 	}
 #undef _
 
-	PUSH_REFN (push, bo, NOUVEAU_BO_VRAM | NOUVEAU_BO_RD);
-	PUSH_DATAu(push, pNv->scratch, TIC_OFFSET + (unit * 32), 8);
-	PUSH_DATA (push, format);
-	PUSH_DATA (push, bo->offset);
-	PUSH_DATA (push, (bo->offset >> 32) |
-			 (bo->config.nv50.tile_mode << 18) |
-			 0xd0005000);
-	PUSH_DATA (push, 0x00300000);
-	PUSH_DATA (push, ppix->drawable.width);
-	PUSH_DATA (push, (1 << NV50TIC_0_5_DEPTH_SHIFT) | ppix->drawable.height);
-	PUSH_DATA (push, 0x03000000);
-	PUSH_DATA (push, 0x00000000);
+	tic[0] = format;
+	tic[1] = bo->offset;
+	tic[2] = (bo->offset >> 32) |
+		 (bo->config.nv50.tile_mode << 18) |
+		 0xd0005000;
+	tic[3] = 0x00300000;
+	tic[4] = ppix->drawable.width;
+	tic[5] = (1 << NV50TIC_0_5_DEPTH_SHIFT) | ppix->drawable.height;
+	tic[6] = 0x03000000;
+	tic[7] = 0x00000000;
 
-	PUSH_DATAu(push, pNv->scratch, TSC_OFFSET + (unit * 32), 8);
 	if (ppict->repeat) {
 		switch (ppict->repeatType) {
 		case RepeatPad:
-			PUSH_DATA (push, NV50TSC_1_0_WRAPS_CLAMP_TO_EDGE |
+			tsc[0] = NV50TSC_1_0_WRAPS_CLAMP_TO_EDGE |
 				 NV50TSC_1_0_WRAPT_CLAMP_TO_EDGE |
-				 NV50TSC_1_0_WRAPR_CLAMP_TO_EDGE | 0x00024000);
+				 NV50TSC_1_0_WRAPR_CLAMP_TO_EDGE | 0x00024000;
 			break;
 		case RepeatReflect:
-			PUSH_DATA (push, NV50TSC_1_0_WRAPS_MIRROR_REPEAT |
+			tsc[0] = NV50TSC_1_0_WRAPS_MIRROR_REPEAT |
 				 NV50TSC_1_0_WRAPT_MIRROR_REPEAT |
-				 NV50TSC_1_0_WRAPR_MIRROR_REPEAT | 0x00024000);
+				 NV50TSC_1_0_WRAPR_MIRROR_REPEAT | 0x00024000;
 			break;
 		case RepeatNormal:
 		default:
-			PUSH_DATA (push, NV50TSC_1_0_WRAPS_REPEAT |
+			tsc[0] = NV50TSC_1_0_WRAPS_REPEAT |
 				 NV50TSC_1_0_WRAPT_REPEAT |
-				 NV50TSC_1_0_WRAPR_REPEAT | 0x00024000);
+				 NV50TSC_1_0_WRAPR_REPEAT | 0x00024000;
 			break;
 		}
 	} else {
-		PUSH_DATA (push, NV50TSC_1_0_WRAPS_CLAMP_TO_BORDER |
+		tsc[0] = NV50TSC_1_0_WRAPS_CLAMP_TO_BORDER |
 			 NV50TSC_1_0_WRAPT_CLAMP_TO_BORDER |
-			 NV50TSC_1_0_WRAPR_CLAMP_TO_BORDER | 0x00024000);
+			 NV50TSC_1_0_WRAPR_CLAMP_TO_BORDER | 0x00024000;
 	}
 	if (ppict->filter == PictFilterBilinear) {
-		PUSH_DATA (push, NV50TSC_1_1_MAGF_LINEAR |
+		tsc[1] = NV50TSC_1_1_MAGF_LINEAR |
 			 NV50TSC_1_1_MINF_LINEAR |
-			 NV50TSC_1_1_MIPF_NONE);
+			 NV50TSC_1_1_MIPF_NONE;
 	} else {
-		PUSH_DATA (push, NV50TSC_1_1_MAGF_NEAREST |
+		tsc[1] = NV50TSC_1_1_MAGF_NEAREST |
 			 NV50TSC_1_1_MINF_NEAREST |
-			 NV50TSC_1_1_MIPF_NONE);
-	}
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-
-	PUSH_DATAu(push, pNv->scratch, PVP_DATA + (unit * 11 * 4), 11);
-	if (ppict->transform) {
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[0][0]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[0][1]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[0][2]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[1][0]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[1][1]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[1][2]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[2][0]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[2][1]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[2][2]));
-	} else {
-		PUSH_DATAf(push, 1.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 1.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 1.0);
-	}
-	PUSH_DATAf(push, 1.0 / ppix->drawable.width);
-	PUSH_DATAf(push, 1.0 / ppix->drawable.height);
+			 NV50TSC_1_1_MIPF_NONE;
+	}
+
+	nouveau_push_refn(pNv, bo, NOUVEAU_BO_VRAM | NOUVEAU_BO_RD);
+	if (!nouveau_tex_cache_tic(pNv, unit, tic)) {
+		PUSH_DATAu(push, pNv->scratch, TIC_OFFSET + (unit * 32), 8);
+		PUSH_DATAp(push, tic, 8);
+	}
+
+	if (!nouveau_tex_cache_tsc(pNv, unit, tsc)) {
+		PUSH_DATAu(push, pNv->scratch, TSC_OFFSET + (unit * 32), 8);
+		PUSH_DATAp(push, tsc, 8);
+	}
+
+	return NV50EXAPictTransform(pNv, ppix, ppict, unit);
+}
+
+/* Source colour for PFP_SC_A8, which skips the source texture fetch */
+static Bool
+NV50EXAPictColour(NVPtr pNv, uint32_t color)
+{
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+
+	PUSH_DATAu(push, pNv->scratch, PFP_DATA, 4);
+	PUSH_DATAf(push, ((color >> 16) & 0xff) / 255.0);
+	PUSH_DATAf(push, ((color >>  8) & 0xff) / 255.0);
+	PUSH_DATAf(push, ((color >>  0) & 0xff) / 255.0);
+	PUSH_DATAf(push, ((color >> 24) & 0xff) / 255.0);
 	return TRUE;
 }
 
+/* Mask unit stand-in for an XRGB source with no repeat: a white texel
+ * with a transparent border, sampled through the source's transform and
+ * normalised to the source's size, so it's 1.0 inside the source and 0.0
+ * outside.  See NV50EXANeedsBounds().
+ */
+static Bool
+NV50EXAPictBounds(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, unsigned unit)
+{
+	if (!NV50EXAPictSolid(pNv, 0xffffffff, unit, TRUE))
+		return FALSE;
+	return NV50EXAPictTransform(pNv, ppix, ppict, unit);
+}
+
 static Bool
-NV50EXAPicture(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, int unit)
+NV50EXAPicture(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, int unit,
+	       const uint32_t *solid)
 {
+	if (solid)
+		return NV50EXAPictSolid(pNv, *solid, unit, FALSE);
+
 	if (ppict->pDrawable)
 		return NV50EXAPictTexture(pNv, ppix, ppict, unit);
 
 	switch (ppict->pSourcePict->type) {
-	case SourcePictTypeSolidFill:
-		return NV50EXAPictSolid(pNv, ppict, unit);
 	case SourcePictTypeLinear:
 		return NV50EXAPictGradient(pNv, ppict, unit);
 	default:
@@ -784,19 +850,16 @@ NV50EXABlend(PixmapPtr ppix, PicturePtr ppict, int op, int component_alpha)
 	}
 
 	if (sblend == BF(ONE) && dblend == BF(ZERO)) {
-		BEGIN_NV04(push, NV50_3D(BLEND_ENABLE(0)), 1);
-		PUSH_DATA (push, 0);
+		nouveau_state_mthd(pNv, NV50_3D(BLEND_ENABLE(0)), 0);
 	} else {
-		BEGIN_NV04(push, NV50_3D(BLEND_ENABLE(0)), 1);
-		PUSH_DATA (push, 1);
-		BEGIN_NV04(push, NV50_3D(BLEND_EQUATION_RGB), 5);
-		PUSH_DATA (push, NV50_3D_BLEND_EQUATION_RGB_FUNC_ADD);
-		PUSH_DATA (push, sblend);
-		PUSH_DATA (push, dblend);
-		PUSH_DATA (push, NV50_3D_BLEND_EQUATION_ALPHA_FUNC_ADD);
-		PUSH_DATA (push, sblend);
-		BEGIN_NV04(push, NV50_3D(BLEND_FUNC_DST_ALPHA), 1);
-		PUSH_DATA (push, dblend);
+		uint32_t blend[5] = {
+			NV50_3D_BLEND_EQUATION_RGB_FUNC_ADD, sblend, dblend,
+			NV50_3D_BLEND_EQUATION_ALPHA_FUNC_ADD, sblend
+		};
+
+		nouveau_state_mthd(pNv, NV50_3D(BLEND_ENABLE(0)), 1);
+		nouveau_state_data(pNv, NV50_3D(BLEND_EQUATION_RGB), 5, blend);
+		nouveau_state_mthd(pNv, NV50_3D(BLEND_FUNC_DST_ALPHA), dblend);
 	}
 }
 
@@ -814,12 +877,30 @@ NV50EXACheckComposite(int op,
 		NOUVEAU_FALLBACK("src picture invalid\n");
 
 	if (pmpict) {
+		/* the mask unit is needed for the bounds test */
+		if (NV50EXANeedsBounds(pspict, pdpict, op))
+			NOUVEAU_FALLBACK("REPEAT_NONE unsupported for XRGB source\n");
+		if (NV50EXANeedsBounds(pmpict, pdpict, op))
+			NOUVEAU_FALLBACK("REPEAT_NONE unsupported for XRGB mask\n");
+
 		if (pmpict->componentAlpha &&
 		    PICT_FORMAT_RGB(pmpict->format) &&
 		    NV50EXABlendOp[op].src_alpha &&
 		    NV50EXABlendOp[op].src_blend != BF(ZERO))
 			NOUVEAU_FALLBACK("component-alpha not supported\n");
 
+		/* the convolution program only has the mask's alpha, and
+		 * doesn't clamp before it
+		 */
+		if (pmpict->filter == PictFilterConvolution)
+			NOUVEAU_FALLBACK("convolution-filtered mask\n");
+		if (pspict->filter == PictFilterConvolution &&
+		    pmpict->componentAlpha && PICT_FORMAT_RGB(pmpict->format))
+			NOUVEAU_FALLBACK("component-alpha under convolution\n");
+		if (pspict->filter == PictFilterConvolution &&
+		    !NV50EXACheckConvMask(pspict))
+			NOUVEAU_FALLBACK("convolution under a mask\n");
+
 		if (!NV50EXACheckTexture(pmpict, pdpict, op))
 			NOUVEAU_FALLBACK("mask picture invalid\n");
 	}
@@ -833,11 +914,32 @@ NV50EXAPrepareComposite(int op,
 			PixmapPtr pspix, PixmapPtr pmpix, PixmapPtr pdpix)
 {
 	NV50EXA_LOCALS(pdpix);
+	uint32_t solid[2], fp;
+	Bool ssolid, msolid, sca8, ident, conv;
+
+	nouveau_pixmap_dirty(pdpix);
+	pNv->composite_open = FALSE;
+	pNv->composite_bounds = !pmpict &&
+				NV50EXANeedsBounds(pspict, pdpict, op);
 
-	if (!PUSH_SPACE(push, 256))
+	/* Before touching the pushbuf, reading back a 1x1 pixmap may kick it.
+	 * A convolution of one is only solid if the weights add up to one.
+	 */
+	conv = pspict->filter == PictFilterConvolution;
+	ssolid = !conv && nouveau_exa_pict_solid(pspix, pspict, &solid[0]);
+	msolid = nouveau_exa_pict_solid(pmpix, pmpict, &solid[1]);
+
+	/* Glyphs are mostly a solid colour through an a8 mask, and nearly
+	 * nothing is transformed, both have cheaper programs.
+	 */
+	sca8 = ssolid && pmpict && pmpict->format == PICT_a8 &&
+	       pdpict->format != PICT_a8;
+	ident = (ssolid || !pspict->transform) &&
+		(!pmpict || msolid || !pmpict->transform);
+
+	if (!PUSH_SPACE(push, conv ? 256 + NV50_CONV_SPACE : 256))
 		NOUVEAU_FALLBACK("space\n");
 	PUSH_RESET(push);
-	PUSH_REFN (push, pNv->scratch, NOUVEAU_BO_VRAM | NOUVEAU_BO_RDWR);
 
 	BEGIN_NV04(push, SUBC_2D(NV50_GRAPH_SERIALIZE), 1);
 	PUSH_DATA (push, 0);
@@ -848,37 +950,72 @@ NV50EXAPrepareComposite(int op,
 	NV50EXABlend(pdpix, pdpict, op, pmpict && pmpict->componentAlpha &&
 		     PICT_FORMAT_RGB(pmpict->format));
 
-	if (!NV50EXAPicture(pNv, pspix, pspict, 0))
-		NOUVEAU_FALLBACK("src picture invalid\n");
+	if (sca8) {
+		if (!NV50EXAPictColour(pNv, solid[0]))
+			NOUVEAU_FALLBACK("src colour invalid\n");
+	} else {
+		if (!NV50EXAPicture(pNv, pspix, pspict, 0,
+				    ssolid ? &solid[0] : NULL))
+			NOUVEAU_FALLBACK("src picture invalid\n");
+	}
+
+	nouveau_state_mthd(pNv, NV50_3D(VP_START_ID),
+			   ident ? PVP_IDENT : PVP_XFRM);
 
 	if (pmpict) {
-		if (!NV50EXAPicture(pNv, pmpix, pmpict, 1))
+		if (!NV50EXAPicture(pNv, pmpix, pmpict, 1,
+				    msolid ? &solid[1] : NULL))
 			NOUVEAU_FALLBACK("mask picture invalid\n");
 
-		BEGIN_NV04(push, NV50_3D(FP_START_ID), 1);
+		if (sca8) {
+			fp = PFP_SC_A8;
+		} else
 		if (pdpict->format == PICT_a8) {
-			PUSH_DATA (push, PFP_C_A8);
+			fp = PFP_C_A8;
 		} else {
 			if (pmpict->componentAlpha &&
 			    PICT_FORMAT_RGB(pmpict->format)) {
 				if (NV50EXABlendOp[op].src_alpha)
-					PUSH_DATA (push, PFP_CCASA);
+					fp = PFP_CCASA;
 				else
-					PUSH_DATA (push, PFP_CCA);
+					fp = PFP_CCA;
 			} else {
-				PUSH_DATA (push, PFP_C);
+				fp = PFP_C;
 			}
 		}
+	} else
+	if (pNv->composite_bounds) {
+		if (!NV50EXAPictBounds(pNv, pspix, pspict, 1))
+			NOUVEAU_FALLBACK("src bounds invalid\n");
+
+		if (pdpict->format == PICT_a8)
+			fp = PFP_C_A8;
+		else
+			fp = PFP_C;
 	} else {
-		BEGIN_NV04(push, NV50_3D(FP_START_ID), 1);
 		if (pdpict->format == PICT_a8)
-			PUSH_DATA (push, PFP_S_A8);
+			fp = PFP_S_A8;
 		else
-			PUSH_DATA (push, PFP_S);
+			fp = PFP_S;
 	}
 
-	BEGIN_NV04(push, NV50_3D(TIC_FLUSH), 1);
-	PUSH_DATA (push, 0);
+	if (conv && !NV50EXAConv(pNv, pspix, pspict, pmpict != NULL,
+				 pdpict->format == PICT_a8, &fp))
+		NOUVEAU_FALLBACK("convolution invalid\n");
+	nouveau_state_mthd(pNv, NV50_3D(FP_START_ID), fp);
+
+	/* A reused descriptor needs no TIC flush, but the texel cache must
+	 * still be dropped in case the source pixmaps were rendered to.
+	 */
+	if (pNv->tic_dirty || pNv->tsc_dirty) {
+		BEGIN_NV04(push, NV50_3D(TIC_FLUSH), 1);
+		PUSH_DATA (push, 0);
+		pNv->tic_dirty = FALSE;
+		pNv->tsc_dirty = FALSE;
+	} else {
+		BEGIN_NV04(push, NV50_3D(TEX_CACHE_CTL), 1);
+		PUSH_DATA (push, 0x20);
+	}
 
 	BEGIN_NV04(push, NV50_3D(BIND_TIC(2)), 1);
 	PUSH_DATA (push, 1);
@@ -891,34 +1028,69 @@ NV50EXAPrepareComposite(int op,
 		NOUVEAU_FALLBACK("validate\n");
 	}
 
+	nouveau_timing_begin(pNv, NOUVEAU_TIMING_COMPOSITE);
 	return TRUE;
 }
 
+/* Rects are drawn as quads in one primitive that stays open from one
+ * Composite to the next, so a run of glyphs or boxes is a single draw.
+ * It's closed before anything else is emitted and before the pushbuf can
+ * be submitted, as libdrm starts each buffer by writing the bufctx's
+ * methods again.
+ */
+static void
+NV50EXACompositeEnd(NVPtr pNv)
+{
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+
+	if (!pNv->composite_open)
+		return;
+
+	BEGIN_NV04(push, NV50_3D(VERTEX_END_GL), 1);
+	PUSH_DATA (push, 0);
+	pNv->composite_open = FALSE;
+}
+
 void
 NV50EXAComposite(PixmapPtr pdpix, int sx, int sy, int mx, int my,
 		 int dx, int dy, int w, int h)
 {
 	NV50EXA_LOCALS(pdpix);
 
-	if (!PUSH_SPACE(push, 64))
-		return;
+	/* the bounds test samples the mask unit at source coordinates */
+	if (pNv->composite_bounds) {
+		mx = sx;
+		my = sy;
+	}
+
+	/* four vertices, and room to end the primitive after them */
+	if (PUSH_AVAIL(push) < 4 * 5 + 2)
+		NV50EXACompositeEnd(pNv);
+
+	if (!pNv->composite_open) {
+		if (!PUSH_SPACE(push, 64))
+			return;
+
+		BEGIN_NV04(push, NV50_3D(SCISSOR_HORIZ(0)), 2);
+		PUSH_DATA (push, pdpix->drawable.width << 16);
+		PUSH_DATA (push, pdpix->drawable.height << 16);
+		BEGIN_NV04(push, NV50_3D(VERTEX_BEGIN_GL), 1);
+		PUSH_DATA (push, NV50_3D_VERTEX_BEGIN_GL_PRIMITIVE_QUADS);
+		pNv->composite_open = TRUE;
+	}
 
-	BEGIN_NV04(push, NV50_3D(SCISSOR_HORIZ(0)), 2);
-	PUSH_DATA (push, (dx + w) << 16 | dx);
-	PUSH_DATA (push, (dy + h) << 16 | dy);
-	BEGIN_NV04(push, NV50_3D(VERTEX_BEGIN_GL), 1);
-	PUSH_DATA (push, NV50_3D_VERTEX_BEGIN_GL_PRIMITIVE_TRIANGLES);
-	PUSH_VTX2s(push, sx, sy + (h * 2), mx, my + (h * 2), dx, dy + (h * 2));
 	PUSH_VTX2s(push, sx, sy, mx, my, dx, dy);
-	PUSH_VTX2s(push, sx + (w * 2), sy, mx + (w * 2), my, dx + (w * 2), dy);
-	BEGIN_NV04(push, NV50_3D(VERTEX_END_GL), 1);
-	PUSH_DATA (push, 0);
+	PUSH_VTX2s(push, sx + w, sy, mx + w, my, dx + w, dy);
+	PUSH_VTX2s(push, sx + w, sy + h, mx + w, my + h, dx + w, dy + h);
+	PUSH_VTX2s(push, sx, sy + h, mx, my + h, dx, dy + h);
 }
 
 void
 NV50EXADoneComposite(PixmapPtr pdpix)
 {
 	NV50EXA_LOCALS(pdpix);
+	NV50EXACompositeEnd(pNv);
+	nouveau_timing_end(pNv);
 	nouveau_pushbuf_bufctx(push, NULL);
 }
 
@@ -975,7 +1147,7 @@ NV50EXARectM2MF(NVPtr pNv, int w, int h, int cpp,
 		if (line_count > 2047)
 			line_count = 2047;
 
-		if (nouveau_pushbuf_space(push, 32, 0, 0) ||
+		if (nouveau_push_space(push, 32, 0, 0) ||
 		    nouveau_pushbuf_refn (push, refs, 2))
 			return FALSE;
 
@@ -0,0 +1,372 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Fragment programs generated at composite time on NV50, for sources with
+ * a convolution filter.
+ *
+ * The program fetches the source once per kernel tap, nearest-filtered at
+ * the tap's offset from the fragment's source position, and sums the
+ * texels times the tap weights in fp32.  The offsets and weights are in
+ * the PFP_DATA constant buffer: c0[0] on are the kw x offsets, then the kh
+ * y offsets, then the weights a row at a time, so any kernel up to
+ * CONV_CONSTS constants in all fits.  Negative weights are fine, the
+ * render target clamps the sum.  The offsets are those pixman uses, in
+ * normalised coordinates, minus a bit so that a nearest fetch of a tap
+ * landing on a texel edge gets the same texel as pixman's rounding down.
+ *
+ * The program itself depends only on the kernel's size, which taps are
+ * zero, whether there's a mask and whether the render target is A8.  What
+ * was last uploaded to each of the two PFP_GEN() slots is remembered, as
+ * for NV30 in nv30_fp.c, so a run of composites with the same shape of
+ * kernel only uploads the constants.
+ */
+
+#include "nv_include.h"
+
+#include "nv50_accel.h"
+
+/* 256 bytes of PFP_DATA are bound as c0[] */
+#define CONV_CONSTS 64
+
+/* A tap lands this far, in texels, before where pixman puts it */
+#define CONV_NUDGE (1.0 / 256)
+
+/* Registers: the sum, the texel (and mask), the fragment's source
+ * position and the 1/w for interpolation.
+ */
+#define R_SUM  0
+#define R_TEX  4
+#define R_POS  8
+#define R_W    10
+#define R_TEMPS 11
+
+struct nv50_fp {
+	uint32_t insn[512];
+	int size;
+	int last;
+};
+
+struct nv50_fp_cache {
+	/* the program in each PFP_GEN() slot */
+	uint32_t gen[2][512];
+	int gen_size[2];
+	int gen_last;
+};
+
+static struct nv50_fp_cache *
+NV50EXAFragProgCache(NVPtr pNv)
+{
+	if (!pNv->nv50_fp_cache)
+		pNv->nv50_fp_cache = calloc(1, sizeof(*pNv->nv50_fp_cache));
+	return pNv->nv50_fp_cache;
+}
+
+/* Forget what the scratch buffer holds, when it's (re)initialised or
+ * going away.
+ */
+void
+NV50EXAFragProgReset(NVPtr pNv)
+{
+	free(pNv->nv50_fp_cache);
+	pNv->nv50_fp_cache = NULL;
+}
+
+/* Instructions, in the encodings of the hand-assembled programs in
+ * nv50_accel.c.  Only the long (two word) forms can end a program.
+ */
+static void
+NV50EXAFragProgShort(struct nv50_fp *fp, uint32_t insn)
+{
+	fp->last = fp->size;
+	fp->insn[fp->size++] = insn;
+}
+
+static void
+NV50EXAFragProgLong(struct nv50_fp *fp, uint32_t insn0, uint32_t insn1)
+{
+	fp->last = fp->size;
+	fp->insn[fp->size++] = insn0 | 0x00000001;
+	fp->insn[fp->size++] = insn1;
+}
+
+/* interp $rd v[a] $rw */
+static void
+NV50EXAFragProgInterp(struct nv50_fp *fp, int d, int a)
+{
+	NV50EXAFragProgShort(fp, 0x82000000 | (a / 4) << 16 | R_W << 9 |
+				 d << 2);
+}
+
+/* texauto, fetching the components in 'mask' of $td at $rd:$rd+1 into
+ * $rd on up
+ */
+static void
+NV50EXAFragProgTex(struct nv50_fp *fp, int t, int d, int mask)
+{
+	NV50EXAFragProgLong(fp, 0xf0400000 | (mask & 1) << 25 |
+				(mask & 2) << 25 | t << 9 | d << 2,
+			    0x00000784 | (mask & 4) << 12 | (mask & 8) << 12);
+}
+
+/* add $rd $rs c0[i] */
+static void
+NV50EXAFragProgAddC(struct nv50_fp *fp, int d, int s, int i)
+{
+	NV50EXAFragProgShort(fp, 0xb0800000 | i << 16 | s << 9 | d << 2);
+}
+
+/* mul $rd $rs c0[i], or add $rd (mul $rs c0[i]) $rd if 'acc' */
+static void
+NV50EXAFragProgMulC(struct nv50_fp *fp, int d, int s, int i, Bool acc,
+		    Bool end)
+{
+	uint32_t op = acc ? 0xe0800000 : 0xc0800000;
+
+	if (end) {
+		NV50EXAFragProgLong(fp, op | i << 16 | s << 9 | d << 2,
+				    0x00000780 | (acc ? d << 14 : 0));
+	} else {
+		NV50EXAFragProgShort(fp, op | i << 16 | s << 9 | d << 2);
+	}
+}
+
+/* mul $rd $rs $rb */
+static void
+NV50EXAFragProgMul(struct nv50_fp *fp, int d, int s, int b, Bool end)
+{
+	uint32_t insn = 0xc0000000 | b << 16 | s << 9 | d << 2;
+
+	if (end)
+		NV50EXAFragProgLong(fp, insn, 0x00000780);
+	else
+		NV50EXAFragProgShort(fp, insn);
+}
+
+/* mov b32 $rd $rs */
+static void
+NV50EXAFragProgMov(struct nv50_fp *fp, int d, int s, Bool end)
+{
+	if (end)
+		NV50EXAFragProgLong(fp, 0x10000000 | s << 9 | d << 2,
+				    0x0403c780);
+	else
+		NV50EXAFragProgShort(fp, 0x10008000 | s << 9 | d << 2);
+}
+
+/* Put a generated program in one of the two PFP_GEN() slots and return
+ * its FP_START_ID.  As on NV30, a slot is only rewritten if neither holds
+ * the program already, and never the one the previous composite used.
+ */
+static Bool
+NV50EXAFragProgUpload(NVPtr pNv, struct nv50_fp *fp, uint32_t *start)
+{
+	struct nv50_fp_cache *cache = NV50EXAFragProgCache(pNv);
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	int i;
+
+	fp->insn[fp->last + 1] |= 0x00000001; /* exit */
+
+	if (!cache)
+		return FALSE;
+
+	for (i = 0; i < 2; i++) {
+		if (cache->gen_size[i] == fp->size &&
+		    !memcmp(cache->gen[i], fp->insn, fp->size * 4))
+			goto done;
+	}
+
+	i = cache->gen_last ^ 1;
+	PUSH_DATAu(push, pNv->scratch, PFP_GEN(i), fp->size);
+	PUSH_DATAp(push, fp->insn, fp->size);
+	BEGIN_NV04(push, NV50_3D(CODE_CB_FLUSH), 1);
+	PUSH_DATA (push, 0);
+
+	memcpy(cache->gen[i], fp->insn, fp->size * 4);
+	cache->gen_size[i] = fp->size;
+done:
+	cache->gen_last = i;
+	*start = PFP_GEN(i) - PFP_OFFSET;
+	return TRUE;
+}
+
+static int
+NV50EXAConvSize(PicturePtr ppict, int *kw, int *kh)
+{
+	xFixed *params = ppict->filter_params;
+
+	if (ppict->filter_nparams < 2)
+		return 0;
+
+	*kw = xFixedToInt(params[0]);
+	*kh = xFixedToInt(params[1]);
+	if (*kw < 1 || *kh < 1 || *kw + *kh + *kw * *kh > CONV_CONSTS ||
+	    ppict->filter_nparams < 2 + *kw * *kh)
+		return 0;
+
+	return *kw * *kh;
+}
+
+/* Whether the convolution of source picture 'ppict' fits a program */
+Bool
+NV50EXACheckConv(PicturePtr ppict)
+{
+	int kw, kh;
+
+	if (!ppict->pDrawable)
+		NOUVEAU_FALLBACK("convolution of a source picture\n");
+
+	if (!NV50EXAConvSize(ppict, &kw, &kh))
+		NOUVEAU_FALLBACK("convolution kernel too large\n");
+
+	/* the border colour, outside an XRGB texture, has no alpha */
+	if (!ppict->repeat && !PICT_FORMAT_A(ppict->format))
+		NOUVEAU_FALLBACK("convolution of XRGB without repeat\n");
+
+	return TRUE;
+}
+
+/* Whether the convolution of source picture 'ppict' can go under a mask.
+ * pixman clamps the sum before multiplying by the mask, which the program
+ * doesn't, so the positive weights mustn't add up to more than one.
+ */
+Bool
+NV50EXACheckConvMask(PicturePtr ppict)
+{
+	xFixed *params = ppict->filter_params;
+	int64_t sum = 0;
+	int kw, kh, n, t;
+
+	n = NV50EXAConvSize(ppict, &kw, &kh);
+	for (t = 0; t < n; t++)
+		sum += max(params[2 + t], 0);
+
+	/* allowing for the weights having been rounded */
+	if (sum > xFixed1 + xFixed1 / 256)
+		NOUVEAU_FALLBACK("convolution can overshoot under a mask\n");
+
+	return TRUE;
+}
+
+/* Set up the convolution of source picture 'ppict' on texture unit 0,
+ * times the alpha of the mask on unit 1 if there's a mask, and return
+ * the program's FP_START_ID in *start.  The pushbuf needs room for up to
+ * NV50_CONV_SPACE words.
+ */
+Bool
+NV50EXAConv(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, Bool mask, Bool a8,
+	    uint32_t *start)
+{
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	xFixed *params = ppict->filter_params;
+	struct nv50_fp fp = { .size = 0 };
+	float xoff, yoff;
+	int kw, kh, n, i, j, t, first, last;
+
+	n = NV50EXAConvSize(ppict, &kw, &kh);
+	if (!n)
+		return FALSE;
+
+	/* c0[]: x offsets, y offsets, then the weights */
+	xoff = xFixedToFloat((params[0] - xFixed1) >> 1) + CONV_NUDGE;
+	yoff = xFixedToFloat((params[1] - xFixed1) >> 1) + CONV_NUDGE;
+	PUSH_DATAu(push, pNv->scratch, PFP_DATA, kw + kh + n);
+	for (i = 0; i < kw; i++)
+		PUSH_DATAf(push, (i - xoff) / ppix->drawable.width);
+	for (j = 0; j < kh; j++)
+		PUSH_DATAf(push, (j - yoff) / ppix->drawable.height);
+	for (t = 0; t < n; t++)
+		PUSH_DATAf(push, xFixedToFloat(params[2 + t]));
+
+	/* taps with no weight are skipped, unless they all are */
+	for (first = 0; first < n && !params[2 + first]; first++)
+		;
+	for (last = n - 1; last > first && !params[2 + last]; last--)
+		;
+	if (first == n)
+		first = last = 0;
+
+	/* interp $r10 v[0x0]
+	 * rcp f32 $r10 $r10
+	 * interp $r8 v[0x4] $r10
+	 * interp $r9 v[0x8] $r10
+	 */
+	NV50EXAFragProgShort(&fp, 0x80000000 | R_W << 2);
+	NV50EXAFragProgShort(&fp, 0x90000000 | R_W << 9 | R_W << 2);
+	NV50EXAFragProgInterp(&fp, R_POS + 0, 0x4);
+	NV50EXAFragProgInterp(&fp, R_POS + 1, 0x8);
+
+	/* for each tap:
+	 *
+	 * add f32 $r4 $r8 c0[x]
+	 * add f32 $r5 $r9 c0[y]
+	 * texauto $r4:$r5:$r6:$r7 $t0 $s0 $r4:$r5
+	 * add f32 $r0 (mul $r4 c0[w]) $r0
+	 * ...
+	 * add f32 $r3 (mul $r7 c0[w]) $r3
+	 *
+	 * with muls for the first.
+	 */
+	for (t = first; t <= last; t++) {
+		Bool end = !mask && !a8 && t == last;
+
+		if (t != first && !params[2 + t])
+			continue;
+
+		NV50EXAFragProgAddC(&fp, R_TEX + 0, R_POS + 0, t % kw);
+		NV50EXAFragProgAddC(&fp, R_TEX + 1, R_POS + 1, kw + t / kw);
+		NV50EXAFragProgTex(&fp, 0, R_TEX, 0xf);
+		for (i = 0; i < 4; i++) {
+			NV50EXAFragProgMulC(&fp, R_SUM + i, R_TEX + i,
+					    kw + kh + t, t != first,
+					    end && i == 3);
+		}
+	}
+
+	/* the sum times the mask's alpha:
+	 *
+	 * interp $r4 v[0xc] $r10
+	 * interp $r5 v[0x10] $r10
+	 * texauto #:#:#:$r4 $t1 $s0 $r4:$r5
+	 * mul f32 $r0 $r0 $r4
+	 * ...
+	 */
+	if (mask) {
+		NV50EXAFragProgInterp(&fp, R_TEX + 0, 0xc);
+		NV50EXAFragProgInterp(&fp, R_TEX + 1, 0x10);
+		NV50EXAFragProgTex(&fp, 1, R_TEX, 0x8);
+		for (i = a8 ? 3 : 0; i < 4; i++)
+			NV50EXAFragProgMul(&fp, R_SUM + i, R_SUM + i, R_TEX,
+					   !a8 && i == 3);
+	}
+
+	/* an A8 target takes the alpha from every component, as PFP_S_A8 */
+	if (a8) {
+		for (i = 0; i < 3; i++)
+			NV50EXAFragProgMov(&fp, R_SUM + i, R_SUM + 3, i == 2);
+	}
+
+	if (!NV50EXAFragProgUpload(pNv, &fp, start))
+		return FALSE;
+
+	nouveau_state_mthd(pNv, NV50_3D(FP_REG_ALLOC_TEMP), R_TEMPS);
+	return TRUE;
+}
@@ -34,6 +34,7 @@
 #include "nv_include.h"
 #include "nv_dma.h"
 #include "nv50_accel.h"
+#include "nouveau_copy.h"
 
 extern Atom xvSyncToVBlank, xvSetDefaults;
 extern Atom xvBrightness, xvContrast, xvHue, xvSaturation;
@@ -78,6 +79,7 @@ nv50_xv_image_put(ScrnInfoPtr pScrn,
 		{ dst, NOUVEAU_BO_VRAM | NOUVEAU_BO_WR },
 	};
 	uint32_t mode = 0xd0005000 | (src->config.nv50.tile_mode << 18);
+	uint32_t rt[5];
 	float X1, X2, Y1, Y2;
 	BoxPtr pbox;
 	int nbox;
@@ -85,29 +87,30 @@ nv50_xv_image_put(ScrnInfoPtr pScrn,
 	if (!nv50_xv_check_image_put(ppix))
 		return BadMatch;
 
+	nouveau_copy_sync(pNv, src);
+	nouveau_copy_sync(pNv, dst);
+
 	if (!PUSH_SPACE(push, 256))
 		return BadImplementation;
 
-	BEGIN_NV04(push, NV50_3D(RT_ADDRESS_HIGH(0)), 5);
-	PUSH_DATA (push, dst->offset >> 32);
-	PUSH_DATA (push, dst->offset);
+	rt[0] = dst->offset >> 32;
+	rt[1] = dst->offset;
 	switch (ppix->drawable.depth) {
-	case 32: PUSH_DATA (push, NV50_SURFACE_FORMAT_BGRA8_UNORM); break;
-	case 30: PUSH_DATA (push, NV50_SURFACE_FORMAT_RGB10_A2_UNORM); break;
-	case 24: PUSH_DATA (push, NV50_SURFACE_FORMAT_BGRX8_UNORM); break;
-	case 16: PUSH_DATA (push, NV50_SURFACE_FORMAT_B5G6R5_UNORM); break;
-	case 15: PUSH_DATA (push, NV50_SURFACE_FORMAT_BGR5_X1_UNORM); break;
+	case 32: rt[2] = NV50_SURFACE_FORMAT_BGRA8_UNORM; break;
+	case 30: rt[2] = NV50_SURFACE_FORMAT_RGB10_A2_UNORM; break;
+	case 24: rt[2] = NV50_SURFACE_FORMAT_BGRX8_UNORM; break;
+	case 16: rt[2] = NV50_SURFACE_FORMAT_B5G6R5_UNORM; break;
+	case 15: rt[2] = NV50_SURFACE_FORMAT_BGR5_X1_UNORM; break;
 	}
-	PUSH_DATA (push, dst->config.nv50.tile_mode);
-	PUSH_DATA (push, 0);
-	BEGIN_NV04(push, NV50_3D(RT_HORIZ(0)), 2);
-	PUSH_DATA (push, ppix->drawable.width);
-	PUSH_DATA (push, ppix->drawable.height);
-	BEGIN_NV04(push, NV50_3D(RT_ARRAY_MODE), 1);
-	PUSH_DATA (push, 1);
+	rt[3] = dst->config.nv50.tile_mode;
+	rt[4] = 0;
+	nouveau_state_data(pNv, NV50_3D(RT_ADDRESS_HIGH(0)), 5, rt);
+	rt[0] = ppix->drawable.width;
+	rt[1] = ppix->drawable.height;
+	nouveau_state_data(pNv, NV50_3D(RT_HORIZ(0)), 2, rt);
+	nouveau_state_mthd(pNv, NV50_3D(RT_ARRAY_MODE), 1);
 
-	BEGIN_NV04(push, NV50_3D(BLEND_ENABLE(0)), 1);
-	PUSH_DATA (push, 0);
+	nouveau_state_mthd(pNv, NV50_3D(BLEND_ENABLE(0)), 0);
 
 	PUSH_DATAu(push, pNv->scratch, TIC_OFFSET, 16);
 	if (id == FOURCC_YV12 || id == FOURCC_I420) {
@@ -204,11 +207,11 @@ nv50_xv_image_put(ScrnInfoPtr pScrn,
 	PUSH_DATA (push, 0x00000000);
 	PUSH_DATA (push, 0x00000000);
 
-	BEGIN_NV04(push, NV50_3D(FP_START_ID), 1);
-	PUSH_DATA (push, PFP_NV12);
+	nouveau_state_mthd(pNv, NV50_3D(FP_START_ID), PFP_NV12);
 
 	BEGIN_NV04(push, NV50_3D(TIC_FLUSH), 1);
 	PUSH_DATA (push, 0);
+	nouveau_tex_cache_invalidate(pNv);
 
 	BEGIN_NV04(push, NV50_3D(BIND_TIC(2)), 1);
 	PUSH_DATA (push, 1);
@@ -237,6 +240,7 @@ nv50_xv_image_put(ScrnInfoPtr pScrn,
 	X2 = (float)(x2>>16)+(float)(x2&0xFFFF)/(float)0x10000;
 	Y2 = (float)(y2>>16)+(float)(y2&0xFFFF)/(float)0x10000;
 
+	nouveau_timing_begin(pNv, NOUVEAU_TIMING_XV);
 	pbox = REGION_RECTS(clipBoxes);
 	nbox = REGION_NUM_RECTS(clipBoxes);
 	while(nbox--) {
@@ -249,9 +253,11 @@ nv50_xv_image_put(ScrnInfoPtr pScrn,
 		int sy1=pbox->y1;
 		int sy2=pbox->y2;
 
-		if (nouveau_pushbuf_space(push, 64, 0, 0) ||
-		    nouveau_pushbuf_refn (push, refs, 3))
+		if (nouveau_push_space(push, 64, 0, 0) ||
+		    nouveau_pushbuf_refn (push, refs, 3)) {
+			nouveau_timing_end(pNv);
 			return BadImplementation;
+		}
 
 		/* NV50_3D_SCISSOR_VERT_T_SHIFT is wrong, because it was deducted with
 		* origin lying at the bottom left. This will be changed to _MIN_ and _MAX_
@@ -271,6 +277,7 @@ nv50_xv_image_put(ScrnInfoPtr pScrn,
 		pbox++;
 	}
 
+	nouveau_timing_end(pNv);
 	PUSH_KICK(push);
 	return Success;
 }
@@ -332,7 +339,7 @@ nv50_xv_csc_update(ScrnInfoPtr pScrn, NVPortPrivPtr pPriv)
 		return;
 	}
 
-	if (nouveau_pushbuf_space(push, 64, 0, 0) ||
+	if (nouveau_push_space(push, 64, 0, 0) ||
 	    nouveau_pushbuf_refn (push, &(struct nouveau_pushbuf_refn) {
 					pNv->scratch, NOUVEAU_BO_WR |
 					NOUVEAU_BO_VRAM }, 1))
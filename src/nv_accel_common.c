@@ -592,6 +592,7 @@ void
 NVAccelCommonFini(ScrnInfoPtr pScrn)
 {
 	NVPtr pNv = NVPTR(pScrn);
+	int i;
 
 	nouveau_object_del(&pNv->notify0);
 	nouveau_object_del(&pNv->vblank_sem);
@@ -612,10 +613,18 @@ NVAccelCommonFini(ScrnInfoPtr pScrn)
 	nouveau_object_del(&pNv->Nv3D);
 	nouveau_object_del(&pNv->NvCOPY);
 
+	NV30EXAFragProgReset(pNv);
+	NV50EXAFragProgReset(pNv);
+	while (pNv->resident_nr)
+		nouveau_push_evict(pNv, pNv->resident[0]);
 	nouveau_bo_ref(NULL, &pNv->scratch);
+	nouveau_bo_ref(NULL, &pNv->vtxbuf);
+	for (i = 0; i < NOUVEAU_XFER_DEPTH; i++)
+		nouveau_bo_ref(NULL, &pNv->xfer_tmp[i]);
+	nouveau_bo_ref(NULL, &pNv->xfer_bo);
 
+	nouveau_push_del(pNv, NOUVEAU_PUSH_MAIN);
 	nouveau_bufctx_del(&pNv->bufctx);
-	nouveau_pushbuf_del(&pNv->pushbuf);
 	nouveau_object_del(&pNv->channel);
 }
 
@@ -652,23 +661,20 @@ NVAccelCommonInit(ScrnInfoPtr pScrn)
 		return FALSE;
 	}
 
-	ret = nouveau_pushbuf_new(pNv->client, pNv->channel, 4, 32 * 1024,
-				  true, &pNv->pushbuf);
+	ret = nouveau_bufctx_new(pNv->client, NOUVEAU_BINS, &pNv->bufctx);
 	if (ret) {
-		xf86DrvMsg(pScrn->scrnIndex, X_ERROR,
-			   "Error allocating DMA push buffer: %d\n",ret);
 		NVAccelCommonFini(pScrn);
 		return FALSE;
 	}
 
-	ret = nouveau_bufctx_new(pNv->client, 1, &pNv->bufctx);
+	ret = nouveau_push_new(pNv, NOUVEAU_PUSH_MAIN, pNv->channel);
 	if (ret) {
+		xf86DrvMsg(pScrn->scrnIndex, X_ERROR,
+			   "Error allocating DMA push buffer: %d\n",ret);
 		NVAccelCommonFini(pScrn);
 		return FALSE;
 	}
 
-	pNv->pushbuf->user_priv = pNv->bufctx;
-
 	/* Scratch buffer */
 	ret = nouveau_bo_new(pNv->dev, NOUVEAU_BO_VRAM | NOUVEAU_BO_MAP,
 			     128 * 1024, 128 * 1024, NULL, &pNv->scratch);
@@ -679,6 +685,12 @@ NVAccelCommonInit(ScrnInfoPtr pScrn)
 			   "Failed to allocate scratch buffer: %d\n", ret);
 		return FALSE;
 	}
+	nouveau_push_resident(pNv, pNv->scratch,
+			      NOUVEAU_BO_VRAM | NOUVEAU_BO_RDWR);
+	if (pNv->scanout) {
+		nouveau_push_resident(pNv, pNv->scanout,
+				      NOUVEAU_BO_VRAM | NOUVEAU_BO_RDWR);
+	}
 
 	/* General engine objects */
 	if (pNv->Architecture < NV_FERMI) {
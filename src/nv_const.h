@@ -19,6 +19,12 @@ typedef enum {
     OPTION_ASYNC_COPY,
     OPTION_ACCELMETHOD,
     OPTION_DRI,
+    OPTION_PUSHBUF_CAPTURE,
+    OPTION_STATE_FILTER,
+    OPTION_GPU_TIMING,
+    OPTION_FALLBACK_DEBUG,
+    OPTION_PUSHBUF_ADAPTIVE,
+    OPTION_ACCEL_TRACE,
 } NVOpts;
 
 
@@ -36,6 +42,12 @@ static const OptionInfoRec NVOptions[] = {
     { OPTION_ASYNC_COPY,	"AsyncUTSDFS",	OPTV_BOOLEAN,	{0}, FALSE },
     { OPTION_ACCELMETHOD,	"AccelMethod",	OPTV_STRING,	{0}, FALSE },
     { OPTION_DRI,		"DRI",		OPTV_INTEGER,	{0}, FALSE },
+    { OPTION_PUSHBUF_CAPTURE,	"PushbufCapture", OPTV_STRING,	{0}, FALSE },
+    { OPTION_STATE_FILTER,	"StateFilter",	OPTV_BOOLEAN,	{0}, FALSE },
+    { OPTION_GPU_TIMING,	"GPUTiming",	OPTV_BOOLEAN,	{0}, FALSE },
+    { OPTION_FALLBACK_DEBUG,	"FallbackDebug", OPTV_BOOLEAN,	{0}, FALSE },
+    { OPTION_PUSHBUF_ADAPTIVE,	"PushbufAdaptive", OPTV_BOOLEAN, {0}, FALSE },
+    { OPTION_ACCEL_TRACE,	"AccelTrace",	OPTV_STRING,	{0}, FALSE },
     { -1,                       NULL,           OPTV_NONE,      {0}, FALSE }
 };
 
@@ -33,9 +33,11 @@
 #include "dri2.h"
 #endif
 
+#include "nouveau_capture.h"
 #include "nouveau_copy.h"
 #include "nouveau_present.h"
 #include "nouveau_sync.h"
+#include "nouveau_trace.h"
 
 #if !HAVE_XORG_LIST
 #define xorg_list_is_empty              list_is_empty
@@ -607,6 +609,10 @@ NVBlockHandler (BLOCKHANDLER_ARGS_DECL)
 #endif
 
 	NVFlushCallback(NULL, pScrn, NULL);
+	nouveau_timing_update(pScreen);
+	nouveau_fallback_update(pScreen);
+	nouveau_push_update(pScreen);
+	nouveau_trace_update(pScreen);
 
 	if (pNv->VideoTimerCallback) 
 		(*pNv->VideoTimerCallback)(pScrn, currentTime.milliseconds);
@@ -655,6 +661,12 @@ NVCloseScreen(CLOSE_SCREEN_ARGS_DECL)
 	nouveau_present_fini(pScreen);
 	nouveau_dri2_fini(pScreen);
 	nouveau_sync_fini(pScreen);
+	nouveau_trace_fini(pScreen);
+	nouveau_capture_fini(pScreen);
+	nouveau_push_fini(pScreen);
+	nouveau_timing_fini(pScreen);
+	nouveau_fallback_fini(pScreen);
+	nouveau_state_fini(pScreen);
 	nouveau_copy_fini(pScreen);
 
 	if (pScrn->vtSema) {
@@ -691,6 +703,7 @@ NVCloseScreen(CLOSE_SCREEN_ARGS_DECL)
 		pNv->textureAdaptor[1] = NULL;
 	}
 	if (pNv->EXADriverPtr) {
+		nouveau_render_fini(pScreen);
 		exaDriverFini(pScreen);
 		free(pNv->EXADriverPtr);
 		pNv->EXADriverPtr = NULL;
@@ -1085,8 +1098,11 @@ NVPreInit(ScrnInfoPtr pScrn, int flags)
 		pNv->tiled_scanout = TRUE;
 	}
 
+	/* nouveau_copy_init() turns it back off by default where transfers
+	 * can't be fenced against the main channel
+	 */
 	pNv->ce_enabled =
-		xf86ReturnOptValBool(pNv->Options, OPTION_ASYNC_COPY, FALSE);
+		xf86ReturnOptValBool(pNv->Options, OPTION_ASYNC_COPY, TRUE);
 
 	/* Define maximum allowed level of DRI implementation to use.
 	 * We default to DRI2 on EXA for now, as DRI3 still has some
@@ -1378,6 +1394,11 @@ NVScreenInit(SCREEN_INIT_ARGS_DECL)
 	}
 
 	nouveau_copy_init(pScreen);
+	nouveau_state_init(pScreen);
+	nouveau_timing_init(pScreen);
+	nouveau_fallback_init(pScreen);
+	nouveau_push_init(pScreen);
+	nouveau_capture_init(pScreen);
 
 	/* Allocate and map memory areas we need */
 	if (!NVMapMem(pScrn))
@@ -1501,6 +1522,8 @@ NVScreenInit(SCREEN_INIT_ARGS_DECL)
 
 		if (!nouveau_exa_init(pScreen))
 			return FALSE;
+
+		nouveau_render_init(pScreen);
 	}
 
 	xf86SetBackingStore(pScreen);
@@ -52,11 +52,63 @@ xf86CrtcPtr nouveau_pick_best_crtc(ScrnInfoPtr pScrn, Bool consider_disabled,
 Bool nouveau_exa_init(ScreenPtr pScreen);
 Bool nouveau_exa_pixmap_is_onscreen(PixmapPtr pPixmap);
 bool nv50_style_tiled_pixmap(PixmapPtr ppix);
+Bool nouveau_exa_pict_solid(PixmapPtr ppix, PicturePtr ppict, uint32_t *argb);
+Bool nouveau_exa_pict_splittable(PicturePtr ppict, int limit);
+Bool nouveau_exa_pict_window(PixmapPtr ppix, PicturePtr ppict, int limit,
+			     int x, int y, int w, int h,
+			     struct nouveau_exa_window *win);
+void nouveau_exa_pict_matrix(PicturePtr ppict,
+			     const struct nouveau_exa_window *win,
+			     float m[16]);
+int nouveau_exa_composite_limit(PicturePtr pspict, PicturePtr pmpict,
+				int limit);
+void nouveau_exa_composite_split(PixmapPtr pdpix, int sx, int sy,
+				 int mx, int my, int dx, int dy, int w, int h,
+				 nouveau_exa_split_rect rect);
 Bool NVAccelM2MF(NVPtr pNv, int w, int h, int cpp, uint32_t srco, uint32_t dsto,
 		 struct nouveau_bo *s, int sd, int sp, int sh, int sx, int sy,
 		 struct nouveau_bo *d, int dd, int dp, int dh, int dx, int dy);
 
 
+/* in nouveau_state.c */
+Bool nouveau_state_init(ScreenPtr pScreen);
+void nouveau_state_fini(ScreenPtr pScreen);
+void nouveau_state_data(NVPtr pNv, int subc, int mthd, int size,
+			const uint32_t *data);
+void nouveau_state_mthd(NVPtr pNv, int subc, int mthd, uint32_t data);
+void nouveau_state_reset(NVPtr pNv);
+
+/* in nouveau_push.c */
+void nouveau_push_init(ScreenPtr pScreen);
+void nouveau_push_fini(ScreenPtr pScreen);
+void nouveau_push_update(ScreenPtr pScreen);
+void nouveau_push_count(NVPtr pNv, uint64_t *words, unsigned *kicks);
+int nouveau_push_new(NVPtr pNv, int which, struct nouveau_object *channel);
+void nouveau_push_del(NVPtr pNv, int which);
+void nouveau_push_begin(NVPtr pNv, int op);
+void nouveau_push_end(NVPtr pNv);
+Bool nouveau_push_resident(NVPtr pNv, struct nouveau_bo *bo, uint32_t access);
+void nouveau_push_evict(NVPtr pNv, struct nouveau_bo *bo);
+void nouveau_push_replace(NVPtr pNv, struct nouveau_bo *old,
+			  struct nouveau_bo *bo);
+void nouveau_push_refn(NVPtr pNv, struct nouveau_bo *bo, uint32_t access);
+
+/* in nouveau_fallback.c */
+void nouveau_fallback_init(ScreenPtr pScreen);
+void nouveau_fallback_fini(ScreenPtr pScreen);
+void nouveau_fallback_update(ScreenPtr pScreen);
+
+/* in nouveau_timing.c */
+Bool nouveau_timing_init(ScreenPtr pScreen);
+void nouveau_timing_fini(ScreenPtr pScreen);
+void nouveau_timing_update(ScreenPtr pScreen);
+void nouveau_timing_begin(NVPtr pNv, int op);
+void nouveau_timing_end(NVPtr pNv);
+
+/* in nouveau_render.c */
+Bool nouveau_render_init(ScreenPtr pScreen);
+void nouveau_render_fini(ScreenPtr pScreen);
+
 /* in nouveau_wfb.c */
 void nouveau_wfb_setup_wrap(ReadMemoryProcPtr *, WriteMemoryProcPtr *,
 			    DrawablePtr);
@@ -119,6 +171,27 @@ Bool NV30EXAPrepareComposite(int, PicturePtr, PicturePtr, PicturePtr,
 void NV30EXAComposite(PixmapPtr, int, int, int, int, int, int, int, int);
 void NV30EXADoneComposite(PixmapPtr);
 
+/* in nv30_fp.c */
+struct nv30_fp;
+void NV30EXAFragProgInsn(struct nv30_fp *, int op, uint32_t dst,
+			 uint32_t src0, uint32_t src1, uint32_t src2);
+void NV30EXAFragProgImm(struct nv30_fp *, float, float, float, float);
+Bool NV30EXAFragProgUpload(NVPtr pNv, struct nv30_fp *, uint32_t *offset);
+void NV30EXAFragProgReset(NVPtr pNv);
+Bool NV30EXAIsGradient(PicturePtr pPict);
+Bool NV30EXACheckGradient(PicturePtr pPict);
+Bool NV30EXAGradientRamp(NVPtr pNv, PicturePtr pPict, int unit);
+void NV30EXAGradient(struct nv30_fp *, PicturePtr pPict, int unit,
+		     uint32_t dst, Bool normalized);
+
+/* in nv30_vtxbuf.c */
+Bool NV30EXAVtxBufInit(NVPtr pNv);
+void NV30EXAVtxBufPrepare(NVPtr pNv);
+Bool NV30EXAVtxBufFlush(NVPtr pNv);
+void NV30EXAVtxBufQuad(NVPtr pNv, int sx, int sy, int mx, int my,
+		       int dx, int dy, int w, int h);
+void NV30EXAVtxBufDone(NVPtr pNv);
+
 /* in nv30_video_texture.c */
 int NV30PutTextureImage(ScrnInfoPtr, struct nouveau_bo *, int, int, int, int,
 			BoxPtr, int, int, int, int, uint16_t, uint16_t,
@@ -177,6 +250,13 @@ Bool NV50EXARectM2MF(NVPtr pNv, int, int, int,
 		     struct nouveau_bo *, uint32_t, int, int, int, int, int,
 		     struct nouveau_bo *, uint32_t, int, int, int, int, int);
 
+/* in nv50_fp.c */
+void NV50EXAFragProgReset(NVPtr pNv);
+Bool NV50EXACheckConv(PicturePtr pPict);
+Bool NV50EXACheckConvMask(PicturePtr pPict);
+Bool NV50EXAConv(NVPtr pNv, PixmapPtr, PicturePtr, Bool mask, Bool a8,
+		 uint32_t *start);
+
 /* in nvc0_exa.c */
 Bool NVC0AccelUploadM2MF(PixmapPtr pdpix, int x, int y, int w, int h,
 			 const char *src, int src_pitch);
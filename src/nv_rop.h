@@ -300,20 +300,20 @@ static struct {
 	int pattern;
 	int pattern_planemask;
 } NVROP[] = {
-	{ ROP_0,    ROP_0,       ROP_0,    ROP_DPna    }, /* GXclear        */
-	{ ROP_DSa,  ROP_DSPnoa,  ROP_DPa,  ROP_DPSnoa  }, /* GXand          */
-	{ ROP_SDna, ROP_DPSnaon, ROP_PDna, ROP_DSPnaon }, /* GXandReverse   */
-	{ ROP_S,    ROP_DPSDxax, ROP_P,    ROP_DSPDxax }, /* GXcopy         */
-	{ ROP_DSna, ROP_DPSana,  ROP_DPna, ROP_DPSana  }, /* GXandInverted  */
-	{ ROP_D,    ROP_D,       ROP_D,    ROP_D       }, /* GXnoop         */
-	{ ROP_DSx,  ROP_DPSax,   ROP_DPx,  ROP_DPSax   }, /* GXxor          */
-	{ ROP_DSo,  ROP_DPSao,   ROP_DPo,  ROP_DPSao   }, /* GXor           */
-	{ ROP_DSon, ROP_DPSaon,  ROP_DPon, ROP_DPSaon  }, /* GXnor          */
-	{ ROP_DSxn, ROP_DPSaxn,  ROP_PDxn, ROP_DPSaxn  }, /* GXequiv        */
-	{ ROP_Dn,   ROP_Dn,      ROP_Dn,   ROP_DPx     }, /* GXinvert       */
-	{ ROP_SDno, ROP_DPSanan, ROP_PDno, ROP_DPSanan }, /* GXorReverse    */
-	{ ROP_Sn,   ROP_PSDPxox, ROP_Pn,   ROP_SPDSxox }, /* GXcopyInverted */
-	{ ROP_DSno, ROP_DPSnao,  ROP_DPno, ROP_DSPnao  }, /* GXorInverted   */
-	{ ROP_DSan, ROP_DSPnoan, ROP_DPan, ROP_DPSnoan }, /* GXnand         */
-	{ ROP_1,    ROP_1,       ROP_1,    ROP_DPo     }  /* GXset          */
+	{ ROP_0,    ROP_DPna,     ROP_0,    ROP_DPna    }, /* GXclear        */
+	{ ROP_DSa,  ROP_DSPnoa,   ROP_DPa,  ROP_DPSnoa  }, /* GXand          */
+	{ ROP_SDna, ROP_DPSDoax,  ROP_PDna, ROP_DSPnaon }, /* GXandReverse   */
+	{ ROP_S,    ROP_DPSDxax,  ROP_P,    ROP_DSPDxax }, /* GXcopy         */
+	{ ROP_DSna, ROP_DPSana,   ROP_DPna, ROP_DPSana  }, /* GXandInverted  */
+	{ ROP_D,    ROP_D,        ROP_D,    ROP_D       }, /* GXnoop         */
+	{ ROP_DSx,  ROP_DPSax,    ROP_DPx,  ROP_DPSax   }, /* GXxor          */
+	{ ROP_DSo,  ROP_DPSao,    ROP_DPo,  ROP_DPSao   }, /* GXor           */
+	{ ROP_DSon, ROP_PDSPaox,  ROP_DPon, ROP_DPSaon  }, /* GXnor          */
+	{ ROP_DSxn, ROP_DPSnax,   ROP_PDxn, ROP_DPSaxn  }, /* GXequiv        */
+	{ ROP_Dn,   ROP_DPx,      ROP_Dn,   ROP_DPx     }, /* GXinvert       */
+	{ ROP_SDno, ROP_DPSDanax, ROP_PDno, ROP_DPSanan }, /* GXorReverse    */
+	{ ROP_Sn,   ROP_SPDSxox,  ROP_Pn,   ROP_SPDSxox }, /* GXcopyInverted */
+	{ ROP_DSno, ROP_DPSnao,   ROP_DPno, ROP_DSPnao  }, /* GXorInverted   */
+	{ ROP_DSan, ROP_DPSDnoax, ROP_DPan, ROP_DPSnoan }, /* GXnand         */
+	{ ROP_1,    ROP_DPo,      ROP_1,    ROP_DPo     }  /* GXset          */
 };
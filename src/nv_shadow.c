@@ -22,6 +22,7 @@
 
 #include "nv_include.h"
 #include "nv_type.h"
+#include "nouveau_cpu.h"
 #include "shadowfb.h"
 #include "servermd.h"
 
@@ -50,12 +51,8 @@ NVRefreshArea(ScrnInfoPtr pScrn, int num, BoxPtr pbox)
 		if (width > 0 && height > 0) {
 			src = pNv->ShadowPtr + (y1 * pNv->ShadowPitch) + (x1 * cpp);
 			dst = pNv->scanout->map + (y1 * FBPitch) + (x1 * cpp);
-
-			while(height--) {
-				memcpy(dst, src, width);
-				dst += FBPitch;
-				src += pNv->ShadowPitch;
-			}
+			nouveau_cpu_copy_rect(dst, FBPitch, src, pNv->ShadowPitch,
+					      width, height);
 		}
 
 		pbox++;
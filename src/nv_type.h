@@ -30,6 +30,87 @@ struct xf86_platform_device;
 /* NV50 */
 typedef struct _NVRec *NVPtr;
 
+/* Sequence numbers released on each copy engine channel after the last
+ * transfer that touched a buffer, see nouveau_copy_sync().
+ */
+#define NOUVEAU_COPY_FENCES 16
+struct nouveau_copy_fence {
+	struct nouveau_bo *bo;
+	uint32_t seq;
+};
+
+/* Engines NVAccelM2MF() can move a rect with */
+#define NOUVEAU_XFER_MAIN 0 /* M2MF or copy class on the main channel */
+#define NOUVEAU_XFER_CE   1 /* async copy engine channel */
+
+/* How a transfer is done, see nouveau_exa_xfer_plan() */
+struct nouveau_xfer_plan {
+	int engine;
+	int tiled;
+	Bool probe;	/* time it, whatever */
+	int lines;	/* per chunk */
+	int depth;	/* download chunks in flight */
+};
+#define NOUVEAU_XFER_DEPTH 4
+
+/* A transfer being timed on the GPU, see nouveau_exa_xfer_begin() */
+#define NOUVEAU_XFER_SAMPLES 16
+struct nouveau_xfer_sample {
+	uint32_t seq;
+	int engine;
+	int tiled;
+	int bytes;
+};
+
+/* Shadow of the TIC/TSC entries and VP transform constants last written
+ * to the scratch buffer for one composite texture unit (NV50 and later).
+ */
+struct nouveau_tex_cache {
+	Bool tic_valid;
+	Bool tsc_valid;
+	Bool xfrm_valid;
+	uint32_t tic[8];
+	uint32_t tsc[8];
+	float xfrm[11];
+};
+
+/* Shadow of the state methods written to one subchannel through
+ * nouveau_state_data(), forgotten whenever the pushbuf is kicked.
+ */
+#define NOUVEAU_STATE_SLOTS 0x1000
+struct nouveau_state {
+	uint32_t valid[NOUVEAU_STATE_SLOTS / 32];
+	uint32_t fixed[NOUVEAU_STATE_SLOTS / 32]; /* side effects, never skip */
+	uint32_t value[NOUVEAU_STATE_SLOTS];
+};
+
+/* Operation classes timed by nouveau_timing_begin() */
+enum nouveau_timing_op {
+	NOUVEAU_TIMING_SOLID,
+	NOUVEAU_TIMING_COPY,
+	NOUVEAU_TIMING_COMPOSITE,
+	NOUVEAU_TIMING_M2MF,
+	NOUVEAU_TIMING_XV,
+	NOUVEAU_TIMING_OPS
+};
+
+/* How many buffers can be kept in every submission */
+#define NOUVEAU_PUSH_RESIDENT 4
+
+/* Part of a composite source too large for the 3D engine's textures,
+ * bound on its own (pre-NV50), see nouveau_exa_pict_window().
+ */
+struct nouveau_exa_window {
+	int x, y, w, h;
+	uint32_t offset;
+};
+
+typedef void (*nouveau_exa_split_rect)(PixmapPtr pdpix,
+				       const struct nouveau_exa_window *swin,
+				       const struct nouveau_exa_window *mwin,
+				       int sx, int sy, int mx, int my,
+				       int dx, int dy, int w, int h);
+
 typedef struct {
 	int fd;
 	unsigned long reinitGeneration;
@@ -99,6 +180,22 @@ typedef struct _NVRec {
 	struct nouveau_bo *transfer;
 	CARD32 transfer_offset;
 
+	/* Transfer planner, see nouveau_exa_xfer_plan() */
+	int xfer_rate[2][2];
+	int xfer_cpu_rate;
+	int xfer_queued;
+	CARD64 xfer_stamp;
+	int xfer_engine;		/* of the last transfer */
+	int xfer_last[2];		/* engine picked, per tiling */
+	int xfer_age[2][2];		/* transfers since it was timed */
+	unsigned xfer_count;
+	struct nouveau_bo *xfer_bo;	/* GPU timestamps */
+	struct nouveau_bo *xfer_tmp[NOUVEAU_XFER_DEPTH];
+	struct nouveau_xfer_sample xfer_sample[NOUVEAU_XFER_SAMPLES];
+	unsigned xfer_head;
+	unsigned xfer_tail;
+	uint32_t xfer_seq;
+
 	struct nouveau_object *channel;
 	struct nouveau_pushbuf *pushbuf;
 	struct nouveau_bufctx *bufctx;
@@ -121,6 +218,10 @@ typedef struct _NVRec {
 	struct nouveau_object *NvSW;
 	struct nouveau_object *NvCOPY;
 	struct nouveau_bo *scratch;
+	/* NV30/NV40 composite vertices, see nv30_vtxbuf.c */
+	struct nouveau_bo *vtxbuf;
+	int vtxbuf_offset;
+	int vtxbuf_start;
 
 	Bool ce_enabled;
 	struct nouveau_object *ce_channel;
@@ -131,17 +232,88 @@ typedef struct _NVRec {
 			struct nouveau_bo *, uint32_t, int, int, int, int, int,
 			struct nouveau_bo *, uint32_t, int, int, int, int, int);
 
+	/* Ordering against the main channel, see nouveau_copy_sync() */
+	struct nouveau_bo *ce_sema;
+	uint32_t ce_main_seq;
+	uint32_t ce_seq;
+	uint32_t ce_acquired;
+	uint32_t ce_evicted;
+	struct nouveau_copy_fence ce_fence[NOUVEAU_COPY_FENCES];
+	int ce_fence_next;
+
+	/* A second copy engine (Kepler and later), see nouveau_copy_rect() */
+	struct nouveau_object *ce_channel2;
+	struct nouveau_pushbuf *ce_pushbuf2;
+	struct nouveau_object *NvCopy2;
+	uint32_t ce_seq2;
+	uint32_t ce_joined;
+
 	/* SYNC extension private */
 	void *sync;
 
 	/* Present extension private */
 	void *present;
 
+	/* Render wrapper private, see nouveau_render.c */
+	void *render;
+
+	/* Per-generation solid and copy hooks, wrapped by nouveau_exa.c to
+	 * size each operation, see nouveau_push_begin()
+	 */
+	Bool (*PrepareSolid)(PixmapPtr, int, Pixel, Pixel);
+	void (*DoneSolid)(PixmapPtr);
+	Bool (*PrepareCopy)(PixmapPtr, PixmapPtr, int, int, int, Pixel);
+	void (*DoneCopy)(PixmapPtr);
+
+	/* Per-generation composite hooks, wrapped by nouveau_exa.c to
+	 * reduce composites to 2D solid fills and copies where possible
+	 */
+	Bool (*CheckComposite)(int, PicturePtr, PicturePtr, PicturePtr);
+	Bool (*PrepareComposite)(int, PicturePtr, PicturePtr, PicturePtr,
+				 PixmapPtr, PixmapPtr, PixmapPtr);
+	void (*Composite)(PixmapPtr, int, int, int, int, int, int, int, int);
+	void (*DoneComposite)(PixmapPtr);
+	int composite_reduced;
+
 	/* Acceleration context */
 	PixmapPtr pspix, pmpix, pdpix;
 	PicturePtr pspict, pmpict;
+	Bool composite_bounds;
+	Bool composite_open;	/* quads primitive left open for more rects */
+	int composite_limit;
 	Pixel fg_colour;
 
+	/* Texture descriptor cache, see nouveau_tex_cache_tic() */
+	struct nouveau_tex_cache tex_cache[2];
+	Bool tic_dirty;
+	Bool tsc_dirty;
+
+	/* Redundant state filter, see nouveau_state_data() */
+	struct nouveau_state *state[8];
+	unsigned state_emitted;
+	unsigned state_dropped;
+
+	/* GPU timing of acceleration, see nouveau_timing.c */
+	struct nouveau_timing *timing;
+
+	/* Pushbuf sizing and accounting, see nouveau_push_new() */
+	struct nouveau_push_track push[NOUVEAU_PUSH_TRACKS];
+
+	/* Buffers every submission references, see nouveau_push_resident() */
+	struct nouveau_bo *resident[NOUVEAU_PUSH_RESIDENT];
+	uint32_t resident_access[NOUVEAU_PUSH_RESIDENT];
+	int resident_nr;
+
+	/* Fallback counts last put in the property, see nouveau_fallback.c */
+	unsigned fallback_published;
+	CARD32 fallback_stamp;
+
+	/* What's in the PFP_GEN() and GRADIENT() slots, see nv30_fp.c */
+	struct nv30_fp_cache *fp_cache;
+
+	/* What's in the NV50 PFP_GEN() slots, see nv50_fp.c */
+	struct nv50_fp_cache *nv50_fp_cache;
+
 	char *render_node;
 } NVRec;
 
@@ -196,6 +368,14 @@ typedef struct _NVPortPrivRec {
 struct nouveau_pixmap {
 	struct nouveau_bo *bo;
 	Bool shared;
+	Bool exported;
+
+	/* Pixel value of a 1x1 pixmap, see nouveau_exa_pict_solid() */
+	Bool solid_valid;
+	uint32_t solid;
+
+	/* Number in the acceleration trace, see nouveau_trace.c */
+	uint32_t trace_id;
 };
 
 static inline struct nouveau_pixmap *
@@ -212,6 +392,16 @@ nouveau_pixmap_bo(PixmapPtr ppix)
 	return nvpix ? nvpix->bo : NULL;
 }
 
+/* Must be called before anything writes to a pixmap's storage */
+static inline void
+nouveau_pixmap_dirty(PixmapPtr ppix)
+{
+	struct nouveau_pixmap *nvpix = nouveau_pixmap(ppix);
+
+	if (nvpix)
+		nvpix->solid_valid = FALSE;
+}
+
 static inline uint32_t
 nv_pitch_align(NVPtr pNv, uint32_t width, int bpp)
 {
@@ -231,6 +421,66 @@ nv_pitch_align(NVPtr pNv, uint32_t width, int bpp)
 	return (width + mask) & ~mask;
 }
 
+/* The texture descriptor cache keeps a copy of what's been uploaded to the
+ * TIC/TSC slot of each texture unit.  These return TRUE if the entry already
+ * matches, otherwise the shadow is updated, the table is marked as needing
+ * a flush, and the caller is expected to upload the new entry.
+ */
+static inline Bool
+nouveau_tex_cache_tic(NVPtr pNv, unsigned unit, const uint32_t *tic)
+{
+	struct nouveau_tex_cache *tc = &pNv->tex_cache[unit];
+
+	if (tc->tic_valid && !memcmp(tc->tic, tic, sizeof(tc->tic)))
+		return TRUE;
+
+	memcpy(tc->tic, tic, sizeof(tc->tic));
+	tc->tic_valid = TRUE;
+	pNv->tic_dirty = TRUE;
+	return FALSE;
+}
+
+static inline Bool
+nouveau_tex_cache_tsc(NVPtr pNv, unsigned unit, const uint32_t *tsc)
+{
+	struct nouveau_tex_cache *tc = &pNv->tex_cache[unit];
+
+	if (tc->tsc_valid && !memcmp(tc->tsc, tsc, sizeof(tc->tsc)))
+		return TRUE;
+
+	memcpy(tc->tsc, tsc, sizeof(tc->tsc));
+	tc->tsc_valid = TRUE;
+	pNv->tsc_dirty = TRUE;
+	return FALSE;
+}
+
+/* Same again for the unit's transform and normalisation constants in the
+ * vertex program's constant buffer.
+ */
+static inline Bool
+nouveau_tex_cache_xfrm(NVPtr pNv, unsigned unit, const float *xfrm)
+{
+	struct nouveau_tex_cache *tc = &pNv->tex_cache[unit];
+
+	if (tc->xfrm_valid && !memcmp(tc->xfrm, xfrm, sizeof(tc->xfrm)))
+		return TRUE;
+
+	memcpy(tc->xfrm, xfrm, sizeof(tc->xfrm));
+	tc->xfrm_valid = TRUE;
+	return FALSE;
+}
+
+/* Anything that writes the descriptor tables or VP constants behind the
+ * cache's back (Xv, channel setup) must call this.
+ */
+static inline void
+nouveau_tex_cache_invalidate(NVPtr pNv)
+{
+	memset(pNv->tex_cache, 0, sizeof(pNv->tex_cache));
+	pNv->tic_dirty = TRUE;
+	pNv->tsc_dirty = TRUE;
+}
+
 /* nv04 cursor max dimensions of 32x32 (A1R5G5B5) */
 #define NV04_CURSOR_SIZE 32
 /* limit nv10 cursors to 64x64 (ARGB8) (we could go to 64x255) */
@@ -275,7 +275,7 @@ NVAccelInit3D_NVC0(ScrnInfoPtr pScrn)
 			   "DRM doesn't support sync-to-vblank\n");
 	}
 
-	if (nouveau_pushbuf_space(push, 512, 0, 0) ||
+	if (nouveau_push_space(push, 512, 0, 0) ||
 	    nouveau_pushbuf_refn (push, &(struct nouveau_pushbuf_refn) {
 					pNv->scratch, NOUVEAU_BO_VRAM |
 					NOUVEAU_BO_WR }, 1))
@@ -433,6 +433,7 @@ NVAccelInit3D_NVC0(ScrnInfoPtr pScrn)
 	BEGIN_NVC0(push, NVC0_3D(CB_BIND(4)), 1);
 	PUSH_DATA (push, 0x01);
 
+	nouveau_tex_cache_invalidate(pNv);
 	return TRUE;
 }
 
@@ -110,58 +110,70 @@ PUSH_DATAu(struct nouveau_pushbuf *push, struct nouveau_bo *bo,
 }
 
 static __inline__ void
-PUSH_TIC(struct nouveau_pushbuf *push, struct nouveau_bo *bo, unsigned offset,
-	 unsigned width, unsigned height, unsigned pitch, unsigned format)
+NVC0_TIC(struct nouveau_device *dev, uint32_t *tic, struct nouveau_bo *bo,
+	 unsigned offset, unsigned width, unsigned height, unsigned pitch,
+	 unsigned format)
 {
-	if (push->client->device->chipset < 0x110) {
+	if (dev->chipset < 0x110) {
 		unsigned tic2 = 0xd0001000;
 		if (pitch == 0)
 			tic2 |= 0x00004000;
 		else
 			tic2 |= 0x0005c000;
-		PUSH_DATA(push, format);
-		PUSH_DATA(push, bo->offset + offset);
-		PUSH_DATA(push, ((bo->offset + offset) >> 32) |
-			        (bo->config.nvc0.tile_mode << 18) |
-			        tic2);
-		PUSH_DATA(push, 0x00300000);
-		PUSH_DATA(push, 0x80000000 | width);
-		PUSH_DATA(push, 0x00010000 | height);
-		PUSH_DATA(push, 0x03000000);
-		PUSH_DATA(push, 0x00000000);
+		tic[0] = format;
+		tic[1] = bo->offset + offset;
+		tic[2] = ((bo->offset + offset) >> 32) |
+			 (bo->config.nvc0.tile_mode << 18) |
+			 tic2;
+		tic[3] = 0x00300000;
+		tic[4] = 0x80000000 | width;
+		tic[5] = 0x00010000 | height;
+		tic[6] = 0x03000000;
+		tic[7] = 0x00000000;
 	} else {
 		unsigned tile_mode = bo->config.nvc0.tile_mode;
-		PUSH_DATA(push, (format & 0x3f) | ((format & ~0x3f) << 1));
-		PUSH_DATA(push, bo->offset + offset);
+		tic[0] = (format & 0x3f) | ((format & ~0x3f) << 1);
+		tic[1] = bo->offset + offset;
 		if (pitch == 0) {
-			PUSH_DATA(push, ((bo->offset + offset) >> 32) |
-				  GM107_TIC2_2_HEADER_VERSION_BLOCKLINEAR);
-			PUSH_DATA(push, GM107_TIC2_3_LOD_ANISO_QUALITY_2 |
-				  ((tile_mode & 0x007)) |
-				  ((tile_mode & 0x070) >> (4 - 3)) |
-				  ((tile_mode & 0x700) >> (8 - 6)));
-			PUSH_DATA(push, GM107_TIC2_4_SECTOR_PROMOTION_PROMOTE_TO_2_V |
-				  GM107_TIC2_4_BORDER_SIZE_SAMPLER_COLOR |
-				  GM107_TIC2_4_TEXTURE_TYPE_TWO_D |
-				  (width - 1));
-			PUSH_DATA(push, GM107_TIC2_5_NORMALIZED_COORDS |
-				        ((height - 1) & 0xffff));
-			PUSH_DATA(push, GM107_TIC2_6_ANISO_FINE_SPREAD_FUNC_TWO |
-				        GM107_TIC2_6_ANISO_COARSE_SPREAD_FUNC_ONE);
-			PUSH_DATA(push, 0x00000000);
+			tic[2] = ((bo->offset + offset) >> 32) |
+				 GM107_TIC2_2_HEADER_VERSION_BLOCKLINEAR;
+			tic[3] = GM107_TIC2_3_LOD_ANISO_QUALITY_2 |
+				 ((tile_mode & 0x007)) |
+				 ((tile_mode & 0x070) >> (4 - 3)) |
+				 ((tile_mode & 0x700) >> (8 - 6));
+			tic[4] = GM107_TIC2_4_SECTOR_PROMOTION_PROMOTE_TO_2_V |
+				 GM107_TIC2_4_BORDER_SIZE_SAMPLER_COLOR |
+				 GM107_TIC2_4_TEXTURE_TYPE_TWO_D |
+				 (width - 1);
+			tic[5] = GM107_TIC2_5_NORMALIZED_COORDS |
+				 ((height - 1) & 0xffff);
+			tic[6] = GM107_TIC2_6_ANISO_FINE_SPREAD_FUNC_TWO |
+				 GM107_TIC2_6_ANISO_COARSE_SPREAD_FUNC_ONE;
+			tic[7] = 0x00000000;
 		} else {
-			PUSH_DATA(push, ((bo->offset + offset) >> 32) |
-				        GM107_TIC2_2_HEADER_VERSION_PITCH);
-			PUSH_DATA(push, GM107_TIC2_3_LOD_ANISO_QUALITY_2 |
-				        (pitch >> 5));
-			PUSH_DATA(push, GM107_TIC2_4_BORDER_SIZE_SAMPLER_COLOR |
-				  GM107_TIC2_4_TEXTURE_TYPE_TWO_D_NO_MIPMAP |
-				  (width - 1));
-			PUSH_DATA(push, GM107_TIC2_5_NORMALIZED_COORDS | (height - 1));
-			PUSH_DATA(push, 0x000000000);
-			PUSH_DATA(push, 0x000000000);
+			tic[2] = ((bo->offset + offset) >> 32) |
+				 GM107_TIC2_2_HEADER_VERSION_PITCH;
+			tic[3] = GM107_TIC2_3_LOD_ANISO_QUALITY_2 |
+				 (pitch >> 5);
+			tic[4] = GM107_TIC2_4_BORDER_SIZE_SAMPLER_COLOR |
+				 GM107_TIC2_4_TEXTURE_TYPE_TWO_D_NO_MIPMAP |
+				 (width - 1);
+			tic[5] = GM107_TIC2_5_NORMALIZED_COORDS | (height - 1);
+			tic[6] = 0x00000000;
+			tic[7] = 0x00000000;
 		}
 	}
 }
 
+static __inline__ void
+PUSH_TIC(struct nouveau_pushbuf *push, struct nouveau_bo *bo, unsigned offset,
+	 unsigned width, unsigned height, unsigned pitch, unsigned format)
+{
+	uint32_t tic[8];
+
+	NVC0_TIC(push->client->device, tic, bo, offset, width, height, pitch,
+		 format);
+	PUSH_DATAp(push, tic, 8);
+}
+
 #endif
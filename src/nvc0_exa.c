@@ -127,7 +127,7 @@ NVC0EXAAcquireSurface2D(PixmapPtr ppix, int is_src, uint32_t fmt)
 	if (is_src == 0)
 		NVC0EXASetClip(ppix, 0, 0, ppix->drawable.width, ppix->drawable.height);
 
-	PUSH_REFN (push, bo, bo_flags);
+	nouveau_push_refn(pNv, bo, bo_flags);
 }
 
 static void
@@ -148,7 +148,7 @@ NVC0EXASetROP(PixmapPtr pdpix, int alu, Pixel planemask)
 	NVC0EXA_LOCALS(pdpix);
 	int rop;
 
-	if (planemask != ~0)
+	if (!EXA_PM_IS_SOLID(&pdpix->drawable, planemask))
 		rop = NVROP[alu].copy_planemask;
 	else
 		rop = NVROP[alu].copy;
@@ -200,6 +200,9 @@ NVC0EXAPrepareSolid(PixmapPtr pdpix, int alu, Pixel planemask, Pixel fg)
 	NVC0EXA_LOCALS(pdpix);
 	uint32_t fmt;
 
+	nouveau_pixmap_dirty(pdpix);
+	nouveau_copy_sync(pNv, nouveau_pixmap_bo(pdpix));
+
 	if (!NVC0EXA2DSurfaceFormat(pdpix, &fmt))
 		NOUVEAU_FALLBACK("rect format\n");
 
@@ -221,6 +224,7 @@ NVC0EXAPrepareSolid(PixmapPtr pdpix, int alu, Pixel planemask, Pixel fg)
 		NOUVEAU_FALLBACK("validate\n");
 	}
 
+	nouveau_timing_begin(pNv, NOUVEAU_TIMING_SOLID);
 	return TRUE;
 }
 
@@ -246,6 +250,7 @@ void
 NVC0EXADoneSolid(PixmapPtr pdpix)
 {
 	NVC0EXA_LOCALS(pdpix);
+	nouveau_timing_end(pNv);
 	nouveau_pushbuf_bufctx(push, NULL);
 }
 
@@ -256,6 +261,10 @@ NVC0EXAPrepareCopy(PixmapPtr pspix, PixmapPtr pdpix, int dx, int dy,
 	NVC0EXA_LOCALS(pdpix);
 	uint32_t src, dst;
 
+	nouveau_pixmap_dirty(pdpix);
+	nouveau_copy_sync(pNv, nouveau_pixmap_bo(pspix));
+	nouveau_copy_sync(pNv, nouveau_pixmap_bo(pdpix));
+
 	if (!NVC0EXA2DSurfaceFormat(pspix, &src))
 		NOUVEAU_FALLBACK("src format\n");
 	if (!NVC0EXA2DSurfaceFormat(pdpix, &dst))
@@ -275,6 +284,7 @@ NVC0EXAPrepareCopy(PixmapPtr pspix, PixmapPtr pdpix, int dx, int dy,
 		NOUVEAU_FALLBACK("validate\n");
 	}
 
+	nouveau_timing_begin(pNv, NOUVEAU_TIMING_COPY);
 	return TRUE;
 }
 
@@ -314,6 +324,7 @@ void
 NVC0EXADoneCopy(PixmapPtr pdpix)
 {
 	NVC0EXA_LOCALS(pdpix);
+	nouveau_timing_end(pNv);
 	nouveau_pushbuf_bufctx(push, NULL);
 }
 
@@ -419,6 +430,7 @@ NVC0EXARenderTarget(PixmapPtr ppix, PicturePtr ppict)
 {
 	NVC0EXA_LOCALS(ppix);
 	struct nouveau_bo *bo = nouveau_pixmap_bo(ppix);
+	uint32_t rt[8];
 	unsigned format;
 
 	/*XXX: Scanout buffer not tiled, someone needs to figure it out */
@@ -445,18 +457,33 @@ NVC0EXARenderTarget(PixmapPtr ppix, PicturePtr ppict)
 		NOUVEAU_FALLBACK("invalid picture format\n");
 	}
 
-	BEGIN_NVC0(push, NVC0_3D(RT_ADDRESS_HIGH(0)), 8);
-	PUSH_DATA (push, bo->offset >> 32);
-	PUSH_DATA (push, bo->offset);
-	PUSH_DATA (push, ppix->drawable.width);
-	PUSH_DATA (push, ppix->drawable.height);
-	PUSH_DATA (push, format);
-	PUSH_DATA (push, bo->config.nvc0.tile_mode);
-	PUSH_DATA (push, 0x00000001);
-	PUSH_DATA (push, 0x00000000);
+	rt[0] = bo->offset >> 32;
+	rt[1] = bo->offset;
+	rt[2] = ppix->drawable.width;
+	rt[3] = ppix->drawable.height;
+	rt[4] = format;
+	rt[5] = bo->config.nvc0.tile_mode;
+	rt[6] = 0x00000001;
+	rt[7] = 0x00000000;
+	nouveau_state_data(pNv, NVC0_3D(RT_ADDRESS_HIGH(0)), 8, rt);
 	return TRUE;
 }
 
+/* OpenGL and Render disagree on what should be sampled outside an XRGB
+ * texture (with no repeating). OpenGL has a hardcoded alpha value of
+ * 1.0, while render expects 0.0. We assume that clipping is done for
+ * untransformed sources, anything else needs the bounds test done by
+ * NVC0EXAPictBounds().
+ */
+static Bool
+NVC0EXANeedsBounds(PicturePtr ppict, PicturePtr pdpict, int op)
+{
+	return NVC0EXABlendOp[op].src_alpha && ppict->pDrawable &&
+	       !ppict->repeat && ppict->transform &&
+	       PICT_FORMAT_A(ppict->format) == 0 &&
+	       PICT_FORMAT_A(pdpict->format) != 0;
+}
+
 static Bool
 NVC0EXACheckTexture(PicturePtr ppict, PicturePtr pdpict, int op)
 {
@@ -509,16 +536,6 @@ NVC0EXACheckTexture(PicturePtr ppict, PicturePtr pdpict, int op)
 		NOUVEAU_FALLBACK("picture filter %d\n", ppict->filter);
 	}
 
-	/* OpenGL and Render disagree on what should be sampled outside an XRGB 
-	 * texture (with no repeating). Opengl has a hardcoded alpha value of 
-	 * 1.0, while render expects 0.0. We assume that clipping is done for 
-	 * untranformed sources.
-	 */
-	if (NVC0EXABlendOp[op].src_alpha && !ppict->repeat &&
-	    ppict->transform && (PICT_FORMAT_A(ppict->format) == 0)
-	    && (PICT_FORMAT_A(pdpict->format) != 0))
-		NOUVEAU_FALLBACK("REPEAT_NONE unsupported for XRGB source\n");
-
 	return TRUE;
 }
 
@@ -530,28 +547,38 @@ NVC0EXACheckTexture(PicturePtr ppict, PicturePtr pdpict, int op)
 	 NV50TIC_0_0_FMT_##FMT)
 
 static Bool
-NVC0EXAPictSolid(NVPtr pNv, PicturePtr ppict, unsigned unit)
+NVC0EXAPictSolid(NVPtr pNv, uint32_t color, unsigned unit, Bool border)
 {
 	struct nouveau_pushbuf *push = pNv->pushbuf;
+	uint32_t tic[8], tsc[8] = {
+		NV50TSC_1_0_WRAPS_REPEAT |
+		NV50TSC_1_0_WRAPT_REPEAT |
+		NV50TSC_1_0_WRAPR_REPEAT | 0x00024000,
+		NV50TSC_1_1_MAGF_NEAREST |
+		NV50TSC_1_1_MINF_NEAREST |
+		NV50TSC_1_1_MIPF_NONE,
+	};
+
+	if (border) {
+		tsc[0] = NV50TSC_1_0_WRAPS_CLAMP_TO_BORDER |
+			 NV50TSC_1_0_WRAPT_CLAMP_TO_BORDER |
+			 NV50TSC_1_0_WRAPR_CLAMP_TO_BORDER | 0x00024000;
+	}
 
 	PUSH_DATAu(push, pNv->scratch, SOLID(unit), 1);
-	PUSH_DATA (push, ppict->pSourcePict->solidFill.color);
-	PUSH_DATAu(push, pNv->scratch, TIC_OFFSET + (unit * 32), 8);
-	PUSH_TIC  (push, pNv->scratch, SOLID(unit), 1, 1, 4,
-		   _(B_C0, G_C1, R_C2, A_C3, 8_8_8_8));
-	PUSH_DATAu(push, pNv->scratch, TSC_OFFSET + (unit * 32), 8);
-	PUSH_DATA (push, NV50TSC_1_0_WRAPS_REPEAT |
-			 NV50TSC_1_0_WRAPT_REPEAT |
-			 NV50TSC_1_0_WRAPR_REPEAT | 0x00024000);
-	PUSH_DATA (push, NV50TSC_1_1_MAGF_NEAREST |
-			 NV50TSC_1_1_MINF_NEAREST |
-			 NV50TSC_1_1_MIPF_NONE);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
+	PUSH_DATA (push, color);
+
+	NVC0_TIC(pNv->dev, tic, pNv->scratch, SOLID(unit), 1, 1, 4,
+		 _(B_C0, G_C1, R_C2, A_C3, 8_8_8_8));
+	if (!nouveau_tex_cache_tic(pNv, unit, tic)) {
+		PUSH_DATAu(push, pNv->scratch, TIC_OFFSET + (unit * 32), 8);
+		PUSH_DATAp(push, tic, 8);
+	}
+
+	if (!nouveau_tex_cache_tsc(pNv, unit, tsc)) {
+		PUSH_DATAu(push, pNv->scratch, TSC_OFFSET + (unit * 32), 8);
+		PUSH_DATAp(push, tsc, 8);
+	}
 
 	return TRUE;
 }
@@ -562,12 +589,39 @@ NVC0EXAPictGradient(NVPtr pNv, PicturePtr ppict, unsigned unit)
 	return FALSE;
 }
 
+static Bool
+NVC0EXAPictTransform(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, unsigned unit)
+{
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	float xfrm[11] = {
+		1.0, 0.0, 0.0,
+		0.0, 1.0, 0.0,
+		0.0, 0.0, 1.0,
+		1.0 / ppix->drawable.width,
+		1.0 / ppix->drawable.height,
+	};
+	PictTransformPtr t = ppict->transform;
+	int i;
+
+	if (t) {
+		for (i = 0; i < 9; i++)
+			xfrm[i] = xFixedToFloat(t->matrix[i / 3][i % 3]);
+	}
+
+	if (!nouveau_tex_cache_xfrm(pNv, unit, xfrm)) {
+		PUSH_DATAu(push, pNv->scratch, PVP_DATA + (unit * 11 * 4), 11);
+		PUSH_DATAp(push, xfrm, 11);
+	}
+
+	return TRUE;
+}
+
 static Bool
 NVC0EXAPictTexture(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, unsigned unit)
 {
 	struct nouveau_bo *bo = nouveau_pixmap_bo(ppix);
 	struct nouveau_pushbuf *push = pNv->pushbuf;
-	uint32_t format;
+	uint32_t format, tic[8], tsc[8] = {};
 
 	/*XXX: Scanout buffer not tiled, someone needs to figure it out */
 	if (!nv50_style_tiled_pixmap(ppix))
@@ -642,92 +696,84 @@ NVC0EXAPictTexture(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, unsigned unit)
 	}
 #undef _
 
-	PUSH_REFN (push, bo, NOUVEAU_BO_VRAM | NOUVEAU_BO_RD);
-	PUSH_DATAu(push, pNv->scratch, TIC_OFFSET + (unit * 32), 8);
-	PUSH_TIC  (push, bo, 0, ppix->drawable.width, ppix->drawable.height, 0,
-		   format);
+	NVC0_TIC(pNv->dev, tic, bo, 0, ppix->drawable.width,
+		 ppix->drawable.height, 0, format);
 
-	PUSH_DATAu(push, pNv->scratch, TSC_OFFSET + (unit * 32), 8);
 	if (ppict->repeat) {
 		switch (ppict->repeatType) {
 		case RepeatPad:
-			PUSH_DATA (push, 0x00024000 |
-					 NV50TSC_1_0_WRAPS_CLAMP_TO_EDGE |
-					 NV50TSC_1_0_WRAPT_CLAMP_TO_EDGE |
-					 NV50TSC_1_0_WRAPR_CLAMP_TO_EDGE);
+			tsc[0] = 0x00024000 |
+				 NV50TSC_1_0_WRAPS_CLAMP_TO_EDGE |
+				 NV50TSC_1_0_WRAPT_CLAMP_TO_EDGE |
+				 NV50TSC_1_0_WRAPR_CLAMP_TO_EDGE;
 			break;
 		case RepeatReflect:
-			PUSH_DATA (push, 0x00024000 |
-					 NV50TSC_1_0_WRAPS_MIRROR_REPEAT |
-					 NV50TSC_1_0_WRAPT_MIRROR_REPEAT |
-					 NV50TSC_1_0_WRAPR_MIRROR_REPEAT);
+			tsc[0] = 0x00024000 |
+				 NV50TSC_1_0_WRAPS_MIRROR_REPEAT |
+				 NV50TSC_1_0_WRAPT_MIRROR_REPEAT |
+				 NV50TSC_1_0_WRAPR_MIRROR_REPEAT;
 			break;
 		case RepeatNormal:
 		default:
-			PUSH_DATA (push, 0x00024000 |
-					 NV50TSC_1_0_WRAPS_REPEAT |
-					 NV50TSC_1_0_WRAPT_REPEAT |
-					 NV50TSC_1_0_WRAPR_REPEAT);
+			tsc[0] = 0x00024000 |
+				 NV50TSC_1_0_WRAPS_REPEAT |
+				 NV50TSC_1_0_WRAPT_REPEAT |
+				 NV50TSC_1_0_WRAPR_REPEAT;
 			break;
 		}
 	} else {
-		PUSH_DATA (push, 0x00024000 |
-				 NV50TSC_1_0_WRAPS_CLAMP_TO_BORDER |
-				 NV50TSC_1_0_WRAPT_CLAMP_TO_BORDER |
-				 NV50TSC_1_0_WRAPR_CLAMP_TO_BORDER);
+		tsc[0] = 0x00024000 |
+			 NV50TSC_1_0_WRAPS_CLAMP_TO_BORDER |
+			 NV50TSC_1_0_WRAPT_CLAMP_TO_BORDER |
+			 NV50TSC_1_0_WRAPR_CLAMP_TO_BORDER;
 	}
 	if (ppict->filter == PictFilterBilinear) {
-		PUSH_DATA (push, NV50TSC_1_1_MAGF_LINEAR |
-				 NV50TSC_1_1_MINF_LINEAR |
-				 NV50TSC_1_1_MIPF_NONE);
+		tsc[1] = NV50TSC_1_1_MAGF_LINEAR |
+			 NV50TSC_1_1_MINF_LINEAR |
+			 NV50TSC_1_1_MIPF_NONE;
 	} else {
-		PUSH_DATA (push, NV50TSC_1_1_MAGF_NEAREST |
-				 NV50TSC_1_1_MINF_NEAREST |
-				 NV50TSC_1_1_MIPF_NONE);
+		tsc[1] = NV50TSC_1_1_MAGF_NEAREST |
+			 NV50TSC_1_1_MINF_NEAREST |
+			 NV50TSC_1_1_MIPF_NONE;
 	}
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-	PUSH_DATA (push, 0x00000000);
-
-	PUSH_DATAu(push, pNv->scratch, PVP_DATA + (unit * 11 * 4), 11);
-	if (ppict->transform) {
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[0][0]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[0][1]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[0][2]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[1][0]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[1][1]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[1][2]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[2][0]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[2][1]));
-		PUSH_DATAf(push, xFixedToFloat(ppict->transform->matrix[2][2]));
-	} else {
-		PUSH_DATAf(push, 1.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 1.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 0.0);
-		PUSH_DATAf(push, 1.0);
+
+	if (!nouveau_tex_cache_tic(pNv, unit, tic)) {
+		PUSH_DATAu(push, pNv->scratch, TIC_OFFSET + (unit * 32), 8);
+		PUSH_DATAp(push, tic, 8);
 	}
-	PUSH_DATAf(push, 1.0 / ppix->drawable.width);
-	PUSH_DATAf(push, 1.0 / ppix->drawable.height);
-	return TRUE;
+
+	if (!nouveau_tex_cache_tsc(pNv, unit, tsc)) {
+		PUSH_DATAu(push, pNv->scratch, TSC_OFFSET + (unit * 32), 8);
+		PUSH_DATAp(push, tsc, 8);
+	}
+
+	return NVC0EXAPictTransform(pNv, ppix, ppict, unit);
+}
+
+/* Mask unit stand-in for an XRGB source with no repeat: a white texel
+ * with a transparent border, sampled through the source's transform and
+ * normalised to the source's size, so it's 1.0 inside the source and 0.0
+ * outside.  See NVC0EXANeedsBounds().
+ */
+static Bool
+NVC0EXAPictBounds(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, unsigned unit)
+{
+	if (!NVC0EXAPictSolid(pNv, 0xffffffff, unit, TRUE))
+		return FALSE;
+	return NVC0EXAPictTransform(pNv, ppix, ppict, unit);
 }
 
 static Bool
-NVC0EXAPicture(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, int unit)
+NVC0EXAPicture(NVPtr pNv, PixmapPtr ppix, PicturePtr ppict, int unit,
+	       const uint32_t *solid)
 {
+	if (solid)
+		return NVC0EXAPictSolid(pNv, *solid, unit, FALSE);
+
 	if (ppict->pDrawable)
 		return NVC0EXAPictTexture(pNv, ppix, ppict, unit);
 
 	switch (ppict->pSourcePict->type) {
-	case SourcePictTypeSolidFill:
-		return NVC0EXAPictSolid(pNv, ppict, unit);
 	case SourcePictTypeLinear:
 		return NVC0EXAPictGradient(pNv, ppict, unit);
 	default:
@@ -771,19 +817,16 @@ NVC0EXABlend(PixmapPtr ppix, PicturePtr ppict, int op, int component_alpha)
 	}
 
 	if (sblend == BF(ONE) && dblend == BF(ZERO)) {
-		BEGIN_NVC0(push, NVC0_3D(BLEND_ENABLE(0)), 1);
-		PUSH_DATA (push, 0);
+		nouveau_state_mthd(pNv, NVC0_3D(BLEND_ENABLE(0)), 0);
 	} else {
-		BEGIN_NVC0(push, NVC0_3D(BLEND_ENABLE(0)), 1);
-		PUSH_DATA (push, 1);
-		BEGIN_NVC0(push, NVC0_3D(BLEND_EQUATION_RGB), 5);
-		PUSH_DATA (push, NVC0_3D_BLEND_EQUATION_RGB_FUNC_ADD);
-		PUSH_DATA (push, sblend);
-		PUSH_DATA (push, dblend);
-		PUSH_DATA (push, NVC0_3D_BLEND_EQUATION_ALPHA_FUNC_ADD);
-		PUSH_DATA (push, sblend);
-		BEGIN_NVC0(push, NVC0_3D(BLEND_FUNC_DST_ALPHA), 1);
-		PUSH_DATA (push, dblend);
+		uint32_t blend[5] = {
+			NVC0_3D_BLEND_EQUATION_RGB_FUNC_ADD, sblend, dblend,
+			NVC0_3D_BLEND_EQUATION_ALPHA_FUNC_ADD, sblend
+		};
+
+		nouveau_state_mthd(pNv, NVC0_3D(BLEND_ENABLE(0)), 1);
+		nouveau_state_data(pNv, NVC0_3D(BLEND_EQUATION_RGB), 5, blend);
+		nouveau_state_mthd(pNv, NVC0_3D(BLEND_FUNC_DST_ALPHA), dblend);
 	}
 }
 
@@ -801,6 +844,12 @@ NVC0EXACheckComposite(int op,
 		NOUVEAU_FALLBACK("src picture invalid\n");
 
 	if (pmpict) {
+		/* the mask unit is needed for the bounds test */
+		if (NVC0EXANeedsBounds(pspict, pdpict, op))
+			NOUVEAU_FALLBACK("REPEAT_NONE unsupported for XRGB source\n");
+		if (NVC0EXANeedsBounds(pmpict, pdpict, op))
+			NOUVEAU_FALLBACK("REPEAT_NONE unsupported for XRGB mask\n");
+
 		if (pmpict->componentAlpha &&
 		    PICT_FORMAT_RGB(pmpict->format) &&
 		    NVC0EXABlendOp[op].src_alpha &&
@@ -821,6 +870,17 @@ NVC0EXAPrepareComposite(int op,
 {
 	struct nouveau_bo *dst = nouveau_pixmap_bo(pdpix);
 	NVC0EXA_LOCALS(pdpix);
+	uint32_t solid[2], fp;
+	Bool ssolid, msolid;
+
+	nouveau_pixmap_dirty(pdpix);
+	pNv->composite_open = FALSE;
+	pNv->composite_bounds = !pmpict &&
+				NVC0EXANeedsBounds(pspict, pdpict, op);
+
+	/* Before touching the pushbuf, reading back a 1x1 pixmap may kick it */
+	ssolid = nouveau_exa_pict_solid(pspix, pspict, &solid[0]);
+	msolid = nouveau_exa_pict_solid(pmpix, pmpict, &solid[1]);
 
 	if (!PUSH_SPACE(push, 256))
 		NOUVEAU_FALLBACK("space\n");
@@ -834,51 +894,69 @@ NVC0EXAPrepareComposite(int op,
 	NVC0EXABlend(pdpix, pdpict, op, pmpict && pmpict->componentAlpha &&
 		     PICT_FORMAT_RGB(pmpict->format));
 
-	if (!NVC0EXAPicture(pNv, pspix, pspict, 0))
+	if (!NVC0EXAPicture(pNv, pspix, pspict, 0, ssolid ? &solid[0] : NULL))
 		NOUVEAU_FALLBACK("src picture invalid\n");
 
 	if (pmpict) {
-		if (!NVC0EXAPicture(pNv, pmpix, pmpict, 1))
+		if (!NVC0EXAPicture(pNv, pmpix, pmpict, 1,
+				    msolid ? &solid[1] : NULL))
 			NOUVEAU_FALLBACK("mask picture invalid\n");
 
-		BEGIN_NVC0(push, NVC0_3D(SP_START_ID(5)), 1);
 		if (pdpict->format == PICT_a8) {
-			PUSH_DATA (push, PFP_C_A8);
+			fp = PFP_C_A8;
 		} else {
 			if (pmpict->componentAlpha &&
 			    PICT_FORMAT_RGB(pmpict->format)) {
 				if (NVC0EXABlendOp[op].src_alpha)
-					PUSH_DATA (push, PFP_CCASA);
+					fp = PFP_CCASA;
 				else
-					PUSH_DATA (push, PFP_CCA);
+					fp = PFP_CCA;
 			} else {
-				PUSH_DATA (push, PFP_C);
+				fp = PFP_C;
 			}
 		}
+	} else
+	if (pNv->composite_bounds) {
+		if (!NVC0EXAPictBounds(pNv, pspix, pspict, 1))
+			NOUVEAU_FALLBACK("src bounds invalid\n");
+
+		if (pdpict->format == PICT_a8)
+			fp = PFP_C_A8;
+		else
+			fp = PFP_C;
 	} else {
-		BEGIN_NVC0(push, NVC0_3D(SP_START_ID(5)), 1);
 		if (pdpict->format == PICT_a8)
-			PUSH_DATA (push, PFP_S_A8);
+			fp = PFP_S_A8;
 		else
-			PUSH_DATA (push, PFP_S);
+			fp = PFP_S;
 	}
+	nouveau_state_mthd(pNv, NVC0_3D(SP_START_ID(5)), fp);
 
-	BEGIN_NVC0(push, NVC0_3D(TSC_FLUSH), 1);
-	PUSH_DATA (push, 0);
-	BEGIN_NVC0(push, NVC0_3D(TIC_FLUSH), 1);
-	PUSH_DATA (push, 0);
+	/* Descriptors only need flushing when one was re-uploaded, but the
+	 * texel cache is always invalidated as the source pixmaps may have
+	 * been rendered to since the last composite.
+	 */
+	if (pNv->tsc_dirty) {
+		BEGIN_NVC0(push, NVC0_3D(TSC_FLUSH), 1);
+		PUSH_DATA (push, 0);
+		pNv->tsc_dirty = FALSE;
+	}
+	if (pNv->tic_dirty) {
+		BEGIN_NVC0(push, NVC0_3D(TIC_FLUSH), 1);
+		PUSH_DATA (push, 0);
+		pNv->tic_dirty = FALSE;
+	}
 	BEGIN_NVC0(push, NVC0_3D(TEX_CACHE_CTL), 1);
 	PUSH_DATA (push, 0);
 
 	PUSH_RESET(push);
-	PUSH_REFN (push, pNv->scratch, NOUVEAU_BO_VRAM | NOUVEAU_BO_RDWR);
-	if (pspict->pDrawable)
-		PUSH_REFN (push, nouveau_pixmap_bo(pspix),
-			   NOUVEAU_BO_VRAM | NOUVEAU_BO_RD);
-	PUSH_REFN (push, dst, NOUVEAU_BO_VRAM | NOUVEAU_BO_WR);
-	if (pmpict && pmpict->pDrawable)
-		PUSH_REFN (push, nouveau_pixmap_bo(pmpix),
-			   NOUVEAU_BO_VRAM | NOUVEAU_BO_RD);
+	if (pspict->pDrawable && !ssolid)
+		nouveau_push_refn(pNv, nouveau_pixmap_bo(pspix),
+				  NOUVEAU_BO_VRAM | NOUVEAU_BO_RD);
+	nouveau_push_refn(pNv, dst, NOUVEAU_BO_VRAM | NOUVEAU_BO_WR);
+	if (pmpict && pmpict->pDrawable && !msolid)
+		nouveau_push_refn(pNv, nouveau_pixmap_bo(pmpix),
+				  NOUVEAU_BO_VRAM | NOUVEAU_BO_RD);
 
 	nouveau_pushbuf_bufctx(push, pNv->bufctx);
 	if (nouveau_pushbuf_validate(push)) {
@@ -886,9 +964,55 @@ NVC0EXAPrepareComposite(int op,
 		NOUVEAU_FALLBACK("validate\n");
 	}
 
+	nouveau_timing_begin(pNv, NOUVEAU_TIMING_COMPOSITE);
 	return TRUE;
 }
 
+/* Before GM200, rects are drawn as quads in one primitive left open from
+ * one Composite to the next, see NV50EXAComposite().
+ */
+static void
+NVC0EXACompositeEnd(NVPtr pNv)
+{
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+
+	if (!pNv->composite_open)
+		return;
+
+	BEGIN_NVC0(push, NVC0_3D(VERTEX_END_GL), 1);
+	PUSH_DATA (push, 0);
+	pNv->composite_open = FALSE;
+}
+
+static void
+NVC0EXACompositeQuad(NVPtr pNv, PixmapPtr pdpix,
+		     int sx, int sy, int mx, int my,
+		     int dx, int dy, int w, int h)
+{
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+
+	/* four vertices, and room to end the primitive after them */
+	if (PUSH_AVAIL(push) < 4 * 12 + 2)
+		NVC0EXACompositeEnd(pNv);
+
+	if (!pNv->composite_open) {
+		if (!PUSH_SPACE(push, 64))
+			return;
+
+		BEGIN_NVC0(push, NVC0_3D(SCISSOR_HORIZ(0)), 2);
+		PUSH_DATA (push, pdpix->drawable.width << 16);
+		PUSH_DATA (push, pdpix->drawable.height << 16);
+		BEGIN_NVC0(push, NVC0_3D(VERTEX_BEGIN_GL), 1);
+		PUSH_DATA (push, NVC0_3D_VERTEX_BEGIN_GL_PRIMITIVE_QUADS);
+		pNv->composite_open = TRUE;
+	}
+
+	PUSH_VTX2s(push, sx, sy, mx, my, dx, dy);
+	PUSH_VTX2s(push, sx + w, sy, mx + w, my, dx + w, dy);
+	PUSH_VTX2s(push, sx + w, sy + h, mx + w, my + h, dx + w, dy + h);
+	PUSH_VTX2s(push, sx, sy + h, mx, my + h, dx, dy + h);
+}
+
 void
 NVC0EXAComposite(PixmapPtr pdpix,
 		 int sx, int sy, int mx, int my,
@@ -896,59 +1020,65 @@ NVC0EXAComposite(PixmapPtr pdpix,
 {
 	NVC0EXA_LOCALS(pdpix);
 
+	/* the bounds test samples the mask unit at source coordinates */
+	if (pNv->composite_bounds) {
+		mx = sx;
+		my = sy;
+	}
+
+	if (pNv->dev->chipset < 0x110) {
+		NVC0EXACompositeQuad(pNv, pdpix, sx, sy, mx, my, dx, dy, w, h);
+		return;
+	}
+
+	/* no immediate-mode vertices, one constant buffer upload and one
+	 * draw per rect
+	 */
 	if (!PUSH_SPACE(push, 64))
 		return;
 
-	if (pNv->dev->chipset >= 0x110) {
-		BEGIN_NVC0(push, NVC0_3D(CB_SIZE), 3);
-		PUSH_DATA (push, 256);
-		PUSH_DATA (push, (pNv->scratch->offset + PVP_DATA) >> 32);
-		PUSH_DATA (push, (pNv->scratch->offset + PVP_DATA));
-		BEGIN_1IC0(push, NVC0_3D(CB_POS), 24 + 1);
-		PUSH_DATA (push, 0x80);
-
-		PUSH_DATAf(push, dx);
-		PUSH_DATAf(push, dy + (h * 2));
-		PUSH_DATAf(push, 0);
-		PUSH_DATAf(push, 1);
-		PUSH_DATAf(push, sx);
-		PUSH_DATAf(push, sy + (h * 2));
-		PUSH_DATAf(push, mx);
-		PUSH_DATAf(push, my + (h * 2));
-
-		PUSH_DATAf(push, dx);
-		PUSH_DATAf(push, dy);
-		PUSH_DATAf(push, 0);
-		PUSH_DATAf(push, 1);
-		PUSH_DATAf(push, sx);
-		PUSH_DATAf(push, sy);
-		PUSH_DATAf(push, mx);
-		PUSH_DATAf(push, my);
-
-		PUSH_DATAf(push, dx + (w * 2));
-		PUSH_DATAf(push, dy);
-		PUSH_DATAf(push, 0);
-		PUSH_DATAf(push, 1);
-		PUSH_DATAf(push, sx + (w * 2));
-		PUSH_DATAf(push, sy);
-		PUSH_DATAf(push, mx + (w * 2));
-		PUSH_DATAf(push, my);
-	}
+	BEGIN_NVC0(push, NVC0_3D(CB_SIZE), 3);
+	PUSH_DATA (push, 256);
+	PUSH_DATA (push, (pNv->scratch->offset + PVP_DATA) >> 32);
+	PUSH_DATA (push, (pNv->scratch->offset + PVP_DATA));
+	BEGIN_1IC0(push, NVC0_3D(CB_POS), 24 + 1);
+	PUSH_DATA (push, 0x80);
+
+	PUSH_DATAf(push, dx);
+	PUSH_DATAf(push, dy + (h * 2));
+	PUSH_DATAf(push, 0);
+	PUSH_DATAf(push, 1);
+	PUSH_DATAf(push, sx);
+	PUSH_DATAf(push, sy + (h * 2));
+	PUSH_DATAf(push, mx);
+	PUSH_DATAf(push, my + (h * 2));
+
+	PUSH_DATAf(push, dx);
+	PUSH_DATAf(push, dy);
+	PUSH_DATAf(push, 0);
+	PUSH_DATAf(push, 1);
+	PUSH_DATAf(push, sx);
+	PUSH_DATAf(push, sy);
+	PUSH_DATAf(push, mx);
+	PUSH_DATAf(push, my);
+
+	PUSH_DATAf(push, dx + (w * 2));
+	PUSH_DATAf(push, dy);
+	PUSH_DATAf(push, 0);
+	PUSH_DATAf(push, 1);
+	PUSH_DATAf(push, sx + (w * 2));
+	PUSH_DATAf(push, sy);
+	PUSH_DATAf(push, mx + (w * 2));
+	PUSH_DATAf(push, my);
 
 	BEGIN_NVC0(push, NVC0_3D(SCISSOR_HORIZ(0)), 2);
 	PUSH_DATA (push, ((dx + w) << 16) | dx);
 	PUSH_DATA (push, ((dy + h) << 16) | dy);
 	BEGIN_NVC0(push, NVC0_3D(VERTEX_BEGIN_GL), 1);
 	PUSH_DATA (push, NVC0_3D_VERTEX_BEGIN_GL_PRIMITIVE_TRIANGLES);
-	if (pNv->dev->chipset < 0x110) {
-		PUSH_VTX2s(push, sx, sy + (h * 2), mx, my + (h * 2), dx, dy + (h * 2));
-		PUSH_VTX2s(push, sx, sy, mx, my, dx, dy);
-		PUSH_VTX2s(push, sx + (w * 2), sy, mx + (w * 2), my, dx + (w * 2), dy);
-	} else {
-		BEGIN_NVC0(push, NVC0_3D(VERTEX_BUFFER_FIRST), 2);
-		PUSH_DATA (push, 0);
-		PUSH_DATA (push, 3);
-	}
+	BEGIN_NVC0(push, NVC0_3D(VERTEX_BUFFER_FIRST), 2);
+	PUSH_DATA (push, 0);
+	PUSH_DATA (push, 3);
 	BEGIN_NVC0(push, NVC0_3D(VERTEX_END_GL), 1);
 	PUSH_DATA (push, 0);
 }
@@ -957,6 +1087,8 @@ void
 NVC0EXADoneComposite(PixmapPtr pdpix)
 {
 	NVC0EXA_LOCALS(pdpix);
+	NVC0EXACompositeEnd(pNv);
+	nouveau_timing_end(pNv);
 	nouveau_pushbuf_bufctx(push, NULL);
 }
 
@@ -1012,7 +1144,7 @@ NVC0EXARectM2MF(NVPtr pNv, int w, int h, int cpp,
 		if (line_count > 2047)
 			line_count = 2047;
 
-		if (nouveau_pushbuf_space(push, 32, 0, 0) ||
+		if (nouveau_push_space(push, 32, 0, 0) ||
 		    nouveau_pushbuf_refn (push, refs, 2))
 			return FALSE;
 
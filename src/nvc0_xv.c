@@ -33,6 +33,7 @@
 
 #include "nv_include.h"
 #include "nvc0_accel.h"
+#include "nouveau_copy.h"
 
 extern Atom xvSyncToVBlank, xvSetDefaults;
 
@@ -74,6 +75,7 @@ nvc0_xv_image_put(ScrnInfoPtr pScrn,
 		{ dst, NOUVEAU_BO_VRAM | NOUVEAU_BO_WR },
 	};
 	struct nouveau_pushbuf *push = pNv->pushbuf;
+	uint32_t rt[8];
 	float X1, X2, Y1, Y2;
 	BoxPtr pbox;
 	int nbox;
@@ -81,27 +83,29 @@ nvc0_xv_image_put(ScrnInfoPtr pScrn,
 	if (!nvc0_xv_check_image_put(ppix))
 		return BadMatch;
 
+	nouveau_copy_sync(pNv, src);
+	nouveau_copy_sync(pNv, dst);
+
 	if (!PUSH_SPACE(push, 256))
 		return BadImplementation;
 
-	BEGIN_NVC0(push, NVC0_3D(RT_ADDRESS_HIGH(0)), 8);
-	PUSH_DATA (push, dst->offset >> 32);
-	PUSH_DATA (push, dst->offset);
-	PUSH_DATA (push, ppix->drawable.width);
-	PUSH_DATA (push, ppix->drawable.height);
+	rt[0] = dst->offset >> 32;
+	rt[1] = dst->offset;
+	rt[2] = ppix->drawable.width;
+	rt[3] = ppix->drawable.height;
 	switch (ppix->drawable.depth) {
-	case 32: PUSH_DATA (push, NV50_SURFACE_FORMAT_BGRA8_UNORM); break;
-	case 30: PUSH_DATA (push, NV50_SURFACE_FORMAT_RGB10_A2_UNORM); break;
-	case 24: PUSH_DATA (push, NV50_SURFACE_FORMAT_BGRX8_UNORM); break;
-	case 16: PUSH_DATA (push, NV50_SURFACE_FORMAT_B5G6R5_UNORM); break;
-	case 15: PUSH_DATA (push, NV50_SURFACE_FORMAT_BGR5_X1_UNORM); break;
+	case 32: rt[4] = NV50_SURFACE_FORMAT_BGRA8_UNORM; break;
+	case 30: rt[4] = NV50_SURFACE_FORMAT_RGB10_A2_UNORM; break;
+	case 24: rt[4] = NV50_SURFACE_FORMAT_BGRX8_UNORM; break;
+	case 16: rt[4] = NV50_SURFACE_FORMAT_B5G6R5_UNORM; break;
+	case 15: rt[4] = NV50_SURFACE_FORMAT_BGR5_X1_UNORM; break;
 	}
-	PUSH_DATA (push, dst->config.nvc0.tile_mode);
-	PUSH_DATA (push, 1);
-	PUSH_DATA (push, 0);
+	rt[5] = dst->config.nvc0.tile_mode;
+	rt[6] = 1;
+	rt[7] = 0;
+	nouveau_state_data(pNv, NVC0_3D(RT_ADDRESS_HIGH(0)), 8, rt);
 
-	BEGIN_NVC0(push, NVC0_3D(BLEND_ENABLE(0)), 1);
-	PUSH_DATA (push, 0);
+	nouveau_state_mthd(pNv, NVC0_3D(BLEND_ENABLE(0)), 0);
 
 	PUSH_DATAu(push, pNv->scratch, TIC_OFFSET, 16);
 	if (id == FOURCC_YV12 || id == FOURCC_I420) {
@@ -176,8 +180,7 @@ nvc0_xv_image_put(ScrnInfoPtr pScrn,
 	PUSH_DATA (push, 0x00000000);
 	PUSH_DATA (push, 0x00000000);
 
-	BEGIN_NVC0(push, NVC0_3D(SP_START_ID(5)), 1);
-	PUSH_DATA (push, PFP_NV12);
+	nouveau_state_mthd(pNv, NVC0_3D(SP_START_ID(5)), PFP_NV12);
 
 	BEGIN_NVC0(push, NVC0_3D(TSC_FLUSH), 1);
 	PUSH_DATA (push, 0);
@@ -185,6 +188,7 @@ nvc0_xv_image_put(ScrnInfoPtr pScrn,
 	PUSH_DATA (push, 0);
 	BEGIN_NVC0(push, NVC0_3D(TEX_CACHE_CTL), 1);
 	PUSH_DATA (push, 0);
+	nouveau_tex_cache_invalidate(pNv);
 
 	PUSH_DATAu(push, pNv->scratch, PVP_DATA, 11);
 	PUSH_DATAf(push, 1.0);
@@ -209,6 +213,7 @@ nvc0_xv_image_put(ScrnInfoPtr pScrn,
 	X2 = (float)(x2>>16)+(float)(x2&0xFFFF)/(float)0x10000;
 	Y2 = (float)(y2>>16)+(float)(y2&0xFFFF)/(float)0x10000;
 
+	nouveau_timing_begin(pNv, NOUVEAU_TIMING_XV);
 	pbox = REGION_RECTS(clipBoxes);
 	nbox = REGION_NUM_RECTS(clipBoxes);
 	while(nbox--) {
@@ -221,9 +226,11 @@ nvc0_xv_image_put(ScrnInfoPtr pScrn,
 		int sy1=pbox->y1;
 		int sy2=pbox->y2;
 
-		if (nouveau_pushbuf_space(push, 64, 0, 0) ||
-		    nouveau_pushbuf_refn (push, refs, 3))
+		if (nouveau_push_space(push, 64, 0, 0) ||
+		    nouveau_pushbuf_refn (push, refs, 3)) {
+			nouveau_timing_end(pNv);
 			return BadImplementation;
+		}
 
 		if (pNv->dev->chipset >= 0x110) {
 			BEGIN_NVC0(push, NVC0_3D(CB_SIZE), 3);
@@ -282,6 +289,7 @@ nvc0_xv_image_put(ScrnInfoPtr pScrn,
 		pbox++;
 	}
 
+	nouveau_timing_end(pNv);
 	PUSH_KICK(push);
 	return Success;
 }
@@ -291,7 +299,7 @@ nvc0_xv_csc_update(NVPtr pNv, float yco, float *off, float *uco, float *vco)
 {
 	struct nouveau_pushbuf *push = pNv->pushbuf;
 
-	if (nouveau_pushbuf_space(push, 64, 0, 0) ||
+	if (nouveau_push_space(push, 64, 0, 0) ||
 	    nouveau_pushbuf_refn (push, &(struct nouveau_pushbuf_refn) {
 					pNv->scratch, NOUVEAU_BO_WR |
 					NOUVEAU_BO_VRAM }, 1))
@@ -0,0 +1,704 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Convolution filters on NV50 and NVC0, against pixman.  The mock GPU
+ * doesn't run the 3D engine, so after the driver has emitted each
+ * composite, the fragment program it left in the scratch buffer is run
+ * here once per destination pixel, with the constants, transforms,
+ * textures and blend state it set up, and the result written to the
+ * destination as the hardware would.
+ *
+ * - small kernels in one pass: with every repeat, scaled and rotated, with
+ *   negative weights, through a mask and into A8.  Transforms are in
+ *   multiples of 1/16 so no sample lands closer to a texel's edge than the
+ *   hardware can tell, unless on it.
+ * - large separable kernels in two passes, by nouveau_render.c
+ * - large kernels that can't be split, an XRGB source with no repeat and
+ *   a kernel that can overshoot under a mask, left to the server
+ * - a kernel of the same shape as the last not uploading its program again
+ * - NVC0, which has no such program, leaving them all to the server
+ *   without Composite being wrapped
+ */
+
+#include <pixman.h>
+
+#include "mock.h"
+#include "nv50_accel.h"
+
+#define W 40
+#define H 32
+
+/* what the hardware may round differently from pixman, in 1/255ths */
+#define TOLERANCE 2
+
+static struct {
+	Bool (*PrepareComposite)(int, PicturePtr, PicturePtr, PicturePtr,
+				 PixmapPtr, PixmapPtr, PixmapPtr);
+	void (*Composite)(PixmapPtr, int, int, int, int, int, int, int, int);
+	void (*DoneComposite)(PixmapPtr);
+	PicturePtr pict[3];
+	PixmapPtr pix[3];
+	int rect[8];
+} real;
+
+struct image {
+	PixmapPtr ppix;
+	PicturePtr ppict;
+	pixman_image_t *pimg;
+	uint32_t *data;
+	int cpp, stride;
+};
+
+enum kernel {
+	IDENTITY,	/* a 1 in the middle */
+	RANDOM,		/* random, some negative, adding up to one */
+	BOX,
+	GAUSSIAN,
+	SHARPEN,	/* a Gaussian row times a column with negative lobes */
+	MIXED,		/* a row with negative lobes times a Gaussian column */
+};
+
+struct conv {
+	const char *name;
+	CARD8 op;
+	CARD32 src, dst;
+	int repeat;
+	Bool mask, smooth;
+	double m[2][3];		/* the source transform */
+	enum kernel kernel;
+	int kw, kh;
+	int passes;		/* 0 for left to the server */
+};
+
+static Bool
+prepare_composite(int op, PicturePtr pSrc, PicturePtr pMask,
+		  PicturePtr pDst, PixmapPtr pspix, PixmapPtr pmpix,
+		  PixmapPtr pdpix)
+{
+	real.pict[0] = pSrc;
+	real.pict[1] = pMask;
+	real.pict[2] = pDst;
+	real.pix[0] = pspix;
+	real.pix[1] = pmpix;
+	real.pix[2] = pdpix;
+	return real.PrepareComposite(op, pSrc, pMask, pDst, pspix, pmpix,
+				     pdpix);
+}
+
+static Bool
+wrap(int repeat, int *x, int size)
+{
+	switch (repeat) {
+	case RepeatNone:
+		return *x >= 0 && *x < size;
+	case RepeatPad:
+		*x = min(max(*x, 0), size - 1);
+		return TRUE;
+	case RepeatReflect:
+		*x %= 2 * size;
+		if (*x < 0)
+			*x += 2 * size;
+		if (*x >= size)
+			*x = 2 * size - 1 - *x;
+		return TRUE;
+	default:
+		*x %= size;
+		if (*x < 0)
+			*x += size;
+		return TRUE;
+	}
+}
+
+/* A nearest fetch of texture unit 'unit', at normalised coordinates */
+static void
+texel(NVPtr pNv, int unit, float s, float t, float *c)
+{
+	PixmapPtr ppix = real.pix[unit];
+	PicturePtr ppict = real.pict[unit];
+	const uint32_t *tic = (const uint32_t *)((uint8_t *)pNv->scratch->map +
+						 TIC_OFFSET + unit * 32);
+	struct nouveau_bo *bo;
+	int x, y, pitch;
+	uint32_t p;
+
+	c[0] = c[1] = c[2] = c[3] = 0.0f;
+	if (!ppix) {
+		mock_error("texture unit %d has no pixmap", unit);
+		return;
+	}
+
+	bo = nouveau_pixmap_bo(ppix);
+	if (tic[1] != (uint32_t)bo->offset) {
+		mock_error("texture unit %d isn't its picture", unit);
+		return;
+	}
+
+	x = floorf(s * ppix->drawable.width);
+	y = floorf(t * ppix->drawable.height);
+	if (!wrap(ppict->repeat ? ppict->repeatType : RepeatNone, &x,
+		  ppix->drawable.width) ||
+	    !wrap(ppict->repeat ? ppict->repeatType : RepeatNone, &y,
+		  ppix->drawable.height))
+		return;
+
+	nouveau_bo_map(bo, NOUVEAU_BO_RD, pNv->client);
+	pitch = exaGetPixmapPitch(ppix);
+	if (ppict->format == PICT_a8) {
+		c[3] = *mock_pixel(bo, pitch, 1, x, y) / 255.0f;
+		return;
+	}
+
+	memcpy(&p, mock_pixel(bo, pitch, 4, x, y), 4);
+	c[0] = ((p >> 16) & 0xff) / 255.0f;
+	c[1] = ((p >> 8) & 0xff) / 255.0f;
+	c[2] = (p & 0xff) / 255.0f;
+	c[3] = ppict->format == PICT_x8r8g8b8 ? 1.0f : (p >> 24) / 255.0f;
+}
+
+/* Run the fragment program at 'code' for a fragment with interpolants v[],
+ * leaving $r0-$r3 in out.  Only what the driver's programs use is known.
+ */
+static void
+run(NVPtr pNv, const uint32_t *code, const float *v, float *out)
+{
+	const float *c0 = (const float *)((uint8_t *)pNv->scratch->map +
+					  PFP_DATA);
+	unsigned temps = mock_3d_state(pNv->pushbuf,
+				       NV50_3D_FP_REG_ALLOC_TEMP);
+	float r[128] = { 0.0f }, c[4];
+	int pc, i, n;
+
+	for (pc = 0; pc < 0x800 / 4; pc += code[pc] & 1 ? 2 : 1) {
+		uint32_t w0 = code[pc], w1 = w0 & 1 ? code[pc + 1] : 0;
+		unsigned m = w0 & 1 ? 0x7f : 0x3f;
+		unsigned d = (w0 >> 2) & m, s = (w0 >> 9) & m;
+		unsigned b = (w0 >> 16) & m;
+		float src2 = w0 & 0x00800000 ? c0[b] : r[b];
+
+		/* the highest register it touches */
+		n = max(d, s);
+		if ((w0 >> 28) == 0xf)
+			n = d + 3;
+		else
+		if ((w0 >> 28) >= 0xb && !(w0 & 0x00800000))
+			n = max(n, b);
+		if (n >= temps)
+			mock_error("$r%d used, %u allocated", n, temps);
+
+		switch (w0 >> 28) {
+		case 0x1:
+			r[d] = r[s];
+			break;
+		case 0x8:
+			r[d] = v[b & 0x3f];
+			if (w0 & 0x02000000)
+				r[d] *= r[s];
+			break;
+		case 0x9:
+			r[d] = 1.0f / r[s];
+			break;
+		case 0xb:
+			r[d] = r[s] + src2;
+			break;
+		case 0xc:
+			r[d] = r[s] * src2;
+			break;
+		case 0xe:
+			r[d] = r[s] * src2 + r[w0 & 1 ? (w1 >> 14) & 0x7f : d];
+			break;
+		case 0xf:
+			texel(pNv, s, r[d], r[d + 1], c);
+			n = (w0 >> 25 & 3) | (w1 >> 12 & 0xc);
+			for (i = 0; i < 4; i++) {
+				if (n & (1 << i))
+					r[d++] = c[i];
+			}
+			break;
+		default:
+			mock_error("fragment program instruction 0x%08x", w0);
+			return;
+		}
+
+		if (w1 & 1) {
+			memcpy(out, r, 4 * sizeof(*r));
+			return;
+		}
+	}
+
+	mock_error("fragment program doesn't exit");
+}
+
+/* The VP's result for texture unit 'unit' at (x, y) */
+static void
+coord(NVPtr pNv, int unit, float x, float y, float *st)
+{
+	const float *m = (const float *)((uint8_t *)pNv->scratch->map +
+					 PVP_DATA) + unit * 11;
+	float w = 1.0f;
+
+	if (mock_3d_state(pNv->pushbuf, NV50_3D_VP_START_ID) == PVP_XFRM) {
+		float tx = m[0] * x + m[1] * y + m[2];
+		float ty = m[3] * x + m[4] * y + m[5];
+
+		w = m[6] * x + m[7] * y + m[8];
+		x = tx;
+		y = ty;
+	}
+
+	st[0] = x / w * m[9];
+	st[1] = y / w * m[10];
+}
+
+static float
+factor(uint32_t f, const float *s, const float *d, int i)
+{
+	switch (f) {
+	case NV50_BLEND_FACTOR_ZERO:                return 0.0f;
+	case NV50_BLEND_FACTOR_ONE:                 return 1.0f;
+	case NV50_BLEND_FACTOR_SRC_COLOR:           return s[i];
+	case NV50_BLEND_FACTOR_ONE_MINUS_SRC_COLOR: return 1.0f - s[i];
+	case NV50_BLEND_FACTOR_SRC_ALPHA:           return s[3];
+	case NV50_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA: return 1.0f - s[3];
+	case NV50_BLEND_FACTOR_DST_ALPHA:           return d[3];
+	case NV50_BLEND_FACTOR_ONE_MINUS_DST_ALPHA: return 1.0f - d[3];
+	default:
+		mock_error("blend factor 0x%x", f);
+		return 0.0f;
+	}
+}
+
+/* Draw what the driver just emitted, as the 3D engine would */
+static void
+draw(NVPtr pNv, int sx, int sy, int mx, int my, int dx, int dy, int w, int h)
+{
+	struct nouveau_pushbuf *push = pNv->pushbuf;
+	PixmapPtr pdpix = real.pix[2];
+	struct nouveau_bo *bo = nouveau_pixmap_bo(pdpix);
+	Bool a8 = real.pict[2]->format == PICT_a8;
+	int pitch = exaGetPixmapPitch(pdpix), cpp = a8 ? 1 : 4;
+	Bool blend = mock_3d_state(push, NV50_3D_BLEND_ENABLE(0));
+	static const int shift[4] = { 16, 8, 0, 24 };
+	uint32_t sf[2], df[2], p;
+	const uint32_t *code;
+	uint64_t address;
+	int x, y, i;
+
+	nouveau_bo_map(pNv->scratch, NOUVEAU_BO_RD, pNv->client);
+	address = (uint64_t)mock_3d_state(push, NV50_3D_FP_ADDRESS_HIGH) << 32 |
+		  mock_3d_state(push, NV50_3D_FP_ADDRESS_LOW);
+	address += mock_3d_state(push, NV50_3D_FP_START_ID);
+	if (address < pNv->scratch->offset ||
+	    address + 0x800 > pNv->scratch->offset + pNv->scratch->size) {
+		mock_error("fragment program outside the scratch buffer");
+		return;
+	}
+	code = (const uint32_t *)((uint8_t *)pNv->scratch->map +
+				  (address - pNv->scratch->offset));
+
+	if (mock_3d_state(push, NV50_3D_RT_ADDRESS_LOW(0)) !=
+	    (uint32_t)bo->offset) {
+		mock_error("render target isn't the destination");
+		return;
+	}
+
+	sf[0] = mock_3d_state(push, NV50_3D_BLEND_FUNC_SRC_RGB);
+	df[0] = mock_3d_state(push, NV50_3D_BLEND_FUNC_DST_RGB);
+	sf[1] = mock_3d_state(push, NV50_3D_BLEND_FUNC_SRC_ALPHA);
+	df[1] = mock_3d_state(push, NV50_3D_BLEND_FUNC_DST_ALPHA);
+
+	nouveau_bo_map(bo, NOUVEAU_BO_RDWR, pNv->client);
+	for (y = max(dy, 0); y < min(dy + h, pdpix->drawable.height); y++) {
+		for (x = max(dx, 0); x < min(dx + w, pdpix->drawable.width);
+		     x++) {
+			float v[5] = { 1.0f }, s[4], d[4];
+			uint8_t *pixel = mock_pixel(bo, pitch, cpp, x, y);
+
+			coord(pNv, 0, sx + (x - dx) + 0.5f,
+			      sy + (y - dy) + 0.5f, &v[1]);
+			coord(pNv, 1, mx + (x - dx) + 0.5f,
+			      my + (y - dy) + 0.5f, &v[3]);
+			run(pNv, code, v, s);
+
+			if (a8) {
+				MOCK_CHECK(s[0] == s[3]);
+				d[0] = d[1] = d[2] = d[3] = *pixel / 255.0f;
+			} else {
+				memcpy(&p, pixel, 4);
+				d[0] = ((p >> 16) & 0xff) / 255.0f;
+				d[1] = ((p >> 8) & 0xff) / 255.0f;
+				d[2] = (p & 0xff) / 255.0f;
+				d[3] = (p >> 24) / 255.0f;
+			}
+
+			/* the fragment is clamped to the UNORM target */
+			for (i = 0; i < 4; i++)
+				s[i] = min(max(s[i], 0.0f), 1.0f);
+
+			for (p = 0, i = 0; i < 4; i++) {
+				float c = s[i];
+
+				if (blend) {
+					c = c * factor(sf[i / 3], s, d, i) +
+					    d[i] * factor(df[i / 3], s, d, i);
+				}
+				c = min(max(c, 0.0f), 1.0f);
+				p |= (uint32_t)lrintf(c * 255.0f) << shift[i];
+			}
+
+			if (a8)
+				*pixel = p >> 24;
+			else
+				memcpy(pixel, &p, 4);
+		}
+	}
+}
+
+/* The rect is checked once the draw is done, as the quads primitive it's
+ * in stays open until then.
+ */
+static void
+composite(PixmapPtr pdpix, int sx, int sy, int mx, int my, int dx, int dy,
+	  int w, int h)
+{
+	real.Composite(pdpix, sx, sy, mx, my, dx, dy, w, h);
+	real.rect[0] = sx;
+	real.rect[1] = sy;
+	real.rect[2] = mx;
+	real.rect[3] = my;
+	real.rect[4] = dx;
+	real.rect[5] = dy;
+	real.rect[6] = w;
+	real.rect[7] = h;
+}
+
+static void
+done_composite(PixmapPtr pdpix)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pdpix->drawable.pScreen));
+	const int *r = real.rect;
+
+	real.DoneComposite(pdpix);
+
+	nouveau_pushbuf_kick(pNv->pushbuf, pNv->pushbuf->channel);
+	mock_finish();
+	draw(pNv, r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7]);
+}
+
+/* A pixmap with random contents, or a smooth pattern, and its picture,
+ * and a pixman image of a copy of it.
+ */
+static void
+image_new(struct image *img, ScreenPtr pScreen, int w, int h, CARD32 format,
+	  int repeat, Bool smooth)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	int depth = format == PICT_a8 ? 8 : format == PICT_a8r8g8b8 ? 32 : 24;
+	XID attr = repeat;
+	struct nouveau_bo *bo;
+	int x, y, i, error;
+
+	img->cpp = depth == 8 ? 1 : 4;
+	img->stride = (w * img->cpp + 3) & ~3;
+	img->data = calloc(h, img->stride);
+	img->ppix = mock_pixmap(pScreen, w, h, depth);
+	img->ppict = CreatePicture(0, &img->ppix->drawable,
+				   PictureMatchFormat(pScreen, depth, format),
+				   CPRepeat, &attr, serverClient, &error);
+	img->pimg = pixman_image_create_bits(format == PICT_a8 ? PIXMAN_a8 :
+					     format == PICT_a8r8g8b8 ?
+					     PIXMAN_a8r8g8b8 : PIXMAN_x8r8g8b8,
+					     w, h, img->data, img->stride);
+	pixman_image_set_repeat(img->pimg, repeat);
+
+	bo = nouveau_pixmap_bo(img->ppix);
+	nouveau_bo_map(bo, NOUVEAU_BO_WR, pNv->client);
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			uint8_t *p = (uint8_t *)img->data + y * img->stride +
+				     x * img->cpp;
+			uint32_t v = 0, a = smooth ? 255 : rand() % 256;
+
+			for (i = 0; i < 3; i++) {
+				int c = smooth ? 128 + 100 * sin(x * 0.05 +
+							y * 0.04 + i) :
+					rand() % (a + 1);
+
+				v |= (uint32_t)c << (i * 8);
+			}
+			v |= format == PICT_x8r8g8b8 ? 0xff000000 : a << 24;
+
+			if (img->cpp == 1)
+				*p = a;
+			else
+				memcpy(p, &v, 4);
+			memcpy(mock_pixel(bo, exaGetPixmapPitch(img->ppix),
+					  img->cpp, x, y), p, img->cpp);
+		}
+	}
+}
+
+static void
+image_free(struct image *img)
+{
+	FreePicture(img->ppict, 0);
+	mock_pixmap_free(img->ppix);
+	pixman_image_unref(img->pimg);
+	free(img->data);
+}
+
+static void
+kernel(enum kernel k, int kw, int kh, xFixed *params)
+{
+	double row[64], col[64], sum = 0.0;
+	xFixed *centre = &params[2 + kh / 2 * kw + kw / 2], total = 0;
+	int i, j;
+
+	params[0] = IntToxFixed(kw);
+	params[1] = IntToxFixed(kh);
+
+	for (i = 0; i < max(kw, kh); i++) {
+		double g = exp(-(i - (max(kw, kh) - 1) / 2.0) *
+			       (i - (max(kw, kh) - 1) / 2.0) / 8.0);
+
+		row[i] = col[i] = g;
+		if (k == SHARPEN && i % 4 == 1)
+			col[i] = -g / 2;
+		if (k == MIXED && i % 4 == 1)
+			row[i] = -g / 2;
+	}
+
+	for (j = 0; j < kh; j++) {
+		for (i = 0; i < kw; i++) {
+			switch (k) {
+			case IDENTITY:
+				params[2 + j * kw + i] = i == kw / 2 &&
+					j == kh / 2 ? xFixed1 : 0;
+				break;
+			case RANDOM:
+				/* none zero, as that would skip the tap */
+				params[2 + j * kw + i] =
+					xDoubleToFixed((rand() % 600 - 299.5) /
+						       1000.0 / kh);
+				total += params[2 + j * kw + i];
+				break;
+			case BOX:
+				params[2 + j * kw + i] = xFixed1 / (kw * kh);
+				break;
+			default:
+				sum += row[i] * col[j];
+				break;
+			}
+		}
+	}
+
+	if (k == RANDOM)
+		*centre += xFixed1 - total;
+
+	for (j = 0; sum != 0.0 && j < kh; j++) {
+		for (i = 0; i < kw; i++)
+			params[2 + j * kw + i] =
+				xDoubleToFixed(row[i] * col[j] / sum);
+	}
+}
+
+/* Composite a W x H rectangle with 'c', on the GPU and with pixman, and
+ * compare.  Returns how many pixels differ too much.
+ */
+static int
+test_conv(ScreenPtr pScreen, const struct conv *c, xFixed *params)
+{
+	PictureScreenPtr ps = GetPictureScreen(pScreen);
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	unsigned composites = mock_render.composites;
+	unsigned fallbacks = mock_render.fallbacks;
+	struct image src, mask, dst;
+	PictTransform t = {{{ 0 }}};
+	char what[80];
+	int i, j, bad = 0;
+
+	sprintf(what, "NV%02X %s", pNv->dev->chipset, c->name);
+
+	image_new(&src, pScreen, 2 * W, 2 * H, c->src, c->repeat, c->smooth);
+	image_new(&dst, pScreen, W + 8, H + 8, c->dst, RepeatNone, FALSE);
+	if (c->mask)
+		image_new(&mask, pScreen, W + 4, H + 4, PICT_a8, RepeatNone,
+			  FALSE);
+
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < 3; j++)
+			t.matrix[i][j] = xDoubleToFixed(c->m[i][j]);
+	}
+	t.matrix[2][2] = xFixed1;
+	SetPictureTransform(src.ppict, &t);
+	pixman_image_set_transform(src.pimg, (pixman_transform_t *)&t);
+
+	kernel(c->kernel, c->kw, c->kh, params);
+	SetPictureFilter(src.ppict, FilterConvolution,
+			 strlen(FilterConvolution), params,
+			 2 + c->kw * c->kh);
+	pixman_image_set_filter(src.pimg, PIXMAN_FILTER_CONVOLUTION, params,
+				2 + c->kw * c->kh);
+
+	ps->Composite(c->op, src.ppict, c->mask ? mask.ppict : NULL,
+		      dst.ppict, 3, 5, 2, 1, 4, 6, W, H);
+	pixman_image_composite32(c->op, src.pimg, c->mask ? mask.pimg : NULL,
+				 dst.pimg, 3, 5, 2, 1, 4, 6, W, H);
+
+	if (!c->passes) {
+		MOCK_CHECK(mock_render.composites == composites + 1);
+		MOCK_CHECK(mock_render.fallbacks == fallbacks + 1);
+		goto out;
+	}
+
+	if (mock_render.composites != composites + c->passes ||
+	    mock_render.fallbacks != fallbacks) {
+		mock_error("%s: %u composites, %u fallbacks", what,
+			   mock_render.composites - composites,
+			   mock_render.fallbacks - fallbacks);
+		goto out;
+	}
+
+	nouveau_bo_map(nouveau_pixmap_bo(dst.ppix), NOUVEAU_BO_RD,
+		       pNv->client);
+	for (j = 0; j < H + 8; j++) {
+		for (i = 0; i < W + 8; i++) {
+			uint8_t *want = (uint8_t *)dst.data + j * dst.stride +
+					i * dst.cpp;
+			uint8_t *got = mock_pixel(nouveau_pixmap_bo(dst.ppix),
+						  exaGetPixmapPitch(dst.ppix),
+						  dst.cpp, i, j);
+			int k;
+
+			for (k = 0; k < dst.cpp; k++) {
+				if (abs(got[k] - want[k]) <= TOLERANCE)
+					continue;
+				if (bad++ < 4)
+					mock_error("%s: (%d,%d)[%d] is %d, "
+						   "pixman has %d", what, i,
+						   j, k, got[k], want[k]);
+			}
+		}
+	}
+
+out:
+	image_free(&src);
+	image_free(&dst);
+	if (c->mask)
+		image_free(&mask);
+	return bad;
+}
+
+static const struct conv
+convs[] = {
+	{ "3x3 identity", PictOpSrc, PICT_a8r8g8b8, PICT_a8r8g8b8,
+	  RepeatNone, FALSE, FALSE, {{ 1, 0, 0 }, { 0, 1, 0 }},
+	  IDENTITY, 3, 3, 1 },
+	{ "5x5 negative weights", PictOpOver, PICT_a8r8g8b8, PICT_a8r8g8b8,
+	  RepeatNormal, FALSE, FALSE, {{ 1, 0, -30 }, { 0, 1, 20 }},
+	  RANDOM, 5, 5, 1 },
+	{ "5x5 box, masked", PictOpOver, PICT_a8r8g8b8, PICT_a8r8g8b8,
+	  RepeatNormal, TRUE, FALSE, {{ 1, 0, 0 }, { 0, 1, 0 }},
+	  BOX, 5, 5, 1 },
+	{ "4x4 downscaled, on texel edges", PictOpSrc, PICT_x8r8g8b8,
+	  PICT_a8r8g8b8, RepeatPad, FALSE, FALSE,
+	  {{ 2, 0, 0.5 }, { 0, 2, 0.5 }}, RANDOM, 4, 4, 1 },
+	{ "7x7 rotated", PictOpOver, PICT_a8r8g8b8, PICT_a8r8g8b8,
+	  RepeatReflect, FALSE, TRUE,
+	  {{ 0.875, -0.5, 7.25 }, { 0.5, 0.875, -9.125 }}, GAUSSIAN, 7, 7, 1 },
+	{ "3x5 into A8, masked", PictOpAdd, PICT_a8, PICT_a8, RepeatPad,
+	  TRUE, FALSE, {{ 1, 0, 0 }, { 0, 1, 0 }}, BOX, 3, 5, 1 },
+	{ "15x15 Gaussian, masked", PictOpOver, PICT_a8r8g8b8,
+	  PICT_a8r8g8b8, RepeatNormal, TRUE, FALSE,
+	  {{ 0.5, 0, 3 }, { 0, 0.5, 2 }}, GAUSSIAN, 15, 15, 2 },
+	{ "9x13 sharpen", PictOpOver, PICT_a8r8g8b8, PICT_a8r8g8b8,
+	  RepeatPad, FALSE, FALSE, {{ 1.5, 0, 0 }, { 0, 0.75, 1 }},
+	  SHARPEN, 9, 13, 2 },
+	{ "15x15 random", PictOpSrc, PICT_a8r8g8b8, PICT_a8r8g8b8,
+	  RepeatNormal, FALSE, FALSE, {{ 1, 0, 0 }, { 0, 1, 0 }},
+	  RANDOM, 15, 15, 0 },
+	{ "9x9 mixed-sign row", PictOpSrc, PICT_a8r8g8b8, PICT_a8r8g8b8,
+	  RepeatNormal, FALSE, FALSE, {{ 1, 0, 0 }, { 0, 1, 0 }},
+	  MIXED, 9, 9, 0 },
+	{ "XRGB without repeat", PictOpOver, PICT_x8r8g8b8, PICT_a8r8g8b8,
+	  RepeatNone, FALSE, FALSE, {{ 1, 0, 0 }, { 0, 1, 0 }},
+	  BOX, 3, 3, 0 },
+	{ "5x5 negative weights, masked", PictOpOver, PICT_a8r8g8b8,
+	  PICT_a8r8g8b8, RepeatNormal, TRUE, FALSE,
+	  {{ 1, 0, 0 }, { 0, 1, 0 }}, RANDOM, 5, 5, 0 },
+};
+
+static void
+test_chipset(uint32_t chipset)
+{
+	ScreenPtr pScreen = mock_screen(chipset, NULL);
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	xFixed params[2 + 15 * 15];
+	struct mock_stats before, after;
+	struct conv c;
+	uint64_t words;
+	int i;
+
+	real.PrepareComposite = mock_exa->PrepareComposite;
+	mock_exa->PrepareComposite = prepare_composite;
+	real.Composite = mock_exa->Composite;
+	mock_exa->Composite = composite;
+	real.DoneComposite = mock_exa->DoneComposite;
+	mock_exa->DoneComposite = done_composite;
+	mock_render.exa = TRUE;
+	MOCK_CHECK(!pNv->render == (chipset >= 0xc0));
+
+	srand(chipset);
+	for (i = 0; i < ARRAY_SIZE(convs); i++) {
+		c = convs[i];
+		if (chipset >= 0xc0)
+			c.passes = 0;
+		test_conv(pScreen, &c, params);
+	}
+
+	if (chipset < 0xc0) {
+		/* a second kernel of the same shape reuses the program */
+		c = convs[1];
+		mock_pushbuf_stats(pNv->pushbuf, &before);
+		test_conv(pScreen, &c, params);
+		mock_pushbuf_stats(pNv->pushbuf, &after);
+		words = after.words - before.words;
+
+		mock_pushbuf_stats(pNv->pushbuf, &before);
+		test_conv(pScreen, &c, params);
+		mock_pushbuf_stats(pNv->pushbuf, &after);
+		MOCK_CHECK(after.words - before.words + 25 * 8 < words);
+	}
+
+	mock_render.exa = FALSE;
+	mock_screen_fini(pScreen);
+}
+
+int
+main(void)
+{
+	test_chipset(0x50);
+	test_chipset(0xc0);
+
+	if (mock_errors)
+		fprintf(stderr, "convolve: %u errors\n", mock_errors);
+	return mock_errors ? 1 : 0;
+}
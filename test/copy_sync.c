@@ -0,0 +1,370 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Ordering between the copy engine channel and the main channel on
+ * Kepler, see nouveau_copy.c.  The mock GPU runs whichever channel the
+ * test prefers first, for as long as it can, so a missing or misplaced
+ * semaphore shows up as the wrong pixels:
+ *
+ * - an upload on the copy engine, then a 2D copy from it on the main
+ *   channel, which runs first
+ * - a solid fill on the main channel, then a download of it on the copy
+ *   engine, which runs first
+ * - the same with no room for a semaphore, falling back to CPU waits
+ * - an upload and a download big enough to be split between both copy
+ *   engines, and the same with no room on the second one
+ *
+ * all with AsyncUTSDFS left at its default, which is on wherever there
+ * are semaphores and off on Tesla, where there aren't.  And to show the
+ * test can tell, the first two without the semaphores.
+ */
+
+#include "mock.h"
+#include "nv_const.h"
+
+#define W 128
+#define H 64
+
+static uint32_t image[H][W];
+
+static void
+pattern(uint32_t seed)
+{
+	int x, y;
+
+	for (y = 0; y < H; y++) {
+		for (x = 0; x < W; x++)
+			image[y][x] = (x * seed) ^ (y << 8) ^ (seed << 16);
+	}
+}
+
+/* Send transfers to the copy engine, whatever they'd cost */
+static void
+prefer_ce(NVPtr pNv)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		pNv->xfer_rate[NOUVEAU_XFER_MAIN][i] = 1;
+		pNv->xfer_rate[NOUVEAU_XFER_CE][i] = 1 << 20;
+	}
+}
+
+static void
+upload(NVPtr pNv, PixmapPtr ppix)
+{
+	prefer_ce(pNv);
+	MOCK_CHECK(mock_exa->UploadToScreen(ppix, 0, 0, W, H, (char *)image,
+					    sizeof(image[0])));
+	MOCK_CHECK(pNv->xfer_engine == NOUVEAU_XFER_CE);
+}
+
+static void
+copy(PixmapPtr src, PixmapPtr dst)
+{
+	MOCK_CHECK(mock_exa->PrepareCopy(src, dst, 1, 1, GXcopy, ~0));
+	mock_exa->Copy(dst, 0, 0, 0, 0, W, H);
+	mock_exa->DoneCopy(dst);
+}
+
+/* Wait for the main channel to be done with a pixmap, as the CPU would,
+ * letting it run ahead of the copy engine.  Only what the driver has
+ * submitted itself runs.
+ */
+static void
+wait_main(NVPtr pNv, PixmapPtr ppix)
+{
+	mock_prefer(pNv->channel);
+	nouveau_bo_wait(nouveau_pixmap_bo(ppix), NOUVEAU_BO_RDWR, pNv->client);
+}
+
+/* How many pixels differ from image[] */
+static int
+compare(PixmapPtr ppix)
+{
+	int x, y, bad = 0;
+
+	for (y = 0; y < H; y++) {
+		for (x = 0; x < W; x++) {
+			uint32_t v;
+
+			memcpy(&v, mock_pixel(nouveau_pixmap_bo(ppix),
+					      exaGetPixmapPitch(ppix), 4, x, y),
+			       4);
+			if ((v & 0x00ffffff) != (image[y][x] & 0x00ffffff))
+				bad++;
+		}
+	}
+
+	return bad;
+}
+
+static int
+compare_download(NVPtr pNv, PixmapPtr ppix)
+{
+	static uint32_t out[H][W];
+	int x, y, bad = 0;
+
+	prefer_ce(pNv);
+	memset(out, 0, sizeof(out));
+	MOCK_CHECK(mock_exa->DownloadFromScreen(ppix, 0, 0, W, H, (char *)out,
+						sizeof(out[0])));
+	MOCK_CHECK(pNv->xfer_engine == NOUVEAU_XFER_CE);
+
+	for (y = 0; y < H; y++) {
+		for (x = 0; x < W; x++) {
+			if ((out[y][x] & 0x00ffffff) !=
+			    (image[y][x] & 0x00ffffff))
+				bad++;
+		}
+	}
+
+	return bad;
+}
+
+/* Returns the number of wrong pixels over both orderings */
+static int
+test(Bool sema)
+{
+	ScreenPtr pScreen;
+	NVPtr pNv;
+	PixmapPtr a, b;
+	uint32_t seq;
+	int bad = 0, x, y;
+
+	pScreen = mock_screen(0xe4, NULL);
+	pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	MOCK_CHECK(pNv->ce_rect && pNv->ce_sema && pNv->ce_enabled);
+	if (!sema)
+		nouveau_bo_ref(NULL, &pNv->ce_sema);
+
+	a = mock_pixmap(pScreen, W, H, 24);
+	b = mock_pixmap(pScreen, W, H, 24);
+	MOCK_CHECK(a && b);
+	if (!a || !b)
+		goto out;
+
+	/* main channel reads what the copy engine wrote */
+	pattern(3);
+	upload(pNv, a);
+	copy(a, b);
+	wait_main(pNv, b);
+	bad += compare(b);
+
+	/* copy engine reads what the main channel wrote */
+	MOCK_CHECK(mock_exa->PrepareSolid(a, GXcopy, ~0, 0x00445566));
+	mock_exa->Solid(a, 0, 0, W, H);
+	mock_exa->DoneSolid(a);
+	for (y = 0; y < H; y++) {
+		for (x = 0; x < W; x++)
+			image[y][x] = 0x00445566;
+	}
+	mock_prefer(pNv->ce_channel);
+	bad += compare_download(pNv, a);
+
+	if (!sema)
+		goto out;
+
+	/* no room for the main channel's acquire */
+	pattern(5);
+	upload(pNv, a);
+	seq = pNv->ce_acquired;
+	mock_fail_space(pNv->pushbuf, 0, 1);
+	copy(a, b);
+	MOCK_CHECK(pNv->ce_acquired == seq);
+	wait_main(pNv, b);
+	bad += compare(b);
+
+	/* no room for the copy engine's release, after the transfer */
+	pattern(7);
+	seq = pNv->ce_seq;
+	mock_fail_space(pNv->ce_pushbuf, 1, 1);
+	upload(pNv, a);
+	MOCK_CHECK(pNv->ce_seq == seq);
+	copy(a, b);
+	wait_main(pNv, b);
+	bad += compare(b);
+
+	/* no room for the main channel's release */
+	MOCK_CHECK(mock_exa->PrepareSolid(a, GXcopy, ~0, 0x00112233));
+	mock_exa->Solid(a, 0, 0, W, H);
+	mock_exa->DoneSolid(a);
+	for (y = 0; y < H; y++) {
+		for (x = 0; x < W; x++)
+			image[y][x] = 0x00112233;
+	}
+	seq = pNv->ce_main_seq;
+	mock_fail_space(pNv->pushbuf, 0, 1);
+	mock_prefer(pNv->ce_channel);
+	bad += compare_download(pNv, a);
+	MOCK_CHECK(pNv->ce_main_seq == seq);
+
+out:
+	if (a)
+		mock_pixmap_free(a);
+	if (b)
+		mock_pixmap_free(b);
+	mock_screen_fini(pScreen);
+	return bad;
+}
+
+/* Big enough for nouveau_copy_rect() to split, small enough to be one
+ * chunk through the scratch buffers
+ */
+#define SW 512
+#define SH 256
+
+static uint32_t split_in[SH][SW], split_out[SH][SW];
+
+static int
+split_upload(NVPtr pNv, PixmapPtr a, PixmapPtr b, uint32_t seed)
+{
+	int x, y, bad = 0;
+
+	for (y = 0; y < SH; y++) {
+		for (x = 0; x < SW; x++)
+			split_in[y][x] = (x * seed) ^ (y << 12);
+	}
+
+	/* the copy engine waiting on the second one, then the main
+	 * channel reading what both wrote
+	 */
+	prefer_ce(pNv);
+	mock_prefer(pNv->ce_channel);
+	MOCK_CHECK(mock_exa->UploadToScreen(a, 0, 0, SW, SH,
+					    (char *)split_in,
+					    sizeof(split_in[0])));
+	MOCK_CHECK(pNv->xfer_engine == NOUVEAU_XFER_CE);
+	MOCK_CHECK(mock_exa->PrepareCopy(a, b, 1, 1, GXcopy, ~0));
+	mock_exa->Copy(b, 0, 0, 0, 0, SW, SH);
+	mock_exa->DoneCopy(b);
+
+	/* and back through both, waited on by the CPU */
+	prefer_ce(pNv);
+	mock_prefer(pNv->channel);
+	memset(split_out, 0, sizeof(split_out));
+	MOCK_CHECK(mock_exa->DownloadFromScreen(b, 0, 0, SW, SH,
+						(char *)split_out,
+						sizeof(split_out[0])));
+	MOCK_CHECK(pNv->xfer_engine == NOUVEAU_XFER_CE);
+
+	for (y = 0; y < SH; y++) {
+		for (x = 0; x < SW; x++) {
+			if ((split_out[y][x] & 0x00ffffff) !=
+			    (split_in[y][x] & 0x00ffffff))
+				bad++;
+		}
+	}
+
+	return bad;
+}
+
+/* Kepler's second copy engine, see nouveau_copy_rect() */
+static int
+test_split(void)
+{
+	ScreenPtr pScreen = mock_screen(0xe4, NULL);
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	struct nouveau_push_track *track = &pNv->push[NOUVEAU_PUSH_COPY2];
+	PixmapPtr a, b;
+	uint64_t words;
+	uint32_t seq;
+	int bad = 0;
+
+	MOCK_CHECK(pNv->ce_pushbuf2 && pNv->NvCopy2);
+	a = mock_pixmap(pScreen, SW, SH, 24);
+	b = mock_pixmap(pScreen, SW, SH, 24);
+	MOCK_CHECK(a && b);
+	if (!pNv->ce_pushbuf2 || !a || !b)
+		goto out;
+
+	/* both engines used, each behind a semaphore */
+	words = track->words;
+	seq = pNv->ce_seq2;
+	bad += split_upload(pNv, a, b, 3);
+	MOCK_CHECK(track->words > words);
+	MOCK_CHECK(pNv->ce_seq2 == seq + 2);
+	MOCK_CHECK(pNv->ce_joined == pNv->ce_seq2);
+
+	/* no room for the second engine's acquire, the first does it all */
+	mock_fail_space(pNv->ce_pushbuf2, 0, 1);
+	bad += split_upload(pNv, a, b, 5);
+	MOCK_CHECK(pNv->ce_seq2 == seq + 3);
+
+	/* no room for its release, it's waited for on the CPU */
+	seq = pNv->ce_seq2;
+	mock_fail_space(pNv->ce_pushbuf2, 1, 1);
+	bad += split_upload(pNv, a, b, 7);
+	MOCK_CHECK(pNv->ce_seq2 == seq + 1);
+
+out:
+	if (a)
+		mock_pixmap_free(a);
+	if (b)
+		mock_pixmap_free(b);
+	mock_screen_fini(pScreen);
+	return bad;
+}
+
+/* Whether the copy engine is used for transfers on a chipset */
+static Bool
+enabled(uint32_t chipset)
+{
+	ScreenPtr pScreen = mock_screen(chipset, NULL);
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	Bool ret;
+
+	MOCK_CHECK(pNv->ce_rect);
+	ret = pNv->ce_enabled;
+	mock_screen_fini(pScreen);
+	return ret;
+}
+
+int
+main(void)
+{
+	int bad;
+
+	if (enabled(0xa3))
+		mock_error("copy engine used by default without semaphores");
+
+	bad = test(TRUE);
+	if (bad)
+		mock_error("%d pixels wrong with semaphores", bad);
+
+	bad = test_split();
+	if (bad)
+		mock_error("%d pixels wrong split between copy engines", bad);
+
+	/* asked for, it's used without them too */
+	mock_option(OPTION_ASYNC_COPY, "on");
+	if (!enabled(0xa3))
+		mock_error("copy engine not used on Tesla when asked for");
+
+	if (!test(FALSE))
+		mock_error("no pixels wrong without semaphores, "
+			   "the test can't tell");
+
+	if (mock_errors)
+		fprintf(stderr, "copy_sync: %u errors\n", mock_errors);
+	return mock_errors ? 1 : 0;
+}
@@ -0,0 +1,396 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Random sequences of EXA solids, copies and uploads on the NV50 and NVC0
+ * 2D engines, as tools/nv_2d.c draws them, against the same sequences
+ * rendered the way fb would: pixman_fill() and pixman_blt() where fb uses
+ * them, its raster ops and planemask everywhere else.
+ *
+ * - every alu, with solid, partial and random planemasks
+ * - depths 8, 15, 16, 24 and 32
+ * - block-linear pixmaps of all sizes, and a linear one
+ * - copies between pixmaps and overlapping within one
+ * - uploads small enough to go through SIFC
+ *
+ * Pixels are compared every few operations.  The sequences come from a
+ * seed, 1 unless another is given as the argument, which is printed
+ * when one goes wrong.
+ *
+ * usage: diff_2d [-c capture] [seed]
+ *   -c  write a PushbufCapture of the NV50 depth 24 sequence, for
+ *       tools/nv2d-replay.  nv50_2d.capture is one, from seed 1.
+ */
+
+#include <unistd.h>
+#include <pixman.h>
+
+#include "mock.h"
+
+#define SURFACES 4
+#define OPS      240
+#define CHECK    24
+
+struct surface {
+	PixmapPtr ppix;
+	uint32_t *ref;
+	int w, h, stride;
+};
+
+struct run {
+	uint32_t chipset;
+	int depth, bpp, cpp;
+	uint32_t mask;		/* bits the pixel format has */
+	unsigned seed, fallbacks;
+	struct surface s[SURFACES];
+};
+
+static uint32_t
+random32(void)
+{
+	return (uint32_t)rand() << 16 ^ rand();
+}
+
+static int
+random_range(int n)
+{
+	return n > 0 ? rand() % n : 0;
+}
+
+/* fbBits.h's raster ops */
+static uint32_t
+fb_rop(int alu, uint32_t s, uint32_t d)
+{
+	switch (alu) {
+	case GXclear:        return 0;
+	case GXand:          return s & d;
+	case GXandReverse:   return s & ~d;
+	case GXcopy:         return s;
+	case GXandInverted:  return ~s & d;
+	case GXnoop:         return d;
+	case GXxor:          return s ^ d;
+	case GXor:           return s | d;
+	case GXnor:          return ~(s | d);
+	case GXequiv:        return ~s ^ d;
+	case GXinvert:       return ~d;
+	case GXorReverse:    return s | ~d;
+	case GXcopyInverted: return ~s;
+	case GXorInverted:   return ~s | d;
+	case GXnand:         return ~(s & d);
+	default:             return ~0;
+	}
+}
+
+static uint8_t *
+ref_pixel(struct run *r, struct surface *s, int x, int y)
+{
+	return (uint8_t *)(s->ref + y * s->stride) + x * r->cpp;
+}
+
+static void
+ref_rop(struct run *r, struct surface *s, int x, int y, int alu,
+	uint32_t pm, uint32_t src)
+{
+	uint8_t *p = ref_pixel(r, s, x, y);
+	uint32_t d = 0;
+
+	memcpy(&d, p, r->cpp);
+	d = (fb_rop(alu, src, d) & pm) | (d & ~pm);
+	memcpy(p, &d, r->cpp);
+}
+
+/* fbReplicatePixel() and fbGetGCPrivate()'s pm for bpp */
+static uint32_t
+fb_bits(struct run *r, uint32_t v)
+{
+	return r->bpp == 32 ? v : v & ((1 << r->bpp) - 1);
+}
+
+static Pixel
+random_planemask(struct run *r)
+{
+	switch (rand() % 4) {
+	case 0:
+		return FbFullMask(r->depth);
+	case 1:
+		return random32();
+	default:
+		return ~0;
+	}
+}
+
+static void
+solid(struct run *r)
+{
+	struct surface *s = &r->s[rand() % SURFACES];
+	int alu = rand() % 16, x1, y1, x2, y2, x, y;
+	Pixel pm = random_planemask(r), fg = random32();
+	uint32_t bpm = fb_bits(r, pm), bfg = fb_bits(r, fg);
+
+	x1 = random_range(s->w);
+	y1 = random_range(s->h);
+	x2 = x1 + 1 + random_range(s->w - x1);
+	y2 = y1 + 1 + random_range(s->h - y1);
+
+	if (!mock_exa->PrepareSolid(s->ppix, alu, pm, fg)) {
+		r->fallbacks++;
+		return;
+	}
+	mock_exa->Solid(s->ppix, x1, y1, x2, y2);
+	mock_exa->DoneSolid(s->ppix);
+
+	if (alu == GXcopy && bpm == fb_bits(r, ~0)) {
+		pixman_fill(s->ref, s->stride, r->bpp, x1, y1, x2 - x1,
+			    y2 - y1, bfg);
+		return;
+	}
+
+	for (y = y1; y < y2; y++) {
+		for (x = x1; x < x2; x++)
+			ref_rop(r, s, x, y, alu, bpm, bfg);
+	}
+}
+
+static void
+copy(struct run *r)
+{
+	struct surface *src = &r->s[rand() % SURFACES];
+	struct surface *dst = &r->s[rand() % SURFACES];
+	int alu = rand() % 16, sx, sy, dx, dy, w, h, x, y;
+	Pixel pm = random_planemask(r);
+	uint32_t bpm = fb_bits(r, pm), *tmp;
+
+	w = 1 + random_range(min(src->w, dst->w));
+	h = 1 + random_range(min(src->h, dst->h));
+	sx = random_range(src->w - w + 1);
+	sy = random_range(src->h - h + 1);
+	dx = random_range(dst->w - w + 1);
+	dy = random_range(dst->h - h + 1);
+
+	if (!mock_exa->PrepareCopy(src->ppix, dst->ppix, dx > sx ? -1 : 1,
+				   dy > sy ? -1 : 1, alu, pm)) {
+		r->fallbacks++;
+		return;
+	}
+	mock_exa->Copy(dst->ppix, sx, sy, dx, dy, w, h);
+	mock_exa->DoneCopy(dst->ppix);
+
+	/* fbCopyNtoN() only leaves it to pixman going forwards */
+	if (alu == GXcopy && bpm == fb_bits(r, ~0) &&
+	    (src != dst || (dx <= sx && dy <= sy))) {
+		pixman_blt(src->ref, dst->ref, src->stride, dst->stride,
+			   r->bpp, r->bpp, sx, sy, dx, dy, w, h);
+		return;
+	}
+
+	tmp = calloc(w * h, sizeof(*tmp));
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			memcpy(&tmp[y * w + x],
+			       ref_pixel(r, src, sx + x, sy + y), r->cpp);
+		}
+	}
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			ref_rop(r, dst, dx + x, dy + y, alu, bpm,
+				tmp[y * w + x]);
+		}
+	}
+	free(tmp);
+}
+
+static void
+upload(struct run *r)
+{
+	struct surface *s = &r->s[rand() % SURFACES];
+	int x, y, w, h, pitch, i;
+	uint32_t *data;
+
+	/* under nouveau_exa_upload_to_screen()'s limit for SIFC */
+	do {
+		w = 1 + random_range(s->w);
+		h = 1 + random_range(s->h);
+	} while (w * h * r->cpp >= 16 * 1024);
+	x = random_range(s->w - w + 1);
+	y = random_range(s->h - h + 1);
+	pitch = (w * r->cpp + 3) / 4 + random_range(3);
+
+	data = malloc(pitch * h * 4);
+	for (i = 0; i < pitch * h; i++)
+		data[i] = random32();
+
+	if (!mock_exa->UploadToScreen(s->ppix, x, y, w, h, (char *)data,
+				      pitch * 4)) {
+		r->fallbacks++;
+		free(data);
+		return;
+	}
+
+	pixman_blt(data, s->ref, pitch, s->stride, r->bpp, r->bpp, 0, 0, x, y,
+		   w, h);
+	free(data);
+}
+
+static Bool
+compare(struct run *r, int op)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(r->s[0].ppix->drawable.pScreen));
+	int i, x, y;
+
+	PUSH_KICK(pNv->pushbuf);
+	mock_finish();
+
+	for (i = 0; i < SURFACES; i++) {
+		struct surface *s = &r->s[i];
+		struct nouveau_bo *bo = nouveau_pixmap_bo(s->ppix);
+
+		for (y = 0; y < s->h; y++) {
+			for (x = 0; x < s->w; x++) {
+				uint32_t gpu = 0, ref = 0;
+
+				memcpy(&gpu, mock_pixel(bo,
+					exaGetPixmapPitch(s->ppix), r->cpp,
+					x, y), r->cpp);
+				memcpy(&ref, ref_pixel(r, s, x, y), r->cpp);
+				if (!((gpu ^ ref) & r->mask))
+					continue;
+
+				mock_error("NV%02X depth %d seed %u: pixmap %d "
+					   "(%dx%d) wrong by op %d, (%d,%d) "
+					   "is %08x, not %08x", r->chipset,
+					   r->depth, r->seed, i, s->w, s->h,
+					   op, x, y, gpu & r->mask,
+					   ref & r->mask);
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+test_run(uint32_t chipset, int depth, unsigned seed)
+{
+	ScreenPtr pScreen = mock_screen(chipset, NULL);
+	struct run r = { chipset, depth };
+	int i, op;
+
+	r.bpp = depth <= 8 ? 8 : depth <= 16 ? 16 : 32;
+	r.cpp = r.bpp / 8;
+	r.mask = FbFullMask(depth);
+	r.seed = seed;
+	srand(seed ^ chipset << 8 ^ depth);
+
+	/* a small one, where everything overlaps, and the last linear, as
+	 * the front buffer is
+	 */
+	for (i = 0; i < SURFACES; i++) {
+		struct surface *s = &r.s[i];
+
+		s->w = 1 + random_range(i ? 160 : 16);
+		s->h = 1 + random_range(i ? 120 : 16);
+		s->ppix = mock_pixmap_hint(pScreen, s->w, s->h, depth,
+					   i == SURFACES - 1 ?
+					   NOUVEAU_CREATE_PIXMAP_SCANOUT : 0);
+		s->stride = (s->w * r.cpp + 3) / 4;
+		s->ref = calloc(s->stride * s->h, 4);
+		MOCK_CHECK(s->ppix);
+		if (!s->ppix)
+			return;
+	}
+
+	/* start from what the pixmaps were allocated with */
+	mock_finish();
+	for (i = 0; i < SURFACES; i++) {
+		struct surface *s = &r.s[i];
+		struct nouveau_bo *bo = nouveau_pixmap_bo(s->ppix);
+		int x, y;
+
+		for (y = 0; y < s->h; y++) {
+			for (x = 0; x < s->w; x++) {
+				memcpy(ref_pixel(&r, s, x, y), mock_pixel(bo,
+				       exaGetPixmapPitch(s->ppix), r.cpp, x, y),
+				       r.cpp);
+			}
+		}
+	}
+
+	for (op = 1; op <= OPS; op++) {
+		switch (rand() % 3) {
+		case 0: solid(&r); break;
+		case 1: copy(&r); break;
+		default: upload(&r); break;
+		}
+
+		if (!(op % CHECK) && !compare(&r, op))
+			break;
+	}
+
+	/* there's no reason for any of these to fall back */
+	MOCK_CHECK(r.fallbacks == 0);
+
+	for (i = 0; i < SURFACES; i++) {
+		mock_pixmap_free(r.s[i].ppix);
+		free(r.s[i].ref);
+	}
+	mock_screen_fini(pScreen);
+}
+
+int
+main(int argc, char **argv)
+{
+	static const uint32_t chipset[] = { 0x50, 0xc0, 0xe4 };
+	static const int depth[] = { 8, 15, 16, 24, 32 };
+	const char *capture = NULL;
+	unsigned seed = 1;
+	int opt, i, j;
+
+	while ((opt = getopt(argc, argv, "c:")) != -1) {
+		switch (opt) {
+		case 'c': capture = optarg; break;
+		default:
+			goto usage;
+		}
+	}
+
+	if (optind < argc - 1)
+		goto usage;
+	if (optind < argc)
+		seed = strtoul(argv[optind], NULL, 0);
+
+	for (i = 0; i < sizeof(chipset) / sizeof(chipset[0]); i++) {
+		for (j = 0; j < sizeof(depth) / sizeof(depth[0]); j++) {
+			if (capture && chipset[i] == 0x50 && depth[j] == 24)
+				mock_option(OPTION_PUSHBUF_CAPTURE, capture);
+			test_run(chipset[i], depth[j], seed);
+			mock_option(OPTION_PUSHBUF_CAPTURE, NULL);
+		}
+	}
+
+	if (mock_errors)
+		fprintf(stderr, "diff_2d: %u errors\n", mock_errors);
+	return mock_errors ? 1 : 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-c capture] [seed]\n", argv[0]);
+	return 1;
+}
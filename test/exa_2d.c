@@ -0,0 +1,150 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* EXA's upload, solid and copy hooks on the NV50 and NVC0 2D engines,
+ * checked pixel for pixel against the same operations done on the CPU.
+ */
+
+#include "mock.h"
+
+#define W 100
+#define H 80
+
+static uint32_t ref[H][W];
+
+static uint32_t
+pixel(PixmapPtr ppix, int x, int y)
+{
+	uint32_t v;
+
+	memcpy(&v, mock_pixel(nouveau_pixmap_bo(ppix), exaGetPixmapPitch(ppix),
+			      4, x, y), 4);
+	return v & 0x00ffffff;
+}
+
+static void
+solid(PixmapPtr ppix, int alu, uint32_t fg, int x1, int y1, int x2, int y2)
+{
+	int x, y;
+
+	MOCK_CHECK(mock_exa->PrepareSolid(ppix, alu, ~0, fg));
+	mock_exa->Solid(ppix, x1, y1, x2, y2);
+	mock_exa->DoneSolid(ppix);
+
+	for (y = y1; y < y2; y++) {
+		for (x = x1; x < x2; x++)
+			ref[y][x] = alu == GXxor ? ref[y][x] ^ fg : fg;
+	}
+}
+
+static void
+copy(PixmapPtr src, const uint32_t *sref, int spitch, PixmapPtr dst,
+     int sx, int sy, int dx, int dy, int w, int h)
+{
+	static uint32_t tmp[H][W];
+	int x, y;
+
+	MOCK_CHECK(mock_exa->PrepareCopy(src, dst, dx > sx ? -1 : 1,
+					 dy > sy ? -1 : 1, GXcopy, ~0));
+	mock_exa->Copy(dst, sx, sy, dx, dy, w, h);
+	mock_exa->DoneCopy(dst);
+
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			tmp[y][x] = sref[(sy + y) * spitch + sx + x] &
+				    0x00ffffff;
+		}
+	}
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++)
+			ref[dy + y][dx + x] = tmp[y][x];
+	}
+}
+
+static void
+test_chipset(uint32_t chipset)
+{
+	static uint32_t upload[40][48];
+	ScreenPtr pScreen = mock_screen(chipset, NULL);
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	PixmapPtr a, b;
+	int x, y, bad = 0;
+
+	a = mock_pixmap(pScreen, 48, 40, 24);
+	b = mock_pixmap(pScreen, W, H, 24);
+	MOCK_CHECK(a && b);
+	if (!a || !b)
+		return;
+
+	/* small enough to go through SIFC */
+	for (y = 0; y < 40; y++) {
+		for (x = 0; x < 48; x++)
+			upload[y][x] = (x * 5) | (y * 3) << 8 | (x ^ y) << 16;
+	}
+	MOCK_CHECK(mock_exa->UploadToScreen(a, 0, 0, 48, 40, (char *)upload,
+					    sizeof(upload[0])));
+
+	solid(b, GXcopy, 0x123456, 0, 0, W, H);
+	solid(b, GXxor, 0x00ff00, 10, 5, 70, 60);
+
+	/* from the upload, then overlapping within b */
+	copy(a, &upload[0][0], 48, b, 8, 10, 40, 50, 40, 30);
+	copy(b, &ref[0][0], W, b, 30, 40, 35, 44, 50, 30);
+
+	PUSH_KICK(pNv->pushbuf);
+	mock_finish();
+
+	for (y = 0; y < H; y++) {
+		for (x = 0; x < W; x++) {
+			if (pixel(b, x, y) == ref[y][x])
+				continue;
+			if (bad++ < 8)
+				mock_error("NV%02X: (%d,%d) is %06x, not %06x",
+					   chipset, x, y, pixel(b, x, y),
+					   ref[y][x]);
+		}
+	}
+	for (y = 0; y < 40; y++) {
+		for (x = 0; x < 48; x++) {
+			if (pixel(a, x, y) != (upload[y][x] & 0x00ffffff) &&
+			    bad++ < 8)
+				mock_error("NV%02X: upload (%d,%d) is %06x",
+					   chipset, x, y, pixel(a, x, y));
+		}
+	}
+
+	mock_pixmap_free(a);
+	mock_pixmap_free(b);
+	mock_screen_fini(pScreen);
+}
+
+int
+main(void)
+{
+	test_chipset(0x50);
+	test_chipset(0xc0);
+	test_chipset(0xe4);
+
+	if (mock_errors)
+		fprintf(stderr, "exa_2d: %u errors\n", mock_errors);
+	return mock_errors ? 1 : 0;
+}
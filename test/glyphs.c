@@ -0,0 +1,157 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Composite rects on NV50 the way EXA's glyph cache flushes them: one
+ * PrepareComposite with a glyph cache picture as the mask, then a
+ * Composite per glyph.  They must come out as one quads primitive for
+ * every pushbuf they fill, with each quad where its glyph is.
+ *
+ * - a screenful of glyphs, filling several pushbufs
+ */
+
+#include "mock.h"
+
+#define W 512
+#define H 512
+#define NR_GLYPHS 6000
+
+struct glyph {
+	int sx, sy, mx, my, dx, dy, w, h;
+};
+
+static void
+random_glyph(struct glyph *g)
+{
+	g->w = 4 + rand() % 12;
+	g->h = 8 + rand() % 9;
+	g->mx = (rand() % 64) * 16;
+	g->my = (rand() % 2) * 16;
+	g->dx = rand() % (W - g->w);
+	g->dy = rand() % (H - g->h);
+	g->sx = g->dx;
+	g->sy = g->dy;
+}
+
+static void
+check_quads(const char *what, const struct glyph *g, int n,
+	    const struct mock_vertex *v, unsigned nvtx)
+{
+	static const int corner[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 },
+					  { 0, 1 } };
+	int i, j;
+
+	if (nvtx != n * 4) {
+		mock_error("%s: %u vertices for %d rects", what, nvtx, n);
+		return;
+	}
+
+	for (i = 0; i < n; i++, g++) {
+		for (j = 0; j < 4; j++, v++) {
+			int x = corner[j][0] * g->w, y = corner[j][1] * g->h;
+
+			if (v->x != g->dx + x || v->y != g->dy + y ||
+			    v->s[0] != g->sx + x || v->t[0] != g->sy + y ||
+			    v->s[1] != g->mx + x || v->t[1] != g->my + y) {
+				mock_error("%s: rect %d corner %d at %d,%d "
+					   "(%d,%d %d,%d)", what, i, j,
+					   v->x, v->y, v->s[1], v->t[1],
+					   g->dx + x, g->dy + y);
+				return;
+			}
+		}
+	}
+}
+
+static void
+test_chipset(uint32_t chipset)
+{
+	ScreenPtr pScreen = mock_screen(chipset, NULL);
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	PixmapPtr pdpix, pmpix, pspix;
+	PicturePtr pDst, pMask, pSrc;
+	struct mock_stats before, after;
+	const struct mock_vertex *vtx;
+	struct glyph *glyphs;
+	unsigned draws, nvtx;
+	char what[64];
+	int i;
+
+	pdpix = mock_pixmap(pScreen, W, H, 32);
+	pmpix = mock_pixmap(pScreen, 1024, 32, 8);
+	pspix = mock_pixmap(pScreen, 1, 1, 32);
+	pDst = mock_picture(pdpix, PICT_a8r8g8b8);
+	pMask = mock_picture(pmpix, PICT_a8);
+	pSrc = mock_picture(pspix, PICT_a8r8g8b8);
+	pSrc->repeat = TRUE;
+	pSrc->repeatType = RepeatNormal;
+
+	glyphs = calloc(NR_GLYPHS, sizeof(*glyphs));
+	srand(chipset);
+	for (i = 0; i < NR_GLYPHS; i++)
+		random_glyph(&glyphs[i]);
+
+	PUSH_KICK(pNv->pushbuf);
+	mock_finish();
+	mock_3d_draws(pNv->pushbuf, &vtx, &nvtx);
+	mock_pushbuf_stats(pNv->pushbuf, &before);
+
+	MOCK_CHECK(mock_exa->CheckComposite(PictOpOver, pSrc, pMask, pDst));
+	MOCK_CHECK(mock_exa->PrepareComposite(PictOpOver, pSrc, pMask, pDst,
+					      pspix, pmpix, pdpix));
+	for (i = 0; i < NR_GLYPHS; i++) {
+		struct glyph *g = &glyphs[i];
+
+		mock_exa->Composite(pdpix, g->sx, g->sy, g->mx, g->my,
+				    g->dx, g->dy, g->w, g->h);
+	}
+	mock_exa->DoneComposite(pdpix);
+	PUSH_KICK(pNv->pushbuf);
+	mock_finish();
+
+	mock_pushbuf_stats(pNv->pushbuf, &after);
+	draws = mock_3d_draws(pNv->pushbuf, &vtx, &nvtx);
+	sprintf(what, "NV%02X glyphs", chipset);
+	check_quads(what, glyphs, NR_GLYPHS, vtx, nvtx);
+	MOCK_CHECK(after.submissions - before.submissions > 1);
+	MOCK_CHECK(draws >= 1);
+	MOCK_CHECK(draws <= after.submissions - before.submissions);
+
+	free(glyphs);
+	FreePicture(pSrc, 0);
+	FreePicture(pMask, 0);
+	FreePicture(pDst, 0);
+	mock_pixmap_free(pspix);
+	mock_pixmap_free(pmpix);
+	mock_pixmap_free(pdpix);
+	mock_screen_fini(pScreen);
+}
+
+int
+main(void)
+{
+	test_chipset(0x50);
+	test_chipset(0xa3);
+
+	if (mock_errors)
+		fprintf(stderr, "glyphs: %u errors\n", mock_errors);
+	return mock_errors ? 1 : 0;
+}
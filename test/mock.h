@@ -0,0 +1,95 @@
+#ifndef __NVDDX_MOCK_H__
+#define __NVDDX_MOCK_H__
+
+#include "nv_include.h"
+
+/* Stand-ins for libdrm_nouveau, the GPU and the bits of the X server the
+ * acceleration code needs, so it can be run and checked without either.
+ *
+ * mock_nouveau.c implements the libdrm_nouveau API the way libdrm does,
+ * down to when it submits, switches buffers and re-emits a bufctx, but
+ * nothing reaches a kernel: each submission is decoded with tools/
+ * nv_decode.c and queued on its channel.  Queued work only runs when
+ * something waits for it, a buffer wait or map or mock_finish(), and then
+ * one channel at a time, the preferred one for as long as it can go.  The
+ * host semaphore methods block and release channels as the GPU would, the
+ * 2D class is tools/nv_2d.c and the copy engine's A0B5 class is modelled
+ * for pitch and block-linear surfaces.  The NV50 3D class keeps its state,
+ * uploads constant buffers and records vertices, but draws nothing.
+ * Everything else is only decoded.
+ * Semaphore releases write a GPU timer that only advances while a copy
+ * runs, at the rate set with mock_rate() for its channel.
+ *
+ * mock_xorg.c brings up a screen the way NVScreenInit() does and has
+ * pixmaps and pictures for EXA's and Render's hooks to be called on.
+ */
+
+/* libdrm and the GPU */
+struct nouveau_device *mock_device(uint32_t chipset, const uint32_t *classes);
+void mock_device_fini(void);
+void mock_prefer(struct nouveau_object *channel);
+void mock_rate(struct nouveau_object *channel, unsigned bytes_per_us);
+void mock_finish(void);
+void mock_fail_space(struct nouveau_pushbuf *push, int after, int count);
+uint8_t *mock_pixel(struct nouveau_bo *bo, int pitch, int cpp, int x, int y);
+uint32_t mock_3d_state(struct nouveau_pushbuf *push, uint32_t mthd);
+
+/* NV50 draws since the last call, and their vertices, valid until the
+ * next call
+ */
+struct mock_vertex {
+	int x, y;
+	int s[2], t[2];
+};
+unsigned mock_3d_draws(struct nouveau_pushbuf *push,
+		       const struct mock_vertex **vtx, unsigned *nvtx);
+
+struct mock_stats {
+	unsigned submissions;
+	uint64_t words;
+};
+void mock_pushbuf_stats(struct nouveau_pushbuf *push, struct mock_stats *);
+const uint32_t *mock_pushbuf_log(struct nouveau_pushbuf *push,
+				 uint64_t *words);
+
+extern unsigned mock_errors;
+void mock_error(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/* the X server */
+extern ExaDriverPtr mock_exa;
+extern CARD64 mock_time_us;
+
+void mock_option(int token, const char *value);
+ScreenPtr mock_screen(uint32_t chipset, const uint32_t *classes);
+void mock_screen_fini(ScreenPtr pScreen);
+PixmapPtr mock_pixmap(ScreenPtr pScreen, int width, int height, int depth);
+PixmapPtr mock_pixmap_hint(ScreenPtr pScreen, int width, int height,
+			   int depth, unsigned usage);
+void mock_pixmap_free(PixmapPtr ppix);
+
+/* Render: pictures of pixmaps and of solid colours, clipped to their
+ * drawable.  Under the driver's wrapper, the server's Composite only
+ * counts its calls, and keeps the last composite's coordinates and its
+ * mask, if A8, as the GPU left it.  With
+ * exa set, composites also go to the EXA hooks, unclipped, counting those
+ * that fall back.
+ */
+struct mock_render {
+	Bool exa;
+	unsigned composites, fallbacks;
+	CARD8 op;
+	INT16 xSrc, ySrc, xMask, yMask, xDst, yDst;
+	CARD16 width, height;
+	uint8_t *mask;
+};
+extern struct mock_render mock_render;
+
+PicturePtr mock_picture(PixmapPtr ppix, CARD32 format);
+
+#define MOCK_CHECK(cond) do {                                                 \
+	if (!(cond))                                                          \
+		mock_error("%s:%d: check failed: %s", __FILE__, __LINE__,     \
+			   #cond);                                            \
+} while (0)
+
+#endif
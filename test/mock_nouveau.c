@@ -0,0 +1,1457 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* libdrm_nouveau and a GPU, see mock.h.
+ *
+ * The pushbuf and bufctx functions follow libdrm's own: a pushbuf is a
+ * ring of nr buffers, a reservation that doesn't fit in what's left of
+ * one submits it and moves on to the next, and validation emits the
+ * packets of the bound bufctx's references that are new to the current
+ * submission.  Where libdrm relocates, the final value is written to the
+ * pushbuf straight away.
+ *
+ * A submission is decoded as it's submitted, and what it does is queued
+ * on its channel, along with references to the buffers it used.  Buffers
+ * are never freed before mock_device_fini(), so nothing the GPU still has
+ * queued can point at freed memory.
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+#include "mock.h"
+#include "nv_decode.h"
+#include "nv_2d.h"
+#include "hwdefs/nv50_defs.xml.h"
+#include "hwdefs/nv50_3d.xml.h"
+
+#define MOCK_VA_BASE    0x100000000ULL
+#define MOCK_VA_ALIGN   0x10000ULL
+
+#define MOCK_SEMA_ADDRESS_HIGH 0x0010
+#define MOCK_SEMA_ADDRESS_LOW  0x0014
+#define MOCK_SEMA_SEQUENCE     0x0018
+#define MOCK_SEMA_TRIGGER      0x001c
+#define MOCK_SEMA_ACQUIRE_EQUAL  1
+#define MOCK_SEMA_WRITE_LONG     2
+#define MOCK_SEMA_ACQUIRE_GEQUAL 4
+
+struct mock_bo {
+	struct nouveau_bo base;
+	int refcnt;
+	uint8_t *mem;
+	uint32_t access;		/* what the GPU last did with it */
+	struct nouveau_pushbuf *push;	/* last one it went into unsubmitted */
+	struct mock_bo *next;
+};
+
+struct mock_op {
+	int subc;
+	uint32_t oclass;
+	uint32_t mthd;
+	uint32_t data;
+};
+
+struct mock_submission {
+	struct mock_op *op;
+	unsigned nr, done;
+	struct mock_bo **bo;
+	unsigned bos;
+	struct mock_submission *next;
+};
+
+struct mock_channel {
+	struct nouveau_object base;
+	union {
+		struct nv04_fifo nv04;
+		struct nvc0_fifo nvc0;
+		struct nve0_fifo nve0;
+	} fifo;
+	int id;
+	struct nv_decode dec;
+	struct mock_submission *building;
+	struct mock_submission *queue, **tail;
+
+	uint64_t sema_addr;
+	uint32_t sema_seq;
+	unsigned rate;			/* copy bytes/us, 0 takes no time */
+	uint32_t copy[0x800 / 4];
+	uint32_t tcl[0x2000 / 4];	/* NV50 3D state */
+	uint64_t cb_address[128];	/* constant buffers */
+	uint32_t cb_size[128];
+	uint32_t cb_addr;
+	Bool drawing;			/* between VERTEX_BEGIN and _END */
+	unsigned draw_vtx;		/* vertices in the current draw */
+	unsigned draws, nvtx, max_vtx;
+	struct mock_vertex *vtx;
+	struct mock_channel *next;	/* in order of preference */
+
+	/* everything submitted, whichever pushbuf it came from */
+	struct mock_stats stats;
+	uint32_t *log;
+	uint64_t log_words, log_max;
+};
+
+struct mock_kref {
+	struct mock_bo *bo;
+	uint32_t flags;
+};
+
+struct mock_pushbuf {
+	struct nouveau_pushbuf base;
+	uint32_t **buf;
+	int nr, next;
+	uint32_t size;
+	uint32_t *bgn;
+
+	struct mock_kref *kref;
+	int krefs, kref_max;
+
+	int fail_after, fail_count;
+};
+
+struct mock_bufref {
+	struct nouveau_bufref base;
+	int bin;
+	struct nouveau_list bin_head;
+};
+
+struct mock_bufctx {
+	struct nouveau_bufctx base;
+	int bins;
+	struct nouveau_list *bin;
+	struct mock_pushbuf *validated;	/* refs in current are for this */
+	struct mock_bufctx *next;
+};
+
+static struct {
+	struct nouveau_device dev;
+	const uint32_t *classes;
+	struct mock_bo *bos;
+	uint64_t va;
+	uint32_t handle;
+	struct mock_channel *chan;	/* most preferred first */
+	struct mock_bufctx *bctx;
+	int channels;
+	struct nv_2d nv2d;
+	struct mock_submission *running;
+	uint64_t gpu_ns;		/* the GPU timer */
+} mock;
+
+unsigned mock_errors;
+
+void
+mock_error(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	fprintf(stderr, "mock: ");
+	vfprintf(stderr, fmt, ap);
+	fprintf(stderr, "\n");
+	va_end(ap);
+	mock_errors++;
+}
+
+/* lists, as libdrm has them */
+static void
+mock_list_init(struct nouveau_list *list)
+{
+	list->prev = list;
+	list->next = list;
+}
+
+static void
+mock_list_del(struct nouveau_list *item)
+{
+	item->prev->next = item->next;
+	item->next->prev = item->prev;
+	mock_list_init(item);
+}
+
+static void
+mock_list_add_tail(struct nouveau_list *item, struct nouveau_list *list)
+{
+	item->next = list;
+	item->prev = list->prev;
+	list->prev->next = item;
+	list->prev = item;
+}
+
+/* move everything in from to the end of to */
+static void
+mock_list_join(struct nouveau_list *from, struct nouveau_list *to)
+{
+	if (from->next == from)
+		return;
+
+	from->next->prev = to->prev;
+	from->prev->next = to;
+	to->prev->next = from->next;
+	to->prev = from->prev;
+	mock_list_init(from);
+}
+
+#define mock_bufref(item) \
+	((struct mock_bufref *)((char *)(item) - \
+				offsetof(struct nouveau_bufref, thead)))
+
+static struct mock_bo *
+mock_bo(struct nouveau_bo *bo)
+{
+	return (struct mock_bo *)bo;
+}
+
+static struct mock_pushbuf *
+mock_pushbuf(struct nouveau_pushbuf *push)
+{
+	return (struct mock_pushbuf *)push;
+}
+
+static struct mock_channel *
+mock_channel(struct nouveau_object *object)
+{
+	struct mock_channel *chan;
+
+	for (chan = mock.chan; chan; chan = chan->next) {
+		if (&chan->base == object)
+			return chan;
+	}
+
+	return NULL;
+}
+
+/* Buffers and the GPU's view of them */
+
+static struct mock_bo *
+mock_bo_at(uint64_t address, uint64_t size)
+{
+	struct mock_bo *bo;
+
+	for (bo = mock.bos; bo; bo = bo->next) {
+		if (address >= bo->base.offset &&
+		    address + size <= bo->base.offset + bo->base.size)
+			return bo;
+	}
+
+	return NULL;
+}
+
+/* Is [address, address + size) inside a buffer the running submission
+ * references?  The GPU only gets to see those.
+ */
+static int
+mock_referenced(uint64_t address, uint64_t size, const char *what)
+{
+	struct mock_submission *sub = mock.running;
+	struct mock_bo *bo = mock_bo_at(address, size ? size : 1);
+	unsigned i;
+
+	for (i = 0; bo && sub && i < sub->bos; i++) {
+		if (sub->bo[i] == bo)
+			return 1;
+	}
+
+	mock_error("%s at 0x%010llx+0x%llx is %s", what,
+		   (unsigned long long)address, (unsigned long long)size,
+		   bo ? "not referenced by the submission" : "outside any bo");
+	return 0;
+}
+
+static uint64_t
+mock_surface_size(const struct nv_2d_surface *s, int cpp)
+{
+	int tw, th;
+
+	if (s->linear)
+		return (uint64_t)s->pitch * (s->height - 1) + s->width * cpp;
+
+	tw = 64 << (s->tile_mode & 0xf);
+	th = (mock.nv2d.nvc0 ? 8 : 4) << ((s->tile_mode >> 4) & 0xf);
+	return (uint64_t)((s->width * cpp + tw - 1) / tw) * tw *
+	       ((s->height + th - 1) / th) * th;
+}
+
+/* The surface a buffer's contents are laid out as, given its pitch */
+static void
+mock_surface(struct mock_bo *bo, int pitch, int cpp, int height,
+	     struct nv_2d_surface *s)
+{
+	const union nouveau_bo_config *cfg = &bo->base.config;
+
+	memset(s, 0, sizeof(*s));
+	s->format = cpp == 4 ? NV50_SURFACE_FORMAT_BGRA8_UNORM :
+		    cpp == 2 ? NV50_SURFACE_FORMAT_B5G6R5_UNORM :
+			       NV50_SURFACE_FORMAT_R8_UNORM;
+	s->pitch = pitch;
+	s->width = pitch / cpp;
+	s->height = height;
+	s->address = bo->base.offset;
+
+	if (mock.dev.chipset >= 0xc0 && cfg->nvc0.memtype)
+		s->tile_mode = cfg->nvc0.tile_mode;
+	else
+	if (mock.dev.chipset >= 0x50 && cfg->nv50.memtype)
+		s->tile_mode = cfg->nv50.tile_mode;
+	else
+		s->linear = 1;
+}
+
+uint8_t *
+mock_pixel(struct nouveau_bo *bo, int pitch, int cpp, int x, int y)
+{
+	struct nv_2d_surface s;
+
+	mock_surface(mock_bo(bo), pitch, cpp, y + 1, &s);
+	return nv_2d_pixel(&mock.nv2d, &s, x, y);
+}
+
+static void
+mock_draw(struct nv_2d *nv, const struct nv_2d_surface *dst, const char *op,
+	  int x, int y, int w, int h)
+{
+	int cpp = nv_2d_cpp(dst->format);
+
+	mock_referenced(dst->address, mock_surface_size(dst, cpp ? cpp : 4),
+			"2D destination");
+	if (!strcmp(op, "blit")) {
+		cpp = nv_2d_cpp(nv->src.format);
+		mock_referenced(nv->src.address,
+				mock_surface_size(&nv->src, cpp ? cpp : 4),
+				"2D source");
+	}
+}
+
+/* The copy engine, A0B5 and later, a byte at a time */
+static void
+mock_copy_surface(struct mock_channel *chan, int dst, int linear,
+		  uint64_t address, uint32_t pitch,
+		  struct nv_2d_surface *s, int *x, int *y)
+{
+	uint32_t *tile = &chan->copy[(dst ? 0x070c : 0x0728) / 4];
+
+	memset(s, 0, sizeof(*s));
+	s->format = NV50_SURFACE_FORMAT_R8_UNORM;
+	s->address = address;
+
+	if (linear) {
+		s->linear = 1;
+		s->pitch = pitch;
+		s->width = pitch;
+		s->height = chan->copy[0x041c / 4];
+		*x = *y = 0;
+		return;
+	}
+
+	s->tile_mode = tile[0] & 0xff;
+	s->width = tile[1];
+	s->height = tile[2];
+	*x = tile[5] & 0xffff;
+	*y = tile[5] >> 16;
+}
+
+/* How many of the bytes from x on are next to each other in memory, a
+ * GOB's row at most when it's tiled
+ */
+static int
+mock_copy_run(const struct nv_2d_surface *s, int x, int bytes)
+{
+	if (s->linear)
+		return bytes;
+	return bytes < 64 - x % 64 ? bytes : 64 - x % 64;
+}
+
+static void
+mock_copy_launch(struct mock_channel *chan, uint32_t exec)
+{
+	uint32_t *m = chan->copy;
+	struct nv_2d_surface src, dst;
+	int sx, sy, dx, dy, bytes = m[0x0418 / 4], lines = m[0x041c / 4];
+	uint8_t *line;
+	int i, j, n;
+
+	mock_copy_surface(chan, 0, exec & 0x80,
+			  (uint64_t)m[0x0400 / 4] << 32 | m[0x0404 / 4],
+			  m[0x0410 / 4], &src, &sx, &sy);
+	mock_copy_surface(chan, 1, exec & 0x100,
+			  (uint64_t)m[0x0408 / 4] << 32 | m[0x040c / 4],
+			  m[0x0414 / 4], &dst, &dx, &dy);
+
+	if (!mock_referenced(src.address, mock_surface_size(&src, 1),
+			     "copy source") ||
+	    !mock_referenced(dst.address, mock_surface_size(&dst, 1),
+			     "copy destination"))
+		return;
+
+	if (chan->rate)
+		mock.gpu_ns += (uint64_t)bytes * lines * 1000 / chan->rate;
+
+	line = malloc(bytes);
+	for (j = 0; line && j < lines; j++) {
+		for (i = 0; i < bytes; i += n) {
+			n = mock_copy_run(&src, sx + i, bytes - i);
+			memcpy(line + i, nv_2d_pixel(&mock.nv2d, &src,
+						     sx + i, sy + j), n);
+		}
+		for (i = 0; i < bytes; i += n) {
+			n = mock_copy_run(&dst, dx + i, bytes - i);
+			memcpy(nv_2d_pixel(&mock.nv2d, &dst, dx + i, dy + j),
+			       line + i, n);
+		}
+	}
+	free(line);
+}
+
+static int16_t
+mock_vtx_s16(uint32_t data, int shift)
+{
+	return (int16_t)(data >> shift);
+}
+
+/* Only vertex attributes may come between VERTEX_BEGIN and VERTEX_END.
+ * Each position written with VTX_ATTR_2I(0) is a vertex, kept with the
+ * texture coordinates last given in attributes 8 and 9.  Positions given
+ * as floats are only counted.
+ */
+static void
+mock_tcl_draw(struct mock_channel *chan, const struct mock_op *op)
+{
+	struct mock_vertex *v;
+	unsigned per;
+	uint32_t data;
+	int i;
+
+	switch (op->mthd) {
+	case NV50_3D_VERTEX_BEGIN_GL:
+		if (chan->drawing)
+			mock_error("VERTEX_BEGIN inside a draw");
+		chan->drawing = TRUE;
+		chan->draws++;
+		chan->draw_vtx = 0;
+		return;
+	case NV50_3D_VERTEX_END_GL:
+		if (!chan->drawing)
+			mock_error("VERTEX_END outside a draw");
+		per = chan->tcl[NV50_3D_VERTEX_BEGIN_GL / 4] ==
+		      NV50_3D_VERTEX_BEGIN_GL_PRIMITIVE_QUADS ? 4 : 3;
+		if (chan->draw_vtx % per)
+			mock_error("draw ended after %u vertices",
+				   chan->draw_vtx);
+		chan->drawing = FALSE;
+		return;
+	case NV50_3D_VTX_ATTR_2I(0):
+		chan->draw_vtx++;
+		if (chan->nvtx == chan->max_vtx) {
+			chan->max_vtx = chan->max_vtx * 2 + 64;
+			chan->vtx = realloc(chan->vtx, chan->max_vtx *
+						       sizeof(*chan->vtx));
+		}
+		v = &chan->vtx[chan->nvtx++];
+		v->x = mock_vtx_s16(op->data, 0);
+		v->y = mock_vtx_s16(op->data, 16);
+		for (i = 0; i < 2; i++) {
+			data = chan->tcl[NV50_3D_VTX_ATTR_2I(8 + i) / 4];
+			v->s[i] = mock_vtx_s16(data, 0);
+			v->t[i] = mock_vtx_s16(data, 16);
+		}
+		return;
+	case NV50_3D_VTX_ATTR_2F_Y(0):
+		chan->draw_vtx++;
+		return;
+	default:
+		if (chan->drawing && (op->mthd < NV50_3D_VTX_ATTR_1F(0) ||
+				      op->mthd >= 0x900))
+			mock_error("3D method 0x%04x inside a draw", op->mthd);
+		return;
+	}
+}
+
+/* The NV50 3D class keeps its state for mock_3d_state(), writes constant
+ * buffer uploads through to memory, and keeps the vertices it's given for
+ * mock_3d_draws().  It draws nothing.
+ */
+static void
+mock_tcl(struct mock_channel *chan, const struct mock_op *op)
+{
+	uint64_t address;
+	unsigned buf, id;
+	struct mock_bo *bo;
+
+	mock_tcl_draw(chan, op);
+	chan->tcl[op->mthd / 4] = op->data;
+
+	switch (op->mthd) {
+	case NV50_3D_CB_DEF_SET:
+		buf = (op->data & NV50_3D_CB_DEF_SET_BUFFER__MASK) >>
+		      NV50_3D_CB_DEF_SET_BUFFER__SHIFT;
+		chan->cb_address[buf] =
+			(uint64_t)chan->tcl[NV50_3D_CB_DEF_ADDRESS_HIGH / 4]
+			<< 32 | chan->tcl[NV50_3D_CB_DEF_ADDRESS_LOW / 4];
+		chan->cb_size[buf] = op->data & NV50_3D_CB_DEF_SET_SIZE__MASK;
+		return;
+	case NV50_3D_CB_ADDR:
+		chan->cb_addr = op->data;
+		return;
+	default:
+		if (op->mthd < NV50_3D_CB_DATA(0) ||
+		    op->mthd >= NV50_3D_CB_DATA(NV50_3D_CB_DATA__LEN))
+			return;
+		break;
+	}
+
+	buf = chan->cb_addr & NV50_3D_CB_ADDR_BUFFER__MASK;
+	id = (chan->cb_addr & NV50_3D_CB_ADDR_ID__MASK) >>
+	     NV50_3D_CB_ADDR_ID__SHIFT;
+	if (id * 4 >= chan->cb_size[buf]) {
+		mock_error("constant buffer %u written past its end", buf);
+		return;
+	}
+
+	address = chan->cb_address[buf] + id * 4;
+	if (!mock_referenced(address, 4, "constant buffer"))
+		return;
+	bo = mock_bo_at(address, 4);
+	memcpy(bo->mem + (address - bo->base.offset), &op->data, 4);
+	chan->cb_addr += 1 << NV50_3D_CB_ADDR_ID__SHIFT;
+}
+
+uint32_t
+mock_3d_state(struct nouveau_pushbuf *push, uint32_t mthd)
+{
+	return mock_channel(push->channel)->tcl[mthd / 4];
+}
+
+unsigned
+mock_3d_draws(struct nouveau_pushbuf *push, const struct mock_vertex **vtx,
+	      unsigned *nvtx)
+{
+	struct mock_channel *chan = mock_channel(push->channel);
+	unsigned draws = chan->draws;
+
+	*vtx = chan->vtx;
+	*nvtx = chan->nvtx;
+	chan->draws = 0;
+	chan->nvtx = 0;
+	return draws;
+}
+
+/* Run one method, returns 0 if the channel has to wait */
+static int
+mock_exec(struct mock_channel *chan, const struct mock_op *op)
+{
+	if (op->mthd < 0x100) {
+		struct mock_bo *bo;
+		uint32_t *sema;
+
+		switch (op->mthd) {
+		case MOCK_SEMA_ADDRESS_HIGH:
+			chan->sema_addr = (uint64_t)op->data << 32 |
+					  (uint32_t)chan->sema_addr;
+			return 1;
+		case MOCK_SEMA_ADDRESS_LOW:
+			chan->sema_addr = (chan->sema_addr & ~0xffffffffULL) |
+					  op->data;
+			return 1;
+		case MOCK_SEMA_SEQUENCE:
+			chan->sema_seq = op->data;
+			return 1;
+		case MOCK_SEMA_TRIGGER:
+			break;
+		default:
+			return 1;
+		}
+
+		if (mock.dev.chipset < 0x84) {
+			mock_error("semaphore trigger on chipset 0x%02x",
+				   mock.dev.chipset);
+			return 1;
+		}
+
+		if (!mock_referenced(chan->sema_addr, 16, "semaphore"))
+			return 1;
+		bo = mock_bo_at(chan->sema_addr, 16);
+		sema = (uint32_t *)(bo->mem + (chan->sema_addr -
+					       bo->base.offset));
+
+		switch (op->data) {
+		case MOCK_SEMA_ACQUIRE_EQUAL:
+			return sema[0] == chan->sema_seq;
+		case MOCK_SEMA_ACQUIRE_GEQUAL:
+			return (int32_t)(sema[0] - chan->sema_seq) >= 0;
+		case MOCK_SEMA_WRITE_LONG:
+			sema[0] = chan->sema_seq;
+			sema[1] = 0;
+			sema[2] = mock.gpu_ns;
+			sema[3] = mock.gpu_ns >> 32;
+			return 1;
+		default:
+			mock_error("semaphore trigger 0x%x", op->data);
+			return 1;
+		}
+	}
+
+	if ((op->oclass & 0xff) == 0x2d) {
+		unsigned ignored = mock.nv2d.ignored;
+
+		nv_2d_method(&mock.nv2d, op->mthd, op->data);
+		if (mock.nv2d.ignored != ignored) {
+			mock_error("2D method 0x%04x = 0x%08x: not modelled",
+				   op->mthd, op->data);
+		}
+		return 1;
+	}
+
+	if ((op->oclass & 0xff) == 0x97 && op->oclass < 0x9097 &&
+	    op->mthd < 0x2000) {
+		mock_tcl(chan, op);
+		return 1;
+	}
+
+	if ((op->oclass & 0xff) == 0xb5 && op->oclass >= 0xa0b5 &&
+	    op->mthd < 0x800) {
+		chan->copy[op->mthd / 4] = op->data;
+		if (op->mthd == 0x0300)
+			mock_copy_launch(chan, op->data);
+		return 1;
+	}
+
+	return 1;
+}
+
+/* Run queued work, the preferred channel first for as long as it can go,
+ * until nothing can.  Returns whether anything is left.
+ */
+static int
+mock_run(void)
+{
+	struct mock_channel *chan;
+	int progress, left;
+
+	do {
+		progress = 0;
+		left = 0;
+
+		for (chan = mock.chan; chan && !progress; chan = chan->next) {
+			struct mock_submission *sub;
+
+			while ((sub = chan->queue)) {
+				mock.running = sub;
+				while (sub->done < sub->nr &&
+				       mock_exec(chan, &sub->op[sub->done])) {
+					sub->done++;
+					progress = 1;
+				}
+				mock.running = NULL;
+
+				if (sub->done < sub->nr) {
+					left = 1;
+					break;
+				}
+
+				chan->queue = sub->next;
+				if (!chan->queue)
+					chan->tail = &chan->queue;
+				free(sub->op);
+				free(sub->bo);
+				free(sub);
+			}
+		}
+	} while (progress);
+
+	return left;
+}
+
+void
+mock_finish(void)
+{
+	if (mock_run())
+		mock_error("GPU deadlocked, channels waiting on semaphores");
+}
+
+/* How fast the channel's copy engine class moves bytes, in bytes/us */
+void
+mock_rate(struct nouveau_object *object, unsigned rate)
+{
+	struct mock_channel *chan = mock_channel(object);
+
+	if (chan)
+		chan->rate = rate;
+}
+
+void
+mock_prefer(struct nouveau_object *object)
+{
+	struct mock_channel *chan = mock_channel(object), **p;
+
+	if (!chan)
+		return;
+
+	for (p = &mock.chan; *p != chan; p = &(*p)->next)
+		;
+	*p = chan->next;
+	chan->next = mock.chan;
+	mock.chan = chan;
+}
+
+static int
+mock_bo_busy(struct mock_bo *bo)
+{
+	struct mock_channel *chan;
+	struct mock_submission *sub;
+	unsigned i;
+
+	for (chan = mock.chan; chan; chan = chan->next) {
+		for (sub = chan->queue; sub; sub = sub->next) {
+			for (i = 0; i < sub->bos; i++) {
+				if (sub->bo[i] == bo)
+					return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Submission */
+
+static void
+mock_decoded(struct nv_decode *dec, int subc, uint32_t oclass,
+	     uint32_t mthd, uint32_t data)
+{
+	struct mock_submission *sub = ((struct mock_channel *)dec->priv)->
+				      building;
+
+	if (!(sub->nr & 1023))
+		sub->op = realloc(sub->op, (sub->nr + 1024) * sizeof(*sub->op));
+	sub->op[sub->nr++] = (struct mock_op) { subc, oclass, mthd, data };
+}
+
+static void
+mock_submit(struct mock_pushbuf *nvpb, const uint32_t *data, uint32_t words)
+{
+	struct mock_channel *chan = mock_channel(nvpb->base.channel);
+	struct mock_submission *sub = calloc(1, sizeof(*sub));
+	unsigned errors = chan->dec.errors;
+	int i;
+
+	sub->bo = calloc(nvpb->krefs, sizeof(*sub->bo));
+	for (i = 0; i < nvpb->krefs; i++) {
+		struct mock_bo *bo = nvpb->kref[i].bo;
+
+		bo->access |= nvpb->kref[i].flags & NOUVEAU_BO_RDWR;
+		sub->bo[sub->bos++] = bo;
+	}
+
+	chan->building = sub;
+	nv_decode_push(&chan->dec, data, words);
+	chan->building = NULL;
+	if (chan->dec.errors != errors)
+		mock_error("channel %d: %u words that don't decode", chan->id,
+			   chan->dec.errors - errors);
+
+	*chan->tail = sub;
+	chan->tail = &sub->next;
+
+	chan->stats.submissions++;
+	chan->stats.words += words;
+
+	if (chan->log_words + words > chan->log_max) {
+		chan->log_max = (chan->log_words + words) * 2;
+		chan->log = realloc(chan->log, chan->log_max * 4);
+	}
+	memcpy(chan->log + chan->log_words, data, words * 4);
+	chan->log_words += words;
+}
+
+static struct mock_kref *
+mock_kref(struct mock_pushbuf *nvpb, struct nouveau_bo *bo, uint32_t flags)
+{
+	struct mock_bo *mbo = mock_bo(bo);
+	int i;
+
+	if (!(flags & NOUVEAU_BO_APER))
+		flags |= bo->flags & NOUVEAU_BO_APER;
+
+	for (i = 0; i < nvpb->krefs; i++) {
+		if (nvpb->kref[i].bo == mbo) {
+			nvpb->kref[i].flags |= flags;
+			return &nvpb->kref[i];
+		}
+	}
+
+	if (nvpb->krefs == nvpb->kref_max) {
+		nvpb->kref_max = nvpb->kref_max ? nvpb->kref_max * 2 : 64;
+		nvpb->kref = realloc(nvpb->kref,
+				     nvpb->kref_max * sizeof(*nvpb->kref));
+	}
+
+	mbo->push = &nvpb->base;
+	nvpb->kref[nvpb->krefs] = (struct mock_kref) { mbo, flags };
+	return &nvpb->kref[nvpb->krefs++];
+}
+
+static uint32_t
+mock_krel(struct nouveau_bo *bo, uint32_t data, uint32_t flags,
+	  uint32_t vor, uint32_t tor)
+{
+	if (flags & NOUVEAU_BO_LOW)
+		data += bo->offset;
+	else
+	if (flags & NOUVEAU_BO_HIGH)
+		data = (bo->offset + data) >> 32;
+
+	if (flags & NOUVEAU_BO_OR)
+		data |= (bo->flags & NOUVEAU_BO_VRAM) ? vor : tor;
+
+	return data;
+}
+
+static void
+mock_flush(struct mock_pushbuf *nvpb)
+{
+	struct nouveau_pushbuf *push = &nvpb->base;
+	struct mock_bufctx *bctx;
+	struct mock_bo *bo;
+	int i;
+
+	if (push->kick_notify)
+		push->kick_notify(push);
+
+	if (push->cur > nvpb->bgn)
+		mock_submit(nvpb, nvpb->bgn, push->cur - nvpb->bgn);
+	nvpb->bgn = push->cur;
+
+	for (i = 0; i < nvpb->krefs; i++) {
+		bo = nvpb->kref[i].bo;
+		if (bo->push == push)
+			bo->push = NULL;
+	}
+	nvpb->krefs = 0;
+
+	/* everything validated for this submission has to be again, bound
+	 * or not
+	 */
+	for (bctx = mock.bctx; bctx; bctx = bctx->next) {
+		if (bctx->validated == nvpb) {
+			mock_list_join(&bctx->base.current,
+				       &bctx->base.pending);
+			bctx->validated = NULL;
+		}
+	}
+}
+
+static int mock_validate(struct mock_pushbuf *nvpb);
+
+static int
+mock_space(struct mock_pushbuf *nvpb, uint32_t dwords)
+{
+	struct nouveau_pushbuf *push = &nvpb->base;
+
+	if (dwords + 2 + push->rsvd_kick > nvpb->size / 4)
+		return -EINVAL;
+
+	if (push->cur && push->cur + dwords < push->end)
+		return 0;
+
+	if (push->cur)
+		mock_flush(nvpb);
+
+	nvpb->bgn = nvpb->buf[nvpb->next];
+	nvpb->next = (nvpb->next + 1) % nvpb->nr;
+	push->cur = nvpb->bgn;
+	push->end = push->cur + nvpb->size / 4 - 2 - push->rsvd_kick;
+	return mock_validate(nvpb);
+}
+
+int
+nouveau_pushbuf_space(struct nouveau_pushbuf *push, uint32_t dwords,
+		      uint32_t relocs, uint32_t pushes)
+{
+	struct mock_pushbuf *nvpb = mock_pushbuf(push);
+
+	if (nvpb->fail_after) {
+		nvpb->fail_after--;
+	} else
+	if (nvpb->fail_count) {
+		nvpb->fail_count--;
+		return -ENOMEM;
+	}
+
+	return mock_space(nvpb, dwords);
+}
+
+/* libdrm's pushbuf_validate(), emitting the packets of whatever in the
+ * bound bufctx hasn't been validated for this submission yet
+ */
+static int
+mock_validate(struct mock_pushbuf *nvpb)
+{
+	struct nouveau_pushbuf *push = &nvpb->base;
+	struct mock_bufctx *bctx = (struct mock_bufctx *)push->bufctx;
+	struct nouveau_list *item;
+	int ret;
+
+	if (!bctx)
+		return 0;
+
+	ret = mock_space(nvpb, bctx->base.relocs * 2);
+	if (ret)
+		return ret;
+
+	/* space() may have switched buffers and validated all of it */
+	for (item = bctx->base.pending.next; item != &bctx->base.pending;
+	     item = item->next) {
+		struct nouveau_bufref *bref = &mock_bufref(item)->base;
+
+		mock_kref(nvpb, bref->bo, bref->flags);
+		if (bref->packet) {
+			*push->cur++ = bref->packet;
+			*push->cur++ = mock_krel(bref->bo, bref->data,
+						 bref->flags, bref->vor,
+						 bref->tor);
+		}
+	}
+
+	mock_list_join(&bctx->base.pending, &bctx->base.current);
+	bctx->validated = nvpb;
+	return 0;
+}
+
+int
+nouveau_pushbuf_validate(struct nouveau_pushbuf *push)
+{
+	return mock_validate(mock_pushbuf(push));
+}
+
+int
+nouveau_pushbuf_kick(struct nouveau_pushbuf *push, struct nouveau_object *chan)
+{
+	mock_flush(mock_pushbuf(push));
+	return mock_validate(mock_pushbuf(push));
+}
+
+int
+nouveau_pushbuf_refn(struct nouveau_pushbuf *push,
+		     struct nouveau_pushbuf_refn *refs, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++)
+		mock_kref(mock_pushbuf(push), refs[i].bo, refs[i].flags);
+	return 0;
+}
+
+uint32_t
+nouveau_pushbuf_refd(struct nouveau_pushbuf *push, struct nouveau_bo *bo)
+{
+	struct mock_pushbuf *nvpb = mock_pushbuf(push);
+	int i;
+
+	if (mock_bo(bo)->push != push)
+		return 0;
+
+	for (i = 0; i < nvpb->krefs; i++) {
+		if (nvpb->kref[i].bo == mock_bo(bo))
+			return nvpb->kref[i].flags & NOUVEAU_BO_RDWR;
+	}
+
+	return 0;
+}
+
+void
+nouveau_pushbuf_reloc(struct nouveau_pushbuf *push, struct nouveau_bo *bo,
+		      uint32_t data, uint32_t flags, uint32_t vor, uint32_t tor)
+{
+	if (!nouveau_pushbuf_refd(push, bo))
+		mock_error("reloc to a buffer the submission doesn't reference");
+	*push->cur++ = mock_krel(bo, data, flags, vor, tor);
+}
+
+void
+nouveau_pushbuf_data(struct nouveau_pushbuf *push, struct nouveau_bo *bo,
+		     uint64_t offset, uint64_t length)
+{
+	mock_error("nouveau_pushbuf_data() isn't modelled");
+}
+
+struct nouveau_bufctx *
+nouveau_pushbuf_bufctx(struct nouveau_pushbuf *push, struct nouveau_bufctx *ctx)
+{
+	struct nouveau_bufctx *prev = push->bufctx;
+
+	push->bufctx = ctx;
+	return prev;
+}
+
+int
+nouveau_pushbuf_new(struct nouveau_client *client, struct nouveau_object *chan,
+		    int nr, uint32_t size, bool immediate,
+		    struct nouveau_pushbuf **ppush)
+{
+	struct mock_pushbuf *nvpb = calloc(1, sizeof(*nvpb));
+	int i;
+
+	if (!nvpb || !mock_channel(chan))
+		return -EINVAL;
+
+	nvpb->base.client = client;
+	nvpb->base.channel = chan;
+	nvpb->nr = nr;
+	nvpb->size = size;
+	nvpb->buf = calloc(nr, sizeof(*nvpb->buf));
+	for (i = 0; i < nr; i++)
+		nvpb->buf[i] = calloc(1, size);
+
+	*ppush = &nvpb->base;
+	return mock_space(nvpb, 0);
+}
+
+/* Unsubmitted work is thrown away, as libdrm does */
+void
+nouveau_pushbuf_del(struct nouveau_pushbuf **ppush)
+{
+	struct mock_pushbuf *nvpb;
+	struct mock_bo *bo;
+	int i;
+
+	if (!*ppush)
+		return;
+
+	nvpb = mock_pushbuf(*ppush);
+	for (bo = mock.bos; bo; bo = bo->next) {
+		if (bo->push == *ppush)
+			bo->push = NULL;
+	}
+	for (i = 0; i < nvpb->nr; i++)
+		free(nvpb->buf[i]);
+	free(nvpb->buf);
+	free(nvpb->kref);
+	free(nvpb);
+	*ppush = NULL;
+}
+
+/* Have the pushbuf's next count reservations fail, after letting through
+ * after of them
+ */
+void
+mock_fail_space(struct nouveau_pushbuf *push, int after, int count)
+{
+	mock_pushbuf(push)->fail_after = after;
+	mock_pushbuf(push)->fail_count = count;
+}
+
+/* What has been submitted on the pushbuf's channel */
+void
+mock_pushbuf_stats(struct nouveau_pushbuf *push, struct mock_stats *stats)
+{
+	*stats = mock_channel(push->channel)->stats;
+}
+
+const uint32_t *
+mock_pushbuf_log(struct nouveau_pushbuf *push, uint64_t *words)
+{
+	struct mock_channel *chan = mock_channel(push->channel);
+
+	*words = chan->log_words;
+	return chan->log;
+}
+
+/* Buffer contexts */
+
+int
+nouveau_bufctx_new(struct nouveau_client *client, int bins,
+		   struct nouveau_bufctx **pbctx)
+{
+	struct mock_bufctx *bctx = calloc(1, sizeof(*bctx));
+	int i;
+
+	if (!bctx)
+		return -ENOMEM;
+
+	bctx->base.client = client;
+	mock_list_init(&bctx->base.head);
+	mock_list_init(&bctx->base.pending);
+	mock_list_init(&bctx->base.current);
+	bctx->bins = bins;
+	bctx->bin = calloc(bins, sizeof(*bctx->bin));
+	for (i = 0; i < bins; i++)
+		mock_list_init(&bctx->bin[i]);
+	bctx->next = mock.bctx;
+	mock.bctx = bctx;
+
+	*pbctx = &bctx->base;
+	return 0;
+}
+
+void
+nouveau_bufctx_del(struct nouveau_bufctx **pbctx)
+{
+	struct mock_bufctx *bctx = (struct mock_bufctx *)*pbctx, **p;
+	int i;
+
+	if (!bctx)
+		return;
+
+	for (p = &mock.bctx; *p != bctx; p = &(*p)->next)
+		;
+	*p = bctx->next;
+	for (i = 0; i < bctx->bins; i++)
+		nouveau_bufctx_reset(&bctx->base, i);
+	free(bctx->bin);
+	free(bctx);
+	*pbctx = NULL;
+}
+
+struct nouveau_bufref *
+nouveau_bufctx_refn(struct nouveau_bufctx *ctx, int bin,
+		    struct nouveau_bo *bo, uint32_t flags)
+{
+	struct mock_bufctx *bctx = (struct mock_bufctx *)ctx;
+	struct mock_bufref *bref = calloc(1, sizeof(*bref));
+
+	if (bin >= bctx->bins) {
+		mock_error("bufctx bin %d of %d", bin, bctx->bins);
+		free(bref);
+		return NULL;
+	}
+
+	if (!(flags & NOUVEAU_BO_APER))
+		flags |= bo->flags & NOUVEAU_BO_APER;
+
+	bref->base.bo = bo;
+	bref->base.flags = flags;
+	bref->bin = bin;
+	mock_list_add_tail(&bref->base.thead, &ctx->pending);
+	mock_list_add_tail(&bref->bin_head, &bctx->bin[bin]);
+	return &bref->base;
+}
+
+struct nouveau_bufref *
+nouveau_bufctx_mthd(struct nouveau_bufctx *ctx, int bin, uint32_t packet,
+		    struct nouveau_bo *bo, uint64_t data, uint32_t flags,
+		    uint32_t vor, uint32_t tor)
+{
+	struct nouveau_bufref *bref = nouveau_bufctx_refn(ctx, bin, bo, flags);
+
+	if (bref) {
+		bref->packet = packet;
+		bref->data = data;
+		bref->vor = vor;
+		bref->tor = tor;
+		ctx->relocs++;
+	}
+
+	return bref;
+}
+
+void
+nouveau_bufctx_reset(struct nouveau_bufctx *ctx, int bin)
+{
+	struct mock_bufctx *bctx = (struct mock_bufctx *)ctx;
+	struct nouveau_list *list = &bctx->bin[bin];
+
+	while (list->next != list) {
+		struct mock_bufref *bref = (struct mock_bufref *)
+			((char *)list->next -
+			 offsetof(struct mock_bufref, bin_head));
+
+		mock_list_del(&bref->bin_head);
+		mock_list_del(&bref->base.thead);
+		if (bref->base.packet)
+			ctx->relocs--;
+		free(bref);
+	}
+}
+
+/* Buffer objects */
+
+int
+nouveau_bo_new(struct nouveau_device *dev, uint32_t flags, uint32_t align,
+	       uint64_t size, union nouveau_bo_config *config,
+	       struct nouveau_bo **pbo)
+{
+	struct mock_bo *bo = calloc(1, sizeof(*bo));
+
+	if (!bo || !size)
+		return -EINVAL;
+
+	bo->mem = calloc(1, size);
+	if (!bo->mem) {
+		free(bo);
+		return -ENOMEM;
+	}
+
+	bo->base.device = dev;
+	bo->base.handle = ++mock.handle;
+	bo->base.size = size;
+	bo->base.flags = flags;
+	bo->base.offset = mock.va;
+	if (config)
+		bo->base.config = *config;
+	bo->refcnt = 1;
+
+	/* a gap after each, so running off the end doesn't land in another */
+	mock.va += (size + 2 * MOCK_VA_ALIGN - 1) & ~(MOCK_VA_ALIGN - 1);
+
+	nv_2d_map(&mock.nv2d, bo->base.offset, size, bo->mem);
+	bo->next = mock.bos;
+	mock.bos = bo;
+
+	*pbo = &bo->base;
+	return 0;
+}
+
+void
+nouveau_bo_ref(struct nouveau_bo *bo, struct nouveau_bo **pref)
+{
+	struct nouveau_bo *ref = *pref;
+
+	if (bo)
+		mock_bo(bo)->refcnt++;
+	if (ref && --mock_bo(ref)->refcnt == 0)
+		ref->map = NULL;
+	*pref = bo;
+}
+
+int
+nouveau_bo_wait(struct nouveau_bo *bo, uint32_t access,
+		struct nouveau_client *client)
+{
+	struct mock_bo *mbo = mock_bo(bo);
+
+	if (!(access & NOUVEAU_BO_RDWR))
+		return 0;
+
+	if (mbo->push)
+		nouveau_pushbuf_kick(mbo->push, mbo->push->channel);
+
+	if (!(mbo->access & NOUVEAU_BO_WR) && !(access & NOUVEAU_BO_WR))
+		return 0;
+
+	if (mock_bo_busy(mbo)) {
+		if (access & NOUVEAU_BO_NOBLOCK)
+			return -EBUSY;
+
+		mock_run();
+		if (mock_bo_busy(mbo)) {
+			mock_error("waiting for a buffer the GPU never gets to");
+			return -EDEADLK;
+		}
+	}
+
+	mbo->access = 0;
+	return 0;
+}
+
+int
+nouveau_bo_map(struct nouveau_bo *bo, uint32_t access,
+	       struct nouveau_client *client)
+{
+	bo->map = mock_bo(bo)->mem;
+	return nouveau_bo_wait(bo, access, client);
+}
+
+int
+nouveau_bo_prime_handle_ref(struct nouveau_device *dev, int prime_fd,
+			    struct nouveau_bo **pbo)
+{
+	return -ENOSYS;
+}
+
+int
+nouveau_bo_set_prime(struct nouveau_bo *bo, int *prime_fd)
+{
+	return -ENOSYS;
+}
+
+/* Objects */
+
+int
+nouveau_object_new(struct nouveau_object *parent, uint64_t handle,
+		   uint32_t oclass, void *data, uint32_t length,
+		   struct nouveau_object **pobj)
+{
+	struct mock_channel *chan;
+	struct nouveau_object *obj;
+	int i;
+
+	if (oclass == NOUVEAU_FIFO_CHANNEL_CLASS) {
+		chan = calloc(1, sizeof(*chan));
+		if (!chan || length > sizeof(chan->fifo))
+			return -EINVAL;
+
+		memcpy(&chan->fifo, data, length);
+		chan->fifo.nv04.base.channel = mock.channels;
+		chan->fifo.nv04.base.object = &chan->base;
+		chan->id = mock.channels++;
+		chan->base.parent = parent;
+		chan->base.handle = handle;
+		chan->base.oclass = oclass;
+		chan->base.data = &chan->fifo;
+		chan->base.length = length;
+		chan->tail = &chan->queue;
+
+		nv_decode_init(&chan->dec, mock.dev.chipset, NULL);
+		chan->dec.method = mock_decoded;
+		chan->dec.priv = chan;
+
+		/* new channels go to the back of the queue */
+		chan->next = NULL;
+		if (!mock.chan) {
+			mock.chan = chan;
+		} else {
+			struct mock_channel *last = mock.chan;
+
+			while (last->next)
+				last = last->next;
+			last->next = chan;
+		}
+
+		*pobj = &chan->base;
+		return 0;
+	}
+
+	if (mock.classes && oclass != NOUVEAU_NOTIFIER_CLASS) {
+		for (i = 0; mock.classes[i]; i++) {
+			if (mock.classes[i] == oclass)
+				break;
+		}
+		if (!mock.classes[i])
+			return -ENODEV;
+	}
+
+	obj = calloc(1, sizeof(*obj));
+	if (!obj)
+		return -ENOMEM;
+
+	obj->parent = parent;
+	obj->handle = handle;
+	obj->oclass = oclass;
+
+	chan = mock_channel(parent);
+	if (chan)
+		nv_decode_object(&chan->dec, handle, oclass);
+
+	*pobj = obj;
+	return 0;
+}
+
+void
+nouveau_object_del(struct nouveau_object **pobj)
+{
+	struct mock_channel *chan, **p;
+
+	if (!*pobj)
+		return;
+
+	chan = mock_channel(*pobj);
+	if (chan) {
+		if (mock_run() && chan->queue)
+			mock_error("channel %d deleted with work queued",
+				   chan->id);
+		for (p = &mock.chan; *p != chan; p = &(*p)->next)
+			;
+		*p = chan->next;
+		free(chan->log);
+		free(chan->vtx);
+		free(chan);
+	} else {
+		free(*pobj);
+	}
+
+	*pobj = NULL;
+}
+
+int
+nouveau_client_new(struct nouveau_device *dev, struct nouveau_client **pcli)
+{
+	struct nouveau_client *client = calloc(1, sizeof(*client));
+
+	if (!client)
+		return -ENOMEM;
+
+	client->device = dev;
+	*pcli = client;
+	return 0;
+}
+
+void
+nouveau_client_del(struct nouveau_client **pcli)
+{
+	free(*pcli);
+	*pcli = NULL;
+}
+
+/* classes is a 0-terminated list of those that can be created, NULL for
+ * any at all
+ */
+struct nouveau_device *
+mock_device(uint32_t chipset, const uint32_t *classes)
+{
+	memset(&mock.dev, 0, sizeof(mock.dev));
+	mock.dev.object.oclass = NOUVEAU_DEVICE_CLASS;
+	mock.dev.drm_version = 0x01000000;
+	mock.dev.chipset = chipset;
+	mock.dev.vram_size = 256 << 20;
+	mock.dev.gart_size = 256 << 20;
+	mock.dev.vram_limit = mock.dev.vram_size;
+	mock.dev.gart_limit = mock.dev.gart_size;
+	mock.classes = classes;
+	mock.va = MOCK_VA_BASE;
+	mock.gpu_ns = 0;
+
+	nv_2d_init(&mock.nv2d, chipset);
+	mock.nv2d.draw = mock_draw;
+	return &mock.dev;
+}
+
+void
+mock_device_fini(void)
+{
+	struct mock_bo *bo;
+
+	mock_finish();
+
+	while (mock.chan) {
+		struct mock_channel *chan = mock.chan;
+
+		mock.chan = chan->next;
+		free(chan->log);
+		free(chan->vtx);
+		free(chan);
+	}
+
+	while ((bo = mock.bos)) {
+		if (bo->refcnt)
+			mock_error("bo %u leaked, %d references",
+				   bo->base.handle, bo->refcnt);
+		mock.bos = bo->next;
+		free(bo->mem);
+		free(bo);
+	}
+
+	nv_2d_fini(&mock.nv2d);
+	nv_decode_fini();
+	mock.channels = 0;
+	mock.handle = 0;
+}
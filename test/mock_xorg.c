@@ -0,0 +1,658 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* The parts of the X server and EXA the acceleration code calls into, and
+ * a screen brought up the way NVScreenInit() does it, see mock.h.  Only
+ * one screen at a time.
+ */
+
+#include <stdarg.h>
+
+#include "mock.h"
+#include "nv_const.h"
+#include "nouveau_capture.h"
+#include "nouveau_copy.h"
+#include "nouveau_trace.h"
+
+ExaDriverPtr mock_exa;
+CARD64 mock_time_us = 1000000;
+ClientPtr serverClient;
+struct mock_render mock_render;
+
+/* The screen's PictureScreenRec is its only private */
+DevPrivateKeyRec PictureScreenPrivateKeyRec = { .initialized = TRUE };
+
+static struct {
+	ScreenPtr pScreen;
+	ScrnInfoPtr pScrn;
+	PictureScreenRec ps;
+	void *privates[1];
+} mock_x;
+
+static const char *mock_options[OPTION_ACCEL_TRACE + 1];
+
+struct mock_pixmap {
+	PixmapRec pix;
+	void *priv;
+};
+
+struct mock_picture {
+	PictureRec pict;
+	RegionRec clip;
+	PictTransform transform;
+	SourcePict source;
+};
+
+static PictFormatRec mock_formats[] = {
+	{ .id = 1, .type = PictTypeDirect, .depth = 32,
+	  .format = PICT_a8r8g8b8 },
+	{ .id = 2, .type = PictTypeDirect, .depth = 24,
+	  .format = PICT_x8r8g8b8 },
+	{ .id = 3, .type = PictTypeDirect, .depth = 8, .format = PICT_a8 },
+};
+
+/* Options, all unset until set here, and kept from one screen to the next */
+void
+mock_option(int token, const char *value)
+{
+	mock_options[token] = value;
+}
+
+const char *
+xf86GetOptValString(const OptionInfoRec *table, int token)
+{
+	return mock_options[token];
+}
+
+Bool
+xf86IsOptionSet(const OptionInfoRec *table, int token)
+{
+	return mock_options[token] != NULL;
+}
+
+Bool
+xf86ReturnOptValBool(const OptionInfoRec *table, int token, Bool def)
+{
+	const char *value = mock_options[token];
+
+	if (!value)
+		return def;
+
+	return !strcmp(value, "on") || !strcmp(value, "true") ||
+	       !strcmp(value, "1");
+}
+
+/* Logging, only errors are of interest */
+void
+xf86DrvMsg(int scrnIndex, MessageType type, const char *format, ...)
+{
+	va_list ap;
+
+	if (type != X_ERROR)
+		return;
+
+	va_start(ap, format);
+	vfprintf(stderr, format, ap);
+	va_end(ap);
+}
+
+void
+VErrorF(const char *format, va_list ap)
+{
+	vfprintf(stderr, format, ap);
+}
+
+void
+ErrorF(const char *format, ...)
+{
+	va_list ap;
+
+	va_start(ap, format);
+	VErrorF(format, ap);
+	va_end(ap);
+}
+
+/* Time only moves when a test moves it */
+CARD64
+GetTimeInMicros(void)
+{
+	return mock_time_us;
+}
+
+CARD32
+GetTimeInMillis(void)
+{
+	return mock_time_us / 1000;
+}
+
+Atom
+MakeAtom(const char *string, unsigned len, Bool makeit)
+{
+	return 1;
+}
+
+OsSigHandlerPtr
+OsSignal(int sig, OsSigHandlerPtr handler)
+{
+	return NULL;
+}
+
+int
+dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
+			Atom type, int format, int mode, unsigned long len,
+			const void *value, Bool sendevent)
+{
+	return Success;
+}
+
+ScrnInfoPtr
+xf86ScreenToScrn(ScreenPtr pScreen)
+{
+	return pScreen == mock_x.pScreen ? mock_x.pScrn : NULL;
+}
+
+void *
+xf86LoadSubModule(ScrnInfoPtr pScrn, const char *name)
+{
+	return pScrn;
+}
+
+/* EXA */
+ExaDriverPtr
+exaDriverAlloc(void)
+{
+	return calloc(1, sizeof(ExaDriverRec));
+}
+
+Bool
+exaDriverInit(ScreenPtr pScreen, ExaDriverPtr exa)
+{
+	mock_exa = exa;
+	return TRUE;
+}
+
+void
+exaDriverFini(ScreenPtr pScreen)
+{
+	mock_exa = NULL;
+}
+
+void *
+exaGetPixmapDriverPrivate(PixmapPtr ppix)
+{
+	return ((struct mock_pixmap *)ppix)->priv;
+}
+
+unsigned long
+exaGetPixmapPitch(PixmapPtr ppix)
+{
+	return ppix->devKind;
+}
+
+void
+exaMoveInPixmap(PixmapPtr ppix)
+{
+}
+
+/* Render */
+PictFormatPtr
+PictureMatchFormat(ScreenPtr pScreen, int depth, PictFormatShort format)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(mock_formats); i++) {
+		if (mock_formats[i].format == format &&
+		    mock_formats[i].depth == depth)
+			return &mock_formats[i];
+	}
+
+	return NULL;
+}
+
+PicturePtr
+CreatePicture(Picture pid, DrawablePtr pDrawable, PictFormatPtr pFormat,
+	      Mask vmask, XID *vlist, ClientPtr client, int *error)
+{
+	struct mock_picture *mpict = calloc(1, sizeof(*mpict));
+	int bit;
+
+	mpict->pict.pDrawable = pDrawable;
+	mpict->pict.pFormat = pFormat;
+	mpict->pict.format = pFormat->format;
+	mpict->pict.refcnt = 1;
+
+	/* one value per attribute, in the order of their bits */
+	for (bit = 0; bit <= 12; bit++) {
+		XID v;
+
+		if (!(vmask & (1 << bit)))
+			continue;
+
+		v = *vlist++;
+		switch (1 << bit) {
+		case CPRepeat:
+			mpict->pict.repeat = v != RepeatNone;
+			mpict->pict.repeatType = v;
+			break;
+		case CPSubwindowMode:
+			mpict->pict.subWindowMode = v;
+			break;
+		case CPComponentAlpha:
+			mpict->pict.componentAlpha = v;
+			break;
+		default:
+			mock_error("CreatePicture() attribute 0x%x", 1 << bit);
+			break;
+		}
+	}
+
+	mpict->clip.extents.x1 = pDrawable->x;
+	mpict->clip.extents.y1 = pDrawable->y;
+	mpict->clip.extents.x2 = pDrawable->x + pDrawable->width;
+	mpict->clip.extents.y2 = pDrawable->y + pDrawable->height;
+	mpict->pict.pCompositeClip = &mpict->clip;
+
+	*error = Success;
+	return &mpict->pict;
+}
+
+PicturePtr
+CreateSolidPicture(Picture pid, xRenderColor *color, int *error)
+{
+	struct mock_picture *mpict = calloc(1, sizeof(*mpict));
+
+	mpict->source.type = SourcePictTypeSolidFill;
+	mpict->source.solidFill.color = (CARD32)(color->alpha >> 8) << 24 |
+					(color->red >> 8) << 16 |
+					(color->green >> 8) << 8 |
+					(color->blue >> 8);
+	mpict->pict.pSourcePict = &mpict->source;
+	mpict->pict.format = PICT_a8r8g8b8;
+	mpict->pict.refcnt = 1;
+
+	*error = Success;
+	return &mpict->pict;
+}
+
+int
+FreePicture(void *value, XID pid)
+{
+	PicturePtr ppict = value;
+
+	if (!--ppict->refcnt) {
+		free(ppict->filter_params);
+		free(ppict);
+	}
+	return Success;
+}
+
+void
+ValidatePicture(PicturePtr ppict)
+{
+}
+
+int
+SetPictureTransform(PicturePtr ppict, PictTransform *transform)
+{
+	static const PictTransform identity = {{
+		{ xFixed1, 0, 0 }, { 0, xFixed1, 0 }, { 0, 0, xFixed1 }
+	}};
+	struct mock_picture *mpict = (struct mock_picture *)ppict;
+
+	ppict->transform = NULL;
+	if (transform && memcmp(transform, &identity, sizeof(identity))) {
+		mpict->transform = *transform;
+		ppict->transform = &mpict->transform;
+	}
+
+	return Success;
+}
+
+int
+SetPictureFilter(PicturePtr ppict, char *name, int len, xFixed *params,
+		 int nparams)
+{
+	static const struct {
+		const char *name;
+		int filter;
+	} filters[] = {
+		{ "nearest", PictFilterNearest },
+		{ "bilinear", PictFilterBilinear },
+		{ FilterConvolution, PictFilterConvolution },
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(filters); i++) {
+		if (strlen(filters[i].name) == len &&
+		    !memcmp(filters[i].name, name, len))
+			break;
+	}
+
+	if (i == ARRAY_SIZE(filters)) {
+		mock_error("SetPictureFilter() filter %.*s", len, name);
+		return BadName;
+	}
+
+	free(ppict->filter_params);
+	ppict->filter_params = NULL;
+	ppict->filter_nparams = 0;
+	if (nparams) {
+		ppict->filter_params = malloc(nparams * sizeof(*params));
+		memcpy(ppict->filter_params, params, nparams * sizeof(*params));
+		ppict->filter_nparams = nparams;
+	}
+
+	ppict->filter = filters[i].filter;
+	return Success;
+}
+
+void
+CompositePicture(CARD8 op, PicturePtr pSrc, PicturePtr pMask,
+		 PicturePtr pDst, INT16 xSrc, INT16 ySrc, INT16 xMask,
+		 INT16 yMask, INT16 xDst, INT16 yDst, CARD16 width,
+		 CARD16 height)
+{
+	PictureScreenPtr ps = GetPictureScreen(pDst->pDrawable->pScreen);
+
+	ps->Composite(op, pSrc, pMask, pDst, xSrc, ySrc, xMask, yMask,
+		      xDst, yDst, width, height);
+}
+
+/* Read back what the GPU drew into an A8 pixmap */
+static uint8_t *
+mock_read_a8(DrawablePtr pDraw, int x, int y, int width, int height)
+{
+	PixmapPtr ppix = (PixmapPtr)pDraw;
+	struct nouveau_bo *bo = nouveau_pixmap_bo(ppix);
+	uint8_t *data;
+	int i, j;
+
+	if (pDraw->type != DRAWABLE_PIXMAP || !bo ||
+	    x < 0 || y < 0 || x + width > pDraw->width ||
+	    y + height > pDraw->height) {
+		mock_error("can't read back a %dx%d A8 mask at (%d,%d)",
+			   width, height, x, y);
+		return NULL;
+	}
+
+	nouveau_bo_map(bo, NOUVEAU_BO_RD, NVPTR(mock_x.pScrn)->client);
+	data = malloc(width * height);
+	for (j = 0; j < height; j++) {
+		for (i = 0; i < width; i++) {
+			data[j * width + i] =
+				*mock_pixel(bo, exaGetPixmapPitch(ppix), 1,
+					    x + i, y + j);
+		}
+	}
+
+	return data;
+}
+
+/* What EXA would do with a composite of pixmaps, less the clipping */
+static void
+mock_exa_composite(CARD8 op, PicturePtr pSrc, PicturePtr pMask,
+		   PicturePtr pDst, INT16 xSrc, INT16 ySrc, INT16 xMask,
+		   INT16 yMask, INT16 xDst, INT16 yDst, CARD16 width,
+		   CARD16 height)
+{
+	PixmapPtr pspix = (PixmapPtr)pSrc->pDrawable;
+	PixmapPtr pmpix = pMask ? (PixmapPtr)pMask->pDrawable : NULL;
+	PixmapPtr pdpix = (PixmapPtr)pDst->pDrawable;
+
+	if (!mock_exa->CheckComposite(op, pSrc, pMask, pDst) ||
+	    !mock_exa->PrepareComposite(op, pSrc, pMask, pDst,
+					pspix, pmpix, pdpix)) {
+		mock_render.fallbacks++;
+		return;
+	}
+
+	mock_exa->Composite(pdpix, xSrc, ySrc, xMask, yMask, xDst, yDst,
+			    width, height);
+	mock_exa->DoneComposite(pdpix);
+}
+
+static void
+mock_composite(CARD8 op, PicturePtr pSrc, PicturePtr pMask, PicturePtr pDst,
+	       INT16 xSrc, INT16 ySrc, INT16 xMask, INT16 yMask,
+	       INT16 xDst, INT16 yDst, CARD16 width, CARD16 height)
+{
+	mock_render.composites++;
+	mock_render.op = op;
+	mock_render.xSrc = xSrc;
+	mock_render.ySrc = ySrc;
+	mock_render.xMask = xMask;
+	mock_render.yMask = yMask;
+	mock_render.xDst = xDst;
+	mock_render.yDst = yDst;
+	mock_render.width = width;
+	mock_render.height = height;
+
+	if (mock_render.exa)
+		mock_exa_composite(op, pSrc, pMask, pDst, xSrc, ySrc,
+				   xMask, yMask, xDst, yDst, width, height);
+
+	free(mock_render.mask);
+	mock_render.mask = NULL;
+	if (pMask && pMask->pDrawable && pMask->format == PICT_a8)
+		mock_render.mask = mock_read_a8(pMask->pDrawable, xMask, yMask,
+						width, height);
+}
+
+PicturePtr
+mock_picture(PixmapPtr ppix, CARD32 format)
+{
+	PictFormatPtr pFormat;
+	int error;
+
+	pFormat = PictureMatchFormat(ppix->drawable.pScreen,
+				     ppix->drawable.depth, format);
+	if (!pFormat) {
+		mock_error("no depth %d format 0x%08x", ppix->drawable.depth,
+			   format);
+		return NULL;
+	}
+
+	return CreatePicture(0, &ppix->drawable, pFormat, 0, NULL,
+			     serverClient, &error);
+}
+
+/* The rest of the driver */
+void
+NVXVComputeBicubicFilter(struct nouveau_bo *bo, unsigned offset,
+			 unsigned size)
+{
+}
+
+int
+drmmode_head(xf86CrtcPtr crtc)
+{
+	return 0;
+}
+
+xf86CrtcPtr
+nouveau_pick_best_crtc(ScrnInfoPtr pScrn, Bool consider_disabled,
+		       int x, int y, int w, int h)
+{
+	return NULL;
+}
+
+static PixmapPtr
+mock_screen_pixmap(ScreenPtr pScreen)
+{
+	return NULL;
+}
+
+static PixmapPtr
+mock_create_pixmap(ScreenPtr pScreen, int width, int height, int depth,
+		   unsigned usage)
+{
+	return mock_pixmap(pScreen, width, height, depth);
+}
+
+static Bool
+mock_destroy_pixmap(PixmapPtr ppix)
+{
+	if (!--ppix->refcnt)
+		mock_pixmap_free(ppix);
+	return TRUE;
+}
+
+ScreenPtr
+mock_screen(uint32_t chipset, const uint32_t *classes)
+{
+	ScreenPtr pScreen = calloc(1, sizeof(*pScreen));
+	ScrnInfoPtr pScrn = calloc(1, sizeof(*pScrn));
+	NVPtr pNv = calloc(1, sizeof(*pNv));
+
+	mock_x.pScreen = pScreen;
+	mock_x.pScrn = pScrn;
+	mock_x.ps.Composite = mock_composite;
+	mock_x.privates[0] = &mock_x.ps;
+	pScreen->devPrivates = (void *)mock_x.privates;
+	pScreen->GetScreenPixmap = mock_screen_pixmap;
+	pScreen->CreatePixmap = mock_create_pixmap;
+	pScreen->DestroyPixmap = mock_destroy_pixmap;
+	pScrn->pScreen = pScreen;
+	pScrn->driverPrivate = pNv;
+	pScrn->depth = 24;
+	pScrn->bitsPerPixel = 32;
+
+	pNv->dev = mock_device(chipset, classes);
+	nouveau_client_new(pNv->dev, &pNv->client);
+	pNv->AccelMethod = EXA;
+
+	switch (chipset & ~0xf) {
+	case 0x40:
+	case 0x60:
+		pNv->Architecture = NV_ARCH_40;
+		break;
+	case 0x50:
+	case 0x80:
+	case 0x90:
+	case 0xa0:
+		pNv->Architecture = NV_TESLA;
+		break;
+	case 0xc0:
+	case 0xd0:
+		pNv->Architecture = NV_FERMI;
+		break;
+	default:
+		pNv->Architecture = NV_KEPLER;
+		break;
+	}
+
+	pNv->ce_enabled =
+		xf86ReturnOptValBool(pNv->Options, OPTION_ASYNC_COPY, TRUE);
+
+	if (!NVAccelCommonInit(pScrn)) {
+		mock_error("NVAccelCommonInit() failed");
+		return pScreen;
+	}
+
+	nouveau_copy_init(pScreen);
+	nouveau_state_init(pScreen);
+	nouveau_timing_init(pScreen);
+	nouveau_fallback_init(pScreen);
+	nouveau_push_init(pScreen);
+	nouveau_capture_init(pScreen);
+
+	if (!nouveau_exa_init(pScreen)) {
+		mock_error("nouveau_exa_init() failed");
+		return pScreen;
+	}
+
+	nouveau_render_init(pScreen);
+	return pScreen;
+}
+
+void
+mock_screen_fini(ScreenPtr pScreen)
+{
+	ScrnInfoPtr pScrn = xf86ScreenToScrn(pScreen);
+	NVPtr pNv = NVPTR(pScrn);
+
+	nouveau_render_fini(pScreen);
+	nouveau_trace_fini(pScreen);
+	nouveau_capture_fini(pScreen);
+	nouveau_push_fini(pScreen);
+	nouveau_timing_fini(pScreen);
+	nouveau_fallback_fini(pScreen);
+	nouveau_state_fini(pScreen);
+	nouveau_copy_fini(pScreen);
+	NVAccelCommonFini(pScrn);
+	if (pNv->EXADriverPtr) {
+		exaDriverFini(pScreen);
+		free(pNv->EXADriverPtr);
+	}
+	nouveau_bo_ref(NULL, &pNv->transfer);
+
+	nouveau_client_del(&pNv->client);
+	mock_device_fini();
+
+	free(pNv);
+	free(pScrn);
+	free(pScreen);
+	memset(&mock_x, 0, sizeof(mock_x));
+	free(mock_render.mask);
+	memset(&mock_render, 0, sizeof(mock_render));
+}
+
+PixmapPtr
+mock_pixmap(ScreenPtr pScreen, int width, int height, int depth)
+{
+	return mock_pixmap_hint(pScreen, width, height, depth, 0);
+}
+
+PixmapPtr
+mock_pixmap_hint(ScreenPtr pScreen, int width, int height, int depth,
+		 unsigned usage)
+{
+	struct mock_pixmap *mpix = calloc(1, sizeof(*mpix));
+	int bpp = depth <= 8 ? 8 : depth <= 16 ? 16 : 32, pitch = 0;
+
+	mpix->priv = mock_exa->CreatePixmap2(pScreen, width, height, depth,
+					     usage, bpp, &pitch);
+	if (!mpix->priv) {
+		mock_error("couldn't create a %dx%d pixmap", width, height);
+		free(mpix);
+		return NULL;
+	}
+
+	mpix->pix.drawable.type = DRAWABLE_PIXMAP;
+	mpix->pix.drawable.depth = depth;
+	mpix->pix.drawable.bitsPerPixel = bpp;
+	mpix->pix.drawable.width = width;
+	mpix->pix.drawable.height = height;
+	mpix->pix.drawable.pScreen = pScreen;
+	mpix->pix.refcnt = 1;
+	mpix->pix.devKind = pitch;
+	return &mpix->pix;
+}
+
+void
+mock_pixmap_free(PixmapPtr ppix)
+{
+	struct mock_pixmap *mpix = (struct mock_pixmap *)ppix;
+
+	mock_exa->DestroyPixmap(ppix->drawable.pScreen, mpix->priv);
+	free(mpix);
+}
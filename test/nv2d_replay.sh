@@ -0,0 +1,11 @@
+#!/bin/sh
+# Replay nv50_2d.capture, the NV50 depth 24 run of diff_2d at seed 1,
+# through the software 2D engine and check every surface comes out the
+# way it did when the capture was taken.  It was compared with pixman
+# then, so a change here is in nv_2d.c or in the capture decoder.
+
+out=nv2d_replay.out
+
+"$NV2D_REPLAY" "$srcdir/nv50_2d.capture" > $out || exit 1
+diff -u "$srcdir/nv50_2d.expected" $out || exit 1
+rm -f $out
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* nouveau_push.c's word and submission counts, and the pushbuf capture,
+ * against what libdrm really submitted.  On NV40, where the surface
+ * offsets are bufctx methods libdrm writes again at the top of every
+ * buffer, through every way a submission happens: explicit kicks, full
+ * buffers, mapping a buffer the pushbuf uses and resizing the pushbuf.
+ */
+
+#include <unistd.h>
+
+#include "mock.h"
+#include "nouveau_capture.h"
+
+static char capture_name[] = "/tmp/nouveau-push-count-XXXXXX";
+
+/* the PUSH words captured for the main channel, channel 0 */
+static uint32_t *
+capture_words(uint64_t *nr)
+{
+	FILE *f = fopen(capture_name, "rb");
+	uint32_t head[3], rec[2], *words = NULL;
+
+	*nr = 0;
+	if (!f || fread(head, 4, 3, f) != 3 ||
+	    head[0] != NOUVEAU_CAPTURE_MAGIC) {
+		mock_error("can't read the capture");
+		if (f)
+			fclose(f);
+		return NULL;
+	}
+
+	while (fread(rec, 4, 2, f) == 2) {
+		uint32_t *data = malloc(rec[1] * 4);
+
+		if (fread(data, 4, rec[1], f) != rec[1]) {
+			mock_error("capture truncated");
+			free(data);
+			break;
+		}
+
+		if (rec[0] == NOUVEAU_CAPTURE_PUSH && rec[1] && !data[0]) {
+			words = realloc(words, (*nr + rec[1]) * 4);
+			memcpy(words + *nr, data + 1, (rec[1] - 1) * 4);
+			*nr += rec[1] - 1;
+		}
+		free(data);
+	}
+
+	fclose(f);
+	return words;
+}
+
+static void
+solids(PixmapPtr ppix, int nr, int size)
+{
+	int i;
+
+	MOCK_CHECK(mock_exa->PrepareSolid(ppix, GXcopy, ~0, 0x00ff00ff));
+	for (i = 0; i < nr; i++) {
+		int x = (i * 7) % (ppix->drawable.width - size);
+		int y = (i * 13) % (ppix->drawable.height - size);
+
+		mock_exa->Solid(ppix, x, y, x + size, y + size);
+	}
+	mock_exa->DoneSolid(ppix);
+}
+
+int
+main(void)
+{
+	ScreenPtr pScreen;
+	NVPtr pNv;
+	PixmapPtr ppix;
+	struct nouveau_pushbuf *old;
+	struct mock_stats s0, s1;
+	uint64_t words0, words1, log0, log1, cap0, cap1;
+	unsigned kicks0, kicks1, split;
+	const uint32_t *log;
+	uint32_t *cap;
+	int fd, i;
+
+	fd = mkstemp(capture_name);
+	if (fd < 0)
+		return 77;
+	close(fd);
+
+	mock_option(OPTION_PUSHBUF_CAPTURE, capture_name);
+	pScreen = mock_screen(0x46, NULL);
+	pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	ppix = mock_pixmap(pScreen, 256, 256, 24);
+	MOCK_CHECK(ppix);
+	if (!ppix)
+		goto out;
+
+	PUSH_KICK(pNv->pushbuf);
+	nouveau_push_count(pNv, &words0, &kicks0);
+	mock_pushbuf_stats(pNv->pushbuf, &s0);
+	mock_pushbuf_log(pNv->pushbuf, &log0);
+	free(capture_words(&cap0));
+
+	/* once an operation's size is known, room is made for it before it
+	 * starts, so one that fits in a buffer goes out in one submission
+	 */
+	solids(ppix, 300, 4);
+	split = pNv->push[NOUVEAU_PUSH_MAIN].split;
+	for (i = 0; i < 100; i++)
+		solids(ppix, 300, 4);
+	MOCK_CHECK(pNv->push[NOUVEAU_PUSH_MAIN].split == split);
+	MOCK_CHECK(pNv->push[NOUVEAU_PUSH_MAIN].kicks[NOUVEAU_PUSH_FULL] > 10);
+
+	/* enough small rects to fill several buffers */
+	solids(ppix, 10000, 4);
+
+	/* big ones, each kicked on its own, then a kick with nothing to
+	 * submit
+	 */
+	solids(ppix, 20, 64);
+	PUSH_KICK(pNv->pushbuf);
+	PUSH_KICK(pNv->pushbuf);
+
+	/* mapping a buffer the pushbuf uses submits it */
+	solids(ppix, 100, 4);
+	MOCK_CHECK(!nouveau_bo_map(nouveau_pixmap_bo(ppix), NOUVEAU_BO_RDWR,
+				   pNv->client));
+
+	/* it filled up often enough to be swapped for a bigger one */
+	solids(ppix, 10000, 4);
+	old = pNv->pushbuf;
+	mock_time_us += 2000000;
+	nouveau_push_update(pScreen);
+	MOCK_CHECK(pNv->pushbuf != old);
+	solids(ppix, 10000, 4);
+
+	PUSH_KICK(pNv->pushbuf);
+	nouveau_push_count(pNv, &words1, &kicks1);
+	mock_pushbuf_stats(pNv->pushbuf, &s1);
+	log = mock_pushbuf_log(pNv->pushbuf, &log1);
+	cap = capture_words(&cap1);
+
+	if (words1 - words0 != s1.words - s0.words)
+		mock_error("counted %llu words, %llu were submitted",
+			   (unsigned long long)(words1 - words0),
+			   (unsigned long long)(s1.words - s0.words));
+	if (kicks1 - kicks0 != s1.submissions - s0.submissions)
+		mock_error("counted %u submissions, there were %u",
+			   kicks1 - kicks0, s1.submissions - s0.submissions);
+	if (s1.submissions - s0.submissions < 30)
+		mock_error("only %u submissions", s1.submissions - s0.submissions);
+
+	if (cap1 - cap0 != log1 - log0)
+		mock_error("captured %llu words, %llu were submitted",
+			   (unsigned long long)(cap1 - cap0),
+			   (unsigned long long)(log1 - log0));
+	else
+	if (memcmp(cap + cap0, log + log0, (cap1 - cap0) * 4))
+		mock_error("capture differs from what was submitted");
+	free(cap);
+
+	mock_pixmap_free(ppix);
+out:
+	mock_screen_fini(pScreen);
+	unlink(capture_name);
+
+	if (mock_errors)
+		fprintf(stderr, "push_count: %u errors\n", mock_errors);
+	return mock_errors ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* The transfer planner in nouveau_exa.c on Kepler, with the main channel
+ * and the copy engine moving bytes at different rates on the mock GPU:
+ *
+ * - uploads alone calibrate both engines' models to those rates
+ * - once they have, the planner sticks to the faster engine for big
+ *   transfers, only leaving it to time the other now and then, and keeps
+ *   small ones on the main channel
+ * - transfers big enough to be cut into chunks arrive intact both ways
+ */
+
+#include "mock.h"
+#include "nv_const.h"
+
+#define RATE_MAIN 1000		/* bytes/us */
+#define RATE_CE   8000
+
+static void
+fill(uint32_t *data, int w, int h, uint32_t seed)
+{
+	int i;
+
+	for (i = 0; i < w * h; i++)
+		data[i] = (i * 2654435761u) ^ seed;
+}
+
+static int
+upload(ScreenPtr pScreen, PixmapPtr ppix, const uint32_t *data, int w, int h)
+{
+	NVPtr pNv = NVPTR(xf86ScreenToScrn(pScreen));
+
+	MOCK_CHECK(mock_exa->UploadToScreen(ppix, 0, 0, w, h, (char *)data,
+					    w * 4));
+
+	/* what the block handler and the GPU would get round to before
+	 * the next one, a frame later
+	 */
+	PUSH_KICK(pNv->pushbuf);
+	PUSH_KICK(pNv->ce_pushbuf);
+	mock_finish();
+	mock_time_us += 16000;
+	return pNv->xfer_engine;
+}
+
+static void
+check_rate(NVPtr pNv, int engine, int tiled, int want, const char *name)
+{
+	int rate = pNv->xfer_rate[engine][tiled];
+
+	if (rate < want * 9 / 10 || rate > want * 11 / 10)
+		mock_error("%s modelled at %d bytes/us, not %d", name, rate,
+			   want);
+}
+
+int
+main(void)
+{
+	static uint32_t data[1024 * 512], out[1024 * 512];
+	ScreenPtr pScreen;
+	NVPtr pNv;
+	PixmapPtr a, big;
+	int i, tiled, engine, last, switches, bad;
+
+	mock_option(OPTION_ASYNC_COPY, "on");
+	pScreen = mock_screen(0xe4, NULL);
+	pNv = NVPTR(xf86ScreenToScrn(pScreen));
+	MOCK_CHECK(pNv->ce_rect && pNv->xfer_bo);
+	mock_rate(pNv->channel, RATE_MAIN);
+	mock_rate(pNv->ce_channel, RATE_CE);
+
+	a = mock_pixmap(pScreen, 128, 128, 24);
+	big = mock_pixmap(pScreen, 1024, 512, 24);
+	MOCK_CHECK(a && big);
+	if (!a || !big)
+		goto out;
+	tiled = nouveau_pixmap_bo(a)->config.nvc0.memtype != 0;
+
+	/* 64KiB each, just big enough to be timed */
+	fill(data, 128, 128, 1);
+	for (i = 0; i < 400; i++)
+		upload(pScreen, a, data, 128, 128);
+	check_rate(pNv, NOUVEAU_XFER_MAIN, tiled, RATE_MAIN, "main channel");
+	check_rate(pNv, NOUVEAU_XFER_CE, tiled, RATE_CE, "copy engine");
+
+	/* only probes of the main channel leave the copy engine */
+	last = NOUVEAU_XFER_CE;
+	switches = 0;
+	for (i = 0; i < 256; i++) {
+		engine = upload(pScreen, a, data, 128, 128);
+		if (engine != last)
+			switches++;
+		last = engine;
+	}
+	if (switches > 2 * (256 / 64 + 1))
+		mock_error("changed engines %d times in 256 transfers",
+			   switches);
+
+	/* 32KiB isn't worth the copy engine's setup */
+	if (upload(pScreen, a, data, 128, 64) != NOUVEAU_XFER_MAIN)
+		mock_error("small transfer went to the copy engine");
+
+	/* 2MiB, several chunks each way */
+	fill(data, 1024, 512, 2);
+	upload(pScreen, big, data, 1024, 512);
+	MOCK_CHECK(mock_exa->DownloadFromScreen(big, 0, 0, 1024, 512,
+						(char *)out, 1024 * 4));
+	for (i = 0, bad = 0; i < 1024 * 512; i++) {
+		if ((out[i] & 0x00ffffff) != (data[i] & 0x00ffffff) &&
+		    bad++ < 8)
+			mock_error("pixel %d is %06x, not %06x", i,
+				   out[i] & 0x00ffffff, data[i] & 0x00ffffff);
+	}
+
+out:
+	if (a)
+		mock_pixmap_free(a);
+	if (big)
+		mock_pixmap_free(big);
+	mock_screen_fini(pScreen);
+
+	if (mock_errors)
+		fprintf(stderr, "xfer_plan: %u errors\n", mock_errors);
+	return mock_errors ? 1 : 0;
+}
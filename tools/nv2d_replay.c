@@ -0,0 +1,191 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Run the 2D engine methods in a PushbufCapture file through the software
+ * 2D engine, and print a checksum of every surface drawn to.  Replaying
+ * captures of the same workload taken before and after a change to the
+ * NV50/NVC0 2D paths should give the same checksums.
+ *
+ * Memory starts out zeroed, so anything a surface got from M2MF, the copy
+ * engines, the 3D engine or the CPU isn't there.
+ *
+ * usage: nv2d-replay [-v] capture
+ *   -v  print every operation
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nv_decode.h"
+#include "nv_2d.h"
+
+/* see src/nouveau_capture.h */
+#define CAPTURE_MAGIC   0x4e565042
+#define CAPTURE_VERSION 1
+#define CAPTURE_OBJECT  1
+#define CAPTURE_PUSH    2
+
+struct replay_surface {
+	struct replay_surface *next;
+	struct nv_2d_surface s;
+	unsigned ops;
+};
+
+static struct replay_surface *surfaces;
+static int verbose;
+
+static void
+replay_draw(struct nv_2d *nv, const struct nv_2d_surface *dst,
+	    const char *op, int x, int y, int w, int h)
+{
+	struct replay_surface *surf;
+
+	if (verbose) {
+		printf("%s %d,%d %dx%d to 0x%010llx\n", op, x, y, w, h,
+		       (unsigned long long)dst->address);
+	}
+
+	for (surf = surfaces; surf; surf = surf->next) {
+		if (!memcmp(&surf->s, dst, sizeof(*dst)))
+			break;
+	}
+
+	if (!surf) {
+		surf = calloc(1, sizeof(*surf));
+		if (!surf)
+			return;
+		surf->s = *dst;
+		surf->next = surfaces;
+		surfaces = surf;
+	}
+
+	surf->ops++;
+}
+
+static void
+replay_method(struct nv_decode *dec, int subc, uint32_t oclass,
+	      uint32_t mthd, uint32_t data)
+{
+	if ((oclass & 0xff) == 0x2d)
+		nv_2d_method(dec->priv, mthd, data);
+}
+
+/* FNV-1a over the visible pixels, so padding and layout don't matter */
+static uint32_t
+replay_checksum(struct nv_2d *nv, const struct nv_2d_surface *s)
+{
+	int cpp = nv_2d_cpp(s->format), x, y, i;
+	uint32_t hash = 0x811c9dc5;
+
+	for (y = 0; y < (int)s->height; y++) {
+		for (x = 0; x < (int)s->width; x++) {
+			uint8_t *p = nv_2d_pixel(nv, s, x, y);
+
+			for (i = 0; p && i < cpp; i++)
+				hash = (hash ^ p[i]) * 0x01000193;
+		}
+	}
+
+	return hash;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct replay_surface *surf;
+	struct nv_decode dec;
+	struct nv_2d nv;
+	uint32_t head[3], rec[2], *data = NULL;
+	int opt;
+	FILE *file;
+
+	while ((opt = getopt(argc, argv, "v")) != -1) {
+		switch (opt) {
+		case 'v': verbose = 1; break;
+		default:
+			goto usage;
+		}
+	}
+
+	if (optind != argc - 1)
+		goto usage;
+
+	file = fopen(argv[optind], "rb");
+	if (!file) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	if (fread(head, 4, 3, file) != 3 || head[0] != CAPTURE_MAGIC ||
+	    head[1] != CAPTURE_VERSION) {
+		fprintf(stderr, "%s: not a pushbuf capture\n", argv[optind]);
+		return 1;
+	}
+
+	nv_decode_init(&dec, head[2], NULL);
+	nv_2d_init(&nv, head[2]);
+	nv.draw = replay_draw;
+	dec.method = replay_method;
+	dec.priv = &nv;
+
+	/* only the main channel has a 2D engine */
+	while (fread(rec, 4, 2, file) == 2) {
+		data = realloc(data, rec[1] * 4 + 4);
+		if (!data || fread(data, 4, rec[1], file) != rec[1]) {
+			fprintf(stderr, "truncated record\n");
+			break;
+		}
+
+		if (!rec[1] || data[0] != 0)
+			continue;
+
+		if (rec[0] == CAPTURE_OBJECT && rec[1] >= 3)
+			nv_decode_object(&dec, data[1], data[2]);
+		else
+		if (rec[0] == CAPTURE_PUSH)
+			nv_decode_push(&dec, data + 1, rec[1] - 1);
+	}
+
+	printf("%u rects, %u blits, %u sifcs, %u unmodelled\n",
+	       nv.rects, nv.blits, nv.sifcs, nv.ignored);
+
+	while ((surf = surfaces)) {
+		printf("0x%010llx %ux%u format 0x%02x %s: %u ops, "
+		       "checksum %08x\n", (unsigned long long)surf->s.address,
+		       surf->s.width, surf->s.height, surf->s.format,
+		       surf->s.linear ? "linear" : "tiled", surf->ops,
+		       replay_checksum(&nv, &surf->s));
+		surfaces = surf->next;
+		free(surf);
+	}
+
+	nv_2d_fini(&nv);
+	nv_decode_fini();
+	free(data);
+	fclose(file);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-v] capture\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,434 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Software 2D engine.  Models what NV50EXA*() and NVC0EXA*() ask of the
+ * NV50_2D/NVC0_2D classes: surfaces, clipping, SRCCOPY and ROP with the
+ * mono 8x8 pattern, rectangles, unscaled point-sampled blits and SIFC
+ * uploads.  Anything else is counted in ->ignored and done as if it were
+ * SRCCOPY, so a capture using something new shows up rather than being
+ * silently misdrawn.
+ *
+ * Memory is addressed the way the GPU sees it.  Ranges can be backed by
+ * the caller with nv_2d_map(), everything else is allocated zeroed the
+ * first time it's touched.  Block-linear surfaces are laid out in tiles
+ * of 64-byte wide GOBs, 4 rows high on NV50 and 8 on NVC0.  The order of
+ * tiles and GOBs matches the hardware.  The bytes inside a GOB are kept
+ * linear, which real NVC0 GOBs aren't.  That doesn't matter as long as
+ * everything is read back through nv_2d_pixel().
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nv_2d.h"
+#include "hwdefs/nv50_2d.xml.h"
+#include "hwdefs/nv50_defs.xml.h"
+
+#define PAGE_SHIFT 16
+#define PAGE_SIZE  (1 << PAGE_SHIFT)
+
+#define M(m) nv->mthd[NV50_2D_##m / 4]
+
+struct nv_2d_region {
+	struct nv_2d_region *next;
+	uint64_t address;
+	uint64_t size;
+	uint8_t *data;
+};
+
+struct nv_2d_page {
+	struct nv_2d_page *next;
+	uint64_t address;
+	uint8_t data[PAGE_SIZE];
+};
+
+int
+nv_2d_cpp(uint32_t format)
+{
+	switch (format) {
+	case NV50_SURFACE_FORMAT_R8_UNORM:
+		return 1;
+	case NV50_SURFACE_FORMAT_BGR5_X1_UNORM:
+	case NV50_SURFACE_FORMAT_B5G6R5_UNORM:
+		return 2;
+	case NV50_SURFACE_FORMAT_BGRX8_UNORM:
+	case NV50_SURFACE_FORMAT_BGRA8_UNORM:
+	case NV50_SURFACE_FORMAT_RGB10_A2_UNORM:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+void
+nv_2d_init(struct nv_2d *nv, int chipset)
+{
+	memset(nv, 0, sizeof(*nv));
+	nv->nvc0 = chipset >= 0xc0;
+	M(CLIP_W) = 0x10000;
+	M(CLIP_H) = 0x10000;
+	M(OPERATION) = NV50_2D_OPERATION_SRCCOPY;
+	M(PATTERN_MONO_FORMAT) = NV50_2D_PATTERN_MONO_FORMAT_LE;
+	M(BLIT_DU_DX_INT) = 1;
+	M(BLIT_DV_DY_INT) = 1;
+	M(SIFC_DX_DU_INT) = 1;
+	M(SIFC_DY_DV_INT) = 1;
+}
+
+void
+nv_2d_fini(struct nv_2d *nv)
+{
+	struct nv_2d_region *region;
+	struct nv_2d_page *page;
+	int i;
+
+	while ((region = nv->regions)) {
+		nv->regions = region->next;
+		free(region);
+	}
+
+	for (i = 0; i < 256; i++) {
+		while ((page = nv->pages[i])) {
+			nv->pages[i] = page->next;
+			free(page);
+		}
+	}
+}
+
+/* Back size bytes at address with the caller's memory */
+void
+nv_2d_map(struct nv_2d *nv, uint64_t address, uint64_t size, void *data)
+{
+	struct nv_2d_region *region = calloc(1, sizeof(*region));
+
+	if (!region)
+		return;
+	region->address = address;
+	region->size = size;
+	region->data = data;
+	region->next = nv->regions;
+	nv->regions = region;
+}
+
+static uint8_t *
+nv_2d_memory(struct nv_2d *nv, uint64_t address)
+{
+	struct nv_2d_region *region;
+	struct nv_2d_page *page, **head;
+
+	for (region = nv->regions; region; region = region->next) {
+		if (address >= region->address &&
+		    address - region->address < region->size)
+			return region->data + (address - region->address);
+	}
+
+	head = &nv->pages[(address >> PAGE_SHIFT) & 0xff];
+	for (page = *head; page; page = page->next) {
+		if (page->address == (address & ~(uint64_t)(PAGE_SIZE - 1)))
+			return page->data + (address & (PAGE_SIZE - 1));
+	}
+
+	page = calloc(1, sizeof(*page));
+	if (!page)
+		return NULL;
+	page->address = address & ~(uint64_t)(PAGE_SIZE - 1);
+	page->next = *head;
+	*head = page;
+	return page->data + (address & (PAGE_SIZE - 1));
+}
+
+/* Where pixel x,y of a surface lives */
+uint8_t *
+nv_2d_pixel(struct nv_2d *nv, const struct nv_2d_surface *s, int x, int y)
+{
+	uint32_t cpp = nv_2d_cpp(s->format);
+	uint32_t xb = x * cpp, tw, th, tiles;
+	uint64_t offset;
+
+	if (s->linear) {
+		offset = (uint64_t)y * s->pitch + xb;
+	} else {
+		tw = 64 << (s->tile_mode & 0xf);
+		th = (nv->nvc0 ? 8 : 4) << ((s->tile_mode >> 4) & 0xf);
+		tiles = (s->width * cpp + tw - 1) / tw;
+
+		offset  = ((uint64_t)(y / th) * tiles + xb / tw) * tw * th;
+		offset += (xb % tw) / 64 * 64 * th;
+		offset += (y % th) * 64 + xb % 64;
+	}
+
+	return nv_2d_memory(nv, s->address + offset);
+}
+
+static uint32_t
+nv_2d_read(struct nv_2d *nv, const struct nv_2d_surface *s, int x, int y)
+{
+	uint8_t *p = nv_2d_pixel(nv, s, x, y);
+	uint32_t v = 0;
+
+	if (p)
+		memcpy(&v, p, nv_2d_cpp(s->format));
+	return v;
+}
+
+/* Ternary ROP: bit (P << 2 | S << 1 | D) of rop is the result */
+static uint32_t
+nv_2d_rop(uint8_t rop, uint32_t p, uint32_t s, uint32_t d)
+{
+	uint32_t r = 0;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		if (rop & (1 << i))
+			r |= ((i & 4) ? p : ~p) & ((i & 2) ? s : ~s) &
+			     ((i & 1) ? d : ~d);
+	}
+
+	return r;
+}
+
+static uint32_t
+nv_2d_pattern(struct nv_2d *nv, int x, int y)
+{
+	int bit = (y & 7) * 8 + (x & 7), on;
+
+	if (M(PATTERN_SELECT) != NV50_2D_PATTERN_SELECT_MONO_8X8 ||
+	    M(PATTERN_MONO_FORMAT) != NV50_2D_PATTERN_MONO_FORMAT_LE)
+		nv->ignored++;
+
+	on = (nv->mthd[NV50_2D_PATTERN_BITMAP(bit / 32) / 4] >>
+	      (bit % 32)) & 1;
+	return nv->mthd[NV50_2D_PATTERN_COLOR(on) / 4];
+}
+
+static int
+nv_2d_clipped(struct nv_2d *nv, int x, int y)
+{
+	int32_t cx = M(CLIP_X), cy = M(CLIP_Y);
+
+	return x < 0 || y < 0 ||
+	       x >= (int)nv->dst.width || y >= (int)nv->dst.height ||
+	       x < cx || y < cy ||
+	       x >= cx + (int)M(CLIP_W) || y >= cy + (int)M(CLIP_H);
+}
+
+static void
+nv_2d_write(struct nv_2d *nv, int x, int y, uint32_t s)
+{
+	uint32_t cpp = nv_2d_cpp(nv->dst.format), d;
+	uint8_t *p;
+
+	if (nv_2d_clipped(nv, x, y))
+		return;
+
+	p = nv_2d_pixel(nv, &nv->dst, x, y);
+	if (!p)
+		return;
+
+	switch (M(OPERATION)) {
+	case NV50_2D_OPERATION_SRCCOPY:
+		d = s;
+		break;
+	case NV50_2D_OPERATION_ROP:
+		d = 0;
+		memcpy(&d, p, cpp);
+		d = nv_2d_rop(M(ROP), nv_2d_pattern(nv, x, y), s, d);
+		break;
+	default:
+		nv->ignored++;
+		d = s;
+		break;
+	}
+
+	memcpy(p, &d, cpp);
+}
+
+static void
+nv_2d_draw(struct nv_2d *nv, const char *op, int x, int y, int w, int h)
+{
+	if (nv->draw)
+		nv->draw(nv, &nv->dst, op, x, y, w, h);
+}
+
+static void
+nv_2d_rect(struct nv_2d *nv)
+{
+	int x1 = nv->point[0], y1 = nv->point[1];
+	int x2 = nv->point[2], y2 = nv->point[3];
+	int x, y;
+
+	if (M(DRAW_SHAPE) != NV50_2D_DRAW_SHAPE_RECTANGLES ||
+	    M(DRAW_COLOR_FORMAT) != nv->dst.format) {
+		nv->ignored++;
+		return;
+	}
+
+	for (y = y1; y < y2; y++) {
+		for (x = x1; x < x2; x++)
+			nv_2d_write(nv, x, y, M(DRAW_COLOR));
+	}
+
+	nv->rects++;
+	nv_2d_draw(nv, "rect", x1, y1, x2 - x1, y2 - y1);
+}
+
+/* The source is read completely before anything is written, so blits
+ * within one surface can overlap.
+ */
+static void
+nv_2d_blit(struct nv_2d *nv)
+{
+	int dx = M(BLIT_DST_X), dy = M(BLIT_DST_Y);
+	int w = M(BLIT_DST_W), h = M(BLIT_DST_H);
+	uint64_t dudx = (uint64_t)M(BLIT_DU_DX_INT) << 32 | M(BLIT_DU_DX_FRACT);
+	uint64_t dvdy = (uint64_t)M(BLIT_DV_DY_INT) << 32 | M(BLIT_DV_DY_FRACT);
+	uint64_t u0 = (uint64_t)M(BLIT_SRC_X_INT) << 32 | M(BLIT_SRC_X_FRACT);
+	uint64_t v = (uint64_t)M(BLIT_SRC_Y_INT) << 32 | M(BLIT_SRC_Y_FRACT);
+	uint32_t *tmp;
+	int x, y;
+
+	if (w <= 0 || h <= 0)
+		return;
+	if (M(BLIT_CONTROL) & NV50_2D_BLIT_CONTROL_FILTER_BILINEAR)
+		nv->ignored++;
+	if (nv_2d_cpp(nv->src.format) != nv_2d_cpp(nv->dst.format))
+		nv->ignored++;
+
+	tmp = malloc((size_t)w * h * sizeof(*tmp));
+	if (!tmp)
+		return;
+
+	for (y = 0; y < h; y++, v += dvdy) {
+		uint64_t u = u0;
+
+		for (x = 0; x < w; x++, u += dudx) {
+			tmp[y * w + x] = nv_2d_read(nv, &nv->src, u >> 32,
+						    v >> 32);
+		}
+	}
+
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++)
+			nv_2d_write(nv, dx + x, dy + y, tmp[y * w + x]);
+	}
+
+	free(tmp);
+	nv->blits++;
+	nv_2d_draw(nv, "blit", dx, dy, w, h);
+}
+
+static void
+nv_2d_sifc_start(struct nv_2d *nv)
+{
+	if (M(SIFC_BITMAP_ENABLE) || M(SIFC_DX_DU_INT) != 1 ||
+	    M(SIFC_DY_DV_INT) != 1 || M(SIFC_DX_DU_FRACT) ||
+	    M(SIFC_DY_DV_FRACT) || !nv_2d_cpp(M(SIFC_FORMAT)))
+		nv->ignored++;
+
+	nv->sifc_x = 0;
+	nv->sifc_y = 0;
+	nv->sifc_left = M(SIFC_WIDTH) * M(SIFC_HEIGHT);
+}
+
+static void
+nv_2d_sifc_data(struct nv_2d *nv, uint32_t data)
+{
+	int cpp = nv_2d_cpp(M(SIFC_FORMAT)), i;
+
+	if (!cpp || !nv->sifc_left) {
+		nv->ignored++;
+		return;
+	}
+
+	for (i = 0; i < 4 / cpp && nv->sifc_left; i++) {
+		uint32_t s = cpp == 4 ? data : (data >> (i * cpp * 8)) &
+					       ((1 << (cpp * 8)) - 1);
+
+		nv_2d_write(nv, M(SIFC_DST_X_INT) + nv->sifc_x,
+			    M(SIFC_DST_Y_INT) + nv->sifc_y, s);
+
+		if (++nv->sifc_x == (int)M(SIFC_WIDTH)) {
+			nv->sifc_x = 0;
+			nv->sifc_y++;
+		}
+
+		if (!--nv->sifc_left) {
+			nv->sifcs++;
+			nv_2d_draw(nv, "sifc", M(SIFC_DST_X_INT),
+				   M(SIFC_DST_Y_INT), M(SIFC_WIDTH),
+				   M(SIFC_HEIGHT));
+		}
+	}
+}
+
+/* DST_* and SRC_* are laid out the same, base is DST_FORMAT or SRC_FORMAT */
+static void
+nv_2d_surface(struct nv_2d *nv, struct nv_2d_surface *s, uint32_t base)
+{
+	const uint32_t *m = &nv->mthd[base / 4];
+
+	/* only one of pitch and tile mode is used for a layout, and the
+	 * other one may be left over from an earlier surface
+	 */
+	s->format    = m[0];
+	s->linear    = m[1];
+	s->tile_mode = s->linear ? 0 : m[2];
+	s->pitch     = s->linear ? m[5] : 0;
+	s->width     = m[6];
+	s->height    = m[7];
+	s->address   = (uint64_t)m[8] << 32 | m[9];
+}
+
+void
+nv_2d_method(struct nv_2d *nv, uint32_t mthd, uint32_t data)
+{
+	if (mthd >= sizeof(nv->mthd) * 4)
+		return;
+
+	if (mthd == NV50_2D_SIFC_DATA) {
+		nv_2d_sifc_data(nv, data);
+		return;
+	}
+
+	nv->mthd[mthd / 4] = data;
+
+	if (mthd >= NV50_2D_DST_FORMAT && mthd <= NV50_2D_DST_ADDRESS_LOW)
+		nv_2d_surface(nv, &nv->dst, NV50_2D_DST_FORMAT);
+	else
+	if (mthd >= NV50_2D_SRC_FORMAT && mthd <= NV50_2D_SRC_ADDRESS_LOW)
+		nv_2d_surface(nv, &nv->src, NV50_2D_SRC_FORMAT);
+	else
+	if (mthd == NV50_2D_DRAW_SHAPE)
+		nv->vertex = 0;
+	else
+	if (mthd >= NV50_2D_DRAW_POINT32_X(0) &&
+	    mthd <= NV50_2D_DRAW_POINT32_Y(NV50_2D_DRAW_POINT32_X__LEN - 1)) {
+		nv->point[nv->vertex++ & 3] = data;
+		if (!(nv->vertex & 3))
+			nv_2d_rect(nv);
+	} else
+	if (mthd == NV50_2D_BLIT_SRC_Y_INT)
+		nv_2d_blit(nv);
+	else
+	if (mthd == NV50_2D_SIFC_DST_Y_INT)
+		nv_2d_sifc_start(nv);
+}
@@ -0,0 +1,55 @@
+#ifndef __NV_2D_H__
+#define __NV_2D_H__
+
+#include <stdint.h>
+
+/* One surface as last set up through the DST_* or SRC_* methods */
+struct nv_2d_surface {
+	uint32_t format;
+	int linear;
+	uint32_t tile_mode;
+	uint32_t pitch;
+	uint32_t width;
+	uint32_t height;
+	uint64_t address;
+};
+
+struct nv_2d_region;
+struct nv_2d_page;
+
+/* Software model of the NV50_2D/NVC0_2D methods the driver uses */
+struct nv_2d {
+	int nvc0;
+	uint32_t mthd[0x1000 / 4];	/* last value of each method */
+
+	struct nv_2d_surface dst;
+	struct nv_2d_surface src;
+
+	int vertex;			/* DRAW_POINT32 coordinates seen */
+	int32_t point[4];
+
+	/* SIFC transfer in progress */
+	int sifc_x, sifc_y;
+	uint32_t sifc_left;
+
+	/* called once per drawing operation, after it's done */
+	void (*draw)(struct nv_2d *, const struct nv_2d_surface *dst,
+		     const char *op, int x, int y, int w, int h);
+	void *priv;
+
+	unsigned rects, blits, sifcs;
+	unsigned ignored;		/* methods or modes not modelled */
+
+	struct nv_2d_region *regions;
+	struct nv_2d_page *pages[256];
+};
+
+void nv_2d_init(struct nv_2d *, int chipset);
+void nv_2d_fini(struct nv_2d *);
+void nv_2d_map(struct nv_2d *, uint64_t address, uint64_t size, void *);
+void nv_2d_method(struct nv_2d *, uint32_t mthd, uint32_t data);
+uint8_t *nv_2d_pixel(struct nv_2d *, const struct nv_2d_surface *,
+		     int x, int y);
+int nv_2d_cpp(uint32_t format);
+
+#endif
@@ -0,0 +1,424 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Method stream decoder.  Method names come from the hwdefs headers the
+ * driver itself is built against (see nv_mthd.awk), and subchannels are
+ * bound the same way the driver's NVAccelInit*() functions bind them.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nv_decode.h"
+#include "nv_mthd.h"
+
+#define MTHD_SLOTS 0x1000 /* 0x4000 bytes of methods per class */
+
+struct nv_decode_class {
+	struct nv_decode_class *next;
+	uint32_t oclass;
+	const char *name;
+	const struct nv_decode_mthd *mthd[MTHD_SLOTS];
+	unsigned count[MTHD_SLOTS];
+	unsigned headers;
+	unsigned words;
+};
+
+/* Which hwdefs prefixes describe each class the driver creates, in order
+ * of preference where they overlap.
+ */
+static const struct {
+	uint32_t oclass;
+	const char *name;
+	const char *prefix[5];
+} nv_decode_classes[] = {
+	{ 0x0012, "NV01_BETA",       { "NV01_BETA_" } },
+	{ 0x0019, "NV01_CLIP",       { "NV01_CLIP_" } },
+	{ 0x0039, "NV03_M2MF",       { "NV03_M2MF_" } },
+	{ 0x0042, "NV04_SURFACE_2D", { "NV04_SURFACE_2D_" } },
+	{ 0x0043, "NV03_ROP",        { "NV01_ROP_" } },
+	{ 0x0044, "NV04_PATTERN",    { "NV04_PATTERN_", "NV01_PATTERN_" } },
+	{ 0x004a, "NV04_GDI",        { "NV04_GDI_" } },
+	{ 0x005f, "NV04_BLIT",       { "NV04_BLIT_", "NV01_BLIT_" } },
+	{ 0x0061, "NV04_IFC",        { "NV04_IFC_", "NV01_IFC_" } },
+	{ 0x0062, "NV10_SURFACE_2D", { "NV04_SURFACE_2D_" } },
+	{ 0x0072, "NV04_BETA4",      { "NV04_BETA4_" } },
+	{ 0x0077, "NV04_SIFM",       { "NV05_SIFM_", "NV03_SIFM_" } },
+	{ 0x0089, "NV10_SIFM",       { "NV05_SIFM_", "NV03_SIFM_" } },
+	{ 0x008a, "NV10_IFC",        { "NV04_IFC_", "NV01_IFC_" } },
+	{ 0x009f, "NV15_BLIT",       { "NV15_BLIT_", "NV04_BLIT_",
+				       "NV01_BLIT_" } },
+	{ 0x3089, "NV40_SIFM",       { "NV05_SIFM_", "NV03_SIFM_" } },
+	{ 0x0056, "NV10_3D",         { "NV10_3D_" } },
+	{ 0x0096, "NV15_3D",         { "NV15_3D_", "NV10_3D_" } },
+	{ 0x0099, "NV17_3D",         { "NV17_3D_", "NV15_3D_", "NV10_3D_" } },
+	{ 0x0397, "NV30_3D",         { "NV30_3D_" } },
+	{ 0x0497, "NV35_3D",         { "NV30_3D_" } },
+	{ 0x0697, "NV34_3D",         { "NV30_3D_" } },
+	{ 0x4097, "NV40_3D",         { "NV40_3D_", "NV30_3D_" } },
+	{ 0x4497, "NV44_3D",         { "NV40_3D_", "NV30_3D_" } },
+	{ 0x5039, "NV50_M2MF",       { "NV50_M2MF_", "NV03_M2MF_" } },
+	{ 0x502d, "NV50_2D",         { "NV50_2D_" } },
+	{ 0x5097, "NV50_3D",         { "NV50_3D_" } },
+	{ 0x8297, "NV84_3D",         { "NV84_3D_", "NV50_3D_" } },
+	{ 0x8397, "NVA0_3D",         { "NVA0_3D_", "NV84_3D_", "NV50_3D_" } },
+	{ 0x8597, "NVA3_3D",         { "NVA3_3D_", "NVA0_3D_", "NV84_3D_",
+				       "NV50_3D_" } },
+	{ 0x8697, "NVAF_3D",         { "NVA3_3D_", "NVA0_3D_", "NV84_3D_",
+				       "NV50_3D_" } },
+	{ 0x9039, "NVC0_M2MF",       { "NVC0_M2MF_" } },
+	{ 0x902d, "NVC0_2D",         { "NVC0_2D_", "NV50_2D_" } },
+	{ 0x9097, "NVC0_3D",         { "NVC0_3D_", "NVC1_3D_", "NVC8_3D_",
+				       "NVE4_3D_" } },
+	{}
+};
+
+static struct nv_decode_class *nv_decode_cache;
+
+static int
+nv_decode_prefix(const char *name, const char *prefix)
+{
+	return prefix && !strncmp(name, prefix, strlen(prefix));
+}
+
+static void
+nv_decode_fill(struct nv_decode_class *cls, const char *prefix, int host)
+{
+	const struct nv_decode_mthd *m;
+	uint32_t i, slot;
+
+	for (m = nv_decode_mthds; m->name; m++) {
+		if (!nv_decode_prefix(m->name, prefix))
+			continue;
+
+		for (i = 0; i < m->len; i++) {
+			slot = (m->base + i * m->stride) / 4;
+			if (slot >= MTHD_SLOTS || (host && slot >= 0x40))
+				break;
+			if (!cls->mthd[slot])
+				cls->mthd[slot] = m;
+			if (!m->stride)
+				break;
+		}
+	}
+}
+
+static struct nv_decode_class *
+nv_decode_class(uint32_t oclass)
+{
+	static const char *host[] = {
+		"NV01_SUBCHAN_", "NV84_SUBCHAN_", "NV11_SUBCHAN_",
+		"NV10_SUBCHAN_", "NV40_SUBCHAN_", NULL
+	};
+	struct nv_decode_class *cls;
+	uint32_t match = oclass;
+	int i, j;
+
+	for (cls = nv_decode_cache; cls; cls = cls->next) {
+		if (cls->oclass == oclass)
+			return cls;
+	}
+
+	cls = calloc(1, sizeof(*cls));
+	if (!cls)
+		return NULL;
+	cls->oclass = oclass;
+	cls->next = nv_decode_cache;
+	nv_decode_cache = cls;
+
+	/* later generations share the methods the driver uses */
+	if ((oclass & 0xff) == 0x97 && oclass > 0x9097)
+		match = 0x9097;
+	if ((oclass & 0xff) == 0x2d && oclass > 0x902d)
+		match = 0x902d;
+
+	for (i = 0; nv_decode_classes[i].oclass; i++) {
+		if (nv_decode_classes[i].oclass != match)
+			continue;
+
+		cls->name = nv_decode_classes[i].name;
+		for (j = 0; j < 5; j++)
+			nv_decode_fill(cls, nv_decode_classes[i].prefix[j], 0);
+		break;
+	}
+
+	if (!cls->name) {
+		switch (oclass & 0xff) {
+		case 0x6e: cls->name = "NVSW"; break;
+		case 0xb5: cls->name = "COPY"; break;
+		case 0x40: cls->name = "P2MF"; break;
+		default:   cls->name = "unknown"; break;
+		}
+	}
+
+	for (i = 0; host[i]; i++)
+		nv_decode_fill(cls, host[i], 1);
+	if (oclass >= 0x9000)
+		nv_decode_fill(cls, "NVC0_GRAPH_", 0);
+	else
+		nv_decode_fill(cls, "NV04_GRAPH_", 0);
+	return cls;
+}
+
+const char *
+nv_decode_name(uint32_t oclass, uint32_t mthd, char *buf, size_t size)
+{
+	struct nv_decode_class *cls = nv_decode_class(oclass);
+	const struct nv_decode_mthd *m;
+
+	m = (cls && mthd / 4 < MTHD_SLOTS) ? cls->mthd[mthd / 4] : NULL;
+	if (!m)
+		snprintf(buf, size, "0x%04x", mthd);
+	else if (m->stride)
+		snprintf(buf, size, "%s[%u]", m->name,
+			 (mthd - m->base) / m->stride);
+	else
+		snprintf(buf, size, "%s", m->name);
+	return buf;
+}
+
+/* Subchannel the driver puts each class on, see SUBC_* in the *_accel.h */
+int
+nv_decode_subc(int chipset, uint32_t oclass)
+{
+	uint32_t type = oclass & 0xff;
+
+	if (chipset >= 0xc0) {
+		switch (type) {
+		case 0x97: return 0;
+		case 0x39: case 0x40: return 2;
+		case 0x2d: return 3;
+		case 0xb5: return 4;
+		case 0x6e: return 5;
+		}
+	} else
+	if (chipset >= 0x50) {
+		switch (type) {
+		case 0x39: return 0;
+		case 0x6e: return 1;
+		case 0x2d: case 0xb5: return 2;
+		case 0x97: return 7;
+		}
+	} else {
+		switch (type) {
+		case 0x39: return 0;
+		case 0x42: case 0x62: return 2;
+		case 0x4a: return 3;
+		case 0x5f: case 0x9f: return 4;
+		case 0x61: case 0x8a: return 5;
+		case 0x56: case 0x96: case 0x99: case 0x97: return 7;
+		}
+	}
+
+	/* the pre-NV50 MISC subchannel gets rebound as needed */
+	return -1;
+}
+
+void
+nv_decode_init(struct nv_decode *dec, int chipset, FILE *out)
+{
+	memset(dec, 0, sizeof(*dec));
+	dec->chipset = chipset;
+	dec->nvc0 = chipset >= 0xc0;
+	dec->out = out;
+}
+
+void
+nv_decode_bind(struct nv_decode *dec, int subc, uint32_t oclass)
+{
+	if (subc >= 0 && subc < 8)
+		dec->subc[subc] = nv_decode_class(oclass);
+}
+
+void
+nv_decode_object(struct nv_decode *dec, uint32_t handle, uint32_t oclass)
+{
+	if (dec->objects < 32) {
+		dec->object[dec->objects].handle = handle;
+		dec->object[dec->objects].oclass = oclass;
+		dec->objects++;
+	}
+
+	nv_decode_bind(dec, nv_decode_subc(dec->chipset, oclass), oclass);
+}
+
+static void
+nv_decode_method(struct nv_decode *dec, const char *type, int subc,
+		 uint32_t mthd, uint32_t data)
+{
+	struct nv_decode_class *cls = dec->subc[subc];
+	char name[64];
+	int i;
+
+	/* SET_OBJECT takes a class on Fermi and up, a handle before that */
+	if (mthd == 0x0000) {
+		uint32_t oclass = data;
+
+		for (i = 0; !dec->nvc0 && i < dec->objects; i++) {
+			if (dec->object[i].handle == data)
+				oclass = dec->object[i].oclass;
+		}
+		nv_decode_bind(dec, subc, oclass);
+		cls = dec->subc[subc];
+	}
+
+	if (cls) {
+		cls->words++;
+		if (mthd / 4 < MTHD_SLOTS)
+			cls->count[mthd / 4]++;
+	}
+	dec->words++;
+
+	if (dec->method)
+		dec->method(dec, subc, cls ? cls->oclass : 0, mthd, data);
+	if (!dec->out)
+		return;
+
+	fprintf(dec->out, "%-5s %d %-10s %-44s 0x%08x\n", type, subc,
+		cls ? cls->name : "?",
+		nv_decode_name(cls ? cls->oclass : 0, mthd, name,
+			       sizeof(name)), data);
+}
+
+void
+nv_decode_push(struct nv_decode *dec, const uint32_t *data, unsigned size)
+{
+	const uint32_t *end = data + size;
+	const char *type;
+	uint32_t hdr, mthd;
+	unsigned count, i;
+	int subc, incr = 0;
+
+	while (data < end) {
+		hdr = *data++;
+		dec->headers++;
+
+		if (dec->nvc0) {
+			subc = (hdr >> 13) & 7;
+			mthd = (hdr & 0xfff) << 2;
+			count = (hdr >> 16) & 0x1fff;
+
+			switch (hdr >> 29) {
+			case 1: type = "INC";   incr = -1; break;
+			case 3: type = "NINC";  incr = 0;  break;
+			case 5: type = "1INC";  incr = 1;  break;
+			case 4:
+				if (dec->subc[subc])
+					dec->subc[subc]->headers++;
+				nv_decode_method(dec, "IMMED", subc, mthd, count);
+				continue;
+			default:
+				type = NULL;
+				break;
+			}
+		} else {
+			subc = (hdr >> 13) & 7;
+			mthd = hdr & 0x1ffc;
+			count = (hdr >> 18) & 0x7ff;
+
+			switch (hdr & 0xe0030003) {
+			case 0x00000000: type = "INC";  incr = -1; break;
+			case 0x40000000: type = "NINC"; incr = 0;  break;
+			default:
+				type = NULL;
+				break;
+			}
+		}
+
+		if (!type) {
+			if (dec->out)
+				fprintf(dec->out, "??? 0x%08x\n", hdr);
+			dec->errors++;
+			continue;
+		}
+
+		if (count > end - data) {
+			if (dec->out)
+				fprintf(dec->out, "??? 0x%08x overruns the "
+					"submission by %u words\n", hdr,
+					count - (unsigned)(end - data));
+			dec->errors++;
+			count = end - data;
+		}
+
+		if (dec->subc[subc])
+			dec->subc[subc]->headers++;
+
+		for (i = 0; i < count; i++) {
+			nv_decode_method(dec, i ? "" : type, subc, mthd, *data++);
+			if (incr < 0 || (incr > 0 && i == 0))
+				mthd += 4;
+		}
+	}
+}
+
+static int
+nv_decode_cmp(const void *a, const void *b)
+{
+	const unsigned *ca = *(const unsigned * const *)a;
+	const unsigned *cb = *(const unsigned * const *)b;
+
+	return (*cb > *ca) - (*cb < *ca);
+}
+
+/* Per-class method counts, most used first */
+void
+nv_decode_summary(FILE *out)
+{
+	struct nv_decode_class *cls;
+	unsigned *sorted[MTHD_SLOTS];
+	char name[64];
+	int i, n;
+
+	for (cls = nv_decode_cache; cls; cls = cls->next) {
+		if (!cls->words)
+			continue;
+
+		fprintf(out, "class 0x%04x %s: %u headers, %u methods\n",
+			cls->oclass, cls->name, cls->headers, cls->words);
+
+		for (i = n = 0; i < MTHD_SLOTS; i++) {
+			if (cls->count[i])
+				sorted[n++] = &cls->count[i];
+		}
+		qsort(sorted, n, sizeof(*sorted), nv_decode_cmp);
+
+		for (i = 0; i < n; i++) {
+			uint32_t mthd = (sorted[i] - cls->count) * 4;
+
+			fprintf(out, "  %8u  %s\n", *sorted[i],
+				nv_decode_name(cls->oclass, mthd, name,
+					       sizeof(name)));
+		}
+	}
+}
+
+void
+nv_decode_fini(void)
+{
+	struct nv_decode_class *cls;
+
+	while ((cls = nv_decode_cache)) {
+		nv_decode_cache = cls->next;
+		free(cls);
+	}
+}
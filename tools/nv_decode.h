@@ -0,0 +1,50 @@
+#ifndef __NV_DECODE_H__
+#define __NV_DECODE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+struct nv_decode_mthd {
+	const char *name;
+	uint32_t base;
+	uint32_t stride;
+	uint32_t len;
+};
+
+struct nv_decode_class;
+
+/* Decoder state for one channel */
+struct nv_decode {
+	int chipset;
+	int nvc0;			/* NVC0-style method headers */
+	FILE *out;			/* NULL to only gather counts */
+
+	struct {
+		uint32_t handle;
+		uint32_t oclass;
+	} object[32];
+	int objects;
+
+	struct nv_decode_class *subc[8];
+
+	/* called for every method, after it has been counted */
+	void (*method)(struct nv_decode *, int subc, uint32_t oclass,
+		       uint32_t mthd, uint32_t data);
+	void *priv;
+
+	unsigned headers;
+	unsigned words;
+	unsigned errors;
+};
+
+void nv_decode_init(struct nv_decode *, int chipset, FILE *out);
+void nv_decode_object(struct nv_decode *, uint32_t handle, uint32_t oclass);
+void nv_decode_bind(struct nv_decode *, int subc, uint32_t oclass);
+int  nv_decode_subc(int chipset, uint32_t oclass);
+void nv_decode_push(struct nv_decode *, const uint32_t *, unsigned size);
+const char *nv_decode_name(uint32_t oclass, uint32_t mthd,
+			   char *buf, size_t size);
+void nv_decode_summary(FILE *);
+void nv_decode_fini(void);
+
+#endif
@@ -0,0 +1,58 @@
+# Turn the rnndb-generated hwdefs headers into a method name table for
+# nv_decode.c.  Registers are the defines that start a block (ie. follow
+# a blank line); the defines after them are their fields and values.
+#
+# usage: awk -f nv_mthd.awk src/hwdefs/*.xml.h > nv_mthd.h
+
+function flush() {
+	if (array != "")
+		printf "\t{ \"%s\", %s, %s, %s },\n", array, base, stride, len
+	array = ""
+}
+
+BEGIN {
+	print "/* Generated by nv_mthd.awk from src/hwdefs, do not edit */"
+	print "static const struct nv_decode_mthd nv_decode_mthds[] = {"
+	blank = 1
+}
+
+/^[ \t]*$/ {
+	blank = 1
+	next
+}
+
+/^#define/ {
+	name = $2
+
+	if (array != "" && name == array "__LEN") {
+		len = $3
+	} else if (blank && name !~ /__|_CLASS$/) {
+		flush()
+
+		if (name ~ /\(i0/) {
+			sub(/\(.*/, "", name)
+			value = substr($0, index($0, "(0x"))
+			gsub(/[()*]|i0|i1/, " ", value)
+			n = split(value, v, /[ \t+]+/)
+			array = name
+			base = v[2]
+			stride = v[n - 1] ~ /^0x/ ? v[n - 1] : v[n]
+			len = "1"
+		} else if ($3 ~ /^0x/ && ($3 !~ /^0x0+$/ || name ~ /_OBJECT$/)) {
+			printf "\t{ \"%s\", %s, 0, 1 },\n", name, $3
+		}
+	}
+
+	blank = 0
+	next
+}
+
+{
+	blank = 0
+}
+
+END {
+	flush()
+	print "\t{ NULL }"
+	print "};"
+}
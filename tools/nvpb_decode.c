@@ -0,0 +1,127 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Decode a file written by the driver's PushbufCapture option.
+ *
+ * usage: nvpb-decode [-q] [-c channel] capture
+ *   -q  only print the per-class method counts
+ *   -c  only decode the given channel (0 is the main one)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nv_decode.h"
+
+/* see src/nouveau_capture.h */
+#define CAPTURE_MAGIC   0x4e565042
+#define CAPTURE_VERSION 1
+#define CAPTURE_OBJECT  1
+#define CAPTURE_PUSH    2
+#define CAPTURE_CHANNELS 8
+
+int
+main(int argc, char **argv)
+{
+	struct nv_decode dec[CAPTURE_CHANNELS];
+	uint32_t head[3], rec[2], *data = NULL;
+	unsigned pushes = 0;
+	int quiet = 0, only = -1, opt, i;
+	FILE *file;
+
+	while ((opt = getopt(argc, argv, "qc:")) != -1) {
+		switch (opt) {
+		case 'q': quiet = 1; break;
+		case 'c': only = atoi(optarg); break;
+		default:
+			goto usage;
+		}
+	}
+
+	if (optind != argc - 1)
+		goto usage;
+
+	file = fopen(argv[optind], "rb");
+	if (!file) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	if (fread(head, 4, 3, file) != 3 || head[0] != CAPTURE_MAGIC ||
+	    head[1] != CAPTURE_VERSION) {
+		fprintf(stderr, "%s: not a pushbuf capture\n", argv[optind]);
+		return 1;
+	}
+
+	for (i = 0; i < CAPTURE_CHANNELS; i++)
+		nv_decode_init(&dec[i], head[2], quiet ? NULL : stdout);
+
+	while (fread(rec, 4, 2, file) == 2) {
+		data = realloc(data, rec[1] * 4 + 4);
+		if (!data || fread(data, 4, rec[1], file) != rec[1]) {
+			fprintf(stderr, "truncated record\n");
+			break;
+		}
+
+		if (!rec[1] || data[0] >= CAPTURE_CHANNELS)
+			continue;
+		if (only >= 0 && (int)data[0] != only)
+			continue;
+
+		switch (rec[0]) {
+		case CAPTURE_OBJECT:
+			if (rec[1] >= 3) {
+				nv_decode_object(&dec[data[0]], data[1],
+						 data[2]);
+			}
+			break;
+		case CAPTURE_PUSH:
+			if (!quiet)
+				printf("--- channel %u push %u, %u words\n",
+				       data[0], pushes, rec[1] - 1);
+			nv_decode_push(&dec[data[0]], data + 1, rec[1] - 1);
+			pushes++;
+			break;
+		default:
+			break;
+		}
+	}
+
+	printf("--- chipset NV%02X, %u submissions\n", head[2], pushes);
+	for (i = 0; i < CAPTURE_CHANNELS; i++) {
+		if (!dec[i].headers)
+			continue;
+		printf("channel %d: %u headers, %u methods, %u errors\n", i,
+		       dec[i].headers, dec[i].words, dec[i].errors);
+	}
+	nv_decode_summary(stdout);
+
+	nv_decode_fini();
+	free(data);
+	fclose(file);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-q] [-c channel] capture\n", argv[0]);
+	return 1;
+}
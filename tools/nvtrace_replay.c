@@ -0,0 +1,795 @@
+/*
+ * Copyright 2026 Nouveau Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Summarise a file written by the driver's AccelTrace option, or replay it
+ * through a running X server.
+ *
+ * The summary is one CSV line per kind of call: how many there were, how
+ * many Prepare or transfer calls failed (and so fell back to software),
+ * the pixels and bytes they covered, and what the driver recorded they
+ * cost it: command bytes and submissions on all channels, and CPU time
+ * spent in the server.
+ *
+ * Replaying turns each call back into the X request that would make the
+ * driver do the same thing: fills, CopyArea, Render Composite, PutImage
+ * and GetImage, on pixmaps like the ones in the trace.  It prints the
+ * wall time the server took, per kind of call with -s.  Running that
+ * server with AccelTrace too gives a second trace whose summary can be
+ * compared with the first.  Calls that failed when recorded aren't
+ * replayed, as the trace doesn't say what the fallback drew.
+ *
+ * usage: nvtrace-replay [-d display] [-n count] [-s] trace
+ *   -d  replay through this X server
+ *   -n  replay this many times, default 1
+ *   -s  wait for the server after every call, to time each kind of call
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef HAVE_XRENDER
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/Xrender.h>
+#endif
+
+/* see src/nouveau_trace.h */
+#define TRACE_MAGIC             0x4e565452
+#define TRACE_VERSION           2
+#define TRACE_PIXMAP            1
+#define TRACE_FREE              2
+#define TRACE_PREPARE_SOLID     3
+#define TRACE_SOLID             4
+#define TRACE_DONE_SOLID        5
+#define TRACE_PREPARE_COPY      6
+#define TRACE_COPY              7
+#define TRACE_DONE_COPY         8
+#define TRACE_PREPARE_COMPOSITE 9
+#define TRACE_COMPOSITE         10
+#define TRACE_DONE_COMPOSITE    11
+#define TRACE_UPLOAD            12
+#define TRACE_DOWNLOAD          13
+#define TRACE_TYPES             14
+
+#define TRACE_PIXMAP_SCREEN     0x00000001
+#define TRACE_PICT_TRANSFORM    0x00000100
+#define TRACE_PICT_CA           0x00000200
+
+static const char *trace_name[TRACE_TYPES] = {
+	[TRACE_PREPARE_SOLID]     = "prepare_solid",
+	[TRACE_SOLID]             = "solid",
+	[TRACE_DONE_SOLID]        = "done_solid",
+	[TRACE_PREPARE_COPY]      = "prepare_copy",
+	[TRACE_COPY]              = "copy",
+	[TRACE_DONE_COPY]         = "done_copy",
+	[TRACE_PREPARE_COMPOSITE] = "prepare_composite",
+	[TRACE_COMPOSITE]         = "composite",
+	[TRACE_DONE_COMPOSITE]    = "done_composite",
+	[TRACE_UPLOAD]            = "upload",
+	[TRACE_DOWNLOAD]          = "download",
+};
+
+struct trace_pixmap {
+	uint32_t width, height, depth, bpp, flags;
+#ifdef HAVE_XRENDER
+	Drawable drawable;
+	int window;
+	Picture picture;
+	uint32_t format;
+#endif
+};
+
+struct trace_stat {
+	unsigned calls;
+	unsigned failed;
+	uint64_t pixels;
+	uint64_t bytes;
+	uint64_t words;
+	uint64_t kicks;
+	uint64_t ns;
+	uint64_t replay_ns;
+};
+
+static struct trace_pixmap *pixmaps;
+static uint32_t npixmaps;
+static struct trace_stat stats[TRACE_TYPES];
+
+static struct trace_pixmap *
+trace_pixmap(uint32_t id)
+{
+	if (!id || id >= npixmaps || !pixmaps[id].width)
+		return NULL;
+	return &pixmaps[id];
+}
+
+static int
+trace_pixmap_new(const uint32_t *data)
+{
+	uint32_t id = data[0];
+
+	if (!id)
+		return 0;
+
+	if (id >= npixmaps) {
+		uint32_t n = npixmaps ? npixmaps : 256;
+		void *p;
+
+		while (n <= id)
+			n *= 2;
+		p = realloc(pixmaps, n * sizeof(*pixmaps));
+		if (!p)
+			return -1;
+		pixmaps = p;
+		memset(&pixmaps[npixmaps], 0,
+		       (n - npixmaps) * sizeof(*pixmaps));
+		npixmaps = n;
+	}
+
+	memset(&pixmaps[id], 0, sizeof(pixmaps[id]));
+	pixmaps[id].width = data[1];
+	pixmaps[id].height = data[2];
+	pixmaps[id].depth = data[3];
+	pixmaps[id].bpp = data[4];
+	pixmaps[id].flags = data[6];
+	return 0;
+}
+
+/* Add up what a call covered and what it cost */
+static void
+trace_count(uint32_t type, const uint32_t *data, uint32_t len)
+{
+	struct trace_stat *stat = &stats[type];
+	struct trace_pixmap *pix;
+
+	stat->calls++;
+	stat->words += data[len - 3];
+	stat->kicks += data[len - 2];
+	stat->ns += data[len - 1];
+
+	switch (type) {
+	case TRACE_PREPARE_SOLID:
+	case TRACE_PREPARE_COPY:
+	case TRACE_PREPARE_COMPOSITE:
+		if (!data[len - 4])
+			stat->failed++;
+		break;
+	case TRACE_SOLID:
+		stat->pixels += (uint64_t)(int)(data[2] - data[0]) *
+				(int)(data[3] - data[1]);
+		break;
+	case TRACE_COPY:
+		stat->pixels += (uint64_t)data[4] * data[5];
+		break;
+	case TRACE_COMPOSITE:
+		stat->pixels += (uint64_t)data[6] * data[7];
+		break;
+	case TRACE_UPLOAD:
+	case TRACE_DOWNLOAD:
+		if (!data[len - 4])
+			stat->failed++;
+		stat->pixels += (uint64_t)data[3] * data[4];
+		pix = trace_pixmap(data[0]);
+		if (pix)
+			stat->bytes += (uint64_t)data[3] * data[4] * pix->bpp / 8;
+		break;
+	default:
+		break;
+	}
+}
+
+/* How long each kind of call record is, not counting pictures' transforms */
+static uint32_t
+trace_min_len(uint32_t type)
+{
+	switch (type) {
+	case TRACE_PIXMAP:            return 7;
+	case TRACE_FREE:              return 1;
+	case TRACE_PREPARE_SOLID:     return 5 + 3;
+	case TRACE_SOLID:             return 4 + 3;
+	case TRACE_PREPARE_COPY:      return 7 + 3;
+	case TRACE_COPY:              return 6 + 3;
+	case TRACE_PREPARE_COMPOSITE: return 1 + 3 * 3 + 1 + 3;
+	case TRACE_COMPOSITE:         return 8 + 3;
+	case TRACE_UPLOAD:            return 7 + 3;
+	case TRACE_DOWNLOAD:          return 7 + 3;
+	case TRACE_DONE_SOLID:
+	case TRACE_DONE_COPY:
+	case TRACE_DONE_COMPOSITE:    return 3;
+	default:
+		return ~0;
+	}
+}
+
+/* Whether a record is as long as its type and, for PREPARE_COMPOSITE,
+ * its pictures' flags say it should be
+ */
+static int
+trace_len_ok(uint32_t type, const uint32_t *data, uint32_t len)
+{
+	uint32_t want = 1;
+	int i;
+
+	if (len < trace_min_len(type))
+		return 0;
+	if (type != TRACE_PREPARE_COMPOSITE)
+		return 1;
+
+	for (i = 0; i < 3; i++) {
+		if (want + 3 > len)
+			return 0;
+		want += 3 + ((data[want + 2] & TRACE_PICT_TRANSFORM) ? 9 : 0);
+	}
+
+	return len == want + 1 + 3;
+}
+
+#ifdef HAVE_XRENDER
+static Display *dpy;
+static Window root;
+static GC gc;
+static Picture solid;
+static int xerrors;
+
+/* what the last successful Prepare set up */
+static struct {
+	uint32_t type;
+	struct trace_pixmap *src, *dst;
+	Picture psrc, pmask, pdst;
+	int op;
+} cur;
+
+static uint64_t
+trace_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int
+replay_error(Display *dpy, XErrorEvent *ev)
+{
+	xerrors++;
+	return 0;
+}
+
+/* Find the XRender format for a pixman/Render format code */
+static XRenderPictFormat *
+replay_format(uint32_t code)
+{
+	int bpp = code >> 24, type = (code >> 16) & 0xff;
+	int a = (code >> 12) & 0xf, r = (code >> 8) & 0xf;
+	int g = (code >> 4) & 0xf, b = code & 0xf;
+	XRenderPictFormat templ;
+	unsigned long mask = PictFormatType | PictFormatDepth |
+			     PictFormatRed | PictFormatRedMask |
+			     PictFormatGreen | PictFormatGreenMask |
+			     PictFormatBlue | PictFormatBlueMask |
+			     PictFormatAlpha | PictFormatAlphaMask;
+
+	memset(&templ, 0, sizeof(templ));
+	templ.type = PictTypeDirect;
+	templ.depth = a + r + g + b;
+	templ.direct.alphaMask = (1 << a) - 1;
+	templ.direct.redMask = (1 << r) - 1;
+	templ.direct.greenMask = (1 << g) - 1;
+	templ.direct.blueMask = (1 << b) - 1;
+
+	switch (type) {
+	case 1: /* A */
+		break;
+	case 2: /* ARGB */
+		templ.direct.green = b;
+		templ.direct.red = b + g;
+		templ.direct.alpha = b + g + r;
+		break;
+	case 3: /* ABGR */
+		templ.direct.green = r;
+		templ.direct.blue = r + g;
+		templ.direct.alpha = r + g + b;
+		break;
+	case 8: /* BGRA */
+		templ.direct.blue = bpp - b;
+		templ.direct.green = bpp - b - g;
+		templ.direct.red = bpp - b - g - r;
+		break;
+	case 9: /* RGBA */
+		templ.direct.red = bpp - r;
+		templ.direct.green = bpp - r - g;
+		templ.direct.blue = bpp - r - g - b;
+		break;
+	default:
+		return NULL;
+	}
+
+	/* Render doesn't count the x in x8r8g8b8 */
+	if (!a)
+		mask &= ~(PictFormatAlpha | PictFormatAlphaMask);
+
+	return XRenderFindFormat(dpy, mask, &templ, 0);
+}
+
+static int
+replay_depth_ok(int depth)
+{
+	int *depths, n, i, ok = 0;
+
+	depths = XListDepths(dpy, DefaultScreen(dpy), &n);
+	for (i = 0; depths && i < n; i++) {
+		if (depths[i] == depth)
+			ok = 1;
+	}
+	XFree(depths);
+	return ok || depth == 1;
+}
+
+static void
+replay_pixmap_new(struct trace_pixmap *pix)
+{
+	int scr = DefaultScreen(dpy);
+
+	pix->drawable = None;
+	pix->window = 0;
+	pix->picture = None;
+
+	if (pix->flags & TRACE_PIXMAP_SCREEN &&
+	    pix->depth == DefaultDepth(dpy, scr)) {
+		XSetWindowAttributes attr = { .override_redirect = True };
+
+		pix->drawable = XCreateWindow(dpy, root, 0, 0, pix->width,
+					      pix->height, 0, CopyFromParent,
+					      InputOutput, CopyFromParent,
+					      CWOverrideRedirect, &attr);
+		XMapWindow(dpy, pix->drawable);
+		pix->window = 1;
+		return;
+	}
+
+	if (replay_depth_ok(pix->depth)) {
+		pix->drawable = XCreatePixmap(dpy, root, pix->width,
+					      pix->height, pix->depth);
+	}
+}
+
+static void
+replay_pixmap_free(struct trace_pixmap *pix)
+{
+	if (pix->picture)
+		XRenderFreePicture(dpy, pix->picture);
+	if (pix->drawable && pix->window)
+		XDestroyWindow(dpy, pix->drawable);
+	else
+	if (pix->drawable)
+		XFreePixmap(dpy, pix->drawable);
+	pix->drawable = None;
+	pix->picture = None;
+}
+
+/* Picture for the n'th picture in a PREPARE_COMPOSITE, or None */
+static Picture
+replay_picture(const uint32_t **pdata, int required)
+{
+	const uint32_t *data = *pdata;
+	struct trace_pixmap *pix = trace_pixmap(data[0]);
+	uint32_t format = data[1], flags = data[2];
+	XRenderPictureAttributes attr;
+	XRenderPictFormat *fmt;
+	XTransform xform;
+	Picture pict;
+	int i;
+
+	*pdata += 3 + ((flags & TRACE_PICT_TRANSFORM) ? 9 : 0);
+
+	if (!format)
+		return required ? solid : None;
+	if (!pix)
+		return solid;
+	if (!pix->drawable)
+		return None;
+
+	if (!pix->picture || pix->format != format) {
+		fmt = replay_format(format);
+		if (!fmt || fmt->depth != pix->depth)
+			return None;
+		if (pix->picture)
+			XRenderFreePicture(dpy, pix->picture);
+		pix->picture = XRenderCreatePicture(dpy, pix->drawable, fmt,
+						    0, NULL);
+		pix->format = format;
+	}
+	pict = pix->picture;
+
+	attr.repeat = flags & 0xf ? (flags & 0xf) - 1 : RepeatNone;
+	attr.component_alpha = !!(flags & TRACE_PICT_CA);
+	XRenderChangePicture(dpy, pict, CPRepeat | CPComponentAlpha, &attr);
+
+	switch ((flags >> 4) & 0xf) {
+	case 0: XRenderSetPictureFilter(dpy, pict, FilterNearest, NULL, 0);
+		break;
+	case 1: XRenderSetPictureFilter(dpy, pict, FilterBilinear, NULL, 0);
+		break;
+	default:
+		break;
+	}
+
+	memset(&xform, 0, sizeof(xform));
+	for (i = 0; i < 3; i++)
+		xform.matrix[i][i] = XDoubleToFixed(1.0);
+	if (flags & TRACE_PICT_TRANSFORM) {
+		for (i = 0; i < 9; i++)
+			xform.matrix[i / 3][i % 3] = data[3 + i];
+	}
+	XRenderSetPictureTransform(dpy, pict, &xform);
+	return pict;
+}
+
+/* Issue the X request matching one call, returns 1 if it did */
+static int
+replay_call(uint32_t type, const uint32_t *data, uint32_t len)
+{
+	struct trace_pixmap *pix;
+	XImage *img;
+	char *buf;
+	int w, h;
+
+	switch (type) {
+	case TRACE_PREPARE_SOLID:
+		cur.type = 0;
+		cur.dst = trace_pixmap(data[0]);
+		if (!data[4] || !cur.dst || !cur.dst->drawable)
+			return 0;
+		XSetFunction(dpy, gc, data[1]);
+		XSetPlaneMask(dpy, gc, data[2]);
+		XSetForeground(dpy, gc, data[3]);
+		cur.type = type;
+		return 0;
+	case TRACE_SOLID:
+		if (cur.type != TRACE_PREPARE_SOLID)
+			return 0;
+		XFillRectangle(dpy, cur.dst->drawable, gc, (int)data[0],
+			       (int)data[1], (int)(data[2] - data[0]),
+			       (int)(data[3] - data[1]));
+		return 1;
+	case TRACE_PREPARE_COPY:
+		cur.type = 0;
+		cur.src = trace_pixmap(data[0]);
+		cur.dst = trace_pixmap(data[1]);
+		if (!data[6] || !cur.src || !cur.dst || !cur.src->drawable ||
+		    !cur.dst->drawable || cur.src->depth != cur.dst->depth)
+			return 0;
+		XSetFunction(dpy, gc, data[4]);
+		XSetPlaneMask(dpy, gc, data[5]);
+		cur.type = type;
+		return 0;
+	case TRACE_COPY:
+		if (cur.type != TRACE_PREPARE_COPY)
+			return 0;
+		XCopyArea(dpy, cur.src->drawable, cur.dst->drawable, gc,
+			  (int)data[0], (int)data[1], data[4], data[5],
+			  (int)data[2], (int)data[3]);
+		return 1;
+	case TRACE_PREPARE_COMPOSITE:
+		cur.type = 0;
+		if (!data[len - 4])
+			return 0;
+		cur.op = data[0];
+		data++;
+		cur.psrc = replay_picture(&data, 1);
+		cur.pmask = replay_picture(&data, 0);
+		cur.pdst = replay_picture(&data, 1);
+		if (!cur.psrc || !cur.pdst || cur.pdst == solid)
+			return 0;
+		cur.type = type;
+		return 0;
+	case TRACE_COMPOSITE:
+		if (cur.type != TRACE_PREPARE_COMPOSITE)
+			return 0;
+		XRenderComposite(dpy, cur.op, cur.psrc, cur.pmask, cur.pdst,
+				 (int)data[0], (int)data[1], (int)data[2],
+				 (int)data[3], (int)data[4], (int)data[5],
+				 data[6], data[7]);
+		return 1;
+	case TRACE_DONE_SOLID:
+	case TRACE_DONE_COPY:
+	case TRACE_DONE_COMPOSITE:
+		cur.type = 0;
+		XSetFunction(dpy, gc, GXcopy);
+		XSetPlaneMask(dpy, gc, AllPlanes);
+		return 0;
+	case TRACE_UPLOAD:
+		pix = trace_pixmap(data[0]);
+		w = data[3];
+		h = data[4];
+		if (!data[6] || !pix || !pix->drawable || !w || !h)
+			return 0;
+		buf = malloc((size_t)w * h * 4);
+		if (!buf)
+			return 0;
+		memset(buf, 0x5a, (size_t)w * h * 4);
+		img = XCreateImage(dpy, DefaultVisual(dpy, DefaultScreen(dpy)),
+				   pix->depth, ZPixmap, 0, buf, w, h, 32, 0);
+		if (!img) {
+			free(buf);
+			return 0;
+		}
+		XPutImage(dpy, pix->drawable, gc, img, 0, 0, (int)data[1],
+			  (int)data[2], w, h);
+		XDestroyImage(img);
+		return 1;
+	case TRACE_DOWNLOAD:
+		pix = trace_pixmap(data[0]);
+		if (!data[6] || !pix || !pix->drawable || !data[3] || !data[4])
+			return 0;
+		img = XGetImage(dpy, pix->drawable, (int)data[1], (int)data[2],
+				data[3], data[4], AllPlanes, ZPixmap);
+		if (img)
+			XDestroyImage(img);
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static int
+replay(const char *display, const uint32_t *words, size_t nwords, int sync,
+       unsigned *calls, uint64_t *ns)
+{
+	XRenderColor white = { 0xffff, 0xffff, 0xffff, 0xffff };
+	const uint32_t *data, *end = words + nwords;
+	uint64_t start, last;
+	uint32_t id;
+	int event, error;
+
+	dpy = XOpenDisplay(display);
+	if (!dpy) {
+		fprintf(stderr, "can't open display %s\n", XDisplayName(display));
+		return -1;
+	}
+
+	if (!XRenderQueryExtension(dpy, &event, &error)) {
+		fprintf(stderr, "%s has no Render extension\n",
+			XDisplayName(display));
+		XCloseDisplay(dpy);
+		return -1;
+	}
+
+	XSetErrorHandler(replay_error);
+	root = DefaultRootWindow(dpy);
+	gc = XCreateGC(dpy, root, 0, NULL);
+	solid = XRenderCreateSolidFill(dpy, &white);
+	memset(&cur, 0, sizeof(cur));
+	XSync(dpy, False);
+
+	*calls = 0;
+	start = last = trace_ns();
+
+	for (data = words; data + 2 <= end; data += 2 + data[1]) {
+		uint32_t type = data[0], len = data[1];
+
+		switch (type) {
+		case TRACE_PIXMAP:
+			id = data[2];
+			if (trace_pixmap_new(&data[2]) < 0)
+				return -1;
+			replay_pixmap_new(&pixmaps[id]);
+			break;
+		case TRACE_FREE:
+			if (trace_pixmap(data[2])) {
+				replay_pixmap_free(&pixmaps[data[2]]);
+				pixmaps[data[2]].width = 0;
+			}
+			break;
+		default:
+			if (!replay_call(type, data + 2, len))
+				break;
+			(*calls)++;
+			if (sync) {
+				uint64_t now;
+
+				XSync(dpy, False);
+				now = trace_ns();
+				stats[type].replay_ns += now - last;
+				last = now;
+			}
+			break;
+		}
+
+		if (sync)
+			last = trace_ns();
+	}
+
+	XSync(dpy, False);
+	*ns = trace_ns() - start;
+
+	for (id = 0; id < npixmaps; id++) {
+		if (pixmaps[id].width)
+			replay_pixmap_free(&pixmaps[id]);
+	}
+	XRenderFreePicture(dpy, solid);
+	XFreeGC(dpy, gc);
+	XCloseDisplay(dpy);
+	return 0;
+}
+
+static int
+trace_replay(const char *display, int count, int sync,
+	     const uint32_t *words, size_t nwords)
+{
+	int i;
+
+	printf("\nreplay,requests,wall_us\n");
+	for (i = 0; i < count; i++) {
+		unsigned calls;
+		uint64_t ns;
+
+		memset(pixmaps, 0, npixmaps * sizeof(*pixmaps));
+		if (replay(display, words, nwords, sync, &calls, &ns) < 0)
+			return -1;
+		printf("%d,%u,%llu\n", i, calls, (unsigned long long)ns / 1000);
+		fflush(stdout);
+	}
+
+	if (sync) {
+		printf("\nop,replay_us\n");
+		for (i = 0; i < TRACE_TYPES; i++) {
+			if (!stats[i].replay_ns)
+				continue;
+			printf("%s,%llu\n", trace_name[i],
+			       (unsigned long long)
+			       stats[i].replay_ns / 1000 / count);
+		}
+	}
+
+	if (xerrors)
+		fprintf(stderr, "%d X errors while replaying\n", xerrors);
+	return 0;
+}
+#else
+static int
+trace_replay(const char *display, int count, int sync,
+	     const uint32_t *words, size_t nwords)
+{
+	fprintf(stderr, "built without X, can't replay\n");
+	return -1;
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+	const char *display = NULL;
+	uint32_t head[3], *words = NULL, *data, *end;
+	size_t nwords = 0, size = 0;
+	int count = 1, sync = 0, replaying = 0, opt, i;
+	struct trace_stat total;
+	FILE *file;
+
+	while ((opt = getopt(argc, argv, "d:n:s")) != -1) {
+		switch (opt) {
+		case 'd': display = optarg; replaying = 1; break;
+		case 'n': count = atoi(optarg); replaying = 1; break;
+		case 's': sync = 1; replaying = 1; break;
+		default:
+			goto usage;
+		}
+	}
+
+	if (optind != argc - 1 || count < 1)
+		goto usage;
+
+	file = fopen(argv[optind], "rb");
+	if (!file) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	if (fread(head, 4, 3, file) != 3 || head[0] != TRACE_MAGIC ||
+	    head[1] != TRACE_VERSION) {
+		fprintf(stderr, "%s: not an acceleration trace\n",
+			argv[optind]);
+		return 1;
+	}
+
+	/* all of it, so reading it doesn't get in the way of replaying it */
+	for (;;) {
+		if (nwords == size) {
+			size = size ? size * 2 : 65536;
+			words = realloc(words, size * 4);
+			if (!words) {
+				fprintf(stderr, "out of memory\n");
+				return 1;
+			}
+		}
+
+		i = fread(words + nwords, 4, size - nwords, file);
+		if (i <= 0)
+			break;
+		nwords += i;
+	}
+	fclose(file);
+
+	/* drop a record cut short by the server going away */
+	end = words + nwords;
+	for (data = words; data + 2 <= end; data += 2 + data[1]) {
+		if (data + 2 + data[1] > end || data[0] >= TRACE_TYPES ||
+		    !trace_len_ok(data[0], &data[2], data[1]))
+			break;
+	}
+	if (data != end)
+		fprintf(stderr, "%s: truncated or corrupt at word %zu\n",
+			argv[optind], (size_t)(data - words) + 3);
+	nwords = data - words;
+
+	for (data = words; data < words + nwords; data += 2 + data[1]) {
+		if (data[0] == TRACE_PIXMAP) {
+			if (trace_pixmap_new(&data[2]) < 0)
+				return 1;
+		} else
+		if (data[0] != TRACE_FREE) {
+			trace_count(data[0], &data[2], data[1]);
+		}
+	}
+
+	printf("op,calls,failed,pixels,xfer_bytes,cmd_bytes,kicks,cpu_us\n");
+	memset(&total, 0, sizeof(total));
+	for (i = 0; i < TRACE_TYPES; i++) {
+		struct trace_stat *stat = &stats[i];
+
+		if (!trace_name[i])
+			continue;
+
+		printf("%s,%u,%u,%llu,%llu,%llu,%llu,%llu\n", trace_name[i],
+		       stat->calls, stat->failed,
+		       (unsigned long long)stat->pixels,
+		       (unsigned long long)stat->bytes,
+		       (unsigned long long)stat->words * 4,
+		       (unsigned long long)stat->kicks,
+		       (unsigned long long)stat->ns / 1000);
+
+		total.calls += stat->calls;
+		total.failed += stat->failed;
+		total.words += stat->words;
+		total.kicks += stat->kicks;
+		total.ns += stat->ns;
+	}
+	printf("total,%u,%u,,,%llu,%llu,%llu\n", total.calls, total.failed,
+	       (unsigned long long)total.words * 4,
+	       (unsigned long long)total.kicks,
+	       (unsigned long long)total.ns / 1000);
+
+	if (replaying && trace_replay(display, count, sync, words, nwords))
+		return 1;
+
+	free(words);
+	free(pixmaps);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-d display] [-n count] [-s] trace\n",
+		argv[0]);
+	return 1;
+}